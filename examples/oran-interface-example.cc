@@ -24,6 +24,7 @@
 
 #include "ns3/core-module.h"
 #include "ns3/oran-interface.h"
+#include "ns3/nr-indication-message-helper.h"
 #include "encode_e2apv1.hpp"
 #include <errno.h>
 
@@ -31,67 +32,42 @@
 using namespace ns3;
 
 Ptr<E2Termination> e2Term;
-// TODO create getters for these parameters in e2Term
 std::string plmId = "111";
 uint16_t cellId = 1;
 const std::string gnb = std::to_string (cellId);
 
 /**
-* Creates an empty RIC Report message and send it to the RIC
+* Dummy source of the DL throughput of a UE
 *
-* \param params the RIC Subscription Request parameters
+* \param imsi the IMSI of the UE
+* \return the throughput
 */
-static void BuildAndSendReportMessage (E2Termination::RicSubscriptionRequest_rval_s params)
+static double
+GetUeThroughput (const std::string &imsi)
 {
-  KpmIndicationHeader::KpmRicIndicationHeaderValues headerValues; 
-  headerValues.m_plmId = plmId;
-  headerValues.m_gnbId = cellId;
-  headerValues.m_nrCellId = cellId;
+  return 10.0;
+}
 
-  Ptr<KpmIndicationHeader> header = Create<KpmIndicationHeader> (KpmIndicationHeader::GlobalE2nodeType::gNB, headerValues);
-  
-  KpmIndicationMessage::KpmIndicationMessageValues msgValues;
-  
-  Ptr<OCuUpContainerValues> cuUpValues = Create<OCuUpContainerValues> ();
-  cuUpValues->m_plmId = plmId;
-  cuUpValues->m_pDCPBytesUL = 100;
-  cuUpValues->m_pDCPBytesDL = 100;
-  msgValues.m_pmContainerValues = cuUpValues;
-  
-  Ptr<MeasurementItemList> ue0DummyValues = Create<MeasurementItemList> ("UE-0");
-  ue0DummyValues->AddItem<long> ("DRB.PdcpSduVolumeDl_Filter.UEID", 6);
-  ue0DummyValues->AddItem<long> ("QosFlow.PdcpPduVolumeDL_Filter.UEID", 7);
-  ue0DummyValues->AddItem<long> ("Tot.PdcpSduNbrDl.UEID", 8);
-  ue0DummyValues->AddItem<long> ("DRB.PdcpPduNbrDl.Qos.UEID", 9);
-  ue0DummyValues->AddItem<double> ("DRB.IPThpDl.UEID", 10.0);
-  ue0DummyValues->AddItem<double> ("DRB.IPLateDl.UEID", 11.0);
-  msgValues.m_ueIndications.insert (ue0DummyValues);
- 
-  Ptr<MeasurementItemList> ue1DummyValues = Create<MeasurementItemList> ("UE-1");;
-  ue1DummyValues->AddItem<long> ("DRB.PdcpSduVolumeDl_Filter.UEID", 6);
-  ue1DummyValues->AddItem<long> ("QosFlow.PdcpPduVolumeDL_Filter.UEID", 7);
-  ue1DummyValues->AddItem<long> ("Tot.PdcpSduNbrDl.UEID", 8);
-  ue1DummyValues->AddItem<long> ("DRB.PdcpPduNbrDl.Qos.UEID", 9);
-  ue1DummyValues->AddItem<double> ("DRB.IPThpDl.UEID", 10.0);
-  ue1DummyValues->AddItem<double> ("DRB.IPLateDl.UEID", 11.0);
-  msgValues.m_ueIndications.insert (ue1DummyValues);
-  
-  Ptr<KpmIndicationMessage> msg = Create<KpmIndicationMessage> (msgValues);
-  
-  E2AP_PDU *pdu_cuup_ue = new E2AP_PDU;	
-  encoding::generate_e2apv1_indication_request_parameterized(pdu_cuup_ue, 
-                                                             params.requestorId,
-                                                             params.instanceId,
-                                                             params.ranFuncionId,
-                                                             params.actionId,
-                                                             1, // TODO sequence number  
-                                                             (uint8_t*) header->m_buffer, // buffer containing the encoded header
-                                                             header->m_size, // size of the encoded header
-                                                             (uint8_t*) msg->m_buffer, // buffer containing the encoded message
-                                                             msg->m_size); // size of the encoded message  
-  e2Term->SendE2Message (pdu_cuup_ue);
-  delete pdu_cuup_ue;
-  
+/**
+* Dummy source of the number of active UEs of the cell
+*
+* \return the number of active UEs
+*/
+static double
+GetActiveUes ()
+{
+  return 2;
+}
+
+/**
+* Dummy source of the UEs served by the cell
+*
+* \return the IMSIs of the UEs
+*/
+static std::vector<std::string>
+GetUes ()
+{
+  return {"111000000000001", "111000000000002"};
 }
 
 /**
@@ -109,24 +85,28 @@ static void KpmSubscriptionCallback (E2AP_PDU_t* sub_req_pdu)
   NS_LOG_UNCOND ("requestorId " << +params.requestorId << 
                  ", instanceId " << +params.instanceId << 
                  ", ranFuncionId " << +params.ranFuncionId << 
-                 ", actionId " << +params.actionId);  
-  
-  BuildAndSendReportMessage (params);
+                 ", actionId " << +params.actionId <<
+                 ", reportingPeriod " << params.reportingPeriod);  
+  // the subscription is now reported periodically from the providers of the helper
 }
 
 /**
-* RIC Control Message callback.
-* This function is triggered whenever a RIC Control Message is received.
+* Handover control handler.
+* This function is triggered once per simulation step with all the RC 
+* handover controls (style 3, action 1) received in the step.
 *
-* \param pdu request message
+* \param controls the decoded controls
 */
 static void
-RicControlMessageCallback (E2AP_PDU_t *ric_ctrl_pdu)
+HandoverControlHandler (const std::vector<Ptr<RicControlMessage>> &controls)
 {
-  NS_LOG_UNCOND ("\n\nReceived RIC Control Message");
+  NS_LOG_UNCOND ("\n\nReceived " << controls.size () << " handover controls");
 
-  RicControlMessage msg = RicControlMessage (ric_ctrl_pdu);
-  // TODO log something
+  for (const Ptr<RicControlMessage> &msg : controls)
+    {
+      NS_LOG_UNCOND ("UE " << msg->GetUeId () << ", target cell " << msg->GetTargetCell ()
+                           << ", " << msg->GetRanParameters ().size () << " RAN parameters");
+    }
 }
 
 
@@ -136,10 +116,18 @@ main (int argc, char *argv[])
   LogComponentEnable ("Asn1Types", LOG_LEVEL_ALL);
   LogComponentEnable ("RicControlMessage", LOG_LEVEL_ALL);
   e2Term = CreateObject<E2Termination> ("10.244.0.191", 36422, 38472, gnb, plmId);
+  // the reports of the subscriptions are built from the metric providers
+  Ptr<NrIndicationMessageHelper> helper = CreateObject<NrIndicationMessageHelper> (
+      IndicationMessageHelper::IndicationMessageType::gNB, false, false);
+  helper->RegisterUeMetricProvider ("DRB.UEThpDl.UEID", MakeCallback (&GetUeThroughput));
+  helper->RegisterCellMetricProvider ("numActiveUes", MakeCallback (&GetActiveUes));
+  helper->SetUeListProvider (MakeCallback (&GetUes));
+  helper->InstallReports (e2Term, cellId);
   Ptr<KpmFunctionDescription> kpmFd = Create<KpmFunctionDescription> ();
   e2Term->RegisterKpmCallbackToE2Sm (200, kpmFd, &KpmSubscriptionCallback);    
   Ptr<RicControlFunctionDescription> rcFd = Create<RicControlFunctionDescription> ();
-  e2Term->RegisterSmCallbackToE2Sm (300, rcFd, &RicControlMessageCallback);
+  e2Term->RegisterControlFunctionToE2Sm (300, rcFd);
+  e2Term->RegisterControlHandler (300, 3, 1, MakeCallback (&HandoverControlHandler));
 
   return 0;
 }
@@ -0,0 +1,190 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Northeastern University
+ * Copyright (c) 2022 Sapienza, University of Rome
+ * Copyright (c) 2022 University of Padova
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrea Lacava <thecave003@gmail.com>
+ *		   Tommaso Zugno <tommasozugno@gmail.com>
+ *		   Michele Polese <michele.polese@gmail.com>
+ */
+
+#include "ns3/core-module.h"
+#include "ns3/oran-interface.h"
+#include "ns3/rc-handover-decoder.h"
+#include <chrono>
+
+using namespace ns3;
+
+static std::vector<uint8_t>
+Encode (const asn_TYPE_descriptor_t *type, void *structure)
+{
+  asn_encode_to_new_buffer_result_t res =
+      asn_encode_to_new_buffer (nullptr, ATS_ALIGNED_BASIC_PER, type, structure);
+  NS_ABORT_MSG_IF (res.buffer == nullptr, "Cannot encode " << type->name);
+  std::vector<uint8_t> encoded ((uint8_t *) res.buffer,
+                                (uint8_t *) res.buffer + res.result.encoded);
+  free (res.buffer);
+  ASN_STRUCT_FREE (*type, structure);
+  return encoded;
+}
+
+static std::vector<uint8_t>
+EncodeHandoverHeader (uint32_t f1apId)
+{
+  auto *header = (E2SM_RC_ControlHeader_t *) calloc (1, sizeof (E2SM_RC_ControlHeader_t));
+  auto *format1 =
+      (E2SM_RC_ControlHeader_Format1_t *) calloc (1, sizeof (E2SM_RC_ControlHeader_Format1_t));
+  header->ric_controlHeader_formats.present =
+      E2SM_RC_ControlHeader__ric_controlHeader_formats_PR_controlHeader_Format1;
+  header->ric_controlHeader_formats.choice.controlHeader_Format1 = format1;
+  format1->ric_Style_Type = 3; // connected mode mobility
+  format1->ric_ControlAction_ID = 1; // handover
+
+  auto *ue = (UEID_GNB_t *) calloc (1, sizeof (UEID_GNB_t));
+  format1->ueID.present = UEID_PR_gNB_UEID;
+  format1->ueID.choice.gNB_UEID = ue;
+  asn_ulong2INTEGER (&ue->amf_UE_NGAP_ID, f1apId);
+  const uint8_t plmn[3] = {0x00, 0xf1, 0x10};
+  OCTET_STRING_fromBuf (&ue->guami.pLMNIdentity, (const char *) plmn, sizeof (plmn));
+  BIT_STRING_t *amfIds[3] = {&ue->guami.aMFRegionID, &ue->guami.aMFSetID, &ue->guami.aMFPointer};
+  const int amfIdBits[3] = {8, 10, 6};
+  for (int i = 0; i < 3; i++)
+    {
+      amfIds[i]->size = (amfIdBits[i] + 7) / 8;
+      amfIds[i]->buf = (uint8_t *) calloc (amfIds[i]->size, 1);
+      amfIds[i]->bits_unused = amfIds[i]->size * 8 - amfIdBits[i];
+    }
+  ue->gNB_CU_UE_F1AP_ID_List =
+      (UEID_GNB_CU_F1AP_ID_List_t *) calloc (1, sizeof (UEID_GNB_CU_F1AP_ID_List_t));
+  auto *item = (UEID_GNB_CU_CP_F1AP_ID_Item_t *) calloc (1, sizeof (UEID_GNB_CU_CP_F1AP_ID_Item_t));
+  item->gNB_CU_UE_F1AP_ID = f1apId;
+  ASN_SEQUENCE_ADD (&ue->gNB_CU_UE_F1AP_ID_List->list, item);
+
+  return Encode (&asn_DEF_E2SM_RC_ControlHeader, header);
+}
+
+static std::vector<uint8_t>
+EncodeHandoverMessage (uint16_t targetCell)
+{
+  // NR CGI of the target cell, with the cell ID in the last nibble
+  auto *value = (RANParameter_Value_t *) calloc (1, sizeof (RANParameter_Value_t));
+  value->present = RANParameter_Value_PR_valueOctS;
+  const uint8_t nrCgi[5] = {0x00, 0x00, 0x00, 0x01, (uint8_t) (0x20 | (targetCell & 0x0F))};
+  OCTET_STRING_fromBuf (&value->choice.valueOctS, (const char *) nrCgi, sizeof (nrCgi));
+
+  auto *valueType = (RANParameter_ValueType_t *) calloc (1, sizeof (RANParameter_ValueType_t));
+  valueType->present = RANParameter_ValueType_PR_ranP_Choice_ElementFalse;
+  valueType->choice.ranP_Choice_ElementFalse = (RANParameter_ValueType_Choice_ElementFalse_t *)
+      calloc (1, sizeof (RANParameter_ValueType_Choice_ElementFalse_t));
+  valueType->choice.ranP_Choice_ElementFalse->ranParameter_value = value;
+
+  // NR CGI (4) in NR Cell (3) in CHOICE Target Cell (2) in Target Primary Cell ID (1)
+  for (long id = 4; id > 1; id--)
+    {
+      auto *item =
+          (RANParameter_STRUCTURE_Item_t *) calloc (1, sizeof (RANParameter_STRUCTURE_Item_t));
+      item->ranParameter_ID = id;
+      item->ranParameter_valueType = valueType;
+      auto *structure = (RANParameter_STRUCTURE_t *) calloc (1, sizeof (RANParameter_STRUCTURE_t));
+      structure->sequence_of_ranParameters =
+          (decltype (structure->sequence_of_ranParameters)) calloc (
+              1, sizeof (*structure->sequence_of_ranParameters));
+      ASN_SEQUENCE_ADD (&structure->sequence_of_ranParameters->list, item);
+
+      valueType = (RANParameter_ValueType_t *) calloc (1, sizeof (RANParameter_ValueType_t));
+      valueType->present = RANParameter_ValueType_PR_ranP_Choice_Structure;
+      valueType->choice.ranP_Choice_Structure = (RANParameter_ValueType_Choice_Structure_t *)
+          calloc (1, sizeof (RANParameter_ValueType_Choice_Structure_t));
+      valueType->choice.ranP_Choice_Structure->ranParameter_Structure = structure;
+    }
+
+  auto *message = (E2SM_RC_ControlMessage_t *) calloc (1, sizeof (E2SM_RC_ControlMessage_t));
+  auto *format1 =
+      (E2SM_RC_ControlMessage_Format1_t *) calloc (1, sizeof (E2SM_RC_ControlMessage_Format1_t));
+  message->ric_controlMessage_formats.present =
+      E2SM_RC_ControlMessage__ric_controlMessage_formats_PR_controlMessage_Format1;
+  message->ric_controlMessage_formats.choice.controlMessage_Format1 = format1;
+  auto *item = (E2SM_RC_ControlMessage_Format1_Item_t *) calloc (
+      1, sizeof (E2SM_RC_ControlMessage_Format1_Item_t));
+  item->ranParameter_ID = 1;
+  item->ranParameter_valueType = *valueType;
+  free (valueType);
+  ASN_SEQUENCE_ADD (&format1->ranP_List.list, item);
+
+  return Encode (&asn_DEF_E2SM_RC_ControlMessage, message);
+}
+
+/**
+* Throughput of the specialized handover decoder against the asn1c decoder,
+* on the RIC Control Header and Message of a handover control
+*/
+int
+main (int argc, char *argv[])
+{
+  uint32_t iterations = 1000000;
+
+  CommandLine cmd (__FILE__);
+  cmd.AddValue ("iterations", "Number of header and message pairs decoded by each decoder",
+                iterations);
+  cmd.Parse (argc, argv);
+
+  std::vector<uint8_t> header = EncodeHandoverHeader (42);
+  std::vector<uint8_t> message = EncodeHandoverMessage (7);
+
+  RcHandoverDecoder::ControlHeader fastHeader;
+  RcHandoverDecoder::HandoverMessage fastMessage;
+  NS_ABORT_MSG_UNLESS (
+      RcHandoverDecoder::DecodeControlHeader (header.data (), header.size (), fastHeader) &&
+          RcHandoverDecoder::DecodeHandoverMessage (message.data (), message.size (), fastMessage),
+      "The handover control is not accepted by the specialized decoder");
+
+  uint64_t checksum = 0;
+  auto start = std::chrono::steady_clock::now ();
+  for (uint32_t i = 0; i < iterations; i++)
+    {
+      RcHandoverDecoder::DecodeControlHeader (header.data (), header.size (), fastHeader);
+      RcHandoverDecoder::DecodeHandoverMessage (message.data (), message.size (), fastMessage);
+      checksum += fastHeader.ueId + fastMessage.bytes[fastMessage.size - 1];
+    }
+  double fastSeconds =
+      std::chrono::duration<double> (std::chrono::steady_clock::now () - start).count ();
+
+  start = std::chrono::steady_clock::now ();
+  for (uint32_t i = 0; i < iterations; i++)
+    {
+      E2SM_RC_ControlHeader_t *genericHeader = nullptr;
+      E2SM_RC_ControlMessage_t *genericMessage = nullptr;
+      asn_decode (nullptr, ATS_ALIGNED_BASIC_PER, &asn_DEF_E2SM_RC_ControlHeader,
+                  (void **) &genericHeader, header.data (), header.size ());
+      asn_decode (nullptr, ATS_ALIGNED_BASIC_PER, &asn_DEF_E2SM_RC_ControlMessage,
+                  (void **) &genericMessage, message.data (), message.size ());
+      checksum += genericHeader->ric_controlHeader_formats.choice.controlHeader_Format1
+                      ->ric_ControlAction_ID;
+      ASN_STRUCT_FREE (asn_DEF_E2SM_RC_ControlHeader, genericHeader);
+      ASN_STRUCT_FREE (asn_DEF_E2SM_RC_ControlMessage, genericMessage);
+    }
+  double genericSeconds =
+      std::chrono::duration<double> (std::chrono::steady_clock::now () - start).count ();
+
+  std::cout << "Handover control of " << header.size () << " + " << message.size ()
+            << " bytes, checksum " << checksum << std::endl;
+  std::cout << "specialized: " << iterations / fastSeconds << " controls/s" << std::endl;
+  std::cout << "asn1c:       " << iterations / genericSeconds << " controls/s" << std::endl;
+  std::cout << "speedup:     " << genericSeconds / fastSeconds << "x" << std::endl;
+
+  return 0;
+}
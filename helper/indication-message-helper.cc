@@ -24,13 +24,14 @@
 
 #include <ns3/indication-message-helper.h>
 #include "ns3/log.h"
+#include <algorithm>
 
 namespace ns3 {
 NS_LOG_COMPONENT_DEFINE("IndicationMessageHelper");
 
 IndicationMessageHelper::IndicationMessageHelper (IndicationMessageType type, bool isOffline,
                                                   bool reducedPmValues)
-    : m_type (type), m_offline (isOffline), m_reducedPmValues (reducedPmValues)
+    : m_type (type), m_offline (isOffline), m_reducedPmValues (reducedPmValues), m_headerValues ()
 {
 
   if (!m_offline)
@@ -75,6 +76,249 @@ IndicationMessageHelper::CreateIndicationMessage (const std::string &targetType)
   return Create<KpmIndicationMessage> (m_msgValues, format_type);
 }
 
+std::vector<Ptr<KpmIndicationMessage>>
+IndicationMessageHelper::CreateUeIndicationMessages ()
+{
+  return KpmIndicationMessage::CreateFormat2Pages (m_msgValues);
+}
+
+/**
+* \return the metrics of the schema matching the names or the measurement IDs
+*/
+static std::vector<uint32_t>
+SelectMetrics (Ptr<const KpiSchema> schema, const std::vector<std::string> &measNames,
+               const std::vector<uint32_t> &measIds)
+{
+  std::vector<uint32_t> selection;
+  for (uint32_t metric = 0; metric < schema->GetMetricCount (); metric++)
+    {
+      bool byName = std::find (measNames.begin (), measNames.end (), schema->GetName (metric)) !=
+                    measNames.end ();
+      bool byId = schema->GetMeasId (metric) != 0 &&
+                  std::find (measIds.begin (), measIds.end (), schema->GetMeasId (metric)) !=
+                      measIds.end ();
+      if (byName || byId)
+        {
+          selection.push_back (metric);
+        }
+    }
+  return selection;
+}
+
+void
+IndicationMessageHelper::SetSubscribedMetrics (const std::vector<std::string> &measNames,
+                                               const std::vector<uint32_t> &measIds)
+{
+  NS_LOG_FUNCTION (this << measNames.size () << measIds.size ());
+  if (measNames.empty () && measIds.empty ())
+    {
+      // an action without measurements is served with the full report
+      ClearSubscription ();
+      return;
+    }
+
+  m_msgValues.m_subscribedMetricsOnly = true;
+  if (m_msgValues.m_ueTable)
+    {
+      m_msgValues.m_ueMetrics =
+          SelectMetrics (m_msgValues.m_ueTable->GetSchema (), measNames, measIds);
+    }
+  if (m_msgValues.m_cellTable)
+    {
+      m_msgValues.m_cellMetrics =
+          SelectMetrics (m_msgValues.m_cellTable->GetSchema (), measNames, measIds);
+    }
+  m_msgValues.m_encodeMeasId = measNames.empty ();
+  NS_LOG_DEBUG ("Subscribed to " << m_msgValues.m_ueMetrics.size () << " UE metrics and "
+                                 << m_msgValues.m_cellMetrics.size () << " cell metrics");
+}
+
+void
+IndicationMessageHelper::SetSubscription (
+    const E2Termination::RicSubscriptionRequest_rval_s &subscription)
+{
+  NS_LOG_FUNCTION (this << subscription.requestorId << subscription.instanceId);
+  SetSubscribedMetrics (subscription.measNames, subscription.measIds);
+  if (subscription.granularityPeriod > 0)
+    {
+      SetGranularityPeriod (subscription.granularityPeriod);
+    }
+}
+
+void
+IndicationMessageHelper::ClearSubscription ()
+{
+  m_msgValues.m_subscribedMetricsOnly = false;
+  m_msgValues.m_ueMetrics.clear ();
+  m_msgValues.m_cellMetrics.clear ();
+}
+
+bool
+IndicationMessageHelper::IsSelected (uint32_t metric, bool subscribedOnly,
+                                     const std::vector<uint32_t> &selection)
+{
+  return !subscribedOnly ||
+         std::find (selection.begin (), selection.end (), metric) != selection.end ();
+}
+
+bool
+IndicationMessageHelper::IsSubscribed (const std::string &measName) const
+{
+  if (m_msgValues.m_ueTable)
+    {
+      int32_t metric = m_msgValues.m_ueTable->GetSchema ()->FindMetric (measName);
+      if (metric >= 0 && IsSelected (metric, m_msgValues.m_subscribedMetricsOnly,
+                                     m_msgValues.m_ueMetrics))
+        {
+          return true;
+        }
+    }
+  if (m_msgValues.m_cellTable)
+    {
+      int32_t metric = m_msgValues.m_cellTable->GetSchema ()->FindMetric (measName);
+      if (metric >= 0 && IsSelected (metric, m_msgValues.m_subscribedMetricsOnly,
+                                     m_msgValues.m_cellMetrics))
+        {
+          return true;
+        }
+    }
+  return false;
+}
+
+void
+IndicationMessageHelper::RegisterUeMetricProvider (const std::string &measName,
+                                                   UeMetricProvider provider)
+{
+  NS_ABORT_MSG_IF (!m_msgValues.m_ueTable, "No UE metrics in this helper");
+  int32_t metric = m_msgValues.m_ueTable->GetSchema ()->FindMetric (measName);
+  NS_ABORT_MSG_IF (metric < 0, "Unknown UE metric " << measName);
+  m_ueProviders[metric] = provider;
+}
+
+void
+IndicationMessageHelper::RegisterCellMetricProvider (const std::string &measName,
+                                                     CellMetricProvider provider)
+{
+  NS_ABORT_MSG_IF (!m_msgValues.m_cellTable, "No cell metrics in this helper");
+  int32_t metric = m_msgValues.m_cellTable->GetSchema ()->FindMetric (measName);
+  NS_ABORT_MSG_IF (metric < 0, "Unknown cell metric " << measName);
+  m_cellProviders[metric] = provider;
+}
+
+void
+IndicationMessageHelper::AddUeFromProviders (const std::string &ueImsiComplete)
+{
+  NS_ABORT_MSG_IF (!m_msgValues.m_ueTable, "No UE metrics in this helper");
+  uint32_t row = m_msgValues.m_ueTable->AppendRow (ueImsiComplete).GetRow ();
+  int32_t ueIdMetric = m_msgValues.m_ueTable->GetSchema ()->FindMetric ("UEID");
+  if (ueIdMetric >= 0 && m_ueProviders.find (ueIdMetric) == m_ueProviders.end () &&
+      IsSelected (ueIdMetric, m_msgValues.m_subscribedMetricsOnly, m_msgValues.m_ueMetrics))
+    {
+      m_msgValues.m_ueTable->SetInteger (ueIdMetric, row, std::stoll (ueImsiComplete));
+    }
+  for (auto &entry : m_ueProviders)
+    {
+      // metrics out of the subscription are never computed
+      if (IsSelected (entry.first, m_msgValues.m_subscribedMetricsOnly, m_msgValues.m_ueMetrics))
+        {
+          m_msgValues.m_ueTable->SetReal (entry.first, row, entry.second (ueImsiComplete));
+        }
+    }
+}
+
+void
+IndicationMessageHelper::UpdateCellFromProviders (long cellId)
+{
+  NS_ABORT_MSG_IF (!m_msgValues.m_cellTable, "No cell metrics in this helper");
+  m_msgValues.m_cellTable->Clear ();
+  uint32_t row = m_msgValues.m_cellTable->AppendRow (std::to_string (cellId)).GetRow ();
+  int32_t cellIdMetric = m_msgValues.m_cellTable->GetSchema ()->FindMetric ("cellID");
+  if (cellIdMetric >= 0 && m_cellProviders.find (cellIdMetric) == m_cellProviders.end () &&
+      IsSelected (cellIdMetric, m_msgValues.m_subscribedMetricsOnly, m_msgValues.m_cellMetrics))
+    {
+      m_msgValues.m_cellTable->SetInteger (cellIdMetric, row, cellId);
+    }
+  for (auto &entry : m_cellProviders)
+    {
+      if (IsSelected (entry.first, m_msgValues.m_subscribedMetricsOnly,
+                      m_msgValues.m_cellMetrics))
+        {
+          m_msgValues.m_cellTable->SetReal (entry.first, row, entry.second ());
+        }
+    }
+}
+
+void
+IndicationMessageHelper::SetUeListProvider (UeListProvider provider)
+{
+  m_ueListProvider = provider;
+}
+
+void
+IndicationMessageHelper::SetReportHeader (
+    const KpmIndicationHeader::KpmRicIndicationHeaderValues &values)
+{
+  m_headerValues = values;
+}
+
+std::vector<E2ReportScheduler::Report>
+IndicationMessageHelper::BuildReports (
+    const E2Termination::RicSubscriptionRequest_rval_s &subscription)
+{
+  NS_LOG_FUNCTION (this << subscription.requestorId << subscription.instanceId);
+  SetSubscription (subscription);
+  // the collection start time is taken when the header is built
+  m_headerValues.m_timestamp = 0;
+  Ptr<KpmIndicationHeader> header = Create<KpmIndicationHeader> (
+      m_type == IndicationMessageType::eNB ? KpmIndicationHeader::eNB : KpmIndicationHeader::gNB,
+      m_headerValues);
+
+  std::vector<E2ReportScheduler::Report> reports;
+  // E2SM-KPM style 1: E2 node measurements
+  bool cellReport = subscription.ricStyleType == -1 || subscription.ricStyleType == 1;
+  bool ueReport = subscription.ricStyleType != 1;
+  if (cellReport && !m_cellProviders.empty ())
+    {
+      UpdateCellFromProviders (m_headerValues.m_nrCellId);
+      reports.push_back ({header, CreateIndicationMessage ("cell")});
+    }
+  if (ueReport && !m_ueProviders.empty () && !m_ueListProvider.IsNull ())
+    {
+      m_msgValues.m_ueTable->Clear ();
+      for (const std::string &imsi : m_ueListProvider ())
+        {
+          AddUeFromProviders (imsi);
+        }
+      for (Ptr<KpmIndicationMessage> page : CreateUeIndicationMessages ())
+        {
+          reports.push_back ({header, page});
+        }
+    }
+  return reports;
+}
+
+void
+IndicationMessageHelper::InstallReports (Ptr<E2Termination> termination, uint16_t cellId)
+{
+  NS_LOG_FUNCTION (this << termination << cellId);
+  KpmIndicationHeader::KpmRicIndicationHeaderValues values;
+  values.m_gnbId = termination->GetGnbId ();
+  values.m_plmId = termination->GetPlmnId ();
+  values.m_nrCellId = cellId;
+  values.m_timestamp = 0;
+  SetReportHeader (values);
+
+  Ptr<E2ReportScheduler> scheduler = termination->GetReportScheduler ();
+  if (!scheduler)
+    {
+      scheduler = CreateObject<E2ReportScheduler> ();
+      termination->SetReportScheduler (scheduler);
+    }
+  // the scheduler keeps the helper alive until it is disposed
+  scheduler->SetReportCallback (
+      MakeCallback (&IndicationMessageHelper::BuildReports, Ptr<IndicationMessageHelper> (this)));
+}
+
 
 
 } // namespace ns3
\ No newline at end of file
@@ -26,6 +26,10 @@
 #define INDICATION_MESSAGE_HELPER_H
 
 #include <ns3/kpm-indication.h>
+#include <ns3/oran-interface.h>
+#include <ns3/e2-report-scheduler.h>
+#include <ns3/callback.h>
+#include <map>
 
 namespace ns3 {
 
@@ -33,22 +37,199 @@ class IndicationMessageHelper : public Object
 {
 public:
   enum class IndicationMessageType {eNB =0, gNB =1}; 
+
+  /**
+  * Source of a UE metric, called with the IMSI of the UE
+  */
+  typedef Callback<double, const std::string &> UeMetricProvider;
+
+  /**
+  * Source of a cell metric
+  */
+  typedef Callback<double> CellMetricProvider;
+
+  /**
+  * Source of the IMSIs of the UEs served in the current reporting tick
+  */
+  typedef Callback<std::vector<std::string>> UeListProvider;
+
   IndicationMessageHelper (IndicationMessageType type, bool isOffline, bool reducedPmValues);
   ~IndicationMessageHelper ();
   // update 1029
   Ptr<KpmIndicationMessage> CreateIndicationMessage (const std::string &targetType = "ue");
 
+  /**
+  * Create the Format 2 UE report, split into pages within the budget set
+  * by SetFormat2Budget. The pages are to be sent in order.
+  *
+  * \return the pages, none if there is no UE
+  */
+  std::vector<Ptr<KpmIndicationMessage>> CreateUeIndicationMessages ();
+
   bool const &
   IsOffline () const
   {
     return m_offline;
   }
 
+  /**
+  * Identify the metrics of the indication messages by measurement ID
+  * instead of measurement name, if the subscription allows it
+  *
+  * \param encodeMeasId true to encode the measurement IDs
+  */
+  void
+  SetEncodeMeasId (bool encodeMeasId)
+  {
+    m_msgValues.m_encodeMeasId = encodeMeasId;
+  }
+
+  /**
+  * \param granularityPeriod the granularity period of the measurements in ms
+  */
+  void
+  SetGranularityPeriod (uint32_t granularityPeriod)
+  {
+    m_msgValues.m_granularityPeriod = granularityPeriod;
+  }
+
+  /**
+  * Budget of each page of the Format 2 UE reports
+  *
+  * \param maxBytes the estimated encoded size of a page, 0 for no limit
+  * \param maxUes the number of UEs of a page, 0 for no limit
+  */
+  void
+  SetFormat2Budget (uint32_t maxBytes, uint32_t maxUes)
+  {
+    m_msgValues.m_maxFormat2Bytes = maxBytes;
+    m_msgValues.m_maxFormat2Ues = maxUes;
+  }
+
+  /**
+  * Restrict the indication messages to the metrics requested by a RIC
+  * subscription. The metrics are matched by name, or by measurement ID;
+  * if the request identified them only by ID, the reports do as well.
+  *
+  * \param measNames the requested measurement names
+  * \param measIds the requested measurement IDs
+  */
+  void SetSubscribedMetrics (const std::vector<std::string> &measNames,
+                             const std::vector<uint32_t> &measIds);
+
+  /**
+  * Restrict the indication messages to the metrics of a RIC subscription,
+  * as returned by E2Termination::ProcessRicSubscriptionRequest or passed
+  * to the report callback of the E2ReportScheduler, and report them with
+  * its granularity period. Only the subscribed metrics are then pulled
+  * from the providers.
+  *
+  * \param subscription the parameters of the RIC subscription
+  */
+  void SetSubscription (const E2Termination::RicSubscriptionRequest_rval_s &subscription);
+
+  /**
+  * Report all the metrics again
+  */
+  void ClearSubscription ();
+
+  /**
+  * \param measName a measurement name
+  * \return true if the metric is reported by the indication messages
+  */
+  bool IsSubscribed (const std::string &measName) const;
+
+  /**
+  * Register the source of a UE metric, evaluated by AddUeFromProviders
+  * only while a subscription references the metric
+  *
+  * \param measName the measurement name, in the UE schema of the helper
+  * \param provider the source of the metric
+  */
+  void RegisterUeMetricProvider (const std::string &measName, UeMetricProvider provider);
+
+  /**
+  * Register the source of a cell metric, evaluated by
+  * UpdateCellFromProviders only while a subscription references the metric
+  *
+  * \param measName the measurement name, in the cell schema of the helper
+  * \param provider the source of the metric
+  */
+  void RegisterCellMetricProvider (const std::string &measName, CellMetricProvider provider);
+
+  /**
+  * Add a UE to the report, pulling the subscribed metrics from the
+  * registered providers. The other metrics are left to zero. The UEID
+  * metric, if in the schema and without provider, is the IMSI.
+  *
+  * \param ueImsiComplete the IMSI of the UE
+  */
+  void AddUeFromProviders (const std::string &ueImsiComplete);
+
+  /**
+  * Replace the cell values of the report, pulling the subscribed metrics
+  * from the registered providers. The cellID metric, if in the schema and
+  * without provider, is the cell ID.
+  *
+  * \param cellId the cell ID
+  */
+  void UpdateCellFromProviders (long cellId);
+
+  /**
+  * Set the UEs reported by BuildReports
+  *
+  * \param provider the source of the IMSIs of the UEs
+  */
+  void SetUeListProvider (UeListProvider provider);
+
+  /**
+  * Set the identity of the E2 node in the headers of the reports built by
+  * BuildReports. The NR cell ID is also the cell of the cell reports.
+  *
+  * \param values the header values
+  */
+  void SetReportHeader (const KpmIndicationHeader::KpmRicIndicationHeaderValues &values);
+
+  /**
+  * Build the reports of a RIC subscription from the registered providers,
+  * restricted to the metrics of the subscription: a cell report for the
+  * E2 node measurements (E2SM-KPM style 1), the pages of a UE report for
+  * the other styles, and both if the subscription has no action
+  * definition. A report without provider is left out.
+  *
+  * \param subscription the parameters of the RIC subscription
+  * \return the reports of the subscription
+  */
+  std::vector<E2ReportScheduler::Report>
+  BuildReports (const E2Termination::RicSubscriptionRequest_rval_s &subscription);
+
+  /**
+  * Report the RIC subscriptions of a termination from the providers of
+  * this helper, with no report callback of the user. The headers carry the
+  * gNB and PLMN IDs of the termination and the cell ID. A report scheduler
+  * is set on the termination if it has none, and BuildReports becomes its
+  * report callback.
+  *
+  * \param termination the termination
+  * \param cellId the cell reported
+  */
+  void InstallReports (Ptr<E2Termination> termination, uint16_t cellId);
+
 protected:
+  /**
+  * \return true if the metric of the schema is reported
+  */
+  static bool IsSelected (uint32_t metric, bool subscribedOnly,
+                          const std::vector<uint32_t> &selection);
+
   IndicationMessageType m_type;
   bool m_offline;
   bool m_reducedPmValues;
   KpmIndicationMessage::KpmIndicationMessageValues m_msgValues;
+  std::map<uint32_t, UeMetricProvider> m_ueProviders; //!< providers, by metric of the UE schema
+  std::map<uint32_t, CellMetricProvider> m_cellProviders; //!< providers, by metric of the cell schema
+  UeListProvider m_ueListProvider; //!< UEs of the reports built by BuildReports
+  KpmIndicationHeader::KpmRicIndicationHeaderValues m_headerValues; //!< header of the reports
 };
 
 } // namespace ns3
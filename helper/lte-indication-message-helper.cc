@@ -24,6 +24,7 @@
 
 
 #include <ns3/lte-indication-message-helper.h>
+#include <ns3/kpm-metric-registry.h>
 
 namespace ns3 {
 
@@ -33,6 +34,10 @@ LteIndicationMessageHelper::LteIndicationMessageHelper (IndicationMessageType ty
 {
   NS_ABORT_MSG_IF (type == IndicationMessageType::gNB,
                    "Wrong type for LTE Indication Message, expected eNB");
+  m_msgValues.m_ueTable = Create<KpiTable> (
+      KpmMetricRegistry::Get ().GetSchema (KpmMetricRegistry::UE_LTE));
+  m_msgValues.m_cellTable = Create<KpiTable> (
+      KpmMetricRegistry::Get ().GetSchema (KpmMetricRegistry::CELL_LTE));
 }
 
 // update user plan measurements 
@@ -42,36 +47,33 @@ LteIndicationMessageHelper::AddeNBUePmItem (std::string ueImsiComplete, long txB
                                              double pdcpLatency,  long numDrb,
                                              long drbRelAct)
 {
-  Ptr<MeasurementItemList> ueVal = Create<MeasurementItemList> (ueImsiComplete);
   long ueImsiLong = std::stoll(ueImsiComplete);
-    ueVal->AddItem<long> ("UEID", ueImsiLong);
-    ueVal->AddItem<long> ("DRB.PdcpSduVolumeDl_Filter.UEID", txBytes);
-    ueVal->AddItem<long> ("Tot.PdcpSduNbrDl.UEID", txDlPackets);
-    ueVal->AddItem<double> ("DRB.PdcpSduBitRateDl.UEID", pdcpThroughput);
-    ueVal->AddItem<double> ("DRB.PdcpSduDelayDl.UEID", pdcpLatency);
-    ueVal->AddItem<long> ("DRB.EstabSucc.5QI.UEID", numDrb);
-    ueVal->AddItem<long> ("DRB.RelActNbr.5QI.UEID", drbRelAct); // not modeled in the simulator
 
-
-  m_msgValues.m_ueIndications.insert (ueVal);
+  // values in the order of the UE_LTE metric group
+  m_msgValues.m_ueTable->AppendRow (ueImsiComplete)
+      .Put (ueImsiLong)
+      .Put (txBytes)
+      .Put (txDlPackets)
+      .Put (pdcpThroughput)
+      .Put (pdcpLatency)
+      .Put (numDrb)
+      .Put (drbRelAct); // drbRelAct is not modeled in the simulator
 }
 
 
 void
 LteIndicationMessageHelper::AddeNBCellPmItem (long cellid, double cellAverageLatency, long pdcpBytesUl, long pdcpBytesDl, uint16_t numActiveUes)
 {
-    Ptr<MeasurementItemList> cellVal = Create<MeasurementItemList> ();
-  
-    cellVal->AddItem<long> ("cellID", cellid);
-    cellVal->AddItem<double> ("DRB.PdcpSduDelayDl", cellAverageLatency);
-    cellVal->AddItem<double> ("pdcpBytesUl", pdcpBytesUl);
-    cellVal->AddItem<double> ("pdcpBytesDl", pdcpBytesDl);
-    cellVal->AddItem<double> ("numActiveUes", numActiveUes);
-    m_msgValues.m_cellMeasurementItems = cellVal;
-
-
-    
+  // values in the order of the CELL_LTE metric group
+  m_msgValues.m_cellTable->Clear ();
+  m_msgValues.m_cellTable->AppendRow (std::to_string (cellid))
+      .Put (cellid)
+      .Put (cellAverageLatency)
+      .Put (pdcpBytesUl)
+      .Put (pdcpBytesDl)
+      .Put (numActiveUes);
 }
+
 LteIndicationMessageHelper::~LteIndicationMessageHelper ()
 {
 }
@@ -36,10 +36,22 @@ public:
 
   ~LteIndicationMessageHelper ();
 
+  /**
+  * Add a UE to the report with all the metrics of the UE_LTE group,
+  * computed by the caller. To compute only the metrics of the RIC
+  * subscription, register their sources with RegisterUeMetricProvider and
+  * add the UE with AddUeFromProviders instead.
+  */
   void AddeNBUePmItem (std::string ueImsiComplete, long txBytes,
                                              long txDlPackets, double pdcpThroughput,
                                              double pdcpLatency,  long numDrb,
                                              long drbRelAct);
+
+  /**
+  * Replace the cell values of the report with all the metrics of the
+  * CELL_LTE group, computed by the caller. UpdateCellFromProviders computes
+  * only the subscribed ones.
+  */
   void AddeNBCellPmItem (long cellid,double cellAverageLatency, long pdcpBytesUl, long pdcpBytesDl, uint16_t numActiveUes);
 
 private:
@@ -25,15 +25,48 @@
  */
 
 #include <ns3/nr-indication-message-helper.h>
+#include <ns3/kpm-metric-registry.h>
 
 namespace ns3 {
 
+static Ptr<const KpiSchema>
+GetNrUeSchema ()
+{
+  return KpmMetricRegistry::Get ().GetSchema (KpmMetricRegistry::UE_GNB);
+}
+
+static Ptr<const KpiSchema>
+BuildReducedNrCellSchema ()
+{
+  Ptr<const KpiSchema> full = KpmMetricRegistry::Get ().GetSchema (KpmMetricRegistry::CELL_GNB);
+  Ptr<KpiSchema> schema = Create<KpiSchema> ();
+  for (uint32_t metric = 0; metric < full->GetMetricCount (); metric++)
+    {
+      const std::string &name = full->GetName (metric);
+      if (name != "TB.TotNbrDl.1" && name != "TB.TotNbrDlInitial")
+        {
+          schema->AddMetric (name, full->GetType (metric), full->GetMeasId (metric));
+        }
+    }
+  return schema;
+}
+
+static Ptr<const KpiSchema>
+GetNrCellSchema (bool reducedPmValues)
+{
+  static Ptr<const KpiSchema> nrCellSchemaReduced = BuildReducedNrCellSchema ();
+  return reducedPmValues ? nrCellSchemaReduced
+                         : KpmMetricRegistry::Get ().GetSchema (KpmMetricRegistry::CELL_GNB);
+}
+
 NrIndicationMessageHelper::NrIndicationMessageHelper (IndicationMessageType type,
                                                               bool isOffline, bool reducedPmValues)
     : IndicationMessageHelper (type, isOffline, reducedPmValues)
 {
     NS_ABORT_MSG_IF (type == IndicationMessageType::eNB,
                    "Wrong type for NR Indication Message, expected gNB");
+    m_msgValues.m_ueTable = Create<KpiTable> (GetNrUeSchema ());
+    m_msgValues.m_cellTable = Create<KpiTable> (GetNrCellSchema (reducedPmValues));
 }
 
 
@@ -62,65 +95,65 @@ NrIndicationMessageHelper::AddgNBUeItem (std::string ueImsiComplete, long numDrb
                                                 double sinrNeigCell8, double convertedSinrNeigCell8,  uint16_t IDNeigCell8   
                                               )
 {
-  Ptr<MeasurementItemList> ueVal = Create<MeasurementItemList> (ueImsiComplete);
-    long ueImsiLong = std::stoll(ueImsiComplete);
+  long ueImsiLong = std::stoll(ueImsiComplete);
 
-    ueVal->AddItem<long> ("UEID", ueImsiLong);
-    ueVal->AddItem<long> ("DRB.EstabSucc.5QI.UEID", numDrb);
-    ueVal->AddItem<long> ("DRB.RelActNbr.5QI.UEID", drbRelAct); // not modeled in the simulator
-    ueVal->AddItem<long> ("QosFlow.PdcpPduVolumeDL_Filter.UEID", txPdcpPduBytesNrRlc);
-    ueVal->AddItem<long> ("DRB.PdcpPduNbrDl.Qos.UEID", txPdcpPduNrRlc);
-    ueVal->AddItem<long> ("TB.TotNbrDl.1.UEID", macPduUe);
-    ueVal->AddItem<long> ("TB.TotNbrDlInitial.UEID", macPduInitialUe);
-    ueVal->AddItem<long> ("TB.TotNbrDlInitial.Qpsk.UEID", macQpsk);
-    ueVal->AddItem<long> ("TB.TotNbrDlInitial.16Qam.UEID", mac16Qam);
-    ueVal->AddItem<long> ("TB.TotNbrDlInitial.64Qam.UEID", mac64Qam);
-    ueVal->AddItem<long> ("TB.ErrTotalNbrDl.1.UEID", macRetx);
-    ueVal->AddItem<long> ("QosFlow.PdcpPduVolumeDL_Filter.UEID", macVolume);
-    ueVal->AddItem<long> ("RRU.PrbUsedDl.UEID", (long) std::ceil (macPrb));
-    ueVal->AddItem<long> ("CARR.PDSCHMCSDist.Bin1.UEID", macMac04);
-    ueVal->AddItem<long> ("CARR.PDSCHMCSDist.Bin2.UEID", macMac59);
-    ueVal->AddItem<long> ("CARR.PDSCHMCSDist.Bin3.UEID", macMac1014);
-    ueVal->AddItem<long> ("CARR.PDSCHMCSDist.Bin4.UEID", macMac1519);
-    ueVal->AddItem<long> ("CARR.PDSCHMCSDist.Bin5.UEID", macMac2024);
-    ueVal->AddItem<long> ("CARR.PDSCHMCSDist.Bin6.UEID", macMac2529);
-    ueVal->AddItem<long> ("L1M.RS-SINR.Bin34.UEID", macSinrBin1);
-    ueVal->AddItem<long> ("L1M.RS-SINR.Bin46.UEID", macSinrBin2);
-    ueVal->AddItem<long> ("L1M.RS-SINR.Bin58.UEID", macSinrBin3);
-    ueVal->AddItem<long> ("L1M.RS-SINR.Bin70.UEID", macSinrBin4);
-    ueVal->AddItem<long> ("L1M.RS-SINR.Bin82.UEID", macSinrBin5);
-    ueVal->AddItem<long> ("L1M.RS-SINR.Bin94.UEID", macSinrBin6);
-    ueVal->AddItem<long> ("L1M.RS-SINR.Bin127.UEID", macSinrBin7);
-    ueVal->AddItem<long> ("DRB.BufferSize.Qos.UEID", rlcBufferOccup);
-    ueVal->AddItem<double> ("HO.SrcCellQual.RS-SINR.UEID", sinrServCell);
-    ueVal->AddItem<double> ("HO.SrcCellQual.RS-SINR-Converted.UEID", convertedSinrServCell);
-    ueVal->AddItem<long> ("HO.SrcCellID.UEID", IDServCell);
-    ueVal->AddItem<double> ("HO.TrgtCellQual.1.RS-SINR.UEID", sinrNeigCell1);
-    ueVal->AddItem<double> ("HO.TrgtCellQual.1.RS-SINR-Converted.UEID", convertedSinrNeigCell1);
-    ueVal->AddItem<long> ("HO.TrgtCellQual.1.UEID", IDNeigCell1);
-    ueVal->AddItem<double> ("HO.TrgtCellQual.2.RS-SINR.UEID", sinrNeigCell2);
-    ueVal->AddItem<double> ("HO.TrgtCellQual.2.RS-SINR-Converted.UEID", convertedSinrNeigCell2);
-    ueVal->AddItem<long> ("HO.TrgtCellQual.2.UEID", IDNeigCell2);
-    ueVal->AddItem<double> ("HO.TrgtCellQual.3.RS-SINR.UEID", sinrNeigCell3);
-    ueVal->AddItem<double> ("HO.TrgtCellQual.3.RS-SINR-Converted.UEID", convertedSinrNeigCell3);
-    ueVal->AddItem<long> ("HO.TrgtCellQual.3.UEID", IDNeigCell3);
-    ueVal->AddItem<double> ("HO.TrgtCellQual.4.RS-SINR.UEID", sinrNeigCell4);
-    ueVal->AddItem<double> ("HO.TrgtCellQual.4.RS-SINR-Converted.UEID", convertedSinrNeigCell4);
-    ueVal->AddItem<long> ("HO.TrgtCellQual.4.UEID", IDNeigCell4);
-    ueVal->AddItem<double> ("HO.TrgtCellQual.5.RS-SINR.UEID", sinrNeigCell5);
-    ueVal->AddItem<double> ("HO.TrgtCellQual.5.RS-SINR-Converted.UEID", convertedSinrNeigCell5);
-    ueVal->AddItem<long> ("HO.TrgtCellQual.5.UEID", IDNeigCell5);
-    ueVal->AddItem<double> ("HO.TrgtCellQual.6.RS-SINR.UEID", sinrNeigCell6);
-    ueVal->AddItem<double> ("HO.TrgtCellQual.6.RS-SINR-Converted.UEID", convertedSinrNeigCell6);
-    ueVal->AddItem<long> ("HO.TrgtCellQual.6.UEID", IDNeigCell6);
-    ueVal->AddItem<double> ("HO.TrgtCellQual.7.RS-SINR.UEID", sinrNeigCell7);
-    ueVal->AddItem<double> ("HO.TrgtCellQual.7.RS-SINR-Converted.UEID", convertedSinrNeigCell7);
-    ueVal->AddItem<long> ("HO.TrgtCellQual.7.UEID", IDNeigCell7);
-    ueVal->AddItem<double> ("HO.TrgtCellQual.8.RS-SINR.UEID", sinrNeigCell8);
-    ueVal->AddItem<double> ("HO.TrgtCellQual.8.RS-SINR-Converted.UEID", convertedSinrNeigCell8);
-    ueVal->AddItem<long> ("HO.TrgtCellQual.8.UEID", IDNeigCell8);
-    ueVal->AddItem<double> ("DRB.UEThpDl.UEID", drbThrDlUeid);
-    m_msgValues.m_ueIndications.insert (ueVal);
+  // values in the order of GetNrUeSchema
+  m_msgValues.m_ueTable->AppendRow (ueImsiComplete)
+      .Put (ueImsiLong)
+      .Put (numDrb)
+      .Put (drbRelAct)
+      .Put (txPdcpPduBytesNrRlc)
+      .Put (txPdcpPduNrRlc)
+      .Put (macPduUe)
+      .Put (macPduInitialUe)
+      .Put (macQpsk)
+      .Put (mac16Qam)
+      .Put (mac64Qam)
+      .Put (macRetx)
+      .Put (macVolume)
+      .Put ((long) std::ceil (macPrb))
+      .Put (macMac04)
+      .Put (macMac59)
+      .Put (macMac1014)
+      .Put (macMac1519)
+      .Put (macMac2024)
+      .Put (macMac2529)
+      .Put (macSinrBin1)
+      .Put (macSinrBin2)
+      .Put (macSinrBin3)
+      .Put (macSinrBin4)
+      .Put (macSinrBin5)
+      .Put (macSinrBin6)
+      .Put (macSinrBin7)
+      .Put (rlcBufferOccup)
+      .Put (sinrServCell)
+      .Put (convertedSinrServCell)
+      .Put (IDServCell)
+      .Put (sinrNeigCell1)
+      .Put (convertedSinrNeigCell1)
+      .Put (IDNeigCell1)
+      .Put (sinrNeigCell2)
+      .Put (convertedSinrNeigCell2)
+      .Put (IDNeigCell2)
+      .Put (sinrNeigCell3)
+      .Put (convertedSinrNeigCell3)
+      .Put (IDNeigCell3)
+      .Put (sinrNeigCell4)
+      .Put (convertedSinrNeigCell4)
+      .Put (IDNeigCell4)
+      .Put (sinrNeigCell5)
+      .Put (convertedSinrNeigCell5)
+      .Put (IDNeigCell5)
+      .Put (sinrNeigCell6)
+      .Put (convertedSinrNeigCell6)
+      .Put (IDNeigCell6)
+      .Put (sinrNeigCell7)
+      .Put (convertedSinrNeigCell7)
+      .Put (IDNeigCell7)
+      .Put (sinrNeigCell8)
+      .Put (convertedSinrNeigCell8)
+      .Put (IDNeigCell8)
+      .Put (drbThrDlUeid);
 }
 
 void
@@ -136,50 +169,45 @@ NrIndicationMessageHelper::AddgNBCellItem (long cellid, uint16_t numActiveUes,
     long dlAvailablePrbs, long ulAvailablePrbs, long qci,
     long dlPrbUsage, long ulPrbUsage)
 {
-  Ptr<MeasurementItemList> cellVal = Create<MeasurementItemList> ();
-      cellVal->AddItem<long> ("cellID", cellid);
-
-    if (!m_reducedPmValues)
+  // values in the order of GetNrCellSchema
+  m_msgValues.m_cellTable->Clear ();
+  KpiTable::RowWriter cell = m_msgValues.m_cellTable->AppendRow (std::to_string (cellid));
+  cell.Put (cellid);
+  if (!m_reducedPmValues)
     {
-      cellVal->AddItem<long> ("TB.TotNbrDl.1", macPduCellSpecific);
-      cellVal->AddItem<long> ("TB.TotNbrDlInitial", macPduInitialCellSpecific);
+      cell.Put (macPduCellSpecific);
+      cell.Put (macPduInitialCellSpecific);
     }
-
-
-  cellVal->AddItem<long> ("numActiveUes", numActiveUes);
-  cellVal->AddItem<long> ("TB.TotNbrDlInitial.Qpsk", macQpskCellSpecific);
-  cellVal->AddItem<long> ("TB.TotNbrDlInitial.16Qam", mac16QamCellSpecific);
-  cellVal->AddItem<long> ("TB.TotNbrDlInitial.64Qam", mac64QamCellSpecific);
-  cellVal->AddItem<long> ("RRU.PrbUsedDl", (long) std::ceil (prbUtilizationDl));
-  cellVal->AddItem<long> ("TB.ErrTotalNbrDl.1", macRetxCellSpecific);
-  cellVal->AddItem<long> ("QosFlow.PdcpPduVolumeDL_Filter", macVolumeCellSpecific);
-  cellVal->AddItem<long> ("CARR.PDSCHMCSDist.Bin1", macMac04CellSpecific);
-  cellVal->AddItem<long> ("CARR.PDSCHMCSDist.Bin2", macMac59CellSpecific);
-  cellVal->AddItem<long> ("CARR.PDSCHMCSDist.Bin3", macMac1014CellSpecific);
-  cellVal->AddItem<long> ("CARR.PDSCHMCSDist.Bin4", macMac1519CellSpecific);
-  cellVal->AddItem<long> ("CARR.PDSCHMCSDist.Bin5", macMac2024CellSpecific);
-  cellVal->AddItem<long> ("CARR.PDSCHMCSDist.Bin6", macMac2529CellSpecific);
-  cellVal->AddItem<long> ("L1M.RS-SINR.Bin34", macSinrBin1CellSpecific);
-  cellVal->AddItem<long> ("L1M.RS-SINR.Bin46", macSinrBin2CellSpecific);
-  cellVal->AddItem<long> ("L1M.RS-SINR.Bin58", macSinrBin3CellSpecific);
-  cellVal->AddItem<long> ("L1M.RS-SINR.Bin70", macSinrBin4CellSpecific);
-  cellVal->AddItem<long> ("L1M.RS-SINR.Bin82", macSinrBin5CellSpecific);
-  cellVal->AddItem<long> ("L1M.RS-SINR.Bin94", macSinrBin6CellSpecific);
-  cellVal->AddItem<long> ("L1M.RS-SINR.Bin127", macSinrBin7CellSpecific);
-  cellVal->AddItem<long> ("DRB.BufferSize.Qos", rlcBufferOccupCellSpecific);
-  cellVal->AddItem<long> ("DRB.MeanActiveUeDl",activeUeDl);
-
-  cellVal->AddItem<long> ("PRB.AvailableDl",dlAvailablePrbs);
-  cellVal->AddItem<long> ("RRB.AvailablePUl",ulAvailablePrbs);
-  cellVal->AddItem<long> ("DRB.QCI",qci);
-  cellVal->AddItem<long> ("RRB.UseageDl",dlPrbUsage);
-  cellVal->AddItem<long> ("RRB.UseageUl",ulPrbUsage);
-
-  m_msgValues.m_cellMeasurementItems = cellVal;
-
+  cell.Put (numActiveUes);
+  cell.Put (macQpskCellSpecific);
+  cell.Put (mac16QamCellSpecific);
+  cell.Put (mac64QamCellSpecific);
+  cell.Put ((long) std::ceil (prbUtilizationDl));
+  cell.Put (macRetxCellSpecific);
+  cell.Put (macVolumeCellSpecific);
+  cell.Put (macMac04CellSpecific);
+  cell.Put (macMac59CellSpecific);
+  cell.Put (macMac1014CellSpecific);
+  cell.Put (macMac1519CellSpecific);
+  cell.Put (macMac2024CellSpecific);
+  cell.Put (macMac2529CellSpecific);
+  cell.Put (macSinrBin1CellSpecific);
+  cell.Put (macSinrBin2CellSpecific);
+  cell.Put (macSinrBin3CellSpecific);
+  cell.Put (macSinrBin4CellSpecific);
+  cell.Put (macSinrBin5CellSpecific);
+  cell.Put (macSinrBin6CellSpecific);
+  cell.Put (macSinrBin7CellSpecific);
+  cell.Put (rlcBufferOccupCellSpecific);
+  cell.Put (activeUeDl);
+  cell.Put (dlAvailablePrbs);
+  cell.Put (ulAvailablePrbs);
+  cell.Put (qci);
+  cell.Put (dlPrbUsage);
+  cell.Put (ulPrbUsage);
 }
 
-NrIndicationMessageHelper::~MmWaveIndicationMessageHelper ()
+NrIndicationMessageHelper::~NrIndicationMessageHelper ()
 {
 }
 
@@ -35,7 +35,13 @@ public:
   NrIndicationMessageHelper (IndicationMessageType type, bool isOffline, bool reducedPmValues);
 
   ~NrIndicationMessageHelper ();
-  
+
+  /**
+  * Add a UE to the report with all the metrics of the UE_GNB group,
+  * computed by the caller. To compute only the metrics of the RIC
+  * subscription, register their sources with RegisterUeMetricProvider and
+  * add the UE with AddUeFromProviders instead.
+  */
   void AddgNBUeItem (std::string ueImsiComplete, long numDrb,
                                                 long drbRelAct,
                                                 long txPdcpPduBytesNrRlc, long txPdcpPduNrRlc, 
@@ -57,6 +63,11 @@ public:
                                                 double sinrNeigCell7, double convertedSinrNeigCell7,  uint16_t IDNeigCell7,   
                                                 double sinrNeigCell8, double convertedSinrNeigCell8,  uint16_t IDNeigCell8);
 
+  /**
+  * Replace the cell values of the report with all the metrics of the
+  * CELL_GNB group, computed by the caller. UpdateCellFromProviders computes
+  * only the subscribed ones.
+  */
   void AddgNBCellItem (long cellid, uint16_t numActiveUes,
     long macPduCellSpecific, long macPduInitialCellSpecific, long macQpskCellSpecific,
     long mac16QamCellSpecific, long mac64QamCellSpecific, double prbUtilizationDl,
@@ -0,0 +1,144 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Northeastern University
+ * Copyright (c) 2022 Sapienza, University of Rome
+ * Copyright (c) 2022 University of Padova
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrea Lacava <thecave003@gmail.com>
+ *		   Tommaso Zugno <tommasozugno@gmail.com>
+ *		   Michele Polese <michele.polese@gmail.com>
+ */
+
+
+#include <ns3/asn-struct-pool.h>
+#include <ns3/log.h>
+#include <ns3/abort.h>
+#include <algorithm>
+#include <stdlib.h>
+
+extern "C" {
+  #include "E2AP-PDU.h"
+  #include "E2SM-RC-ControlHeader.h"
+  #include "E2SM-RC-ControlMessage.h"
+  #include "E2SM-KPM-IndicationHeader.h"
+}
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("AsnStructPool");
+
+AsnStructPool::AsnStructPool (const asn_TYPE_descriptor_t *type, size_t structSize,
+                              size_t capacity)
+  : m_type (type),
+    m_structSize (structSize),
+    m_capacity (capacity)
+{
+  m_idle.reserve (m_capacity);
+}
+
+AsnStructPool::~AsnStructPool ()
+{
+  // the idle structures have been reset, only the top level is left
+  for (void *structure : m_idle)
+    {
+      free (structure);
+    }
+  m_idle.clear ();
+}
+
+void *
+AsnStructPool::Acquire ()
+{
+  std::unique_lock<std::mutex> lock (m_mutex);
+  m_stats.acquired++;
+  if (!m_idle.empty ())
+    {
+      void *structure = m_idle.back ();
+      m_idle.pop_back ();
+      m_stats.reused++;
+      m_stats.idle = m_idle.size ();
+      return structure;
+    }
+  lock.unlock ();
+
+  void *structure = calloc (1, m_structSize);
+  NS_ABORT_MSG_IF (structure == nullptr, "Memory exhausted while allocating a " << m_type->name);
+  return structure;
+}
+
+void
+AsnStructPool::Release (void *structure)
+{
+  if (structure == nullptr)
+    {
+      return;
+    }
+
+  // the members are freed outside of the lock
+  ASN_STRUCT_RESET (*m_type, structure);
+
+  std::unique_lock<std::mutex> lock (m_mutex);
+  m_stats.released++;
+  if (m_idle.size () < m_capacity)
+    {
+      m_idle.push_back (structure);
+      m_stats.idle = m_idle.size ();
+      m_stats.peakIdle = std::max (m_stats.peakIdle, m_stats.idle);
+      return;
+    }
+  m_stats.discarded++;
+  lock.unlock ();
+  NS_LOG_LOGIC ("Pool of " << m_type->name << " full, structure freed");
+  free (structure);
+}
+
+AsnStructPool::Stats
+AsnStructPool::GetStats () const
+{
+  std::unique_lock<std::mutex> lock (m_mutex);
+  return m_stats;
+}
+
+AsnStructPool &
+AsnStructPool::GetE2apPduPool ()
+{
+  static AsnStructPool pool (&asn_DEF_E2AP_PDU, sizeof (E2AP_PDU_t));
+  return pool;
+}
+
+AsnStructPool &
+AsnStructPool::GetRcControlHeaderPool ()
+{
+  static AsnStructPool pool (&asn_DEF_E2SM_RC_ControlHeader, sizeof (E2SM_RC_ControlHeader_t));
+  return pool;
+}
+
+AsnStructPool &
+AsnStructPool::GetRcControlMessagePool ()
+{
+  static AsnStructPool pool (&asn_DEF_E2SM_RC_ControlMessage, sizeof (E2SM_RC_ControlMessage_t));
+  return pool;
+}
+
+AsnStructPool &
+AsnStructPool::GetKpmIndicationHeaderPool ()
+{
+  static AsnStructPool pool (&asn_DEF_E2SM_KPM_IndicationHeader,
+                             sizeof (E2SM_KPM_IndicationHeader_t));
+  return pool;
+}
+
+} // namespace ns3
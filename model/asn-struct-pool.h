@@ -0,0 +1,123 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Northeastern University
+ * Copyright (c) 2022 Sapienza, University of Rome
+ * Copyright (c) 2022 University of Padova
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrea Lacava <thecave003@gmail.com>
+ *		   Tommaso Zugno <tommasozugno@gmail.com>
+ *		   Michele Polese <michele.polese@gmail.com>
+ */
+
+
+#ifndef ASN_STRUCT_POOL_H
+#define ASN_STRUCT_POOL_H
+
+#include <mutex>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+extern "C" {
+  #include "asn_application.h"
+}
+
+namespace ns3 {
+
+  /**
+  * Thread-safe pool of top-level asn1c structures of one type. Released
+  * structures are emptied with ASN_STRUCT_RESET, which frees their members
+  * and zeroes them, and kept for the next Acquire instead of going back to
+  * the allocator. Any structure of the type allocated with malloc or calloc
+  * can be released to the pool, not only those acquired from it.
+  */
+  class AsnStructPool
+  {
+  public:
+    /**
+    * Occupancy of the pool
+    */
+    struct Stats
+    {
+      uint64_t acquired = 0; //!< structures handed out
+      uint64_t reused = 0; //!< structures handed out from the idle ones
+      uint64_t released = 0; //!< structures given back
+      uint64_t discarded = 0; //!< structures freed since the pool was full
+      size_t idle = 0; //!< structures waiting in the pool
+      size_t peakIdle = 0; //!< maximum number of idle structures
+    };
+
+    /**
+    * \param type the asn1c descriptor of the structures
+    * \param structSize the size of the structures
+    * \param capacity maximum number of idle structures kept by the pool
+    */
+    AsnStructPool (const asn_TYPE_descriptor_t *type, size_t structSize, size_t capacity = 256);
+    ~AsnStructPool ();
+
+    /**
+    * \return a zeroed structure
+    */
+    void *Acquire ();
+
+    template <class T>
+    T *
+    Acquire ()
+    {
+      return static_cast<T *> (Acquire ());
+    }
+
+    /**
+    * Empty a structure and keep it for reuse. The members are freed as
+    * ASN_STRUCT_FREE would do.
+    *
+    * \param structure the structure, ignored if nullptr
+    */
+    void Release (void *structure);
+
+    Stats GetStats () const;
+
+    /**
+    * \return the pool of the E2AP PDUs sent and received by the E2 terminations
+    */
+    static AsnStructPool &GetE2apPduPool ();
+
+    /**
+    * \return the pool of the E2SM-RC control headers decoded by RicControlMessage
+    */
+    static AsnStructPool &GetRcControlHeaderPool ();
+
+    /**
+    * \return the pool of the E2SM-RC control messages decoded by RicControlMessage
+    */
+    static AsnStructPool &GetRcControlMessagePool ();
+
+    /**
+    * \return the pool of the E2SM-KPM indication headers
+    */
+    static AsnStructPool &GetKpmIndicationHeaderPool ();
+
+  private:
+    const asn_TYPE_descriptor_t *m_type;
+    size_t m_structSize;
+    size_t m_capacity;
+    mutable std::mutex m_mutex;
+    std::vector<void *> m_idle; //!< emptied structures, ready for reuse
+    Stats m_stats;
+  };
+}
+
+#endif /* ASN_STRUCT_POOL_H */
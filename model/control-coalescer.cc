@@ -0,0 +1,171 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Northeastern University
+ * Copyright (c) 2022 Sapienza, University of Rome
+ * Copyright (c) 2022 University of Padova
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrea Lacava <thecave003@gmail.com>
+ *		   Tommaso Zugno <tommasozugno@gmail.com>
+ *		   Michele Polese <michele.polese@gmail.com>
+ */
+
+#include <ns3/control-coalescer.h>
+#include <ns3/log.h>
+#include <algorithm>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("ControlCoalescer");
+
+ControlCoalescer::ControlCoalescer ()
+  : m_window (Seconds (0)),
+    m_ueRate (0),
+    m_ueBurst (1),
+    m_globalRate (0),
+    m_globalBurst (1),
+    m_globalBucket ({1, Seconds (0)})
+{
+}
+
+void
+ControlCoalescer::SetWindow (Time window)
+{
+  m_window = window;
+}
+
+void
+ControlCoalescer::SetUeRateLimit (double rate, double burst)
+{
+  m_ueRate = rate;
+  m_ueBurst = std::max (burst, 1.0);
+  m_ueBuckets.clear ();
+}
+
+void
+ControlCoalescer::SetGlobalRateLimit (double rate, double burst)
+{
+  m_globalRate = rate;
+  m_globalBurst = std::max (burst, 1.0);
+  m_globalBucket = {m_globalBurst, Seconds (0)};
+}
+
+Ptr<RicControlMessage>
+ControlCoalescer::Add (long ranFunctionId, Ptr<RicControlMessage> control, Time now)
+{
+  m_stats.received++;
+  Key key (ranFunctionId, control->GetUeId (), control->GetControlStyle (),
+           control->GetControlActionId ());
+  auto it = m_index.find (key);
+  if (it != m_index.end ())
+    {
+      // the window of the first control is kept, so that a stream of
+      // controls cannot postpone the application forever
+      NS_LOG_LOGIC ("Control for UE " << control->GetUeId () << " replaces a pending one");
+      Ptr<RicControlMessage> replaced = it->second->released.control;
+      it->second->released.control = control;
+      m_stats.merged++;
+      return replaced;
+    }
+  m_pending.push_back ({key, {ranFunctionId, control}, now + m_window});
+  m_index.emplace (key, std::prev (m_pending.end ()));
+  return nullptr;
+}
+
+void
+ControlCoalescer::Release (Time now, std::vector<Released> &out, std::vector<Released> *dropped)
+{
+  // the window is the same for all the controls, so the deadlines follow
+  // the order of arrival
+  while (!m_pending.empty () && m_pending.front ().deadline <= now)
+    {
+      Pending &pending = m_pending.front ();
+      if (Admit (std::get<1> (pending.key), now))
+        {
+          out.push_back (pending.released);
+          m_stats.released++;
+        }
+      else
+        {
+          NS_LOG_WARN ("Rate limit exceeded, control for UE " << std::get<1> (pending.key)
+                                                              << " dropped");
+          m_stats.dropped++;
+          if (dropped != nullptr)
+            {
+              dropped->push_back (pending.released);
+            }
+        }
+      m_index.erase (pending.key);
+      m_pending.pop_front ();
+    }
+}
+
+bool
+ControlCoalescer::HasPending () const
+{
+  return !m_pending.empty ();
+}
+
+Time
+ControlCoalescer::GetNextRelease () const
+{
+  NS_ABORT_MSG_IF (m_pending.empty (), "No pending control");
+  return m_pending.front ().deadline;
+}
+
+ControlCoalescer::Stats
+ControlCoalescer::GetStats () const
+{
+  return m_stats;
+}
+
+void
+ControlCoalescer::Refill (TokenBucket &bucket, double rate, double burst, Time now)
+{
+  bucket.tokens = std::min (burst, bucket.tokens + rate * (now - bucket.last).GetSeconds ());
+  bucket.last = now;
+}
+
+bool
+ControlCoalescer::Admit (uint64_t ueId, Time now)
+{
+  // a token is taken only if both buckets admit the control
+  TokenBucket *ueBucket = nullptr;
+  if (m_ueRate > 0)
+    {
+      ueBucket = &m_ueBuckets.emplace (ueId, TokenBucket{m_ueBurst, now}).first->second;
+      Refill (*ueBucket, m_ueRate, m_ueBurst, now);
+      if (ueBucket->tokens < 1)
+        {
+          return false;
+        }
+    }
+  if (m_globalRate > 0)
+    {
+      Refill (m_globalBucket, m_globalRate, m_globalBurst, now);
+      if (m_globalBucket.tokens < 1)
+        {
+          return false;
+        }
+      m_globalBucket.tokens -= 1;
+    }
+  if (ueBucket != nullptr)
+    {
+      ueBucket->tokens -= 1;
+    }
+  return true;
+}
+
+} // namespace ns3
@@ -0,0 +1,170 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Northeastern University
+ * Copyright (c) 2022 Sapienza, University of Rome
+ * Copyright (c) 2022 University of Padova
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrea Lacava <thecave003@gmail.com>
+ *		   Tommaso Zugno <tommasozugno@gmail.com>
+ *		   Michele Polese <michele.polese@gmail.com>
+ */
+
+#ifndef CONTROL_COALESCER_H
+#define CONTROL_COALESCER_H
+
+#include <ns3/simple-ref-count.h>
+#include <ns3/ptr.h>
+#include <ns3/nstime.h>
+#include <ns3/ric-control-message.h>
+#include <list>
+#include <map>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+namespace ns3 {
+
+  /**
+  * Stage between the reception of the RIC controls and their application.
+  * The controls of the same UE and control action received within a window
+  * of simulation time are merged, and only the last one is released when
+  * the window of the first one ends. The released controls then go through
+  * a token bucket per UE and a global one: the controls finding an empty
+  * bucket are dropped.
+  * Not thread-safe, to be used in the simulator thread.
+  */
+  class ControlCoalescer : public SimpleRefCount<ControlCoalescer>
+  {
+  public:
+    /**
+    * Counters of the controls that went through the coalescer
+    */
+    struct Stats
+    {
+      uint64_t received = 0; //!< controls passed to Add
+      uint64_t merged = 0; //!< controls replaced by a later one of the same UE and action
+      uint64_t dropped = 0; //!< controls dropped by the rate limits
+      uint64_t released = 0; //!< controls released for application
+    };
+
+    /**
+    * A control released by the coalescer, with its RAN function
+    */
+    struct Released
+    {
+      long ranFunctionId;
+      Ptr<RicControlMessage> control;
+    };
+
+    ControlCoalescer ();
+
+    /**
+    * \param window time during which the controls of the same UE and action
+    *        are merged; with zero, the controls added before the same call
+    *        of Release are merged
+    */
+    void SetWindow (Time window);
+
+    /**
+    * Set the token bucket of each UE
+    *
+    * \param rate controls per second of simulation time, zero for no limit
+    * \param burst size of the bucket, at least one control
+    */
+    void SetUeRateLimit (double rate, double burst);
+
+    /**
+    * Set the token bucket shared by all the UEs
+    *
+    * \param rate controls per second of simulation time, zero for no limit
+    * \param burst size of the bucket, at least one control
+    */
+    void SetGlobalRateLimit (double rate, double burst);
+
+    /**
+    * Add a control, replacing the pending one of the same UE and action
+    *
+    * \param ranFunctionId the RAN function of the control
+    * \param control the control, with a single action
+    * \param now the current simulation time
+    * \return the pending control replaced, nullptr if none
+    */
+    Ptr<RicControlMessage> Add (long ranFunctionId, Ptr<RicControlMessage> control, Time now);
+
+    /**
+    * Release the controls whose window has ended, in order of arrival of the
+    * first control of each UE and action
+    *
+    * \param now the current simulation time
+    * \param out vector the released controls are appended to
+    * \param dropped vector the controls dropped by the rate limits are
+    *        appended to, if not nullptr
+    */
+    void Release (Time now, std::vector<Released> &out, std::vector<Released> *dropped = nullptr);
+
+    /**
+    * \return true if controls are waiting for the end of their window
+    */
+    bool HasPending () const;
+
+    /**
+    * \return the end of the window of the oldest pending control
+    */
+    Time GetNextRelease () const;
+
+    Stats GetStats () const;
+
+  private:
+    typedef std::tuple<long, uint64_t, long, long> Key; //!< RAN function, UE, style and action
+
+    struct Pending
+    {
+      Key key;
+      Released released;
+      Time deadline; //!< end of the window
+    };
+
+    struct TokenBucket
+    {
+      double tokens;
+      Time last; //!< time of the last refill
+    };
+
+    /**
+    * Add the tokens accumulated since the last refill, up to the burst size
+    */
+    static void Refill (TokenBucket &bucket, double rate, double burst, Time now);
+
+    /**
+    * \return true if a token could be taken from both the bucket of the UE
+    *         and the global bucket
+    */
+    bool Admit (uint64_t ueId, Time now);
+
+    Time m_window;
+    double m_ueRate; //!< tokens per second of each UE bucket, 0 for no limit
+    double m_ueBurst; //!< size of each UE bucket
+    double m_globalRate; //!< tokens per second of the global bucket, 0 for no limit
+    double m_globalBurst; //!< size of the global bucket
+    std::list<Pending> m_pending; //!< controls waiting for the end of their window, by deadline
+    std::map<Key, std::list<Pending>::iterator> m_index; //!< pending control of each UE and action
+    std::unordered_map<uint64_t, TokenBucket> m_ueBuckets; //!< token buckets, by UE
+    TokenBucket m_globalBucket;
+    Stats m_stats;
+  };
+}
+
+#endif /* CONTROL_COALESCER_H */
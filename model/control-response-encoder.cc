@@ -0,0 +1,267 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Northeastern University
+ * Copyright (c) 2022 Sapienza, University of Rome
+ * Copyright (c) 2022 University of Padova
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrea Lacava <thecave003@gmail.com>
+ *		   Tommaso Zugno <tommasozugno@gmail.com>
+ *		   Michele Polese <michele.polese@gmail.com>
+ */
+
+#include <ns3/control-response-encoder.h>
+#include <ns3/asn-struct-pool.h>
+#include <ns3/log.h>
+#include <algorithm>
+#include <string.h>
+
+extern "C" {
+  #include "SuccessfulOutcome.h"
+  #include "UnsuccessfulOutcome.h"
+  #include "RICcontrolAcknowledge.h"
+  #include "RICcontrolFailure.h"
+  #include "ProtocolIE-Field.h"
+  #include "ProtocolIE-ID.h"
+  #include "ProcedureCode.h"
+}
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("ControlResponseEncoder");
+
+/**
+ * Append an IE of type T to a list of protocol IEs
+ */
+template <class T, class L>
+static T *
+AddResponseIe (L *list, ProtocolIE_ID_t id, Criticality_t criticality)
+{
+  auto *ie = (T *) calloc (1, sizeof (T));
+  ie->id = id;
+  ie->criticality = criticality;
+  ASN_SEQUENCE_ADD (&list->list, ie);
+  return ie;
+}
+
+E2AP_PDU_t *
+ControlResponseEncoder::BuildResponse (long ranFunctionId, const RICrequestID_t &requestId,
+                                       const std::string &callProcessId, Cause_PR causeGroup,
+                                       long cause)
+{
+  E2AP_PDU_t *pdu = AsnStructPool::GetE2apPduPool ().Acquire<E2AP_PDU_t> ();
+  if (causeGroup == Cause_PR_NOTHING)
+    {
+      pdu->present = E2AP_PDU_PR_successfulOutcome;
+      pdu->choice.successfulOutcome =
+          (SuccessfulOutcome_t *) calloc (1, sizeof (SuccessfulOutcome_t));
+      SuccessfulOutcome_t *outcome = pdu->choice.successfulOutcome;
+      outcome->procedureCode = ProcedureCode_id_RICcontrol;
+      outcome->criticality = Criticality_reject;
+      outcome->value.present = SuccessfulOutcome__value_PR_RICcontrolAcknowledge;
+      auto *ies = &outcome->value.choice.RICcontrolAcknowledge.protocolIEs;
+
+      auto *ie = AddResponseIe<RICcontrolAcknowledge_IEs_t> (ies, ProtocolIE_ID_id_RICrequestID,
+                                                             Criticality_reject);
+      ie->value.present = RICcontrolAcknowledge_IEs__value_PR_RICrequestID;
+      ie->value.choice.RICrequestID = requestId;
+      ie = AddResponseIe<RICcontrolAcknowledge_IEs_t> (ies, ProtocolIE_ID_id_RANfunctionID,
+                                                       Criticality_reject);
+      ie->value.present = RICcontrolAcknowledge_IEs__value_PR_RANfunctionID;
+      ie->value.choice.RANfunctionID = ranFunctionId;
+      if (!callProcessId.empty ())
+        {
+          ie = AddResponseIe<RICcontrolAcknowledge_IEs_t> (
+              ies, ProtocolIE_ID_id_RICcallProcessID, Criticality_reject);
+          ie->value.present = RICcontrolAcknowledge_IEs__value_PR_RICcallProcessID;
+          OCTET_STRING_fromBuf (&ie->value.choice.RICcallProcessID, callProcessId.data (),
+                                callProcessId.size ());
+        }
+      ie = AddResponseIe<RICcontrolAcknowledge_IEs_t> (ies, ProtocolIE_ID_id_RICcontrolStatus,
+                                                       Criticality_reject);
+      ie->value.present = RICcontrolAcknowledge_IEs__value_PR_RICcontrolStatus;
+      ie->value.choice.RICcontrolStatus = RICcontrolStatus_success;
+      return pdu;
+    }
+
+  pdu->present = E2AP_PDU_PR_unsuccessfulOutcome;
+  pdu->choice.unsuccessfulOutcome =
+      (UnsuccessfulOutcome_t *) calloc (1, sizeof (UnsuccessfulOutcome_t));
+  UnsuccessfulOutcome_t *outcome = pdu->choice.unsuccessfulOutcome;
+  outcome->procedureCode = ProcedureCode_id_RICcontrol;
+  outcome->criticality = Criticality_reject;
+  outcome->value.present = UnsuccessfulOutcome__value_PR_RICcontrolFailure;
+  auto *ies = &outcome->value.choice.RICcontrolFailure.protocolIEs;
+
+  auto *ie = AddResponseIe<RICcontrolFailure_IEs_t> (ies, ProtocolIE_ID_id_RICrequestID,
+                                                     Criticality_reject);
+  ie->value.present = RICcontrolFailure_IEs__value_PR_RICrequestID;
+  ie->value.choice.RICrequestID = requestId;
+  ie = AddResponseIe<RICcontrolFailure_IEs_t> (ies, ProtocolIE_ID_id_RANfunctionID,
+                                               Criticality_reject);
+  ie->value.present = RICcontrolFailure_IEs__value_PR_RANfunctionID;
+  ie->value.choice.RANfunctionID = ranFunctionId;
+  if (!callProcessId.empty ())
+    {
+      ie = AddResponseIe<RICcontrolFailure_IEs_t> (ies, ProtocolIE_ID_id_RICcallProcessID,
+                                                   Criticality_reject);
+      ie->value.present = RICcontrolFailure_IEs__value_PR_RICcallProcessID;
+      OCTET_STRING_fromBuf (&ie->value.choice.RICcallProcessID, callProcessId.data (),
+                            callProcessId.size ());
+    }
+  ie = AddResponseIe<RICcontrolFailure_IEs_t> (ies, ProtocolIE_ID_id_Cause, Criticality_ignore);
+  ie->value.present = RICcontrolFailure_IEs__value_PR_Cause;
+  ie->value.choice.Cause.present = causeGroup;
+  switch (causeGroup)
+    {
+    case Cause_PR_ricRequest:
+      ie->value.choice.Cause.choice.ricRequest = cause;
+      break;
+    case Cause_PR_ricService:
+      ie->value.choice.Cause.choice.ricService = cause;
+      break;
+    case Cause_PR_transport:
+      ie->value.choice.Cause.choice.transport = cause;
+      break;
+    case Cause_PR_protocol:
+      ie->value.choice.Cause.choice.protocol = cause;
+      break;
+    default:
+      ie->value.choice.Cause.present = Cause_PR_misc;
+      ie->value.choice.Cause.choice.misc = cause;
+      break;
+    }
+  return pdu;
+}
+
+std::vector<uint8_t>
+ControlResponseEncoder::EncodeResponse (long ranFunctionId, const RICrequestID_t &requestId,
+                                        const std::string &callProcessId, Cause_PR causeGroup,
+                                        long cause)
+{
+  E2AP_PDU_t *pdu = BuildResponse (ranFunctionId, requestId, callProcessId, causeGroup, cause);
+  asn_encode_to_new_buffer_result_t res =
+      asn_encode_to_new_buffer (nullptr, ATS_ALIGNED_BASIC_PER, &asn_DEF_E2AP_PDU, pdu);
+  AsnStructPool::GetE2apPduPool ().Release (pdu);
+  NS_ABORT_MSG_IF (res.buffer == nullptr, "Cannot encode the RIC Control response");
+  std::vector<uint8_t> encoded ((uint8_t *) res.buffer, (uint8_t *) res.buffer + res.result.encoded);
+  free (res.buffer);
+  return encoded;
+}
+
+bool
+ControlResponseEncoder::FindDifference (const std::vector<uint8_t> &a,
+                                        const std::vector<uint8_t> &b, size_t size,
+                                        size_t &offset)
+{
+  if (a.size () != b.size ())
+    {
+      return false;
+    }
+  size_t first = a.size ();
+  size_t last = 0;
+  for (size_t i = 0; i < a.size (); i++)
+    {
+      if (a[i] != b[i])
+        {
+          first = std::min (first, i);
+          last = i;
+        }
+    }
+  if (first == a.size () || last - first + 1 != size)
+    {
+      return false;
+    }
+  offset = first;
+  return true;
+}
+
+const std::vector<uint8_t> &
+ControlResponseEncoder::Encode (long ranFunctionId, const RICrequestID_t &requestId,
+                                const std::string &callProcessId, Cause_PR causeGroup, long cause)
+{
+  Key key (ranFunctionId, causeGroup, cause, callProcessId.size ());
+  auto it = m_skeletons.find (key);
+  if (it == m_skeletons.end ())
+    {
+      // the fields are located by encoding the skeleton with all-zero and
+      // all-one values: with APER, the RIC Request ID is two octet-aligned
+      // 16-bit integers and the content of the RIC Call Process ID is
+      // octet-aligned, so that only their bytes change
+      Skeleton skeleton;
+      RICrequestID_t zero = {0, 0};
+      RICrequestID_t requestor = {0xFFFF, 0};
+      RICrequestID_t instance = {0, 0xFFFF};
+      std::string zeroCall (callProcessId.size (), '\0');
+      std::string oneCall (callProcessId.size (), '\xFF');
+      skeleton.bytes = EncodeResponse (ranFunctionId, zero, zeroCall, causeGroup, cause);
+      skeleton.patchable =
+          FindDifference (skeleton.bytes,
+                          EncodeResponse (ranFunctionId, requestor, zeroCall, causeGroup, cause),
+                          2, skeleton.requestorOffset) &&
+          FindDifference (skeleton.bytes,
+                          EncodeResponse (ranFunctionId, instance, zeroCall, causeGroup, cause),
+                          2, skeleton.instanceOffset) &&
+          (callProcessId.empty () ||
+           FindDifference (skeleton.bytes,
+                           EncodeResponse (ranFunctionId, zero, oneCall, causeGroup, cause),
+                           callProcessId.size (), skeleton.callProcessOffset));
+      NS_LOG_LOGIC ("New RIC Control response skeleton of " << skeleton.bytes.size ()
+                                                            << " bytes, patchable "
+                                                            << skeleton.patchable);
+      it = m_skeletons.emplace (key, std::move (skeleton)).first;
+    }
+
+  Skeleton &skeleton = it->second;
+  if (!skeleton.patchable)
+    {
+      m_encoded = EncodeResponse (ranFunctionId, requestId, callProcessId, causeGroup, cause);
+      return m_encoded;
+    }
+  skeleton.bytes[skeleton.requestorOffset] = requestId.ricRequestorID >> 8;
+  skeleton.bytes[skeleton.requestorOffset + 1] = requestId.ricRequestorID & 0xFF;
+  skeleton.bytes[skeleton.instanceOffset] = requestId.ricInstanceID >> 8;
+  skeleton.bytes[skeleton.instanceOffset + 1] = requestId.ricInstanceID & 0xFF;
+  if (!callProcessId.empty ())
+    {
+      memcpy (skeleton.bytes.data () + skeleton.callProcessOffset, callProcessId.data (),
+              callProcessId.size ());
+    }
+  m_patched++;
+  return skeleton.bytes;
+}
+
+const std::vector<uint8_t> &
+ControlResponseEncoder::EncodeAcknowledge (long ranFunctionId, const RICrequestID_t &requestId,
+                                           const std::string &callProcessId)
+{
+  return Encode (ranFunctionId, requestId, callProcessId, Cause_PR_NOTHING, 0);
+}
+
+const std::vector<uint8_t> &
+ControlResponseEncoder::EncodeFailure (long ranFunctionId, const RICrequestID_t &requestId,
+                                       const std::string &callProcessId, Cause_PR causeGroup,
+                                       long cause)
+{
+  return Encode (ranFunctionId, requestId, callProcessId, causeGroup, cause);
+}
+
+uint64_t
+ControlResponseEncoder::GetPatchedCount () const
+{
+  return m_patched;
+}
+
+} // namespace ns3
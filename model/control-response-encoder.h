@@ -0,0 +1,135 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Northeastern University
+ * Copyright (c) 2022 Sapienza, University of Rome
+ * Copyright (c) 2022 University of Padova
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrea Lacava <thecave003@gmail.com>
+ *		   Tommaso Zugno <tommasozugno@gmail.com>
+ *		   Michele Polese <michele.polese@gmail.com>
+ */
+
+#ifndef CONTROL_RESPONSE_ENCODER_H
+#define CONTROL_RESPONSE_ENCODER_H
+
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+#include <stdint.h>
+
+extern "C" {
+  #include "E2AP-PDU.h"
+  #include "RICrequestID.h"
+  #include "Cause.h"
+}
+
+namespace ns3 {
+
+  /**
+  * Encoder of the RIC Control Acknowledge and RIC Control Failure messages.
+  * The first response of a RAN function, outcome and length of the RIC Call
+  * Process ID is encoded with asn1c, then kept as a skeleton with the
+  * offsets of the RIC Request ID and of the RIC Call Process ID in the
+  * encoding; the following ones are obtained by overwriting these bytes.
+  * Not thread-safe.
+  */
+  class ControlResponseEncoder
+  {
+  public:
+    /**
+    * \param ranFunctionId the RAN function of the request
+    * \param requestId the RIC Request ID of the request
+    * \param callProcessId the RIC Call Process ID of the request, empty if absent
+    * \return the APER encoding of the RIC Control Acknowledge, valid until
+    *         the next call
+    */
+    const std::vector<uint8_t> &EncodeAcknowledge (long ranFunctionId,
+                                                   const RICrequestID_t &requestId,
+                                                   const std::string &callProcessId);
+
+    /**
+    * \param ranFunctionId the RAN function of the request
+    * \param requestId the RIC Request ID of the request
+    * \param callProcessId the RIC Call Process ID of the request, empty if absent
+    * \param causeGroup the group of the cause of the failure
+    * \param cause the cause of the failure, within its group
+    * \return the APER encoding of the RIC Control Failure, valid until the
+    *         next call
+    */
+    const std::vector<uint8_t> &EncodeFailure (long ranFunctionId, const RICrequestID_t &requestId,
+                                               const std::string &callProcessId,
+                                               Cause_PR causeGroup, long cause);
+
+    /**
+    * Build a RIC Control Acknowledge, or a RIC Control Failure if a cause
+    * group is given
+    *
+    * \return the PDU, to be released with ASN_STRUCT_FREE
+    */
+    static E2AP_PDU_t *BuildResponse (long ranFunctionId, const RICrequestID_t &requestId,
+                                      const std::string &callProcessId,
+                                      Cause_PR causeGroup = Cause_PR_NOTHING, long cause = 0);
+
+    /**
+    * \return the number of responses obtained by patching a skeleton
+    */
+    uint64_t GetPatchedCount () const;
+
+  private:
+    /**
+    * Encoding of a response, with the position of the fields to patch
+    */
+    struct Skeleton
+    {
+      std::vector<uint8_t> bytes;
+      bool patchable = false; //!< false if the fields could not be located
+      size_t requestorOffset = 0; //!< two octets of the RIC Requestor ID
+      size_t instanceOffset = 0; //!< two octets of the RIC Instance ID
+      size_t callProcessOffset = 0; //!< content of the RIC Call Process ID
+    };
+
+    typedef std::tuple<long, int, long, size_t> Key; //!< RAN function, cause and call process size
+
+    const std::vector<uint8_t> &Encode (long ranFunctionId, const RICrequestID_t &requestId,
+                                        const std::string &callProcessId, Cause_PR causeGroup,
+                                        long cause);
+
+    /**
+    * Encode a response with asn1c
+    */
+    static std::vector<uint8_t> EncodeResponse (long ranFunctionId,
+                                                const RICrequestID_t &requestId,
+                                                const std::string &callProcessId,
+                                                Cause_PR causeGroup, long cause);
+
+    /**
+    * Locate the bytes that differ between two encodings
+    *
+    * \param size the expected number of different bytes, all contiguous
+    * \param offset set to the first different byte
+    * \return true if exactly size contiguous bytes differ
+    */
+    static bool FindDifference (const std::vector<uint8_t> &a, const std::vector<uint8_t> &b,
+                                size_t size, size_t &offset);
+
+    std::map<Key, Skeleton> m_skeletons; //!< skeletons built so far
+    std::vector<uint8_t> m_encoded; //!< last response encoded without skeleton
+    uint64_t m_patched = 0;
+  };
+}
+
+#endif /* CONTROL_RESPONSE_ENCODER_H */
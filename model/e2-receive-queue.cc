@@ -0,0 +1,103 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Northeastern University
+ * Copyright (c) 2022 Sapienza, University of Rome
+ * Copyright (c) 2022 University of Padova
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrea Lacava <thecave003@gmail.com>
+ *		   Tommaso Zugno <tommasozugno@gmail.com>
+ *		   Michele Polese <michele.polese@gmail.com>
+ */
+
+
+#include <ns3/e2-receive-queue.h>
+
+namespace ns3 {
+
+E2ReceiveQueue::E2ReceiveQueue ()
+  : m_head (&m_stub),
+    m_tail (&m_stub)
+{
+  m_stub.next.store (nullptr, std::memory_order_relaxed);
+}
+
+E2ReceiveQueue::~E2ReceiveQueue ()
+{
+  // the encodings go back to the threads that made them as they are popped
+  Item item;
+  while (Pop (item))
+    {
+    }
+}
+
+void
+E2ReceiveQueue::PushNode (Node *node)
+{
+  node->next.store (nullptr, std::memory_order_relaxed);
+  Node *prev = m_head.exchange (node, std::memory_order_acq_rel);
+  // between the exchange and this store the node is not reachable yet
+  prev->next.store (node, std::memory_order_release);
+}
+
+void
+E2ReceiveQueue::Push (Item &&item)
+{
+  Node *node = new Node;
+  node->item = std::move (item);
+  PushNode (node);
+}
+
+bool
+E2ReceiveQueue::Pop (Item &item)
+{
+  Node *tail = m_tail;
+  Node *next = tail->next.load (std::memory_order_acquire);
+  if (tail == &m_stub)
+    {
+      if (next == nullptr)
+        {
+          return false;
+        }
+      m_tail = next;
+      tail = next;
+      next = next->next.load (std::memory_order_acquire);
+    }
+  if (next != nullptr)
+    {
+      m_tail = next;
+      item = std::move (tail->item);
+      delete tail;
+      return true;
+    }
+  if (tail != m_head.load (std::memory_order_acquire))
+    {
+      // a producer is linking a new node
+      return false;
+    }
+  // tail is the last node: put the stub behind it so that it can be removed
+  PushNode (&m_stub);
+  next = tail->next.load (std::memory_order_acquire);
+  if (next != nullptr)
+    {
+      m_tail = next;
+      item = std::move (tail->item);
+      delete tail;
+      return true;
+    }
+  return false;
+}
+
+} // namespace ns3
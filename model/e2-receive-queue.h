@@ -0,0 +1,94 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Northeastern University
+ * Copyright (c) 2022 Sapienza, University of Rome
+ * Copyright (c) 2022 University of Padova
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrea Lacava <thecave003@gmail.com>
+ *		   Tommaso Zugno <tommasozugno@gmail.com>
+ *		   Michele Polese <michele.polese@gmail.com>
+ */
+
+
+#ifndef E2_RECEIVE_QUEUE_H
+#define E2_RECEIVE_QUEUE_H
+
+#include <ns3/kpm-encode-buffer.h>
+#include <atomic>
+#include <chrono>
+#include <stdint.h>
+
+namespace ns3 {
+
+  /**
+  * Lock-free multi-producer single-consumer queue of the E2AP PDUs received
+  * from the RIC (an intrusive Vyukov queue).
+  * The e2sim threads push the APER encodings of the PDUs without taking any
+  * lock; the simulator thread pops and decodes them when it applies them, so
+  * the simulation state is only touched by the simulator thread.
+  */
+  class E2ReceiveQueue
+  {
+  public:
+    /**
+    * PDU received from the RIC
+    */
+    struct Item
+    {
+      KpmEncodeBuffer::Block encoded; //!< APER encoding of the PDU
+      uint32_t handler; //!< index of the handler of the PDU
+      std::chrono::steady_clock::time_point enqueueTime; //!< wall-clock time of the push
+    };
+
+    E2ReceiveQueue ();
+
+    /**
+    * Release the items still in the queue
+    */
+    ~E2ReceiveQueue ();
+
+    /**
+    * Enqueue an item. Lock-free, may be called by any thread.
+    *
+    * \param item the item, moved into the queue
+    */
+    void Push (Item &&item);
+
+    /**
+    * Dequeue the oldest item. Must be called by a single thread.
+    *
+    * \param item the dequeued item, moved out of the queue
+    * \return false if the queue is empty, or if the only item is still
+    *         being pushed
+    */
+    bool Pop (Item &item);
+
+  private:
+    struct Node
+    {
+      std::atomic<Node *> next;
+      Item item;
+    };
+
+    void PushNode (Node *node);
+
+    std::atomic<Node *> m_head; //!< last node pushed, swapped by the producers
+    Node *m_tail; //!< oldest node, owned by the consumer
+    Node m_stub; //!< placeholder node keeping the list non-empty
+  };
+}
+
+#endif /* E2_RECEIVE_QUEUE_H */
@@ -0,0 +1,593 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Northeastern University
+ * Copyright (c) 2022 Sapienza, University of Rome
+ * Copyright (c) 2022 University of Padova
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrea Lacava <thecave003@gmail.com>
+ *		   Tommaso Zugno <tommasozugno@gmail.com>
+ *		   Michele Polese <michele.polese@gmail.com>
+ */
+
+
+#include <ns3/e2-report-scheduler.h>
+#include <ns3/indication-encoder.h>
+#include <ns3/log.h>
+#include <ns3/simulator.h>
+#include <chrono>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("E2ReportScheduler");
+
+NS_OBJECT_ENSURE_REGISTERED (E2ReportScheduler);
+
+TypeId
+E2ReportScheduler::GetTypeId ()
+{
+  static TypeId tid =
+      TypeId ("ns3::E2ReportScheduler")
+          .SetParent<Object> ()
+          .AddConstructor<E2ReportScheduler> ()
+          .AddAttribute ("DefaultReportingPeriod",
+                         "Reporting period of the subscriptions whose event trigger "
+                         "does not set one",
+                         TimeValue (MilliSeconds (100)),
+                         MakeTimeAccessor (&E2ReportScheduler::m_defaultPeriod),
+                         MakeTimeChecker (MilliSeconds (1)));
+  return tid;
+}
+
+E2ReportScheduler::E2ReportScheduler ()
+  : m_defaultPeriod (MilliSeconds (100)),
+    m_drainTarget (std::make_shared<DrainTarget> ()),
+    m_drainScheduled (false),
+    m_encodedSent (0)
+{
+  NS_LOG_FUNCTION (this);
+  m_drainTarget->scheduler = this;
+}
+
+E2ReportScheduler::~E2ReportScheduler ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+E2ReportScheduler::DoDispose ()
+{
+  NS_LOG_FUNCTION (this);
+  for (auto &group : m_groups)
+    {
+      group.second.tick.Cancel ();
+    }
+  m_groups.clear ();
+  // the workers must be done with the pending jobs before they are dropped
+  for (PendingReport &report : m_pending)
+    {
+      report.encoded.wait ();
+    }
+  m_pending.clear ();
+  {
+    std::unique_lock<std::mutex> lock (m_drainTarget->mutex);
+    m_drainTarget->scheduler = nullptr;
+  }
+  m_encoder = nullptr;
+  m_jobCb = MakeNullCallback<std::vector<std::shared_ptr<KpmEncodeJob>>, const Subscription &> ();
+  m_collectCb = MakeNullCallback<void, Time> ();
+  m_reportCb = MakeNullCallback<std::vector<Report>, const Subscription &> ();
+  m_sendCb = MakeNullCallback<void, E2AP_PDU_t *> ();
+  m_indicationCb = MakeNullCallback<void, const Subscription &, long, Ptr<KpmIndicationHeader>,
+                                    Ptr<KpmIndicationMessage>> ();
+  m_stepCb = MakeNullCallback<void, uint32_t> ();
+  m_ueKpiCb = MakeNullCallback<Ptr<const KpiTable>> ();
+  m_cellKpiCb = MakeNullCallback<Ptr<const KpiTable>> ();
+  m_decisionCb = MakeNullCallback<void, const RcPolicy &, const RcPolicy::Decision &> ();
+  Object::DoDispose ();
+}
+
+void
+E2ReportScheduler::SetCollectCallback (CollectCallback cb)
+{
+  m_collectCb = cb;
+}
+
+void
+E2ReportScheduler::SetReportCallback (ReportCallback cb)
+{
+  m_reportCb = cb;
+}
+
+void
+E2ReportScheduler::SetSendCallback (SendCallback cb)
+{
+  m_sendCb = cb;
+}
+
+void
+E2ReportScheduler::SetIndicationCallback (IndicationCallback cb)
+{
+  m_indicationCb = cb;
+}
+
+void
+E2ReportScheduler::SetStepCallback (StepCallback cb)
+{
+  m_stepCb = cb;
+}
+
+void
+E2ReportScheduler::SetEncoderService (Ptr<KpmEncoderService> service, EncodeJobCallback cb)
+{
+  m_encoder = service;
+  m_jobCb = cb;
+}
+
+void
+E2ReportScheduler::SetPolicyCallbacks (UeKpiCallback kpiCb, PolicyDecisionCallback decisionCb)
+{
+  m_ueKpiCb = kpiCb;
+  m_decisionCb = decisionCb;
+}
+
+void
+E2ReportScheduler::SetCellKpiCallback (CellKpiCallback cb)
+{
+  m_cellKpiCb = cb;
+}
+
+void
+E2ReportScheduler::SetUeKpiCallback (UeKpiCallback cb)
+{
+  m_ueKpiCb = cb;
+}
+
+Time
+E2ReportScheduler::GetAlignedDelay (Time now, Time period)
+{
+  return period - TimeStep (now.GetTimeStep () % period.GetTimeStep ());
+}
+
+void
+E2ReportScheduler::AddSubscription (const Subscription &subscription)
+{
+  // the subscription requests are processed in the e2sim thread
+  Simulator::ScheduleWithContext (Simulator::NO_CONTEXT, Seconds (0),
+                                  &E2ReportScheduler::DoAddSubscription, this, subscription);
+}
+
+void
+E2ReportScheduler::RemoveSubscription (uint16_t requestorId, uint16_t instanceId)
+{
+  Simulator::ScheduleWithContext (Simulator::NO_CONTEXT, Seconds (0),
+                                  &E2ReportScheduler::DoRemoveSubscription, this, requestorId,
+                                  instanceId);
+}
+
+void
+E2ReportScheduler::AddPolicy (Ptr<RcPolicy> policy, uint32_t periodMs)
+{
+  Simulator::ScheduleWithContext (Simulator::NO_CONTEXT, Seconds (0),
+                                  &E2ReportScheduler::DoAddPolicy, this, policy, periodMs);
+}
+
+E2ReportScheduler::PeriodGroup &
+E2ReportScheduler::GetGroup (uint32_t periodMs)
+{
+  auto it = m_groups.find (periodMs);
+  if (it != m_groups.end ())
+    {
+      return it->second;
+    }
+  // first subscription or policy of the period, the groups are removed when empty
+  PeriodGroup &group = m_groups[periodMs];
+  Time delay = GetAlignedDelay (Simulator::Now (), MilliSeconds (periodMs));
+  group.tick = Simulator::Schedule (delay, &E2ReportScheduler::Tick, this, periodMs);
+  return group;
+}
+
+void
+E2ReportScheduler::DoAddSubscription (Subscription subscription)
+{
+  DoRemoveSubscription (subscription.requestorId, subscription.instanceId);
+
+  uint32_t periodMs = subscription.reportingPeriod;
+  if (periodMs == 0)
+    {
+      periodMs = m_defaultPeriod.GetMilliSeconds ();
+    }
+  if (subscription.granularityPeriod == 0)
+    {
+      subscription.granularityPeriod = periodMs;
+    }
+
+  NS_LOG_INFO ("Report subscription " << subscription.requestorId << "/"
+                                      << subscription.instanceId << " every " << periodMs
+                                      << " ms");
+
+  GetGroup (periodMs).subscriptions.push_back ({subscription, 1});
+}
+
+void
+E2ReportScheduler::DoAddPolicy (Ptr<RcPolicy> policy, uint32_t periodMs)
+{
+  // a policy replaces the one installed by the same request, not its reports
+  for (auto &group : m_groups)
+    {
+      std::vector<Ptr<RcPolicy>> &policies = group.second.policies;
+      for (auto it = policies.begin (); it != policies.end (); ++it)
+        {
+          if ((*it)->GetRequestorId () == policy->GetRequestorId () &&
+              (*it)->GetInstanceId () == policy->GetInstanceId ())
+            {
+              policies.erase (it);
+              break;
+            }
+        }
+    }
+
+  if (periodMs == 0)
+    {
+      periodMs = m_defaultPeriod.GetMilliSeconds ();
+    }
+  NS_LOG_INFO ("Evaluate policy " << policy->GetRequestorId () << "/"
+                                  << policy->GetInstanceId () << " every " << periodMs << " ms");
+  GetGroup (periodMs).policies.push_back (policy);
+}
+
+void
+E2ReportScheduler::DoRemoveSubscription (uint16_t requestorId, uint16_t instanceId)
+{
+  for (auto it = m_groups.begin (); it != m_groups.end ();)
+    {
+      std::vector<ScheduledSubscription> &subscriptions = it->second.subscriptions;
+      for (auto sub = subscriptions.begin (); sub != subscriptions.end (); ++sub)
+        {
+          if (sub->params.requestorId == requestorId && sub->params.instanceId == instanceId)
+            {
+              NS_LOG_INFO ("Stop reporting subscription " << requestorId << "/" << instanceId);
+              subscriptions.erase (sub);
+              break;
+            }
+        }
+      std::vector<Ptr<RcPolicy>> &policies = it->second.policies;
+      for (auto policy = policies.begin (); policy != policies.end (); ++policy)
+        {
+          if ((*policy)->GetRequestorId () == requestorId &&
+              (*policy)->GetInstanceId () == instanceId)
+            {
+              NS_LOG_INFO ("Stop evaluating policy " << requestorId << "/" << instanceId);
+              policies.erase (policy);
+              break;
+            }
+        }
+      it = RemoveGroupIfEmpty (it);
+    }
+}
+
+std::map<uint32_t, E2ReportScheduler::PeriodGroup>::iterator
+E2ReportScheduler::RemoveGroupIfEmpty (std::map<uint32_t, PeriodGroup>::iterator it)
+{
+  const PeriodGroup &group = it->second;
+  if (!group.subscriptions.empty () || !group.policies.empty () || !group.rics.empty ())
+    {
+      return ++it;
+    }
+  it->second.tick.Cancel ();
+  return m_groups.erase (it);
+}
+
+void
+E2ReportScheduler::AddEmbeddedRic (Ptr<EmbeddedRic> ric)
+{
+  NS_LOG_FUNCTION (this << ric);
+  uint32_t periodMs = ric->GetReportingPeriod ().GetMilliSeconds ();
+  ScheduledRic scheduled;
+  scheduled.ric = ric;
+  scheduled.params = Subscription ();
+  scheduled.params.ranFuncionId = ric->GetRanFunctionId ();
+  scheduled.params.ricStyleType = -1;
+  scheduled.params.granularityPeriod = periodMs;
+  scheduled.params.reportingPeriod = periodMs;
+  scheduled.sequenceNumber = 0;
+  GetGroup (periodMs).rics.push_back (scheduled);
+}
+
+void
+E2ReportScheduler::RemoveEmbeddedRic (Ptr<EmbeddedRic> ric)
+{
+  NS_LOG_FUNCTION (this << ric);
+  for (auto it = m_groups.begin (); it != m_groups.end ();)
+    {
+      std::vector<ScheduledRic> &rics = it->second.rics;
+      for (auto scheduled = rics.begin (); scheduled != rics.end (); ++scheduled)
+        {
+          if (scheduled->ric == ric)
+            {
+              rics.erase (scheduled);
+              break;
+            }
+        }
+      it = RemoveGroupIfEmpty (it);
+    }
+}
+
+uint32_t
+E2ReportScheduler::GetSubscriptionCount () const
+{
+  uint32_t count = 0;
+  for (const auto &group : m_groups)
+    {
+      count += group.second.subscriptions.size ();
+    }
+  return count;
+}
+
+uint32_t
+E2ReportScheduler::GetPolicyCount () const
+{
+  uint32_t count = 0;
+  for (const auto &group : m_groups)
+    {
+      count += group.second.policies.size ();
+    }
+  return count;
+}
+
+void
+E2ReportScheduler::EvaluatePolicies (const std::vector<Ptr<RcPolicy>> &policies)
+{
+  if (m_ueKpiCb.IsNull () || m_decisionCb.IsNull ())
+    {
+      NS_LOG_WARN ("Policies installed without the policy callbacks, not evaluated");
+      return;
+    }
+  Ptr<const KpiTable> table = m_ueKpiCb ();
+  for (const Ptr<RcPolicy> &policy : policies)
+    {
+      m_decisions.clear ();
+      policy->Evaluate (table, m_decisions);
+      NS_LOG_DEBUG ("Policy " << policy->GetRequestorId () << "/" << policy->GetInstanceId ()
+                              << " decided " << m_decisions.size () << " handovers");
+      for (const RcPolicy::Decision &decision : m_decisions)
+        {
+          m_decisionCb (*policy, decision);
+        }
+    }
+}
+
+void
+E2ReportScheduler::NotifyEmbeddedRics (Time period, std::vector<ScheduledRic> &rics)
+{
+  for (ScheduledRic &scheduled : rics)
+    {
+      EmbeddedRic::Indication indication;
+      indication.ranFunctionId = scheduled.params.ranFuncionId;
+      indication.period = period;
+      if (scheduled.ric->IsStructuredView ())
+        {
+          // the KPIs are passed as collected, nothing is encoded
+          if (!m_cellKpiCb.IsNull ())
+            {
+              indication.cellTable = m_cellKpiCb ();
+            }
+          if (!m_ueKpiCb.IsNull ())
+            {
+              indication.ueTable = m_ueKpiCb ();
+            }
+          indication.sequenceNumber = scheduled.sequenceNumber++;
+          scheduled.ric->OnIndication (indication);
+          continue;
+        }
+      if (m_reportCb.IsNull ())
+        {
+          continue;
+        }
+      for (const Report &report : m_reportCb (scheduled.params))
+        {
+          indication.header = report.header;
+          indication.message = report.message;
+          indication.sequenceNumber = scheduled.sequenceNumber++;
+          scheduled.ric->OnIndication (indication);
+        }
+    }
+}
+
+E2ReportScheduler::ScheduledSubscription *
+E2ReportScheduler::FindSubscription (uint16_t requestorId, uint16_t instanceId)
+{
+  for (auto &group : m_groups)
+    {
+      for (ScheduledSubscription &sub : group.second.subscriptions)
+        {
+          if (sub.params.requestorId == requestorId && sub.params.instanceId == instanceId)
+            {
+              return &sub;
+            }
+        }
+    }
+  return nullptr;
+}
+
+bool
+E2ReportScheduler::SendReport (ScheduledSubscription &sub, Ptr<KpmIndicationHeader> header,
+                               Ptr<KpmIndicationMessage> message)
+{
+  if (!header || !message || message->GetSpan ().size == 0)
+    {
+      NS_LOG_WARN ("Empty report for subscription " << sub.params.requestorId << "/"
+                                                    << sub.params.instanceId);
+      return false;
+    }
+  if (!m_indicationCb.IsNull ())
+    {
+      m_indicationCb (sub.params, sub.sequenceNumber++, header, message);
+    }
+  else
+    {
+      m_sendCb (IndicationEncoder::BuildIndication (
+          sub.params.requestorId, sub.params.instanceId, sub.params.ranFuncionId,
+          sub.params.actionId, sub.sequenceNumber++, (const uint8_t *) header->m_buffer,
+          header->m_size, message->GetSpan ().data, message->GetSpan ().size));
+    }
+  return true;
+}
+
+void
+E2ReportScheduler::ScheduleDrain ()
+{
+  if (!m_drainScheduled.exchange (true))
+    {
+      Simulator::ScheduleWithContext (Simulator::NO_CONTEXT, Seconds (0),
+                                      &E2ReportScheduler::DrainScheduled, m_drainTarget);
+    }
+}
+
+void
+E2ReportScheduler::DrainScheduled (std::shared_ptr<DrainTarget> target)
+{
+  E2ReportScheduler *scheduler;
+  {
+    std::unique_lock<std::mutex> lock (target->mutex);
+    scheduler = target->scheduler;
+  }
+  // cleared in the simulator thread as well, by DoDispose
+  if (scheduler != nullptr)
+    {
+      scheduler->DrainEncoded (Seconds (0));
+    }
+}
+
+void
+E2ReportScheduler::FlushEncoded ()
+{
+  DrainEncoded (Time::Max ());
+}
+
+void
+E2ReportScheduler::DrainEncoded (Time before)
+{
+  // the flag is cleared first, the jobs completing from now on schedule
+  // another drain
+  m_drainScheduled = false;
+  while (!m_pending.empty ())
+    {
+      PendingReport &report = m_pending.front ();
+      if (report.submitted < before)
+        {
+          report.encoded.wait ();
+        }
+      else if (report.encoded.wait_for (std::chrono::seconds (0)) != std::future_status::ready)
+        {
+          break;
+        }
+
+      // the SN is taken when the report is sent, so that the empty reports
+      // and the ones of removed subscriptions leave no gap
+      ScheduledSubscription *sub = FindSubscription (report.requestorId, report.instanceId);
+      if (sub == nullptr)
+        {
+          NS_LOG_LOGIC ("Subscription " << report.requestorId << "/" << report.instanceId
+                                        << " removed, encoded report dropped");
+        }
+      else if (SendReport (*sub, report.job->GetHeader (), report.job->GetMessage ()))
+        {
+          m_encodedSent++;
+        }
+      m_pending.pop_front ();
+    }
+
+  if (m_pending.empty () && m_encodedSent > 0 && !m_stepCb.IsNull ())
+    {
+      uint32_t sent = m_encodedSent;
+      m_encodedSent = 0;
+      m_stepCb (sent);
+    }
+}
+
+void
+E2ReportScheduler::Tick (uint32_t periodMs)
+{
+  auto it = m_groups.find (periodMs);
+  NS_ASSERT (it != m_groups.end ());
+  Time period = MilliSeconds (periodMs);
+  NS_LOG_FUNCTION (this << periodMs << it->second.subscriptions.size ());
+
+  // the reports of the previous ticks are sent before the KPIs are refreshed
+  DrainEncoded (Simulator::Now ());
+
+  // collected once for all the subscriptions of the period
+  if (!m_collectCb.IsNull ())
+    {
+      m_collectCb (period);
+    }
+  if (!it->second.policies.empty ())
+    {
+      EvaluatePolicies (it->second.policies);
+    }
+  if (!it->second.rics.empty ())
+    {
+      NotifyEmbeddedRics (period, it->second.rics);
+    }
+
+  uint32_t sent = 0;
+  bool canSend = !m_sendCb.IsNull () || !m_indicationCb.IsNull ();
+  if (m_encoder && !m_jobCb.IsNull () && canSend)
+    {
+      std::shared_ptr<DrainTarget> target = m_drainTarget;
+      auto done = [target] () {
+        std::unique_lock<std::mutex> lock (target->mutex);
+        if (target->scheduler != nullptr)
+          {
+            target->scheduler->ScheduleDrain ();
+          }
+      };
+      for (ScheduledSubscription &sub : it->second.subscriptions)
+        {
+          for (const std::shared_ptr<KpmEncodeJob> &job : m_jobCb (sub.params))
+            {
+              PendingReport report;
+              report.requestorId = sub.params.requestorId;
+              report.instanceId = sub.params.instanceId;
+              report.job = job;
+              report.encoded = m_encoder->Submit (job, done);
+              report.submitted = Simulator::Now ();
+              m_pending.push_back (report);
+            }
+        }
+    }
+  else if (!m_reportCb.IsNull () && canSend)
+    {
+      for (ScheduledSubscription &sub : it->second.subscriptions)
+        {
+          for (const Report &report : m_reportCb (sub.params))
+            {
+              if (SendReport (sub, report.header, report.message))
+                {
+                  sent++;
+                }
+            }
+        }
+    }
+
+  it->second.tick = Simulator::Schedule (period, &E2ReportScheduler::Tick, this, periodMs);
+  if (sent > 0 && !m_stepCb.IsNull ())
+    {
+      m_stepCb (sent);
+    }
+}
+
+} // namespace ns3
@@ -0,0 +1,368 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Northeastern University
+ * Copyright (c) 2022 Sapienza, University of Rome
+ * Copyright (c) 2022 University of Padova
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrea Lacava <thecave003@gmail.com>
+ *		   Tommaso Zugno <tommasozugno@gmail.com>
+ *		   Michele Polese <michele.polese@gmail.com>
+ */
+
+
+#ifndef E2_REPORT_SCHEDULER_H
+#define E2_REPORT_SCHEDULER_H
+
+#include <ns3/object.h>
+#include <ns3/nstime.h>
+#include <ns3/event-id.h>
+#include <ns3/callback.h>
+#include <ns3/oran-interface.h>
+#include <ns3/rc-policy.h>
+#include <ns3/embedded-ric.h>
+#include <ns3/kpm-encoder-service.h>
+#include <atomic>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace ns3 {
+
+  /**
+  * Periodic reporting of the RIC subscriptions of an E2 termination.
+  * Each subscription is reported every reporting period of its event
+  * trigger. The subscriptions with the same period share one simulation
+  * event: at each tick the KPIs are collected once, then the indications of
+  * every subscription of the period are built, encoded and sent.
+  * The ticks of a period are aligned to the multiples of the period, so that
+  * periods multiple of each other fire in the same simulation timestamp.
+  * The E2SM-RC policies installed by the RIC are evaluated at the ticks of
+  * their period as well, on the UE KPIs just collected, and their decisions
+  * are applied locally without a round trip to the RIC. The embedded xApps
+  * receive their indications at the ticks of their period too.
+  * With an encoder service, the reports are encoded by its workers while
+  * the simulation goes on; the scheduler sequences them, and sends each
+  * report once it and all the reports submitted before are encoded. The
+  * reports of a tick are all sent before the next tick collects the KPIs.
+  */
+  class E2ReportScheduler : public Object
+  {
+  public:
+    typedef E2Termination::RicSubscriptionRequest_rval_s Subscription;
+
+    /**
+    * Indication of a subscription, header and message
+    */
+    struct Report
+    {
+      Ptr<KpmIndicationHeader> header;
+      Ptr<KpmIndicationMessage> message;
+    };
+
+    /**
+    * Collects the KPIs of a reporting period, called once per tick with the
+    * period, before the reports of the subscriptions of the period are built
+    */
+    typedef Callback<void, Time> CollectCallback;
+
+    /**
+    * Builds the indications of a subscription from the KPIs collected in
+    * the current tick
+    */
+    typedef Callback<std::vector<Report>, const Subscription &> ReportCallback;
+
+    /**
+    * Builds the encoding jobs of the indications of a subscription from the
+    * KPIs collected in the current tick, used instead of the report
+    * callback if an encoder service is set
+    */
+    typedef Callback<std::vector<std::shared_ptr<KpmEncodeJob>>, const Subscription &>
+        EncodeJobCallback;
+
+    /**
+    * Sends an E2 PDU, taking its ownership
+    */
+    typedef Callback<void, E2AP_PDU_t *> SendCallback;
+
+    /**
+    * Sends the indication of a subscription with its RIC Indication SN,
+    * used instead of the send callback if set
+    */
+    typedef Callback<void, const Subscription &, long, Ptr<KpmIndicationHeader>,
+                     Ptr<KpmIndicationMessage>>
+        IndicationCallback;
+
+    /**
+    * Called at the end of a tick in which indications were sent, with
+    * their number, e.g., to synchronize with the RIC
+    */
+    typedef Callback<void, uint32_t> StepCallback;
+
+    /**
+    * Provides the UE KPIs collected in the current tick
+    */
+    typedef Callback<Ptr<const KpiTable>> UeKpiCallback;
+
+    /**
+    * Provides the cell KPIs collected in the current tick
+    */
+    typedef Callback<Ptr<const KpiTable>> CellKpiCallback;
+
+    /**
+    * Applies a decision of a policy, e.g., triggers the handover
+    */
+    typedef Callback<void, const RcPolicy &, const RcPolicy::Decision &> PolicyDecisionCallback;
+
+    E2ReportScheduler ();
+    virtual ~E2ReportScheduler ();
+
+    static TypeId GetTypeId ();
+
+    void SetCollectCallback (CollectCallback cb);
+    void SetReportCallback (ReportCallback cb);
+    void SetSendCallback (SendCallback cb);
+    void SetIndicationCallback (IndicationCallback cb);
+    void SetStepCallback (StepCallback cb);
+
+    /**
+    * Encode the reports in the workers of a service
+    *
+    * \param service the encoder service
+    * \param cb the builder of the encoding jobs
+    */
+    void SetEncoderService (Ptr<KpmEncoderService> service, EncodeJobCallback cb);
+
+    /**
+    * \param kpiCb the source of the UE KPIs the policies are evaluated on
+    * \param decisionCb the callback applying the decisions of the policies
+    */
+    void SetPolicyCallbacks (UeKpiCallback kpiCb, PolicyDecisionCallback decisionCb);
+
+    /**
+    * Set the sources of the KPI tables of the structured indications of
+    * the embedded xApps. The UE KPIs are the ones the policies are
+    * evaluated on, as set by SetPolicyCallbacks.
+    */
+    void SetCellKpiCallback (CellKpiCallback cb);
+    void SetUeKpiCallback (UeKpiCallback cb);
+
+    /**
+    * Start reporting a subscription, replacing the subscription with the
+    * same RIC Request ID if any. May be called outside of the simulator
+    * thread, e.g., from the callbacks triggered by e2sim.
+    *
+    * \param subscription the parameters of the RIC subscription
+    */
+    void AddSubscription (const Subscription &subscription);
+
+    /**
+    * Stop reporting a subscription. May be called outside of the simulator
+    * thread.
+    *
+    * \param requestorId the RIC Requestor ID of the subscription
+    * \param instanceId the RIC Instance ID of the subscription
+    */
+    void RemoveSubscription (uint16_t requestorId, uint16_t instanceId);
+
+    /**
+    * Wait for the reports still being encoded by the encoder service and
+    * send them, e.g., at the end of the simulation
+    */
+    void FlushEncoded ();
+
+    /**
+    * \return the number of subscriptions being reported
+    */
+    uint32_t GetSubscriptionCount () const;
+
+    /**
+    * Start evaluating a policy at each tick of a period, replacing the
+    * policy with the same RIC Request ID if any. May be called outside of
+    * the simulator thread. RemoveSubscription removes the policy too.
+    *
+    * \param policy the policy, with the identifiers of its subscription
+    * \param periodMs the evaluation period in ms, 0 for the default period
+    */
+    void AddPolicy (Ptr<RcPolicy> policy, uint32_t periodMs = 0);
+
+    /**
+    * \return the number of policies being evaluated
+    */
+    uint32_t GetPolicyCount () const;
+
+    /**
+    * Start passing indications to an embedded xApp at each tick of its
+    * reporting period. To be called in the simulator thread, not from
+    * EmbeddedRic::OnIndication.
+    *
+    * \param ric the xApp
+    */
+    void AddEmbeddedRic (Ptr<EmbeddedRic> ric);
+
+    /**
+    * Stop passing indications to an embedded xApp. To be called in the
+    * simulator thread, not from EmbeddedRic::OnIndication.
+    *
+    * \param ric the xApp
+    */
+    void RemoveEmbeddedRic (Ptr<EmbeddedRic> ric);
+
+    /**
+    * \param now the current simulation time
+    * \param period the reporting period
+    * \return the delay to the next multiple of the period
+    */
+    static Time GetAlignedDelay (Time now, Time period);
+
+  protected:
+    virtual void DoDispose ();
+
+  private:
+    struct ScheduledSubscription
+    {
+      Subscription params; //!< parameters of the RIC subscription
+      long sequenceNumber; //!< RIC Indication SN of the next report
+    };
+
+    struct ScheduledRic
+    {
+      Ptr<EmbeddedRic> ric; //!< the xApp
+      Subscription params; //!< passed to the report callback in the encoded view
+      long sequenceNumber; //!< sequence number of the next indication
+    };
+
+    /**
+    * Report submitted to the encoder service, waiting to be sent
+    */
+    struct PendingReport
+    {
+      uint16_t requestorId; //!< RIC Requestor ID of the subscription
+      uint16_t instanceId; //!< RIC Instance ID of the subscription
+      std::shared_ptr<KpmEncodeJob> job;
+      std::shared_future<void> encoded; //!< ready once the job is encoded
+      Time submitted; //!< simulation time of the submission
+    };
+
+    /**
+    * Target of the drains requested by the workers, cleared at disposal
+    * so that a worker finishing late does not reach a disposed scheduler
+    */
+    struct DrainTarget
+    {
+      std::mutex mutex;
+      E2ReportScheduler *scheduler;
+    };
+
+    struct PeriodGroup
+    {
+      EventId tick; //!< next tick of the period
+      std::vector<ScheduledSubscription> subscriptions; //!< subscriptions of the period
+      std::vector<Ptr<RcPolicy>> policies; //!< policies evaluated every period
+      std::vector<ScheduledRic> rics; //!< embedded xApps of the period
+    };
+
+    void DoAddSubscription (Subscription subscription);
+    void DoRemoveSubscription (uint16_t requestorId, uint16_t instanceId);
+    void DoAddPolicy (Ptr<RcPolicy> policy, uint32_t periodMs);
+
+    /**
+    * \param periodMs the period in ms
+    * \return the group of the period, created with its first tick if needed
+    */
+    PeriodGroup &GetGroup (uint32_t periodMs);
+
+    /**
+    * Evaluate the policies of a period and apply their decisions
+    */
+    void EvaluatePolicies (const std::vector<Ptr<RcPolicy>> &policies);
+
+    /**
+    * Pass the indications of a period to the embedded xApps
+    */
+    void NotifyEmbeddedRics (Time period, std::vector<ScheduledRic> &rics);
+
+    /**
+    * Cancel the tick of a period and remove its group, if the group has
+    * nothing left to evaluate or report
+    *
+    * \param it the group
+    * \return the group following it
+    */
+    std::map<uint32_t, PeriodGroup>::iterator
+    RemoveGroupIfEmpty (std::map<uint32_t, PeriodGroup>::iterator it);
+
+    /**
+    * \return the subscription with a RIC Request ID, nullptr if not reported
+    */
+    ScheduledSubscription *FindSubscription (uint16_t requestorId, uint16_t instanceId);
+
+    /**
+    * Send a report with the next RIC Indication SN of its subscription
+    *
+    * \return false if the message is empty
+    */
+    bool SendReport (ScheduledSubscription &sub, Ptr<KpmIndicationHeader> header,
+                     Ptr<KpmIndicationMessage> message);
+
+    /**
+    * Schedule DrainEncoded in the simulator thread, called by the workers
+    * of the encoder service
+    */
+    void ScheduleDrain ();
+
+    /**
+    * Run the drain scheduled by a worker, if the scheduler is not disposed
+    */
+    static void DrainScheduled (std::shared_ptr<DrainTarget> target);
+
+    /**
+    * Send the encoded reports, in the order of their submission
+    *
+    * \param before the reports submitted before this time are waited for,
+    *        the following ones are sent only if already encoded
+    */
+    void DrainEncoded (Time before);
+
+    /**
+    * Collect, build and send the reports of the subscriptions of a period
+    *
+    * \param periodMs the reporting period in ms
+    */
+    void Tick (uint32_t periodMs);
+
+    Time m_defaultPeriod; //!< reporting period of the subscriptions without event trigger
+    CollectCallback m_collectCb;
+    ReportCallback m_reportCb;
+    SendCallback m_sendCb;
+    IndicationCallback m_indicationCb;
+    StepCallback m_stepCb;
+    UeKpiCallback m_ueKpiCb;
+    CellKpiCallback m_cellKpiCb;
+    PolicyDecisionCallback m_decisionCb;
+    Ptr<KpmEncoderService> m_encoder;
+    EncodeJobCallback m_jobCb;
+    std::deque<PendingReport> m_pending; //!< reports being encoded, in submission order
+    std::shared_ptr<DrainTarget> m_drainTarget; //!< shared with the completion callbacks
+    std::atomic<bool> m_drainScheduled; //!< true if DrainEncoded is already scheduled
+    uint32_t m_encodedSent; //!< encoded reports sent since the last step callback
+    std::vector<RcPolicy::Decision> m_decisions; //!< decisions of a tick, reused across ticks
+    std::map<uint32_t, PeriodGroup> m_groups; //!< subscriptions, policies and xApps, by period in ms
+  };
+}
+
+#endif /* E2_REPORT_SCHEDULER_H */
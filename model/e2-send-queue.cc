@@ -0,0 +1,186 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Northeastern University
+ * Copyright (c) 2022 Sapienza, University of Rome
+ * Copyright (c) 2022 University of Padova
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrea Lacava <thecave003@gmail.com>
+ *		   Tommaso Zugno <tommasozugno@gmail.com>
+ *		   Michele Polese <michele.polese@gmail.com>
+ */
+
+#include <ns3/e2-send-queue.h>
+#include <ns3/asn-struct-pool.h>
+#include <ns3/log.h>
+#include <ns3/abort.h>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("E2SendQueue");
+
+void
+E2SendQueue::PduDeleter::operator() (E2AP_PDU_t *pdu) const
+{
+  AsnStructPool::GetE2apPduPool ().Release (pdu);
+}
+
+E2SendQueue::E2SendQueue (size_t capacity)
+  : m_capacity (capacity),
+    m_pushed (0),
+    m_sent (0),
+    m_closed (false)
+{
+  NS_ABORT_MSG_IF (m_capacity == 0, "The E2 send queue needs a capacity of at least one message");
+}
+
+E2SendQueue::~E2SendQueue ()
+{
+  // messages never handed to the consumer are released here
+  m_messages.clear ();
+}
+
+bool
+E2SendQueue::Push (Message &&message)
+{
+  std::unique_lock<std::mutex> lock (m_mutex);
+  m_notFull.wait (lock, [this] { return m_closed || m_messages.size () < m_capacity; });
+  if (m_closed)
+    {
+      NS_LOG_WARN ("E2 send queue closed, message refused");
+      return false;
+    }
+  m_messages.push_back (std::move (message));
+  m_pushed++;
+  lock.unlock ();
+  m_notEmpty.notify_one ();
+  return true;
+}
+
+bool
+E2SendQueue::PushBatch (std::vector<Message> &&messages)
+{
+  if (messages.empty ())
+    {
+      return true;
+    }
+  std::unique_lock<std::mutex> lock (m_mutex);
+  m_notFull.wait (lock, [this, &messages] {
+    return m_closed || m_messages.empty () || m_messages.size () + messages.size () <= m_capacity;
+  });
+  if (m_closed)
+    {
+      NS_LOG_WARN ("E2 send queue closed, batch of " << messages.size () << " messages refused");
+      return false;
+    }
+  for (Message &message : messages)
+    {
+      m_messages.push_back (std::move (message));
+    }
+  m_pushed += messages.size ();
+  messages.clear ();
+  lock.unlock ();
+  m_notEmpty.notify_one ();
+  return true;
+}
+
+size_t
+E2SendQueue::Pop (std::vector<Message> &out)
+{
+  std::unique_lock<std::mutex> lock (m_mutex);
+  m_notEmpty.wait (lock, [this] { return m_closed || !m_messages.empty (); });
+  size_t count = m_messages.size ();
+  for (Message &message : m_messages)
+    {
+      out.push_back (std::move (message));
+    }
+  m_messages.clear ();
+  lock.unlock ();
+  if (count > 0)
+    {
+      m_notFull.notify_all ();
+    }
+  return count;
+}
+
+size_t
+E2SendQueue::TryPop (std::vector<Message> &out)
+{
+  std::unique_lock<std::mutex> lock (m_mutex);
+  size_t count = m_messages.size ();
+  for (Message &message : m_messages)
+    {
+      out.push_back (std::move (message));
+    }
+  m_messages.clear ();
+  lock.unlock ();
+  if (count > 0)
+    {
+      m_notFull.notify_all ();
+    }
+  return count;
+}
+
+void
+E2SendQueue::MarkSent (size_t count)
+{
+  std::unique_lock<std::mutex> lock (m_mutex);
+  m_sent += count;
+  bool drained = (m_sent == m_pushed);
+  lock.unlock ();
+  if (drained)
+    {
+      m_drained.notify_all ();
+    }
+}
+
+void
+E2SendQueue::WaitUntilDrained ()
+{
+  std::unique_lock<std::mutex> lock (m_mutex);
+  m_drained.wait (lock, [this] { return m_sent == m_pushed; });
+}
+
+void
+E2SendQueue::Close ()
+{
+  std::unique_lock<std::mutex> lock (m_mutex);
+  m_closed = true;
+  lock.unlock ();
+  m_notEmpty.notify_all ();
+  m_notFull.notify_all ();
+}
+
+size_t
+E2SendQueue::GetCapacity () const
+{
+  return m_capacity;
+}
+
+uint64_t
+E2SendQueue::GetPushedCount () const
+{
+  std::unique_lock<std::mutex> lock (m_mutex);
+  return m_pushed;
+}
+
+uint64_t
+E2SendQueue::GetSentCount () const
+{
+  std::unique_lock<std::mutex> lock (m_mutex);
+  return m_sent;
+}
+
+} // namespace ns3
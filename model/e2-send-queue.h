@@ -0,0 +1,160 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Northeastern University
+ * Copyright (c) 2022 Sapienza, University of Rome
+ * Copyright (c) 2022 University of Padova
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrea Lacava <thecave003@gmail.com>
+ *		   Tommaso Zugno <tommasozugno@gmail.com>
+ *		   Michele Polese <michele.polese@gmail.com>
+ */
+
+#ifndef E2_SEND_QUEUE_H
+#define E2_SEND_QUEUE_H
+
+#include <ns3/kpm-encode-buffer.h>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <stdint.h>
+
+extern "C" {
+  #include "E2AP-PDU.h"
+}
+
+namespace ns3 {
+
+  /**
+  * Bounded multi-producer queue of E2 messages waiting to be written to the
+  * RIC socket. A message is either a fully built E2AP PDU, owned by the
+  * queue and encoded by the consumer, or the APER encoding of a PDU.
+  * Producers (the simulator thread and the e2sim thread) hand the messages
+  * over with Push; a single consumer (the sender thread of the E2
+  * termination, or a sender thread of its E2TerminationManager at a time)
+  * takes them out with Pop or TryPop, sends them and acknowledges them with
+  * MarkSent, so that WaitUntilDrained can block until the socket has
+  * actually been written.
+  */
+  class E2SendQueue
+  {
+  public:
+    /**
+    * Releases a PDU handed over to the queue to the E2AP PDU pool
+    */
+    struct PduDeleter
+    {
+      void operator() (E2AP_PDU_t *pdu) const;
+    };
+
+    /**
+    * PDU owned by the queue, allocated with malloc or calloc
+    */
+    typedef std::unique_ptr<E2AP_PDU_t, PduDeleter> PduPtr;
+
+    /**
+    * E2 message waiting to be sent
+    */
+    struct Message
+    {
+      PduPtr pdu; //!< PDU to be encoded by the consumer, nullptr if already encoded
+      KpmEncodeBuffer::Block encoded; //!< APER encoding of the PDU, if pdu is nullptr
+    };
+
+    /**
+    * \param capacity maximum number of messages waiting in the queue; Push
+    *        blocks the producer while the queue is full
+    */
+    E2SendQueue (size_t capacity);
+    ~E2SendQueue ();
+
+    /**
+    * Enqueue a message.
+    *
+    * \param message the message to send, moved into the queue if accepted
+    * \return false if the queue has been closed, in which case the message
+    *         is left to the caller
+    */
+    bool Push (Message &&message);
+
+    /**
+    * Enqueue a batch of messages with a single hand-over to the consumer,
+    * so that they are sent back to back in the same wakeup of the sender
+    * thread. A batch larger than the capacity is accepted once the queue is
+    * empty.
+    *
+    * \param messages the messages to send, in order, moved into the queue
+    *        if accepted
+    * \return false if the queue has been closed, in which case the messages
+    *         are left to the caller
+    */
+    bool PushBatch (std::vector<Message> &&messages);
+
+    /**
+    * Dequeue all the messages currently waiting, blocking until at least
+    * one is available or the queue is closed.
+    *
+    * \param out vector to which the messages are appended
+    * \return the number of messages appended, 0 if the queue is closed and empty
+    */
+    size_t Pop (std::vector<Message> &out);
+
+    /**
+    * Dequeue all the messages currently waiting, without blocking.
+    *
+    * \param out vector to which the messages are appended
+    * \return the number of messages appended
+    */
+    size_t TryPop (std::vector<Message> &out);
+
+    /**
+    * Acknowledge that a number of messages previously returned by Pop have
+    * been written to the socket.
+    *
+    * \param count number of messages sent
+    */
+    void MarkSent (size_t count);
+
+    /**
+    * Block until every message pushed so far has been sent.
+    */
+    void WaitUntilDrained ();
+
+    /**
+    * Close the queue: pending messages are still returned by Pop, new
+    * ones are refused.
+    */
+    void Close ();
+
+    size_t GetCapacity () const;
+    uint64_t GetPushedCount () const;
+    uint64_t GetSentCount () const;
+
+  private:
+    mutable std::mutex m_mutex;
+    std::condition_variable m_notEmpty; //!< signaled to the consumer
+    std::condition_variable m_notFull; //!< signaled to blocked producers
+    std::condition_variable m_drained; //!< signaled to WaitUntilDrained
+    std::deque<Message> m_messages; //!< messages waiting to be sent
+    size_t m_capacity; //!< maximum size of m_messages
+    uint64_t m_pushed; //!< messages accepted so far
+    uint64_t m_sent; //!< messages acknowledged by the consumer so far
+    bool m_closed;
+  };
+}
+
+#endif /* E2_SEND_QUEUE_H */
@@ -0,0 +1,370 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Northeastern University
+ * Copyright (c) 2022 Sapienza, University of Rome
+ * Copyright (c) 2022 University of Padova
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrea Lacava <thecave003@gmail.com>
+ *		   Tommaso Zugno <tommasozugno@gmail.com>
+ *		   Michele Polese <michele.polese@gmail.com>
+ */
+
+
+#include <ns3/e2-termination-manager.h>
+#include <ns3/log.h>
+#include <ns3/uinteger.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <functional>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("E2TerminationManager");
+
+NS_OBJECT_ENSURE_REGISTERED (E2TerminationManager);
+
+// events handled per wakeup of a receive thread
+static const int MAX_POLLED_EVENTS = 64;
+
+TypeId
+E2TerminationManager::GetTypeId ()
+{
+  static TypeId tid =
+      TypeId ("ns3::E2TerminationManager")
+          .SetParent<Object> ()
+          .AddConstructor<E2TerminationManager> ()
+          .AddAttribute ("SenderThreads",
+                         "Number of threads encoding and writing the E2 messages of all "
+                         "the hosted terminations. With zero, one per core, but no more "
+                         "than the number of terminations.",
+                         UintegerValue (0),
+                         MakeUintegerAccessor (&E2TerminationManager::m_senderThreadCount),
+                         MakeUintegerChecker<uint32_t> ())
+          .AddAttribute ("ReceiveThreads",
+                         "Number of threads polling the E2 connections of all the hosted "
+                         "terminations. With zero, one per core, but no more than the "
+                         "number of terminations.",
+                         UintegerValue (0),
+                         MakeUintegerAccessor (&E2TerminationManager::m_receiveThreadCount),
+                         MakeUintegerChecker<uint32_t> ());
+  return tid;
+}
+
+E2TerminationManager::E2TerminationManager ()
+  : m_senderThreadCount (0),
+    m_receiveThreadCount (0),
+    m_stopping (false)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+E2TerminationManager::~E2TerminationManager ()
+{
+  NS_LOG_FUNCTION (this);
+  Stop ();
+}
+
+void
+E2TerminationManager::DoDispose ()
+{
+  NS_LOG_FUNCTION (this);
+  Stop ();
+  for (Ptr<E2Termination> termination : m_terminations)
+    {
+      termination->m_manager = nullptr;
+    }
+  m_terminations.clear ();
+  {
+    std::unique_lock<std::mutex> lock (m_handlersMutex);
+    m_handlers.clear ();
+  }
+  Object::DoDispose ();
+}
+
+void
+E2TerminationManager::AddTermination (Ptr<E2Termination> termination)
+{
+  NS_LOG_FUNCTION (this << termination);
+  NS_ABORT_MSG_IF (!m_senderThreads.empty (), "E2 termination manager already started");
+  NS_ABORT_MSG_IF (termination->m_sendQueue, "E2 termination already started");
+  NS_ABORT_MSG_IF (termination->m_manager, "E2 termination already hosted by a manager");
+  termination->m_manager = this;
+  m_terminations.push_back (termination);
+}
+
+void
+E2TerminationManager::RegisterKpmHandler (Ptr<E2Termination> termination, long ranFunctionId,
+                                          Ptr<FunctionDescription> ranFunctionDescription,
+                                          E2MessageHandler handler)
+{
+  NS_ABORT_MSG_IF (termination->m_manager != this, "E2 termination not hosted by this manager");
+  {
+    std::unique_lock<std::mutex> lock (m_handlersMutex);
+    m_handlers[std::make_pair (PeekPointer (termination), ranFunctionId)] = handler;
+  }
+  termination->RegisterKpmCallbackToE2Sm (
+      ranFunctionId, ranFunctionDescription,
+      std::bind (&E2TerminationManager::Dispatch, this, PeekPointer (termination), ranFunctionId,
+                 std::placeholders::_1));
+}
+
+void
+E2TerminationManager::RegisterSmHandler (Ptr<E2Termination> termination, long ranFunctionId,
+                                         Ptr<FunctionDescription> ranFunctionDescription,
+                                         E2MessageHandler handler)
+{
+  NS_ABORT_MSG_IF (termination->m_manager != this, "E2 termination not hosted by this manager");
+  {
+    std::unique_lock<std::mutex> lock (m_handlersMutex);
+    m_handlers[std::make_pair (PeekPointer (termination), ranFunctionId)] = handler;
+  }
+  termination->RegisterSmCallbackToE2Sm (
+      ranFunctionId, ranFunctionDescription,
+      std::bind (&E2TerminationManager::Dispatch, this, PeekPointer (termination), ranFunctionId,
+                 std::placeholders::_1));
+}
+
+void
+E2TerminationManager::Start ()
+{
+  NS_LOG_FUNCTION (this);
+  NS_ABORT_MSG_IF (!m_senderThreads.empty (), "E2 termination manager already started");
+  NS_ABORT_MSG_IF (m_terminations.empty (), "No E2 termination to start");
+
+  uint32_t threads = m_senderThreadCount;
+  if (threads == 0)
+    {
+      threads = std::max<uint32_t> (std::thread::hardware_concurrency (), 1);
+    }
+  threads = std::min<uint32_t> (threads, m_terminations.size ());
+  NS_LOG_INFO ("Start " << m_terminations.size () << " E2 terminations with " << threads
+                        << " sender threads");
+
+  // the sender threads must be ready before e2sim can trigger any callback
+  m_stopping = false;
+  for (uint32_t i = 0; i < threads; i++)
+    {
+      m_senderThreads.emplace_back (&E2TerminationManager::DoSend, this);
+    }
+  for (Ptr<E2Termination> termination : m_terminations)
+    {
+      termination->Start ();
+    }
+
+  uint32_t receivers = m_receiveThreadCount;
+  if (receivers == 0)
+    {
+      receivers = std::max<uint32_t> (std::thread::hardware_concurrency (), 1);
+    }
+  receivers = std::min<uint32_t> (receivers, m_terminations.size ());
+  for (uint32_t i = 0; i < receivers; i++)
+    {
+      Poller poller;
+      poller.epollFd = epoll_create1 (EPOLL_CLOEXEC);
+      poller.wakeFd = eventfd (0, EFD_CLOEXEC);
+      NS_ABORT_MSG_IF (poller.epollFd < 0 || poller.wakeFd < 0,
+                       "Cannot create the receive poller: " << strerror (errno));
+      struct epoll_event event = {};
+      event.events = EPOLLIN;
+      event.data.ptr = nullptr;
+      epoll_ctl (poller.epollFd, EPOLL_CTL_ADD, poller.wakeFd, &event);
+      m_pollers.push_back (poller);
+    }
+  // each socket is polled by a single thread, so that its messages are
+  // handled in order
+  for (size_t t = 0; t < m_terminations.size (); t++)
+    {
+      struct epoll_event event = {};
+      event.events = EPOLLIN;
+      event.data.ptr = PeekPointer (m_terminations[t]);
+      NS_ABORT_MSG_IF (epoll_ctl (m_pollers[t % receivers].epollFd, EPOLL_CTL_ADD,
+                                  m_terminations[t]->m_socket, &event) < 0,
+                       "Cannot poll the E2 connection: " << strerror (errno));
+    }
+  NS_LOG_INFO ("Poll the E2 connections with " << receivers << " receive threads");
+  for (const Poller &poller : m_pollers)
+    {
+      m_receiveThreads.emplace_back (&E2TerminationManager::DoReceive, this, poller.epollFd);
+    }
+}
+
+uint32_t
+E2TerminationManager::GetTerminationCount () const
+{
+  return m_terminations.size ();
+}
+
+uint32_t
+E2TerminationManager::GetSenderThreadCount () const
+{
+  return m_senderThreads.size ();
+}
+
+uint32_t
+E2TerminationManager::GetReceiveThreadCount () const
+{
+  return m_receiveThreads.size ();
+}
+
+void
+E2TerminationManager::NotifyPendingMessages (E2Termination *termination)
+{
+  std::unique_lock<std::mutex> lock (m_readyMutex);
+  // a termination already queued or being served is not queued twice, so
+  // that its PDUs are never sent by two threads at once
+  if (m_queued.insert (termination).second)
+    {
+      m_ready.push_back (termination);
+      lock.unlock ();
+      m_readyCv.notify_one ();
+    }
+}
+
+void
+E2TerminationManager::DoSend ()
+{
+  NS_LOG_FUNCTION (this);
+  std::unique_lock<std::mutex> lock (m_readyMutex);
+  while (true)
+    {
+      m_readyCv.wait (lock, [this] { return m_stopping || !m_ready.empty (); });
+      if (m_ready.empty ())
+        {
+          break;
+        }
+      E2Termination *termination = m_ready.front ();
+      m_ready.pop_front ();
+      lock.unlock ();
+
+      // one round per termination, then the other terminations get a turn
+      termination->SendPendingMessages ();
+
+      lock.lock ();
+      m_queued.erase (termination);
+      if (termination->HasPendingMessages ())
+        {
+          m_queued.insert (termination);
+          m_ready.push_back (termination);
+          m_readyCv.notify_one ();
+        }
+    }
+  NS_LOG_DEBUG ("Sender thread of the E2 termination manager stopped");
+}
+
+void
+E2TerminationManager::DoReceive (int epollFd)
+{
+  NS_LOG_FUNCTION (this << epollFd);
+  struct epoll_event events[MAX_POLLED_EVENTS];
+  while (true)
+    {
+      int count = epoll_wait (epollFd, events, MAX_POLLED_EVENTS, -1);
+      if (count < 0)
+        {
+          if (errno == EINTR)
+            {
+              continue;
+            }
+          NS_LOG_ERROR ("Cannot poll the E2 connections: " << strerror (errno));
+          return;
+        }
+      for (int i = 0; i < count; i++)
+        {
+          auto *termination = (E2Termination *) events[i].data.ptr;
+          if (termination == nullptr)
+            {
+              NS_LOG_DEBUG ("Receive thread of the E2 termination manager stopped");
+              return;
+            }
+          if (!termination->ReceiveMessage ())
+            {
+              // closed, not polled anymore
+              epoll_ctl (epollFd, EPOLL_CTL_DEL, termination->m_socket, nullptr);
+            }
+        }
+    }
+}
+
+void
+E2TerminationManager::Dispatch (E2Termination *termination, long ranFunctionId,
+                                E2AP_PDU_t *pdu)
+{
+  E2MessageHandler handler;
+  {
+    std::unique_lock<std::mutex> lock (m_handlersMutex);
+    auto it = m_handlers.find (std::make_pair (termination, ranFunctionId));
+    if (it == m_handlers.end ())
+      {
+        NS_LOG_WARN ("No handler for RAN function " << ranFunctionId);
+        return;
+      }
+    handler = it->second;
+  }
+  // no Ptr is built here: its reference count would race with the simulator thread
+  handler (termination, pdu);
+}
+
+void
+E2TerminationManager::Stop ()
+{
+  if (m_senderThreads.empty ())
+    {
+      return;
+    }
+  NS_LOG_FUNCTION (this);
+
+  // no message is received from now on
+  for (const Poller &poller : m_pollers)
+    {
+      uint64_t wake = 1;
+      NS_ABORT_MSG_IF (write (poller.wakeFd, &wake, sizeof (wake)) < 0,
+                       "Cannot stop the receive threads: " << strerror (errno));
+    }
+  for (std::thread &thread : m_receiveThreads)
+    {
+      thread.join ();
+    }
+  m_receiveThreads.clear ();
+  for (const Poller &poller : m_pollers)
+    {
+      close (poller.epollFd);
+      close (poller.wakeFd);
+    }
+  m_pollers.clear ();
+
+  // the pending PDUs of every termination are sent before the pool exits
+  for (Ptr<E2Termination> termination : m_terminations)
+    {
+      termination->StopSender ();
+      termination->m_manager = nullptr;
+    }
+  {
+    std::unique_lock<std::mutex> lock (m_readyMutex);
+    m_stopping = true;
+  }
+  m_readyCv.notify_all ();
+  for (std::thread &thread : m_senderThreads)
+    {
+      thread.join ();
+    }
+  m_senderThreads.clear ();
+}
+
+} // namespace ns3
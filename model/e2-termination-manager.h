@@ -0,0 +1,187 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Northeastern University
+ * Copyright (c) 2022 Sapienza, University of Rome
+ * Copyright (c) 2022 University of Padova
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrea Lacava <thecave003@gmail.com>
+ *		   Tommaso Zugno <tommasozugno@gmail.com>
+ *		   Michele Polese <michele.polese@gmail.com>
+ */
+
+
+#ifndef E2_TERMINATION_MANAGER_H
+#define E2_TERMINATION_MANAGER_H
+
+#include <ns3/object.h>
+#include <ns3/callback.h>
+#include <ns3/oran-interface.h>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace ns3 {
+
+  /**
+  * Host of many E2 terminations, e.g., one per simulated E2 node.
+  * Instead of a sender thread per termination, the PDUs of all the hosted
+  * terminations are encoded and written by a fixed pool of sender threads,
+  * sized on the number of cores. The PDUs of a termination are sent by one
+  * thread of the pool at a time, in order.
+  * The E2 connections of the terminations are polled by a fixed pool of
+  * receive threads, each with its own epoll instance and its share of the
+  * sockets. A received message is handled by e2sim in the receive thread of
+  * its socket, and dispatched through a single table, by termination and
+  * RAN Function ID.
+  */
+  class E2TerminationManager : public Object
+  {
+  public:
+    /**
+    * Handler of the messages received by a termination for a RAN function.
+    * With ReceiveInSimulatorThread false, it is called in the receive thread
+    * polling the termination: the termination is passed as a raw pointer, since
+    * the reference count of a Ptr is not thread safe, and is to be wrapped
+    * in a Ptr only in the simulator thread.
+    */
+    typedef Callback<void, E2Termination *, E2AP_PDU_t *> E2MessageHandler;
+
+    E2TerminationManager ();
+    virtual ~E2TerminationManager ();
+
+    static TypeId GetTypeId ();
+
+    /**
+    * Host a termination. Must be called before Start.
+    *
+    * \param termination the termination, not started yet
+    */
+    void AddTermination (Ptr<E2Termination> termination);
+
+    /**
+    * Register a KPM RAN function to a hosted termination. The RIC
+    * Subscription Requests for the function are passed to the handler.
+    *
+    * \param termination the termination
+    * \param ranFunctionId the RAN Function ID
+    * \param ranFunctionDescription the RAN Function Description
+    * \param handler the handler of the subscription requests
+    */
+    void RegisterKpmHandler (Ptr<E2Termination> termination, long ranFunctionId,
+                             Ptr<FunctionDescription> ranFunctionDescription,
+                             E2MessageHandler handler);
+
+    /**
+    * Register a RAN function to a hosted termination. The messages of the
+    * service model for the function are passed to the handler.
+    *
+    * \param termination the termination
+    * \param ranFunctionId the RAN Function ID
+    * \param ranFunctionDescription the RAN Function Description
+    * \param handler the handler of the messages
+    */
+    void RegisterSmHandler (Ptr<E2Termination> termination, long ranFunctionId,
+                            Ptr<FunctionDescription> ranFunctionDescription,
+                            E2MessageHandler handler);
+
+    /**
+    * Start the sender threads, then all the hosted terminations, then the
+    * receive threads polling their connections
+    */
+    void Start ();
+
+    uint32_t GetTerminationCount () const;
+
+    /**
+    * \return the number of sender threads, once started
+    */
+    uint32_t GetSenderThreadCount () const;
+
+    /**
+    * \return the number of receive threads, once started
+    */
+    uint32_t GetReceiveThreadCount () const;
+
+  protected:
+    virtual void DoDispose ();
+
+  private:
+    friend class E2Termination;
+
+    /**
+    * Queue a termination whose send queue has PDUs to be sent.
+    * Thread safe.
+    *
+    * \param termination the termination
+    */
+    void NotifyPendingMessages (E2Termination *termination);
+
+    /**
+    * Body of the sender threads
+    */
+    void DoSend ();
+
+    /**
+    * Body of the receive threads: receive the messages of the sockets
+    * polled by an epoll instance, until woken by Stop
+    *
+    * \param epollFd the epoll instance of the thread
+    */
+    void DoReceive (int epollFd);
+
+    /**
+    * Pass a received message to the handler registered for the
+    * termination and the RAN function. Called by the receive threads.
+    */
+    void Dispatch (E2Termination *termination, long ranFunctionId, E2AP_PDU_t *pdu);
+
+    /**
+    * Join the receive threads, then drain the hosted terminations and join
+    * the sender threads
+    */
+    void Stop ();
+
+    /**
+    * epoll instance of a receive thread, and the event waking it up
+    */
+    struct Poller
+    {
+      int epollFd;
+      int wakeFd;
+    };
+
+    uint32_t m_senderThreadCount; //!< size of the sender pool, 0 for the number of cores
+    uint32_t m_receiveThreadCount; //!< size of the receive pool, 0 for the number of cores
+    std::vector<Poller> m_pollers; //!< one per receive thread
+    std::vector<std::thread> m_receiveThreads; //!< receive pool
+    std::vector<Ptr<E2Termination>> m_terminations; //!< hosted terminations
+    std::vector<std::thread> m_senderThreads; //!< sender pool
+    std::mutex m_readyMutex; //!< protects m_ready, m_queued and m_stopping
+    std::condition_variable m_readyCv; //!< signaled to the sender threads
+    std::deque<E2Termination *> m_ready; //!< terminations with PDUs to be sent
+    std::set<E2Termination *> m_queued; //!< terminations in m_ready or being served
+    bool m_stopping; //!< true once the sender threads are asked to exit
+    mutable std::mutex m_handlersMutex; //!< protects m_handlers
+    std::map<std::pair<E2Termination *, long>, E2MessageHandler>
+        m_handlers; //!< handlers, by termination and RAN Function ID
+  };
+}
+
+#endif /* E2_TERMINATION_MANAGER_H */
@@ -0,0 +1,114 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Northeastern University
+ * Copyright (c) 2022 Sapienza, University of Rome
+ * Copyright (c) 2022 University of Padova
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrea Lacava <thecave003@gmail.com>
+ *		   Tommaso Zugno <tommasozugno@gmail.com>
+ *		   Michele Polese <michele.polese@gmail.com>
+ */
+
+#include <ns3/embedded-ric.h>
+#include <ns3/oran-interface.h>
+#include <ns3/log.h>
+#include <ns3/boolean.h>
+#include <ns3/uinteger.h>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("EmbeddedRic");
+
+NS_OBJECT_ENSURE_REGISTERED (EmbeddedRic);
+
+TypeId
+EmbeddedRic::GetTypeId ()
+{
+  static TypeId tid =
+      TypeId ("ns3::EmbeddedRic")
+          .SetParent<Object> ()
+          .AddAttribute ("StructuredView",
+                         "If true, the indications carry the KPI tables of the period "
+                         "instead of the encoded E2SM-KPM reports",
+                         BooleanValue (true),
+                         MakeBooleanAccessor (&EmbeddedRic::m_structuredView),
+                         MakeBooleanChecker ())
+          .AddAttribute ("ReportingPeriod",
+                         "Period of the indications passed to the xApp. Must be set "
+                         "before the xApp is attached to the termination.",
+                         TimeValue (MilliSeconds (100)),
+                         MakeTimeAccessor (&EmbeddedRic::m_reportingPeriod),
+                         MakeTimeChecker (MilliSeconds (1)))
+          .AddAttribute ("RanFunctionId",
+                         "KPM RAN Function of the indications, passed to the report "
+                         "callback in the encoded view",
+                         UintegerValue (200),
+                         MakeUintegerAccessor (&EmbeddedRic::m_ranFunctionId),
+                         MakeUintegerChecker<uint16_t> ());
+  return tid;
+}
+
+EmbeddedRic::EmbeddedRic ()
+  : m_termination (nullptr),
+    m_structuredView (true),
+    m_reportingPeriod (MilliSeconds (100)),
+    m_ranFunctionId (200)
+{
+}
+
+EmbeddedRic::~EmbeddedRic ()
+{
+}
+
+void
+EmbeddedRic::DoDispose ()
+{
+  m_termination = nullptr;
+  Object::DoDispose ();
+}
+
+void
+EmbeddedRic::SetTermination (E2Termination *termination)
+{
+  m_termination = termination;
+}
+
+void
+EmbeddedRic::SendControl (Ptr<RicControlMessage> control)
+{
+  NS_ABORT_MSG_IF (m_termination == nullptr, "Embedded RIC not attached to an E2 termination");
+  m_termination->SubmitControl (control->m_ranFunctionId, control);
+}
+
+bool
+EmbeddedRic::IsStructuredView () const
+{
+  return m_structuredView;
+}
+
+Time
+EmbeddedRic::GetReportingPeriod () const
+{
+  return m_reportingPeriod;
+}
+
+uint16_t
+EmbeddedRic::GetRanFunctionId () const
+{
+  return m_ranFunctionId;
+}
+
+} // namespace ns3
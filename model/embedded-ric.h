@@ -0,0 +1,110 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Northeastern University
+ * Copyright (c) 2022 Sapienza, University of Rome
+ * Copyright (c) 2022 University of Padova
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrea Lacava <thecave003@gmail.com>
+ *		   Tommaso Zugno <tommasozugno@gmail.com>
+ *		   Michele Polese <michele.polese@gmail.com>
+ */
+
+#ifndef EMBEDDED_RIC_H
+#define EMBEDDED_RIC_H
+
+#include <ns3/object.h>
+#include <ns3/nstime.h>
+#include <ns3/kpi-table.h>
+#include <ns3/kpm-indication.h>
+#include <ns3/ric-control-message.h>
+
+namespace ns3 {
+
+  class E2Termination;
+
+  /**
+  * xApp running in the simulator process, attached to an E2 termination
+  * with E2Termination::SetEmbeddedRic. The report scheduler of the
+  * termination passes it the indications of the E2 node at each tick of its
+  * reporting period, with neither the E2AP layer nor the SCTP connection,
+  * and its controls go through the same coalescing stage and handlers as
+  * the RIC Control Requests of a remote RIC.
+  * With the structured view, an indication carries the KPI tables of the
+  * period and nothing is encoded; otherwise it carries the E2SM-KPM header
+  * and message built by the report callback of the scheduler, as a remote
+  * RIC would receive them.
+  */
+  class EmbeddedRic : public Object
+  {
+  public:
+    /**
+    * Reports of a period passed to the xApp
+    */
+    struct Indication
+    {
+      uint16_t ranFunctionId; //!< KPM RAN Function of the reports
+      long sequenceNumber; //!< incremented at each indication
+      Time period; //!< reporting period
+      Ptr<const KpiTable> cellTable; //!< cell KPIs, structured view only
+      Ptr<const KpiTable> ueTable; //!< UE KPIs, structured view only
+      Ptr<KpmIndicationHeader> header; //!< encoded header, encoded view only
+      Ptr<KpmIndicationMessage> message; //!< encoded message, encoded view only
+    };
+
+    EmbeddedRic ();
+    virtual ~EmbeddedRic ();
+
+    static TypeId GetTypeId ();
+
+    /**
+    * Called in the simulator thread at each tick of the reporting period.
+    * The tables of a structured indication are only valid during the call.
+    *
+    * \param indication the reports of the period
+    */
+    virtual void OnIndication (const Indication &indication) = 0;
+
+    /**
+    * Apply a control through the handler of its control action, as a RIC
+    * Control Request received from the RIC. No response is sent for it; a
+    * control rejected by its handler is only logged.
+    *
+    * \param control the control, built from its actions
+    */
+    void SendControl (Ptr<RicControlMessage> control);
+
+    /**
+    * \param termination the termination the xApp is attached to, nullptr
+    *        to detach it. Called by E2Termination::SetEmbeddedRic.
+    */
+    void SetTermination (E2Termination *termination);
+
+    bool IsStructuredView () const;
+    Time GetReportingPeriod () const;
+    uint16_t GetRanFunctionId () const;
+
+  protected:
+    virtual void DoDispose ();
+
+  private:
+    E2Termination *m_termination; //!< not owned, the termination owns the xApp
+    bool m_structuredView; //!< pass the KPI tables instead of the encoded reports
+    Time m_reportingPeriod; //!< period of the indications
+    uint16_t m_ranFunctionId; //!< KPM RAN Function of the indications
+  };
+}
+
+#endif /* EMBEDDED_RIC_H */
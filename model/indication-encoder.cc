@@ -0,0 +1,361 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Northeastern University
+ * Copyright (c) 2022 Sapienza, University of Rome
+ * Copyright (c) 2022 University of Padova
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrea Lacava <thecave003@gmail.com>
+ *		   Tommaso Zugno <tommasozugno@gmail.com>
+ *		   Michele Polese <michele.polese@gmail.com>
+ */
+
+#include <ns3/indication-encoder.h>
+#include <ns3/asn-struct-pool.h>
+#include <ns3/log.h>
+#include <ns3/abort.h>
+#include <string.h>
+#include "encode_e2apv1.hpp"
+
+extern "C" {
+  #include "ProtocolIE-ID.h"
+  #include "ProcedureCode.h"
+}
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("IndicationEncoder");
+
+/**
+ * \return the size of the APER length determinant of a length, 0 if it
+ *         needs fragmentation
+ */
+static size_t
+LengthSize (size_t length)
+{
+  if (length < 128)
+    {
+      return 1;
+    }
+  if (length < 16384)
+    {
+      return 2;
+    }
+  return 0;
+}
+
+static uint8_t *
+PutLength (uint8_t *out, size_t length)
+{
+  if (length < 128)
+    {
+      *out++ = length;
+    }
+  else
+    {
+      *out++ = 0x80 | (length >> 8);
+      *out++ = length & 0xFF;
+    }
+  return out;
+}
+
+/**
+ * Read an APER length determinant of up to two octets
+ *
+ * \param pos the position of the determinant, moved past it
+ * \return false if the determinant is truncated or fragmented
+ */
+static bool
+GetLength (const std::vector<uint8_t> &encoded, size_t &pos, size_t &length)
+{
+  if (pos >= encoded.size ())
+    {
+      return false;
+    }
+  uint8_t first = encoded[pos++];
+  if ((first & 0x80) == 0)
+    {
+      length = first;
+      return true;
+    }
+  if ((first & 0xC0) == 0xC0 || pos >= encoded.size ())
+    {
+      return false;
+    }
+  length = ((first & 0x3F) << 8) | encoded[pos++];
+  return true;
+}
+
+E2AP_PDU_t *
+IndicationEncoder::BuildIndication (long requestorId, long instanceId, long ranFunctionId,
+                                    long actionId, long sequenceNumber, const uint8_t *header,
+                                    size_t headerSize, const uint8_t *message,
+                                    size_t messageSize)
+{
+  E2AP_PDU_t *pdu = AsnStructPool::GetE2apPduPool ().Acquire<E2AP_PDU_t> ();
+  encoding::generate_e2apv1_indication_request_parameterized (
+      pdu, requestorId, instanceId, ranFunctionId, actionId, sequenceNumber,
+      const_cast<uint8_t *> (header), headerSize, const_cast<uint8_t *> (message), messageSize);
+  return pdu;
+}
+
+std::vector<uint8_t>
+IndicationEncoder::EncodeIndication (long requestorId, long instanceId, long ranFunctionId,
+                                     long actionId, long sequenceNumber,
+                                     const std::vector<uint8_t> &header,
+                                     const std::vector<uint8_t> &message)
+{
+  E2AP_PDU_t *pdu = BuildIndication (requestorId, instanceId, ranFunctionId, actionId,
+                                     sequenceNumber, header.data (), header.size (),
+                                     message.data (), message.size ());
+  asn_encode_to_new_buffer_result_t res =
+      asn_encode_to_new_buffer (nullptr, ATS_ALIGNED_BASIC_PER, &asn_DEF_E2AP_PDU, pdu);
+  AsnStructPool::GetE2apPduPool ().Release (pdu);
+  NS_ABORT_MSG_IF (res.buffer == nullptr, "Cannot encode the RIC Indication");
+  std::vector<uint8_t> encoded ((uint8_t *) res.buffer, (uint8_t *) res.buffer + res.result.encoded);
+  free (res.buffer);
+  return encoded;
+}
+
+bool
+IndicationEncoder::Parse (const std::vector<uint8_t> &encoded, Skeleton &skeleton)
+{
+  // APER layout: initiatingMessage choice, procedure code, criticality and
+  // the RIC Indication as an open type, i.e., a length determinant followed
+  // by its extension bit, the number of IEs and the IEs; each IE is its ID,
+  // its criticality and its value as an open type
+  if (encoded.size () < 6 || encoded[0] != 0 || encoded[1] != ProcedureCode_id_RICindication)
+    {
+      return false;
+    }
+  memcpy (skeleton.prefix, encoded.data (), 3);
+  size_t pos = 3;
+  size_t length;
+  if (!GetLength (encoded, pos, length) || pos + length != encoded.size () ||
+      pos + 3 > encoded.size ())
+    {
+      return false;
+    }
+  skeleton.preamble = encoded[pos];
+  size_t count = (encoded[pos + 1] << 8) | encoded[pos + 2];
+  pos += 3;
+
+  uint32_t found = 0;
+  for (size_t i = 0; i < count; i++)
+    {
+      if (pos + 3 > encoded.size ())
+        {
+          return false;
+        }
+      Ie ie;
+      memcpy (ie.prefix, encoded.data () + pos, 3);
+      long id = (encoded[pos] << 8) | encoded[pos + 1];
+      pos += 3;
+      if (!GetLength (encoded, pos, length) || pos + length > encoded.size ())
+        {
+          return false;
+        }
+
+      size_t inner = pos;
+      size_t octets;
+      switch (id)
+        {
+        case ProtocolIE_ID_id_RICindicationSN:
+          if (length != 2)
+            {
+              return false;
+            }
+          ie.kind = Ie::SEQUENCE_NUMBER;
+          found++;
+          break;
+        case ProtocolIE_ID_id_RICindicationHeader:
+        case ProtocolIE_ID_id_RICindicationMessage:
+          // an octet string, with its own length determinant
+          if (!GetLength (encoded, inner, octets) || inner + octets != pos + length)
+            {
+              return false;
+            }
+          ie.kind = id == ProtocolIE_ID_id_RICindicationHeader ? Ie::HEADER : Ie::MESSAGE;
+          found++;
+          break;
+        default:
+          ie.kind = Ie::FIXED;
+          ie.value.assign (encoded.begin () + pos, encoded.begin () + pos + length);
+          break;
+        }
+      pos += length;
+      skeleton.ies.push_back (std::move (ie));
+    }
+  return pos == encoded.size () && found == 3;
+}
+
+size_t
+IndicationEncoder::Compose (const Skeleton &skeleton, long sequenceNumber, const uint8_t *header,
+                            size_t headerSize, const uint8_t *message, size_t messageSize,
+                            uint8_t *out, size_t capacity)
+{
+  // sizes first, so that the payloads are written once at their place
+  if (LengthSize (headerSize) == 0 || LengthSize (messageSize) == 0)
+    {
+      return 0;
+    }
+  size_t headerValue = LengthSize (headerSize) + headerSize;
+  size_t messageValue = LengthSize (messageSize) + messageSize;
+  size_t body = 3;
+  for (const Ie &ie : skeleton.ies)
+    {
+      size_t value = 2;
+      if (ie.kind == Ie::FIXED)
+        {
+          value = ie.value.size ();
+        }
+      else if (ie.kind == Ie::HEADER)
+        {
+          value = headerValue;
+        }
+      else if (ie.kind == Ie::MESSAGE)
+        {
+          value = messageValue;
+        }
+      if (LengthSize (value) == 0)
+        {
+          return 0;
+        }
+      body += 3 + LengthSize (value) + value;
+    }
+  if (LengthSize (body) == 0 || 3 + LengthSize (body) + body > capacity)
+    {
+      return 0;
+    }
+
+  uint8_t *pos = out;
+  memcpy (pos, skeleton.prefix, 3);
+  pos = PutLength (pos + 3, body);
+  *pos++ = skeleton.preamble;
+  *pos++ = skeleton.ies.size () >> 8;
+  *pos++ = skeleton.ies.size () & 0xFF;
+  for (const Ie &ie : skeleton.ies)
+    {
+      memcpy (pos, ie.prefix, 3);
+      pos += 3;
+      switch (ie.kind)
+        {
+        case Ie::FIXED:
+          pos = PutLength (pos, ie.value.size ());
+          memcpy (pos, ie.value.data (), ie.value.size ());
+          pos += ie.value.size ();
+          break;
+        case Ie::SEQUENCE_NUMBER:
+          // INTEGER (0..65535), the SN wraps around
+          *pos++ = 2;
+          *pos++ = (sequenceNumber >> 8) & 0xFF;
+          *pos++ = sequenceNumber & 0xFF;
+          break;
+        case Ie::HEADER:
+          pos = PutLength (PutLength (pos, headerValue), headerSize);
+          memcpy (pos, header, headerSize);
+          pos += headerSize;
+          break;
+        case Ie::MESSAGE:
+          pos = PutLength (PutLength (pos, messageValue), messageSize);
+          memcpy (pos, message, messageSize);
+          pos += messageSize;
+          break;
+        }
+    }
+  return pos - out;
+}
+
+IndicationEncoder::Skeleton
+IndicationEncoder::BuildSkeleton (long requestorId, long instanceId, long ranFunctionId,
+                                  long actionId)
+{
+  Skeleton skeleton;
+  std::vector<uint8_t> header (1, 0x01);
+  std::vector<uint8_t> message (1, 0x02);
+  if (!Parse (EncodeIndication (requestorId, instanceId, ranFunctionId, actionId, 0, header,
+                                message),
+              skeleton))
+    {
+      skeleton.ies.clear ();
+      return skeleton;
+    }
+
+  // the skeleton must reproduce asn1c with one- and two-octet lengths
+  const size_t checks[][3] = {{0x1234, 5, 200}, {0xFFFF, 130, 20}, {7, 300, 9000}};
+  std::vector<uint8_t> composed;
+  for (const auto &check : checks)
+    {
+      header.resize (check[1]);
+      message.resize (check[2]);
+      for (size_t i = 0; i < message.size (); i++)
+        {
+          message[i] = i * 7;
+        }
+      for (size_t i = 0; i < header.size (); i++)
+        {
+          header[i] = i * 3 + 1;
+        }
+      std::vector<uint8_t> expected = EncodeIndication (requestorId, instanceId, ranFunctionId,
+                                                        actionId, check[0], header, message);
+      composed.assign (expected.size () + 16, 0);
+      size_t size = Compose (skeleton, check[0], header.data (), header.size (), message.data (),
+                             message.size (), composed.data (), composed.size ());
+      composed.resize (size);
+      if (composed != expected)
+        {
+          NS_LOG_WARN ("RIC Indication skeleton differs from asn1c, not used");
+          return skeleton;
+        }
+    }
+  skeleton.patchable = true;
+  return skeleton;
+}
+
+size_t
+IndicationEncoder::Encode (long requestorId, long instanceId, long ranFunctionId, long actionId,
+                           long sequenceNumber, const uint8_t *header, size_t headerSize,
+                           const uint8_t *message, size_t messageSize, uint8_t *out,
+                           size_t capacity)
+{
+  Key key (requestorId, instanceId, ranFunctionId, actionId);
+  auto it = m_skeletons.find (key);
+  if (it == m_skeletons.end ())
+    {
+      Skeleton skeleton = BuildSkeleton (requestorId, instanceId, ranFunctionId, actionId);
+      NS_LOG_LOGIC ("New RIC Indication skeleton for " << requestorId << "/" << instanceId
+                                                       << ", patchable " << skeleton.patchable);
+      it = m_skeletons.emplace (key, std::move (skeleton)).first;
+    }
+  if (!it->second.patchable)
+    {
+      return 0;
+    }
+  size_t size = Compose (it->second, sequenceNumber, header, headerSize, message, messageSize,
+                         out, capacity);
+  if (size > 0)
+    {
+      m_spliced++;
+    }
+  return size;
+}
+
+uint64_t
+IndicationEncoder::GetSplicedCount () const
+{
+  return m_spliced;
+}
+
+} // namespace ns3
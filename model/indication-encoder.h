@@ -0,0 +1,152 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Northeastern University
+ * Copyright (c) 2022 Sapienza, University of Rome
+ * Copyright (c) 2022 University of Padova
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrea Lacava <thecave003@gmail.com>
+ *		   Tommaso Zugno <tommasozugno@gmail.com>
+ *		   Michele Polese <michele.polese@gmail.com>
+ */
+
+#ifndef INDICATION_ENCODER_H
+#define INDICATION_ENCODER_H
+
+#include <map>
+#include <tuple>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+extern "C" {
+  #include "E2AP-PDU.h"
+}
+
+namespace ns3 {
+
+  /**
+  * Encoder of the RIC Indication messages of the subscriptions.
+  * The first indication of a subscription is encoded with asn1c and split
+  * into its protocol IEs: the ones that do not change between indications
+  * (RIC Request ID, RAN Function ID, RIC Action ID and RIC Indication Type)
+  * are kept encoded, while the RIC Indication SN, header and message are
+  * written at each indication, together with the length determinants that
+  * depend on their size. The E2SM header and message are thus copied once,
+  * directly into the output buffer.
+  * Only the length determinants of up to two octets are written, larger
+  * indications are left to asn1c. Not thread-safe.
+  */
+  class IndicationEncoder
+  {
+  public:
+    /**
+    * Encode a RIC Indication in a buffer
+    *
+    * \param requestorId the RIC Requestor ID of the subscription
+    * \param instanceId the RIC Instance ID of the subscription
+    * \param ranFunctionId the RAN Function ID of the subscription
+    * \param actionId the RIC Action ID of the subscription
+    * \param sequenceNumber the RIC Indication SN
+    * \param header the encoded E2SM indication header
+    * \param headerSize the size of the header
+    * \param message the encoded E2SM indication message
+    * \param messageSize the size of the message
+    * \param out the output buffer
+    * \param capacity the size of the output buffer
+    * \return the size of the APER encoding written in out, 0 if the
+    *         indication has to be encoded with asn1c
+    */
+    size_t Encode (long requestorId, long instanceId, long ranFunctionId, long actionId,
+                   long sequenceNumber, const uint8_t *header, size_t headerSize,
+                   const uint8_t *message, size_t messageSize, uint8_t *out, size_t capacity);
+
+    /**
+    * Build a RIC Indication with asn1c
+    *
+    * \return the PDU, to be released with ASN_STRUCT_FREE
+    */
+    static E2AP_PDU_t *BuildIndication (long requestorId, long instanceId, long ranFunctionId,
+                                        long actionId, long sequenceNumber,
+                                        const uint8_t *header, size_t headerSize,
+                                        const uint8_t *message, size_t messageSize);
+
+    /**
+    * \return the number of indications encoded from a skeleton
+    */
+    uint64_t GetSplicedCount () const;
+
+  private:
+    /**
+    * Protocol IE of a RIC Indication
+    */
+    struct Ie
+    {
+      enum Kind { FIXED, SEQUENCE_NUMBER, HEADER, MESSAGE };
+
+      Kind kind;
+      uint8_t prefix[3]; //!< ID and criticality
+      std::vector<uint8_t> value; //!< encoded value of the FIXED IEs
+    };
+
+    /**
+    * RIC Indication of a subscription, split into its protocol IEs
+    */
+    struct Skeleton
+    {
+      bool patchable = false; //!< false if the encoding could not be split
+      uint8_t prefix[3]; //!< E2AP-PDU choice, procedure code and criticality
+      uint8_t preamble; //!< extension bit of the RIC Indication
+      std::vector<Ie> ies;
+    };
+
+    typedef std::tuple<long, long, long, long> Key; //!< request IDs, RAN function and action
+
+    /**
+    * Encode a RIC Indication with asn1c
+    */
+    static std::vector<uint8_t> EncodeIndication (long requestorId, long instanceId,
+                                                  long ranFunctionId, long actionId,
+                                                  long sequenceNumber,
+                                                  const std::vector<uint8_t> &header,
+                                                  const std::vector<uint8_t> &message);
+
+    /**
+    * Split an encoding produced by asn1c into its protocol IEs
+    *
+    * \return false if the encoding has an unexpected layout
+    */
+    static bool Parse (const std::vector<uint8_t> &encoded, Skeleton &skeleton);
+
+    /**
+    * Write an indication from a skeleton
+    */
+    static size_t Compose (const Skeleton &skeleton, long sequenceNumber, const uint8_t *header,
+                           size_t headerSize, const uint8_t *message, size_t messageSize,
+                           uint8_t *out, size_t capacity);
+
+    /**
+    * Build the skeleton of a subscription, and check that it reproduces
+    * the asn1c encoding of a few indications
+    */
+    static Skeleton BuildSkeleton (long requestorId, long instanceId, long ranFunctionId,
+                                   long actionId);
+
+    std::map<Key, Skeleton> m_skeletons; //!< skeletons built so far
+    uint64_t m_spliced = 0;
+  };
+}
+
+#endif /* INDICATION_ENCODER_H */
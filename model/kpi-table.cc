@@ -0,0 +1,246 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Northeastern University
+ * Copyright (c) 2022 Sapienza, University of Rome
+ * Copyright (c) 2022 University of Padova
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrea Lacava <thecave003@gmail.com>
+ *		   Tommaso Zugno <tommasozugno@gmail.com>
+ *		   Michele Polese <michele.polese@gmail.com>
+ */
+
+#include <ns3/kpi-table.h>
+#include <ns3/log.h>
+#include <algorithm>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("KpiTable");
+
+uint32_t
+KpiSchema::AddMetric (const std::string &name, Type type, uint32_t measId)
+{
+  uint32_t metric = m_names.size ();
+  m_names.push_back (name);
+  m_types.push_back (type);
+  m_measIds.push_back (measId);
+  // a repeated name keeps the ID of its first occurrence
+  m_index.emplace (name, metric);
+  return metric;
+}
+
+uint32_t
+KpiSchema::GetMetricCount () const
+{
+  return m_names.size ();
+}
+
+const std::string &
+KpiSchema::GetName (uint32_t metric) const
+{
+  return m_names.at (metric);
+}
+
+KpiSchema::Type
+KpiSchema::GetType (uint32_t metric) const
+{
+  return m_types.at (metric);
+}
+
+uint32_t
+KpiSchema::GetMeasId (uint32_t metric) const
+{
+  return m_measIds.at (metric);
+}
+
+int32_t
+KpiSchema::FindMetric (const std::string &name) const
+{
+  auto it = m_index.find (name);
+  if (it == m_index.end ())
+    {
+      return -1;
+    }
+  return it->second;
+}
+
+KpiTable::RowWriter::RowWriter (KpiTable *table, uint32_t row)
+  : m_table (table),
+    m_row (row),
+    m_next (0)
+{
+}
+
+uint32_t
+KpiTable::RowWriter::GetRow () const
+{
+  return m_row;
+}
+
+KpiTable::KpiTable (Ptr<const KpiSchema> schema)
+  : m_schema (schema)
+{
+  NS_ABORT_MSG_IF (m_schema == nullptr, "A KPI table needs a schema");
+  for (uint32_t metric = 0; metric < m_schema->GetMetricCount (); metric++)
+    {
+      if (m_schema->GetType (metric) == KpiSchema::Type::REAL)
+        {
+          m_columnIndex.push_back (m_realColumns.size ());
+          m_realColumns.emplace_back ();
+        }
+      else
+        {
+          m_columnIndex.push_back (m_intColumns.size ());
+          m_intColumns.emplace_back ();
+        }
+    }
+}
+
+Ptr<const KpiSchema>
+KpiTable::GetSchema () const
+{
+  return m_schema;
+}
+
+KpiTable::RowWriter
+KpiTable::AppendRow (const std::string &id)
+{
+  uint32_t row = m_rowIds.size ();
+  m_rowIds.push_back (id);
+  for (auto &column : m_intColumns)
+    {
+      column.push_back (0);
+    }
+  for (auto &column : m_realColumns)
+    {
+      column.push_back (0.0);
+    }
+  return RowWriter (this, row);
+}
+
+void
+KpiTable::SetInteger (uint32_t metric, uint32_t row, int64_t value)
+{
+  if (m_schema->GetType (metric) == KpiSchema::Type::REAL)
+    {
+      m_realColumns[m_columnIndex[metric]].at (row) = value;
+    }
+  else
+    {
+      m_intColumns[m_columnIndex[metric]].at (row) = value;
+    }
+}
+
+void
+KpiTable::SetReal (uint32_t metric, uint32_t row, double value)
+{
+  if (m_schema->GetType (metric) == KpiSchema::Type::REAL)
+    {
+      m_realColumns[m_columnIndex[metric]].at (row) = value;
+    }
+  else
+    {
+      m_intColumns[m_columnIndex[metric]].at (row) = (int64_t) value;
+    }
+}
+
+double
+KpiTable::GetValue (uint32_t metric, uint32_t row) const
+{
+  if (m_schema->GetType (metric) == KpiSchema::Type::REAL)
+    {
+      return m_realColumns[m_columnIndex[metric]].at (row);
+    }
+  return m_intColumns[m_columnIndex[metric]].at (row);
+}
+
+int64_t
+KpiTable::GetIntegerValue (uint32_t metric, uint32_t row) const
+{
+  if (m_schema->GetType (metric) == KpiSchema::Type::REAL)
+    {
+      return (int64_t) m_realColumns[m_columnIndex[metric]].at (row);
+    }
+  return m_intColumns[m_columnIndex[metric]].at (row);
+}
+
+const int64_t *
+KpiTable::GetIntegerColumn (uint32_t metric) const
+{
+  NS_ABORT_MSG_IF (m_schema->GetType (metric) != KpiSchema::Type::INTEGER,
+                   "Metric " << m_schema->GetName (metric) << " is not an integer");
+  return m_intColumns[m_columnIndex[metric]].data ();
+}
+
+const double *
+KpiTable::GetRealColumn (uint32_t metric) const
+{
+  NS_ABORT_MSG_IF (m_schema->GetType (metric) != KpiSchema::Type::REAL,
+                   "Metric " << m_schema->GetName (metric) << " is not a real");
+  return m_realColumns[m_columnIndex[metric]].data ();
+}
+
+uint32_t
+KpiTable::GetRowCount () const
+{
+  return m_rowIds.size ();
+}
+
+const std::string &
+KpiTable::GetRowId (uint32_t row) const
+{
+  return m_rowIds.at (row);
+}
+
+void
+KpiTable::Clear ()
+{
+  NS_LOG_FUNCTION (this);
+  m_rowIds.clear ();
+  for (auto &column : m_intColumns)
+    {
+      column.clear ();
+    }
+  for (auto &column : m_realColumns)
+    {
+      column.clear ();
+    }
+}
+
+Ptr<KpiTable>
+KpiTable::Copy (Ptr<const KpiSchema> schema, uint32_t firstRow, uint32_t rowCount) const
+{
+  NS_ABORT_MSG_IF (schema->GetMetricCount () != m_schema->GetMetricCount (),
+                   "The schema of the copy does not match the one of the table");
+  uint32_t first = std::min<uint32_t> (firstRow, m_rowIds.size ());
+  uint32_t last = first + std::min<uint32_t> (rowCount, m_rowIds.size () - first);
+
+  Ptr<KpiTable> table = Create<KpiTable> (schema);
+  table->m_rowIds.assign (m_rowIds.begin () + first, m_rowIds.begin () + last);
+  for (size_t c = 0; c < m_intColumns.size (); c++)
+    {
+      table->m_intColumns[c].assign (m_intColumns[c].begin () + first,
+                                     m_intColumns[c].begin () + last);
+    }
+  for (size_t c = 0; c < m_realColumns.size (); c++)
+    {
+      table->m_realColumns[c].assign (m_realColumns[c].begin () + first,
+                                      m_realColumns[c].begin () + last);
+    }
+  return table;
+}
+
+} // namespace ns3
@@ -0,0 +1,194 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Northeastern University
+ * Copyright (c) 2022 Sapienza, University of Rome
+ * Copyright (c) 2022 University of Padova
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrea Lacava <thecave003@gmail.com>
+ *		   Tommaso Zugno <tommasozugno@gmail.com>
+ *		   Michele Polese <michele.polese@gmail.com>
+ */
+
+#ifndef KPI_TABLE_H
+#define KPI_TABLE_H
+
+#include <ns3/simple-ref-count.h>
+#include <ns3/ptr.h>
+#include <ns3/abort.h>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+#include <stdint.h>
+
+namespace ns3 {
+
+  /**
+  * Ordered list of the metrics reported by an E2 node. The metric ID is the
+  * position of the metric in the schema; the metric names are stored only
+  * here and are shared by all the tables built on the schema.
+  */
+  class KpiSchema : public SimpleRefCount<KpiSchema>
+  {
+  public:
+    enum class Type { INTEGER = 0, REAL = 1 };
+
+    /**
+    * \param name the measurement name, as encoded in the E2SM-KPM messages
+    * \param type the type of the values of the metric
+    * \param measId the E2SM-KPM measurement ID of the metric, 0 if none
+    * \return the ID of the metric
+    */
+    uint32_t AddMetric (const std::string &name, Type type, uint32_t measId = 0);
+
+    uint32_t GetMetricCount () const;
+    const std::string &GetName (uint32_t metric) const;
+    Type GetType (uint32_t metric) const;
+
+    /**
+    * \return the E2SM-KPM measurement ID of a metric, 0 if it has none
+    */
+    uint32_t GetMeasId (uint32_t metric) const;
+
+    /**
+    * \param name the measurement name
+    * \return the ID of the first metric with this name, -1 if not found
+    */
+    int32_t FindMetric (const std::string &name) const;
+
+  private:
+    std::vector<std::string> m_names; //!< measurement names, by metric ID
+    std::vector<Type> m_types; //!< value types, by metric ID
+    std::vector<uint32_t> m_measIds; //!< E2SM-KPM measurement IDs, by metric ID
+    std::unordered_map<std::string, uint32_t> m_index; //!< first metric ID of each name
+  };
+
+  /**
+  * Columnar store of the KPIs of a reporting period. Each metric of the
+  * schema is a contiguous column of int64 or double values, indexed by row
+  * (the UE slot, or the cell). Clear keeps the memory of the columns, so a
+  * table can be refilled every period without allocations.
+  */
+  class KpiTable : public SimpleRefCount<KpiTable>
+  {
+  public:
+    /**
+    * Sequential writer of the values of a row, in the order of the schema
+    */
+    class RowWriter
+    {
+    public:
+      RowWriter (KpiTable *table, uint32_t row);
+
+      /**
+      * Write the value of the next metric of the schema
+      *
+      * \param value the value, converted to the type of the column
+      * \return this writer
+      */
+      template <class T>
+      RowWriter &
+      Put (T value)
+      {
+        NS_ABORT_MSG_IF (m_next >= m_table->m_schema->GetMetricCount (),
+                         "More values than metrics in the KPI schema");
+        if (std::is_floating_point<T>::value)
+          {
+            m_table->SetReal (m_next++, m_row, (double) value);
+          }
+        else
+          {
+            m_table->SetInteger (m_next++, m_row, (int64_t) value);
+          }
+        return *this;
+      }
+
+      uint32_t GetRow () const;
+
+    private:
+      KpiTable *m_table;
+      uint32_t m_row;
+      uint32_t m_next; //!< ID of the next metric to write
+    };
+
+    KpiTable (Ptr<const KpiSchema> schema);
+
+    Ptr<const KpiSchema> GetSchema () const;
+
+    /**
+    * Add a row with all the values set to zero
+    *
+    * \param id the identifier of the row (the UE IMSI, or the cell ID)
+    * \return a writer for the values of the new row
+    */
+    RowWriter AppendRow (const std::string &id);
+
+    /**
+    * Store a value, converted to the type of the column
+    */
+    void SetInteger (uint32_t metric, uint32_t row, int64_t value);
+    void SetReal (uint32_t metric, uint32_t row, double value);
+
+    /**
+    * \return the value of a metric for a row, converted to double
+    */
+    double GetValue (uint32_t metric, uint32_t row) const;
+
+    /**
+    * \return the value of an integer metric for a row
+    */
+    int64_t GetIntegerValue (uint32_t metric, uint32_t row) const;
+
+    /**
+    * \return the contiguous column of an integer metric, one value per row
+    */
+    const int64_t *GetIntegerColumn (uint32_t metric) const;
+
+    /**
+    * \return the contiguous column of a real metric, one value per row
+    */
+    const double *GetRealColumn (uint32_t metric) const;
+
+    uint32_t GetRowCount () const;
+    const std::string &GetRowId (uint32_t row) const;
+
+    /**
+    * Remove all the rows, keeping the memory of the columns
+    */
+    void Clear ();
+
+    /**
+    * Copy a range of rows into a new table, e.g., to hand the KPIs over to
+    * another thread together with a copy of the schema
+    *
+    * \param schema the schema of the copy, with the same metrics as the one of this table
+    * \param firstRow the first row to copy
+    * \param rowCount the number of rows to copy, clamped to the rows of the table
+    * \return the copy
+    */
+    Ptr<KpiTable> Copy (Ptr<const KpiSchema> schema, uint32_t firstRow = 0,
+                        uint32_t rowCount = UINT32_MAX) const;
+
+  private:
+    Ptr<const KpiSchema> m_schema;
+    std::vector<uint32_t> m_columnIndex; //!< position of each metric in its column vector
+    std::vector<std::vector<int64_t>> m_intColumns; //!< columns of the integer metrics
+    std::vector<std::vector<double>> m_realColumns; //!< columns of the real metrics
+    std::vector<std::string> m_rowIds; //!< identifier of each row
+  };
+}
+
+#endif /* KPI_TABLE_H */
@@ -0,0 +1,127 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Northeastern University
+ * Copyright (c) 2022 Sapienza, University of Rome
+ * Copyright (c) 2022 University of Padova
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrea Lacava <thecave003@gmail.com>
+ *		   Tommaso Zugno <tommasozugno@gmail.com>
+ *		   Michele Polese <michele.polese@gmail.com>
+ */
+
+#include <ns3/kpm-arena.h>
+#include <ns3/log.h>
+#include <cstddef>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("KpmArena");
+
+static const size_t ARENA_ALIGNMENT = alignof (std::max_align_t);
+
+KpmArena::KpmArena (size_t blockSize)
+  : m_blockSize (blockSize),
+    m_current (0),
+    m_offset (0),
+    m_used (0)
+{
+}
+
+KpmArena::~KpmArena ()
+{
+  for (Block &block : m_blocks)
+    {
+      free (block.data);
+    }
+  m_blocks.clear ();
+}
+
+void *
+KpmArena::Allocate (size_t size)
+{
+  size = (size + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1);
+  if (size == 0)
+    {
+      size = ARENA_ALIGNMENT;
+    }
+
+  // look for room in the block in use, then in the blocks kept by Reset
+  while (m_current < m_blocks.size () && m_offset + size > m_blocks[m_current].size)
+    {
+      m_current++;
+      m_offset = 0;
+    }
+
+  if (m_current == m_blocks.size ())
+    {
+      Block block;
+      block.size = size > m_blockSize ? size : m_blockSize;
+      block.data = (uint8_t *) malloc (block.size);
+      NS_ABORT_MSG_IF (block.data == nullptr, "Memory exhausted while growing the KPM arena");
+      NS_LOG_LOGIC ("New arena block of " << block.size << " bytes");
+      m_blocks.push_back (block);
+      m_offset = 0;
+    }
+
+  uint8_t *ptr = m_blocks[m_current].data + m_offset;
+  m_offset += size;
+  m_used += size;
+  memset (ptr, 0, size);
+  return ptr;
+}
+
+uint8_t *
+KpmArena::CopyBytes (const void *src, size_t size)
+{
+  uint8_t *dst = static_cast<uint8_t *> (Allocate (size));
+  memcpy (dst, src, size);
+  return dst;
+}
+
+void
+KpmArena::Reset ()
+{
+  NS_LOG_LOGIC ("Reset arena, " << m_used << " bytes were used");
+  m_current = 0;
+  m_offset = 0;
+  m_used = 0;
+}
+
+size_t
+KpmArena::GetUsedBytes () const
+{
+  return m_used;
+}
+
+size_t
+KpmArena::GetReservedBytes () const
+{
+  size_t reserved = 0;
+  for (const Block &block : m_blocks)
+    {
+      reserved += block.size;
+    }
+  return reserved;
+}
+
+KpmArena &
+KpmArena::GetThreadArena ()
+{
+  static thread_local KpmArena arena;
+  return arena;
+}
+
+} // namespace ns3
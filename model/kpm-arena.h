@@ -0,0 +1,158 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Northeastern University
+ * Copyright (c) 2022 Sapienza, University of Rome
+ * Copyright (c) 2022 University of Padova
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrea Lacava <thecave003@gmail.com>
+ *		   Tommaso Zugno <tommasozugno@gmail.com>
+ *		   Michele Polese <michele.polese@gmail.com>
+ */
+
+#ifndef KPM_ARENA_H
+#define KPM_ARENA_H
+
+#include <ns3/abort.h>
+#include <vector>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace ns3 {
+
+  /**
+  * Region allocator owning the whole asn1c descriptor tree of an indication.
+  * Every node of the tree is carved out of a few large blocks, zeroed as
+  * calloc would do. The tree is never released with ASN_STRUCT_FREE: once
+  * the message has been encoded, Reset drops all the nodes at once and keeps
+  * the blocks for the next reporting period.
+  * The asn_SEQUENCE lists of the tree must be presized with PresizeList and
+  * filled with ListAdd, since asn1c would realloc the list storage.
+  */
+  class KpmArena
+  {
+  public:
+    /**
+    * \param blockSize size in bytes of the blocks requested to the system
+    */
+    KpmArena (size_t blockSize = 64 * 1024);
+    ~KpmArena ();
+
+    /**
+    * \param size number of bytes
+    * \return a zeroed memory area, aligned for any type
+    */
+    void *Allocate (size_t size);
+
+    /**
+    * \return a zeroed object of type T
+    */
+    template <class T>
+    T *
+    New ()
+    {
+      return static_cast<T *> (Allocate (sizeof (T)));
+    }
+
+    /**
+    * \param count number of objects
+    * \return a zeroed array of count objects of type T
+    */
+    template <class T>
+    T *
+    NewArray (size_t count)
+    {
+      return static_cast<T *> (Allocate (sizeof (T) * count));
+    }
+
+    /**
+    * Copy a buffer into the arena.
+    *
+    * \param src the bytes to copy
+    * \param size the number of bytes
+    * \return the copy
+    */
+    uint8_t *CopyBytes (const void *src, size_t size);
+
+    /**
+    * Allocate the storage of an asn_SEQUENCE list for exactly count items.
+    *
+    * \param list the A_SEQUENCE_OF list to be presized
+    * \param count the number of items that will be added
+    */
+    template <class L>
+    void
+    PresizeList (L *list, int count)
+    {
+      list->array = static_cast<decltype (list->array)> (
+          Allocate (sizeof (*list->array) * (count > 0 ? count : 1)));
+      list->size = count;
+      list->count = 0;
+    }
+
+    /**
+    * Append an item to a list presized with PresizeList.
+    *
+    * \param list the A_SEQUENCE_OF list
+    * \param item the item, allocated from this arena
+    */
+    template <class L, class T>
+    static void
+    ListAdd (L *list, T *item)
+    {
+      NS_ABORT_MSG_IF (list->count >= list->size, "Arena list presized for " << list->size
+                                                    << " items, cannot add more");
+      list->array[list->count++] = item;
+    }
+
+    /**
+    * Release all the objects allocated so far. The memory blocks are kept
+    * and reused by the following allocations.
+    */
+    void Reset ();
+
+    /**
+    * \return the number of bytes allocated since the last Reset
+    */
+    size_t GetUsedBytes () const;
+
+    /**
+    * \return the number of bytes held by the arena
+    */
+    size_t GetReservedBytes () const;
+
+    /**
+    * \return the arena of the calling thread, used to build the KPM
+    *         indications and reused across reporting periods
+    */
+    static KpmArena &GetThreadArena ();
+
+  private:
+    struct Block
+    {
+      uint8_t *data;
+      size_t size;
+    };
+
+    std::vector<Block> m_blocks; //!< blocks obtained from the system
+    size_t m_blockSize; //!< default size of a new block
+    size_t m_current; //!< index of the block in use
+    size_t m_offset; //!< first free byte in the block in use
+    size_t m_used; //!< bytes allocated since the last Reset
+  };
+}
+
+#endif /* KPM_ARENA_H */
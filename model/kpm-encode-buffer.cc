@@ -0,0 +1,190 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Northeastern University
+ * Copyright (c) 2022 Sapienza, University of Rome
+ * Copyright (c) 2022 University of Padova
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrea Lacava <thecave003@gmail.com>
+ *		   Tommaso Zugno <tommasozugno@gmail.com>
+ *		   Michele Polese <michele.polese@gmail.com>
+ */
+
+#include <ns3/kpm-encode-buffer.h>
+#include <ns3/log.h>
+#include <ns3/abort.h>
+#include <algorithm>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("KpmEncodeBuffer");
+
+// size of the first buffer of a key never encoded
+static const size_t MIN_ENCODE_BUFFER = 256;
+// idle buffers kept by a thread, the others go back to the system
+static const size_t MAX_IDLE_BUFFERS = 256;
+
+KpmEncodeBuffer::Block::Block ()
+  : m_size (0)
+{
+}
+
+KpmEncodeBuffer::Block::Block (Block &&other)
+  : m_shelf (std::move (other.m_shelf)),
+    m_bytes (std::move (other.m_bytes)),
+    m_size (other.m_size)
+{
+  other.m_size = 0;
+}
+
+KpmEncodeBuffer::Block &
+KpmEncodeBuffer::Block::operator= (Block &&other)
+{
+  if (this != &other)
+    {
+      Release ();
+      m_shelf = std::move (other.m_shelf);
+      m_bytes = std::move (other.m_bytes);
+      m_size = other.m_size;
+      other.m_size = 0;
+    }
+  return *this;
+}
+
+KpmEncodeBuffer::Block::~Block ()
+{
+  Release ();
+}
+
+KpmEncodeBuffer::Span
+KpmEncodeBuffer::Block::GetSpan () const
+{
+  Span span;
+  span.data = m_size > 0 ? m_bytes.data () : nullptr;
+  span.size = m_size;
+  return span;
+}
+
+uint8_t *
+KpmEncodeBuffer::Block::GetData ()
+{
+  return m_bytes.data ();
+}
+
+void
+KpmEncodeBuffer::Block::Release ()
+{
+  if (m_shelf && m_bytes.capacity () > 0)
+    {
+      std::unique_lock<std::mutex> lock (m_shelf->mutex);
+      if (m_shelf->idle.size () < MAX_IDLE_BUFFERS)
+        {
+          m_shelf->idle.push_back (std::move (m_bytes));
+        }
+    }
+  m_shelf = nullptr;
+  m_bytes = std::vector<uint8_t> ();
+  m_size = 0;
+}
+
+KpmEncodeBuffer::KpmEncodeBuffer ()
+  : m_shelf (std::make_shared<Shelf> ())
+{
+}
+
+KpmEncodeBuffer::Block
+KpmEncodeBuffer::Acquire (size_t size, uint64_t sizeKey)
+{
+  Block block;
+  block.m_shelf = m_shelf;
+  {
+    std::unique_lock<std::mutex> lock (m_shelf->mutex);
+    if (!m_shelf->idle.empty ())
+      {
+        block.m_bytes = std::move (m_shelf->idle.back ());
+        m_shelf->idle.pop_back ();
+        m_stats.reused++;
+      }
+  }
+  m_stats.encoded++;
+
+  auto it = m_highWater.find (sizeKey);
+  size_t predicted = it == m_highWater.end () ? MIN_ENCODE_BUFFER : it->second;
+  predicted = std::max (predicted, size);
+  if (block.m_bytes.size () < predicted)
+    {
+      block.m_bytes.resize (predicted);
+    }
+  return block;
+}
+
+void
+KpmEncodeBuffer::Commit (Block &block, size_t size, uint64_t sizeKey)
+{
+  NS_ABORT_MSG_IF (size > block.m_bytes.size (), "Encoding larger than its buffer");
+  block.m_size = size;
+  size_t &highWater = m_highWater[sizeKey];
+  highWater = std::max (highWater, size);
+}
+
+KpmEncodeBuffer::Block
+KpmEncodeBuffer::Encode (const asn_TYPE_descriptor_t *type, const void *structure,
+                         uint64_t sizeKey)
+{
+  Block block = Acquire (0, sizeKey);
+  asn_enc_rval_t rval = asn_encode_to_buffer (nullptr, ATS_ALIGNED_BASIC_PER, type, structure,
+                                              block.m_bytes.data (), block.m_bytes.size ());
+  if (rval.encoded > (ssize_t) block.m_bytes.size ())
+    {
+      // the returned size is the one the encoding needs
+      NS_LOG_LOGIC ("Encoding of " << rval.encoded << " bytes retried, buffer of "
+                                   << block.m_bytes.size () << " bytes");
+      m_stats.retried++;
+      block.m_bytes.resize (rval.encoded);
+      rval = asn_encode_to_buffer (nullptr, ATS_ALIGNED_BASIC_PER, type, structure,
+                                   block.m_bytes.data (), block.m_bytes.size ());
+    }
+  if (rval.encoded < 0 || rval.encoded > (ssize_t) block.m_bytes.size ())
+    {
+      NS_LOG_ERROR ("Encoding of " << type->name << " failed, failed_type "
+                                   << (rval.failed_type ? rval.failed_type->name : "none"));
+      return block;
+    }
+
+  Commit (block, rval.encoded, sizeKey);
+  return block;
+}
+
+size_t
+KpmEncodeBuffer::GetHighWaterMark (uint64_t sizeKey) const
+{
+  auto it = m_highWater.find (sizeKey);
+  return it == m_highWater.end () ? 0 : it->second;
+}
+
+KpmEncodeBuffer::Stats
+KpmEncodeBuffer::GetStats () const
+{
+  return m_stats;
+}
+
+KpmEncodeBuffer &
+KpmEncodeBuffer::GetThreadBuffer ()
+{
+  static thread_local KpmEncodeBuffer buffer;
+  return buffer;
+}
+
+} // namespace ns3
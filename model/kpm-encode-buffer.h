@@ -0,0 +1,162 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Northeastern University
+ * Copyright (c) 2022 Sapienza, University of Rome
+ * Copyright (c) 2022 University of Padova
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrea Lacava <thecave003@gmail.com>
+ *		   Tommaso Zugno <tommasozugno@gmail.com>
+ *		   Michele Polese <michele.polese@gmail.com>
+ */
+
+#ifndef KPM_ENCODE_BUFFER_H
+#define KPM_ENCODE_BUFFER_H
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+extern "C" {
+  #include "asn_application.h"
+}
+
+namespace ns3 {
+
+  /**
+  * Encoder of the E2SM-KPM messages into buffers kept by the thread that
+  * encodes them. A buffer handed out with an encoding goes back to the
+  * thread when the message is destroyed, in any thread, and serves a later
+  * encoding: in steady state no memory is requested to the system. The
+  * buffers are presized from the largest encoding seen for the same size
+  * key, e.g., the format and the number of UEs of a message, and the
+  * encoding is retried in a larger buffer if it does not fit.
+  */
+  class KpmEncodeBuffer
+  {
+  public:
+    /**
+    * Non-owning view of encoded bytes
+    */
+    struct Span
+    {
+      const uint8_t *data = nullptr;
+      size_t size = 0;
+    };
+
+    /**
+    * Usage of the buffers of a thread
+    */
+    struct Stats
+    {
+      uint64_t encoded = 0; //!< encodings
+      uint64_t reused = 0; //!< encodings into a buffer given back by a message
+      uint64_t retried = 0; //!< encodings retried in a larger buffer
+    };
+
+  private:
+    /**
+    * Idle buffers of a thread, shared with the blocks it handed out so that
+    * they can be given back after the thread exits
+    */
+    struct Shelf
+    {
+      std::mutex mutex;
+      std::vector<std::vector<uint8_t>> idle;
+    };
+
+  public:
+    /**
+    * Encoded bytes, owning the buffer they are stored in until destroyed
+    */
+    class Block
+    {
+    public:
+      Block ();
+      Block (Block &&other);
+      Block &operator= (Block &&other);
+      ~Block ();
+
+      Span GetSpan () const;
+
+      /**
+      * \return the buffer, for an encoding written by the caller
+      */
+      uint8_t *GetData ();
+
+    private:
+      friend class KpmEncodeBuffer;
+
+      /**
+      * Give the buffer back to the thread that handed it out
+      */
+      void Release ();
+
+      std::shared_ptr<Shelf> m_shelf; //!< idle buffers of the encoding thread
+      std::vector<uint8_t> m_bytes; //!< the buffer, possibly larger than the encoding
+      size_t m_size; //!< encoded bytes
+    };
+
+    KpmEncodeBuffer ();
+
+    /**
+    * Encode a structure with APER, as asn_encode_to_new_buffer would do
+    *
+    * \param type the asn1c descriptor of the structure
+    * \param structure the structure
+    * \param sizeKey the key of the size prediction of the encoding
+    * \return the encoded bytes, empty if the encoding failed
+    */
+    Block Encode (const asn_TYPE_descriptor_t *type, const void *structure, uint64_t sizeKey);
+
+    /**
+    * \param size the minimum size of the buffer
+    * \param sizeKey the key of the size prediction of the encoding
+    * \return an empty block with a buffer for an encoding written by the caller
+    */
+    Block Acquire (size_t size, uint64_t sizeKey);
+
+    /**
+    * Set the size of the encoding written into an acquired block
+    *
+    * \param block the block
+    * \param size the encoded bytes
+    * \param sizeKey the key of the size prediction of the encoding
+    */
+    void Commit (Block &block, size_t size, uint64_t sizeKey);
+
+    /**
+    * \return the size of the largest encoding of a key, 0 if none
+    */
+    size_t GetHighWaterMark (uint64_t sizeKey) const;
+
+    Stats GetStats () const;
+
+    /**
+    * \return the encode buffers of the calling thread
+    */
+    static KpmEncodeBuffer &GetThreadBuffer ();
+
+  private:
+    std::shared_ptr<Shelf> m_shelf;
+    std::unordered_map<uint64_t, size_t> m_highWater; //!< largest encoding, by size key
+    Stats m_stats;
+  };
+}
+
+#endif /* KPM_ENCODE_BUFFER_H */
@@ -0,0 +1,279 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Northeastern University
+ * Copyright (c) 2022 Sapienza, University of Rome
+ * Copyright (c) 2022 University of Padova
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrea Lacava <thecave003@gmail.com>
+ *		   Tommaso Zugno <tommasozugno@gmail.com>
+ *		   Michele Polese <michele.polese@gmail.com>
+ */
+
+#include <ns3/kpm-encoder-service.h>
+#include <ns3/log.h>
+#include <ns3/uinteger.h>
+#include <algorithm>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("KpmEncoderService");
+
+NS_OBJECT_ENSURE_REGISTERED (KpmEncoderService);
+
+KpmEncodeJob::KpmEncodeJob (KpmIndicationHeader::GlobalE2nodeType nodeType,
+                            const KpmIndicationHeader::KpmRicIndicationHeaderValues &headerValues,
+                            const KpmIndicationMessage::KpmIndicationMessageValues &messageValues,
+                            E2SM_KPM_IndicationMessage_FormatType format)
+  : m_nodeType (nodeType),
+    m_headerValues (headerValues),
+    m_messageValues (messageValues),
+    m_format (format),
+    m_page (false),
+    m_firstUe (0),
+    m_ueCount (UINT32_MAX)
+{
+  Detach (0, UINT32_MAX);
+}
+
+KpmEncodeJob::KpmEncodeJob (KpmIndicationHeader::GlobalE2nodeType nodeType,
+                            const KpmIndicationHeader::KpmRicIndicationHeaderValues &headerValues,
+                            const KpmIndicationMessage::KpmIndicationMessageValues &messageValues,
+                            uint32_t firstUe, uint32_t ueCount)
+  : m_nodeType (nodeType),
+    m_headerValues (headerValues),
+    m_messageValues (messageValues),
+    m_format (E2SM_KPM_INDICATION_MESSAGE_FORMART2),
+    m_page (true),
+    m_firstUe (firstUe),
+    m_ueCount (ueCount)
+{
+  Detach (firstUe, ueCount);
+}
+
+void
+KpmEncodeJob::Detach (uint32_t firstUe, uint32_t ueCount)
+{
+  KpmIndicationMessage::KpmIndicationMessageValues &values = m_messageValues;
+  // the values of the other kind of report are not copied
+  if (m_format == E2SM_KPM_INDICATION_MESSAGE_FORMART1)
+    {
+      values.m_ueTable = nullptr;
+      values.m_ueIndications.clear ();
+    }
+  else if (m_format == E2SM_KPM_INDICATION_MESSAGE_FORMART2)
+    {
+      values.m_cellTable = nullptr;
+      values.m_cellMeasurementItems = nullptr;
+    }
+
+  if (values.m_cellTable)
+    {
+      if (values.m_cellTable->GetRowCount () > 0)
+        {
+          // not encoded, see FillAndEncodeKpmIndicationMessage
+          values.m_cellMeasurementItems = nullptr;
+        }
+      values.m_cellTable = values.m_cellTable->Copy (
+          Create<KpiSchema> (*values.m_cellTable->GetSchema ()));
+    }
+  if (values.m_ueTable)
+    {
+      values.m_ueIndications.clear ();
+      // only the rows of the page are copied, the copy is the whole page
+      values.m_ueTable = values.m_ueTable->Copy (
+          Create<KpiSchema> (*values.m_ueTable->GetSchema ()), firstUe, ueCount);
+      m_firstUe = 0;
+      m_ueCount = UINT32_MAX;
+    }
+  m_detached = !values.m_cellMeasurementItems && values.m_ueIndications.empty ();
+}
+
+std::vector<std::shared_ptr<KpmEncodeJob>>
+KpmEncodeJob::CreateFormat2Jobs (
+    KpmIndicationHeader::GlobalE2nodeType nodeType,
+    const KpmIndicationHeader::KpmRicIndicationHeaderValues &headerValues,
+    const KpmIndicationMessage::KpmIndicationMessageValues &messageValues)
+{
+  std::vector<std::shared_ptr<KpmEncodeJob>> jobs;
+  for (const auto &range : KpmIndicationMessage::GetFormat2Pages (messageValues))
+    {
+      jobs.push_back (std::make_shared<KpmEncodeJob> (nodeType, headerValues, messageValues,
+                                                      range.first, range.second));
+    }
+  return jobs;
+}
+
+bool
+KpmEncodeJob::IsDetached () const
+{
+  return m_detached;
+}
+
+void
+KpmEncodeJob::Run ()
+{
+  m_header = Create<KpmIndicationHeader> (m_nodeType, m_headerValues);
+  if (m_page)
+    {
+      m_message = Create<KpmIndicationMessage> (m_messageValues, m_firstUe, m_ueCount);
+    }
+  else
+    {
+      m_message = Create<KpmIndicationMessage> (m_messageValues, m_format);
+    }
+}
+
+Ptr<KpmIndicationHeader>
+KpmEncodeJob::GetHeader () const
+{
+  return m_header;
+}
+
+Ptr<KpmIndicationMessage>
+KpmEncodeJob::GetMessage () const
+{
+  return m_message;
+}
+
+TypeId
+KpmEncoderService::GetTypeId ()
+{
+  static TypeId tid =
+      TypeId ("ns3::KpmEncoderService")
+          .SetParent<Object> ()
+          .AddConstructor<KpmEncoderService> ()
+          .AddAttribute ("Workers",
+                         "Number of worker threads encoding the indications, 0 for one "
+                         "per hardware thread",
+                         UintegerValue (0),
+                         MakeUintegerAccessor (&KpmEncoderService::m_workerCount),
+                         MakeUintegerChecker<uint32_t> ());
+  return tid;
+}
+
+KpmEncoderService::KpmEncoderService ()
+  : m_workerCount (0),
+    m_stopping (false)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+KpmEncoderService::~KpmEncoderService ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+KpmEncoderService::Start ()
+{
+  uint32_t count = m_workerCount;
+  if (count == 0)
+    {
+      count = std::max (1u, std::thread::hardware_concurrency ());
+    }
+  NS_LOG_INFO ("Start " << count << " encoder threads");
+  for (uint32_t i = 0; i < count; i++)
+    {
+      m_workers.emplace_back (&KpmEncoderService::Work, this);
+    }
+}
+
+std::shared_future<void>
+KpmEncoderService::Submit (std::shared_ptr<KpmEncodeJob> job, std::function<void ()> done)
+{
+  Task task;
+  task.job = job;
+  task.done = done;
+  std::shared_future<void> encoded = task.encoded.get_future ().share ();
+
+  if (!job->IsDetached ())
+    {
+      NS_LOG_LOGIC ("Job sharing values with the simulator, encoded in the caller");
+      job->Run ();
+      task.encoded.set_value ();
+      if (done)
+        {
+          done ();
+        }
+      return encoded;
+    }
+
+  if (m_workers.empty ())
+    {
+      Start ();
+    }
+  {
+    std::unique_lock<std::mutex> lock (m_mutex);
+    NS_ABORT_MSG_IF (m_stopping, "Job submitted to a stopped encoder service");
+    m_tasks.push_back (std::move (task));
+  }
+  m_taskAvailable.notify_one ();
+  return encoded;
+}
+
+void
+KpmEncoderService::Work ()
+{
+  for (;;)
+    {
+      Task task;
+      {
+        std::unique_lock<std::mutex> lock (m_mutex);
+        m_taskAvailable.wait (lock, [this] { return m_stopping || !m_tasks.empty (); });
+        if (m_tasks.empty ())
+          {
+            return;
+          }
+        task = std::move (m_tasks.front ());
+        m_tasks.pop_front ();
+      }
+
+      task.job->Run ();
+      // the results are read by the submitter once the future is ready
+      task.job.reset ();
+      task.encoded.set_value ();
+      if (task.done)
+        {
+          task.done ();
+        }
+    }
+}
+
+uint32_t
+KpmEncoderService::GetWorkerCount () const
+{
+  return m_workers.size ();
+}
+
+void
+KpmEncoderService::DoDispose ()
+{
+  NS_LOG_FUNCTION (this);
+  {
+    std::unique_lock<std::mutex> lock (m_mutex);
+    m_stopping = true;
+  }
+  m_taskAvailable.notify_all ();
+  // the tasks already submitted are encoded before the workers exit
+  for (std::thread &worker : m_workers)
+    {
+      worker.join ();
+    }
+  m_workers.clear ();
+  Object::DoDispose ();
+}
+
+} // namespace ns3
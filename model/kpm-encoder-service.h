@@ -0,0 +1,185 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Northeastern University
+ * Copyright (c) 2022 Sapienza, University of Rome
+ * Copyright (c) 2022 University of Padova
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrea Lacava <thecave003@gmail.com>
+ *		   Tommaso Zugno <tommasozugno@gmail.com>
+ *		   Michele Polese <michele.polese@gmail.com>
+ */
+
+#ifndef KPM_ENCODER_SERVICE_H
+#define KPM_ENCODER_SERVICE_H
+
+#include <ns3/object.h>
+#include <ns3/kpm-indication.h>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ns3 {
+
+  /**
+  * Encoding of the header and the message of an indication. The values are
+  * copied at construction, with private copies of their KPI tables and
+  * schemas, so that the job shares no reference counted object with the
+  * simulator thread while it is encoded. The jobs are held by
+  * std::shared_ptr, whose count is atomic, for the same reason.
+  */
+  class KpmEncodeJob
+  {
+  public:
+    /**
+    * \param nodeType the type of the E2 node
+    * \param headerValues the values of the header
+    * \param messageValues the values of the message
+    * \param format the format of the message
+    */
+    KpmEncodeJob (KpmIndicationHeader::GlobalE2nodeType nodeType,
+                  const KpmIndicationHeader::KpmRicIndicationHeaderValues &headerValues,
+                  const KpmIndicationMessage::KpmIndicationMessageValues &messageValues,
+                  E2SM_KPM_IndicationMessage_FormatType format);
+
+    /**
+    * Job of a page of a Format 2 report
+    *
+    * \param nodeType the type of the E2 node
+    * \param headerValues the values of the header
+    * \param messageValues the values of the report
+    * \param firstUe the first UE of the page
+    * \param ueCount the number of UEs of the page
+    */
+    KpmEncodeJob (KpmIndicationHeader::GlobalE2nodeType nodeType,
+                  const KpmIndicationHeader::KpmRicIndicationHeaderValues &headerValues,
+                  const KpmIndicationMessage::KpmIndicationMessageValues &messageValues,
+                  uint32_t firstUe, uint32_t ueCount);
+
+    /**
+    * One job per page of a Format 2 report, see
+    * KpmIndicationMessage::CreateFormat2Pages
+    *
+    * \return the jobs, in the order of the pages
+    */
+    static std::vector<std::shared_ptr<KpmEncodeJob>>
+    CreateFormat2Jobs (KpmIndicationHeader::GlobalE2nodeType nodeType,
+                       const KpmIndicationHeader::KpmRicIndicationHeaderValues &headerValues,
+                       const KpmIndicationMessage::KpmIndicationMessageValues &messageValues);
+
+    /**
+    * \return false if the values carry MeasurementItemList objects, which
+    *         cannot be copied: the job is then encoded in the simulator thread
+    */
+    bool IsDetached () const;
+
+    /**
+    * Encode the header and the message
+    */
+    void Run ();
+
+    /**
+    * \return the encoded header, once the job has run
+    */
+    Ptr<KpmIndicationHeader> GetHeader () const;
+
+    /**
+    * \return the encoded message, once the job has run
+    */
+    Ptr<KpmIndicationMessage> GetMessage () const;
+
+  private:
+    /**
+    * Replace the KPI tables of the values with private copies
+    */
+    void Detach (uint32_t firstUe, uint32_t ueCount);
+
+    KpmIndicationHeader::GlobalE2nodeType m_nodeType;
+    KpmIndicationHeader::KpmRicIndicationHeaderValues m_headerValues;
+    KpmIndicationMessage::KpmIndicationMessageValues m_messageValues;
+    E2SM_KPM_IndicationMessage_FormatType m_format;
+    bool m_page; //!< true for a page of a Format 2 report
+    uint32_t m_firstUe; //!< first UE of the page in m_messageValues
+    uint32_t m_ueCount; //!< UEs of the page
+    bool m_detached; //!< false if the values are shared with the simulator thread
+    Ptr<KpmIndicationHeader> m_header;
+    Ptr<KpmIndicationMessage> m_message;
+  };
+
+  /**
+  * Pool of worker threads encoding the indications, e.g., the cell and UE
+  * reports of many cells at each reporting period, while the simulator
+  * moves on to the next events. The jobs are encoded in any order; the
+  * submitter restores the order of the results, see E2ReportScheduler.
+  */
+  class KpmEncoderService : public Object
+  {
+  public:
+    KpmEncoderService ();
+    virtual ~KpmEncoderService ();
+
+    static TypeId GetTypeId ();
+
+    /**
+    * Encode a job in a worker thread, or in the calling thread if the job
+    * is not detached from the simulator. The workers are started by the
+    * first submission.
+    *
+    * \param job the job
+    * \param done called once the job is encoded, in the thread that
+    *        encoded it, e.g., to schedule the sending of the results
+    * \return a future ready once the job is encoded
+    */
+    std::shared_future<void> Submit (std::shared_ptr<KpmEncodeJob> job,
+                                     std::function<void ()> done);
+
+    /**
+    * \return the number of worker threads
+    */
+    uint32_t GetWorkerCount () const;
+
+  protected:
+    virtual void DoDispose ();
+
+  private:
+    struct Task
+    {
+      std::shared_ptr<KpmEncodeJob> job;
+      std::promise<void> encoded;
+      std::function<void ()> done;
+    };
+
+    void Start ();
+
+    /**
+    * Loop of a worker thread, until the service is stopped and no task is left
+    */
+    void Work ();
+
+    uint32_t m_workerCount; //!< worker threads, 0 for one per hardware thread
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex; //!< protects m_tasks and m_stopping
+    std::condition_variable m_taskAvailable;
+    std::deque<Task> m_tasks; //!< tasks waiting for a worker
+    bool m_stopping;
+  };
+}
+
+#endif /* KPM_ENCODER_SERVICE_H */
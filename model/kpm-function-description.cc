@@ -28,6 +28,7 @@
 
 #include <ns3/kpm-function-description.h>
 #include <ns3/asn1c-types.h>
+#include <ns3/kpm-metric-registry.h>
 #include <ns3/log.h>
 
 extern "C" {
@@ -38,127 +39,6 @@ extern "C" {
 namespace ns3 {
 
 NS_LOG_COMPONENT_DEFINE ("KpmFunctionDescription");
-// JUST FOR lte_ue
-
-const char* performance_measurements_ue_lte[] = {
-    "UEID",
-  "DRB.PdcpSduVolumeDl_Filter.UEID",
-  "Tot.PdcpSduNbrDl.UEID",
-  "DRB.PdcpSduBitRateDl.UEID",
-  "DRB.PdcpSduDelayDl.UEID",
-  "DRB.EstabSucc.5QI.UEID",
-  "DRB.RelActNbr.5QI.UEID"
-  };
-
-int NUMBER_MEASUREMENTS_UE_LTE = 7;
-
-const char* performance_measurements_ue_gnb[] = {
-  "UEID",
-  "DRB.EstabSucc.5QI.UEID",
-  "DRB.RelActNbr.5QI.UEID",
-  "QosFlow.PdcpPduVolumeDL_Filter.UEID",
-  "DRB.PdcpPduNbrDl.Qos.UEID",
-  "TB.TotNbrDl.1.UEID",
-  "DRB.RelActNbr.5QI.UEID",
-  "TB.TotNbrDlInitial.UEID", 
-  "TB.TotNbrDlInitial.Qpsk.UEID", 
-  "TB.TotNbrDlInitial.16Qam.UEID", 
-  "TB.TotNbrDlInitial.64Qam.UEID",
-  "TB.ErrTotalNbrDl.1.UEID",
-  "QosFlow.PdcpPduVolumeDL_Filter.UEID", 
-  "RRU.PrbUsedDl.UEID",
-  "CARR.PDSCHMCSDist.Bin1.UEID",
-  "CARR.PDSCHMCSDist.Bin2.UEID",
-  "CARR.PDSCHMCSDist.Bin3.UEID",
-  "CARR.PDSCHMCSDist.Bin4.UEID",
-  "CARR.PDSCHMCSDist.Bin5.UEID",
-  "CARR.PDSCHMCSDist.Bin6.UEID",
-  "L1M.RS-SINR.Bin34.UEID",
-  "L1M.RS-SINR.Bin46.UEID",
-  "L1M.RS-SINR.Bin58.UEID",
-  "L1M.RS-SINR.Bin70.UEID",
-  "L1M.RS-SINR.Bin82.UEID",
-  "L1M.RS-SINR.Bin94.UEID",
-  "L1M.RS-SINR.Bin127.UEID",
-  "DRB.BufferSize.Qos.UEID",
-  "HO.SrcCellQual.RS-SINR.UEID",
-  "HO.SrcCellQual.RS-SINR-Converted.UEID",
-  "HO.SrcCellID.UEID",
-  "HO.TrgtCellQual.1.RS-SINR.UEID", 
-  "HO.TrgtCellQual.1.RS-SINR-Converted.UEID", 
-  "HO.TrgtCellQual.1.UEID", 
-  "HO.TrgtCellQual.2.RS-SINR.UEID", 
-  "HO.TrgtCellQual.2.RS-SINR-Converted.UEID", 
-  "HO.TrgtCellQual.2.UEID", 
-  "HO.TrgtCellQual.3.RS-SINR.UEID", 
-  "HO.TrgtCellQual.3.RS-SINR-Converted.UEID", 
-  "HO.TrgtCellQual.3.UEID", 
-  "HO.TrgtCellQual.4.RS-SINR.UEID", 
-  "HO.TrgtCellQual.4.RS-SINR-Converted.UEID", 
-  "HO.TrgtCellQual.4.UEID", 
-  "HO.TrgtCellQual.5.RS-SINR.UEID", 
-  "HO.TrgtCellQual.5.RS-SINR-Converted.UEID", 
-  "HO.TrgtCellQual.5.UEID", 
-  "HO.TrgtCellQual.6.RS-SINR.UEID", 
-  "HO.TrgtCellQual.6.RS-SINR-Converted.UEID", 
-  "HO.TrgtCellQual.6.UEID", 
-  "HO.TrgtCellQual.7.RS-SINR.UEID", 
-  "HO.TrgtCellQual.7.RS-SINR-Converted.UEID", 
-  "HO.TrgtCellQual.7.UEID", 
-  "HO.TrgtCellQual.8.RS-SINR.UEID", 
-  "HO.TrgtCellQual.8.RS-SINR-Converted.UEID", 
-  "HO.TrgtCellQual.8.UEID", 
-  "DRB.UEThpDl.UEID"
-};
-
-int NUMBER_MEASUREMENTS_UE_GNB = 56; //56
-
-// JUST FOR lte_cell
-const char* performance_measurements_cell_lte[] = {
-  "cellID",
-  "DRB.PdcpSduDelayDl",
-  "pdcpBytesUl",
-  "pdcpBytesDl",
-  "numActiveUes"
-};
-int NUMBER_MEASUREMENTS_CELL_LTE = 5; // 4
-
-// JUST FOR lte_cell
-const char* performance_measurements_cell_gnb[] = {
-  "cellID",
-  "TB.TotNbrDl.1",
-  "TB.TotNbrDlInitial",
-  "numActiveUes",
-  "TB.TotNbrDlInitial.Qpsk",
-  "TB.TotNbrDlInitial.16Qam",
-  "TB.TotNbrDlInitial.64Qam",
-  "RRU.PrbUsedDl",
-  "TB.ErrTotalNbrDl.1",
-  "QosFlow.PdcpPduVolumeDL_Filter",
-  "CARR.PDSCHMCSDist.Bin1",
-  "CARR.PDSCHMCSDist.Bin2",
-  "CARR.PDSCHMCSDist.Bin３",
-  "CARR.PDSCHMCSDist.Bin４",
-  "CARR.PDSCHMCSDist.Bin５",
-  "CARR.PDSCHMCSDist.Bin６",
-  "L1M.RS-SINR.Bin34",
-  "L1M.RS-SINR.Bin46",
-  "L1M.RS-SINR.Bin58",
-  "L1M.RS-SINR.Bin70",
-  "L1M.RS-SINR.Bin82",
-  "L1M.RS-SINR.Bin94",
-  "L1M.RS-SINR.Bin127",
-  "DRB.BufferSize.Qos",
-  "DRB.MeanActiveUeDl",
-  "PRB.AvailableDl",
-  "RRB.AvailablePUl",
-  "DRB.QCI",
-  "RRB.UseageDl",
-  "RRB.UseageUl"
-  };
-int NUMBER_MEASUREMENTS_CELL_GNB = 30; // 4
-
-
 KpmFunctionDescription::KpmFunctionDescription (int nb_type)
 {
   NS_LOG_DEBUG ("Create KPM Function Descrption");
@@ -271,79 +151,33 @@ KpmFunctionDescription::FillAndEncodeKpmFunctionDescription (
 
   ASN_SEQUENCE_ADD(&ranfunc_desc->ric_EventTriggerStyle_List->list, trigger_style);
 
-  MeasurementInfo_Action_List_t* measInfo_Action_List_ue_lte =
-      (MeasurementInfo_Action_List_t*)calloc(1, sizeof(MeasurementInfo_Action_List_t));
-
-  for (int i = 0; i < NUMBER_MEASUREMENTS_UE_LTE; i++) {
-    uint8_t* metrics = (uint8_t *)performance_measurements_ue_lte[i];
-    MeasurementInfo_Action_Item_t* measItem =
-        (MeasurementInfo_Action_Item_t*)calloc(1, sizeof(MeasurementInfo_Action_Item_t));
-    measItem->measName.buf = (uint8_t*)calloc(1, strlen((char*)metrics));
-    memcpy(measItem->measName.buf, metrics, strlen((char*)metrics));
-
-    measItem->measName.size = strlen((char*)metrics);
-
-    measItem->measID = (MeasurementTypeID_t*)calloc(1, sizeof(MeasurementTypeID_t));
-    *measItem->measID = i+1;
-
-    ASN_SEQUENCE_ADD(&measInfo_Action_List_ue_lte->list, measItem);
-  }
-
-    MeasurementInfo_Action_List_t* measInfo_Action_List_ue_gnb =
-      (MeasurementInfo_Action_List_t*)calloc(1, sizeof(MeasurementInfo_Action_List_t));
-
-  for (int i = 0; i < NUMBER_MEASUREMENTS_UE_GNB; i++) {
-    uint8_t* metrics = (uint8_t *)performance_measurements_ue_gnb[i];
-    MeasurementInfo_Action_Item_t* measItem =
-        (MeasurementInfo_Action_Item_t*)calloc(1, sizeof(MeasurementInfo_Action_Item_t));
-    measItem->measName.buf = (uint8_t*)calloc(1, strlen((char*)metrics));
-    memcpy(measItem->measName.buf, metrics, strlen((char*)metrics));
-
-    measItem->measName.size = strlen((char*)metrics);
-
-    measItem->measID = (MeasurementTypeID_t*)calloc(1, sizeof(MeasurementTypeID_t));
-    *measItem->measID = i+1;
-
-    ASN_SEQUENCE_ADD(&measInfo_Action_List_ue_gnb->list, measItem);
-  }
-
-
-  MeasurementInfo_Action_List_t* measInfo_Action_List_cell_lte =
-      (MeasurementInfo_Action_List_t*)calloc(1, sizeof(MeasurementInfo_Action_List_t));
-
-  for (int i = 0; i < NUMBER_MEASUREMENTS_CELL_LTE; i++) {
-    uint8_t* metrics = (uint8_t *)performance_measurements_cell_lte[i];
-    MeasurementInfo_Action_Item_t* measItem =
-        (MeasurementInfo_Action_Item_t*)calloc(1, sizeof(MeasurementInfo_Action_Item_t));
-    measItem->measName.buf = (uint8_t*)calloc(1, strlen((char*)metrics));
-    memcpy(measItem->measName.buf, metrics, strlen((char*)metrics));
-
-    measItem->measName.size = strlen((char*)metrics);
-
-    measItem->measID = (MeasurementTypeID_t*)calloc(1, sizeof(MeasurementTypeID_t));
-    *measItem->measID = i+1;
-
-    ASN_SEQUENCE_ADD(&measInfo_Action_List_cell_lte->list, measItem);
-  }
-
-  MeasurementInfo_Action_List_t* measInfo_Action_List_cell_gnb =
-      (MeasurementInfo_Action_List_t*)calloc(1, sizeof(MeasurementInfo_Action_List_t));
-
-  for (int i = 0; i < NUMBER_MEASUREMENTS_CELL_GNB; i++) {
-    uint8_t* metrics = (uint8_t *)performance_measurements_cell_gnb[i];
-    MeasurementInfo_Action_Item_t* measItem =
-        (MeasurementInfo_Action_Item_t*)calloc(1, sizeof(MeasurementInfo_Action_Item_t));
-    measItem->measName.buf = (uint8_t*)calloc(1, strlen((char*)metrics));
-    memcpy(measItem->measName.buf, metrics, strlen((char*)metrics));
-
-    measItem->measName.size = strlen((char*)metrics);
-
-    measItem->measID = (MeasurementTypeID_t*)calloc(1, sizeof(MeasurementTypeID_t));
-    *measItem->measID = i+1;
-
-    ASN_SEQUENCE_ADD(&measInfo_Action_List_cell_gnb->list, measItem);
-  }
+  // advertise the metrics of the registry with their measurement IDs, the
+  // same IDs used by the indication messages
+  auto make_measInfoList = [&](KpmMetricRegistry::MetricGroup group) {
+    Ptr<const KpiSchema> schema = KpmMetricRegistry::Get ().GetSchema (group);
+    MeasurementInfo_Action_List_t *list =
+        (MeasurementInfo_Action_List_t *) calloc (1, sizeof (MeasurementInfo_Action_List_t));
+    for (uint32_t i = 0; i < schema->GetMetricCount (); i++)
+      {
+        const std::string &name = schema->GetName (i);
+        MeasurementInfo_Action_Item_t *measItem =
+            (MeasurementInfo_Action_Item_t *) calloc (1, sizeof (MeasurementInfo_Action_Item_t));
+        OCTET_STRING_fromBuf (&measItem->measName, name.data (), name.size ());
+        measItem->measID = (MeasurementTypeID_t *) calloc (1, sizeof (MeasurementTypeID_t));
+        *measItem->measID = schema->GetMeasId (i);
+        ASN_SEQUENCE_ADD (&list->list, measItem);
+      }
+    return list;
+  };
 
+  MeasurementInfo_Action_List_t *measInfo_Action_List_ue_lte =
+      make_measInfoList (KpmMetricRegistry::UE_LTE);
+  MeasurementInfo_Action_List_t *measInfo_Action_List_ue_gnb =
+      make_measInfoList (KpmMetricRegistry::UE_GNB);
+  MeasurementInfo_Action_List_t *measInfo_Action_List_cell_lte =
+      make_measInfoList (KpmMetricRegistry::CELL_LTE);
+  MeasurementInfo_Action_List_t *measInfo_Action_List_cell_gnb =
+      make_measInfoList (KpmMetricRegistry::CELL_GNB);
 
   ranfunc_desc->ric_ReportStyle_List = (E2SM_KPM_RANfunction_Description::E2SM_KPM_RANfunction_Description__ric_ReportStyle_List*) calloc(1, sizeof(E2SM_KPM_RANfunction_Description::E2SM_KPM_RANfunction_Description__ric_ReportStyle_List));
   
@@ -28,11 +28,16 @@
  */
 
 #include <ns3/kpm-indication.h>
+#include <ns3/kpm-arena.h>
+#include <ns3/asn-struct-pool.h>
 // #include "kpm-indication.h"
 
 #include <ns3/asn1c-types.h>
 #include <ns3/log.h>
+#include <algorithm>
 #include <chrono>
+#include <cmath>
+#include <sstream>
 
 
 extern "C" {
@@ -66,22 +71,24 @@ namespace ns3 {
 NS_LOG_COMPONENT_DEFINE ("KpmIndication");
 
 //add for maintain meas information
-MeasurementItem::MeasurementItem(std::string name, long value)
+MeasurementItem::MeasurementItem (std::string name, long value)
+  : m_name (name),
+    m_isReal (false),
+    m_intValue (value),
+    m_realValue (value),
+    m_recordItem (nullptr),
+    m_infoItem (nullptr)
 {
-  m_recordItem = nullptr;
-  m_infoItem = nullptr;
-
-  CreateInfoItem(name);
-  CreateRecordItem(value);
 }
 
-MeasurementItem::MeasurementItem(std::string name, double value)
+MeasurementItem::MeasurementItem (std::string name, double value)
+  : m_name (name),
+    m_isReal (true),
+    m_intValue (0),
+    m_realValue (value),
+    m_recordItem (nullptr),
+    m_infoItem (nullptr)
 {
-  m_recordItem = nullptr;
-  m_infoItem = nullptr;
-
-  CreateInfoItem(name);
-  CreateRecordItem(value);
 }
 
 
@@ -101,15 +108,70 @@ MeasurementItem::~MeasurementItem()
 MeasurementRecordItem_t* 
 MeasurementItem::GetRecordItem()
 {
+  // the encoders do not use the ASN.1 items, build them only on request
+  if (!m_recordItem)
+    {
+      if (m_isReal)
+        {
+          CreateRecordItem (m_realValue);
+        }
+      else
+        {
+          CreateRecordItem (m_intValue);
+        }
+    }
   return m_recordItem;
 }
 
 MeasurementInfoItem_t* 
 MeasurementItem::GetInfoItem()
 {
+  if (!m_infoItem)
+    {
+      CreateInfoItem (m_name);
+    }
   return m_infoItem;
 }
 
+const std::string &
+MeasurementItem::GetName () const
+{
+  return m_name;
+}
+
+bool
+MeasurementItem::IsReal () const
+{
+  return m_isReal;
+}
+
+long
+MeasurementItem::GetIntegerValue () const
+{
+  return m_intValue;
+}
+
+double
+MeasurementItem::GetRealValue () const
+{
+  return m_realValue;
+}
+
+void
+MeasurementItem::FillRecordItem (MeasurementRecordItem_t *recordItem) const
+{
+  if (m_isReal)
+    {
+      recordItem->present = MeasurementRecordItem_PR_real;
+      recordItem->choice.real = m_realValue;
+    }
+  else
+    {
+      recordItem->present = MeasurementRecordItem_PR_integer;
+      recordItem->choice.integer = m_intValue;
+    }
+}
+
 void
 MeasurementItem::CreateRecordItem(long value)
 {
@@ -142,24 +204,144 @@ MeasurementItem::CreateInfoItem(std::string name)
   LabelInfoItem_t *labelItem =
       (LabelInfoItem_t *)calloc(1, sizeof(LabelInfoItem_t));
 
-  MeasurementLabel_t *label =
-      (MeasurementLabel_t *)calloc(1, sizeof(MeasurementLabel_t));
-
-  label->noLabel = (long *)calloc(1, sizeof(long));
-  *label->noLabel = 0;
+  labelItem->measLabel.noLabel = (long *)calloc(1, sizeof(long));
+  *labelItem->measLabel.noLabel = 0;
 
-  labelItem->measLabel = *label;
   ASN_SEQUENCE_ADD(&m_infoItem->labelInfoList.list, labelItem);
 }
 
 //=============================================
+std::mutex KpmIndicationHeader::s_templateMutex;
+std::map<std::string, KpmIndicationHeader::HeaderTemplate> KpmIndicationHeader::s_templates;
+
 KpmIndicationHeader::KpmIndicationHeader (GlobalE2nodeType nodeType,
-                                          KpmRicIndicationHeaderValues values)
+                                          KpmRicIndicationHeaderValues values,
+                                          bool useTemplate)
+  : m_buffer (nullptr),
+    m_size (0),
+    m_nodeType (nodeType)
+{
+  uint32_t collectStartTime = GetCollectStartTime (values.m_timestamp);
+  if (!useTemplate || !EncodeFromTemplate (values, collectStartTime))
+    {
+      EncodeGeneric (collectStartTime);
+    }
+}
+
+void
+KpmIndicationHeader::EncodeGeneric (uint32_t collectStartTime)
+{
+  AsnStructPool &pool = AsnStructPool::GetKpmIndicationHeaderPool ();
+  E2SM_KPM_IndicationHeader_t *descriptor = pool.Acquire<E2SM_KPM_IndicationHeader_t> ();
+  FillAndEncodeKpmRicIndicationHeader (descriptor, collectStartTime);
+  // releases the Format1 header as well
+  pool.Release (descriptor);
+}
+
+KpmIndicationHeader::HeaderTemplate
+KpmIndicationHeader::BuildTemplate ()
+{
+  // encode the header with all the timestamp bits cleared and then set, 
+  // the bits that differ are the ones of colletStartTime
+  HeaderTemplate tmpl;
+  tmpl.timestampBitOffset = 0;
+  tmpl.patchable = false;
+
+  EncodeGeneric (0);
+  tmpl.bytes.assign ((uint8_t *) m_buffer, (uint8_t *) m_buffer + m_size);
+  EncodeGeneric (0xFFFFFFFF);
+  std::vector<uint8_t> ones ((uint8_t *) m_buffer, (uint8_t *) m_buffer + m_size);
+  free (m_buffer);
+  m_buffer = nullptr;
+  m_size = 0;
+
+  if (ones.size () != tmpl.bytes.size ())
+    {
+      NS_LOG_WARN ("The header length depends on the timestamp, template disabled");
+      return tmpl;
+    }
+
+  size_t firstBit = 0;
+  size_t diffBits = 0;
+  for (size_t bit = 0; bit < tmpl.bytes.size () * 8; bit++)
+    {
+      uint8_t mask = 0x80 >> (bit % 8);
+      if ((tmpl.bytes[bit / 8] ^ ones[bit / 8]) & mask)
+        {
+          if (diffBits == 0)
+            {
+              firstBit = bit;
+            }
+          else if (bit != firstBit + diffBits)
+            {
+              NS_LOG_WARN ("The timestamp bits are not contiguous, template disabled");
+              return tmpl;
+            }
+          diffBits++;
+        }
+    }
+
+  // the template must carry the timestamp as 32 zero bits
+  if (diffBits != 32 || (ones[firstBit / 8] & (0x80 >> (firstBit % 8))) == 0)
+    {
+      NS_LOG_WARN ("Could not locate the timestamp in the header, template disabled");
+      return tmpl;
+    }
+
+  NS_LOG_LOGIC ("Header template of " << tmpl.bytes.size () << " bytes, timestamp at bit "
+                                      << firstBit);
+  tmpl.timestampBitOffset = firstBit;
+  tmpl.patchable = true;
+  return tmpl;
+}
+
+bool
+KpmIndicationHeader::EncodeFromTemplate (KpmRicIndicationHeaderValues values,
+                                         uint32_t collectStartTime)
 {
-  m_nodeType = nodeType;
-  E2SM_KPM_IndicationHeader_t *descriptor = new E2SM_KPM_IndicationHeader_t;
-  FillAndEncodeKpmRicIndicationHeader (descriptor, values);
-  delete descriptor;
+  std::ostringstream key;
+  key << m_nodeType << '|' << values.m_gnbId << '|' << values.m_nrCellId << '|'
+      << values.m_plmId;
+
+  std::unique_lock<std::mutex> lock (s_templateMutex);
+  auto it = s_templates.find (key.str ());
+  if (it == s_templates.end ())
+    {
+      it = s_templates.emplace (key.str (), BuildTemplate ()).first;
+    }
+  const HeaderTemplate &tmpl = it->second;
+  if (!tmpl.patchable)
+    {
+      return false;
+    }
+
+  uint8_t *buffer = (uint8_t *) malloc (tmpl.bytes.size ());
+  memcpy (buffer, tmpl.bytes.data (), tmpl.bytes.size ());
+  size_t offset = tmpl.timestampBitOffset;
+  lock.unlock ();
+
+  if (offset % 8 == 0)
+    {
+      // octet aligned, as for the fixed size OCTET STRING in aligned PER
+      buffer[offset / 8] = collectStartTime >> 24;
+      buffer[offset / 8 + 1] = collectStartTime >> 16;
+      buffer[offset / 8 + 2] = collectStartTime >> 8;
+      buffer[offset / 8 + 3] = collectStartTime;
+    }
+  else
+    {
+      for (size_t i = 0; i < 32; i++)
+        {
+          if ((collectStartTime >> (31 - i)) & 1)
+            {
+              buffer[(offset + i) / 8] |= 0x80 >> ((offset + i) % 8);
+            }
+        }
+    }
+
+  m_buffer = buffer;
+  m_size = tmpl.bytes.size ();
+  return true;
 }
 
 KpmIndicationHeader::~KpmIndicationHeader ()
@@ -273,22 +455,11 @@ ntohll (uint64_t val)
   return ((uint64_t) high << 32) | low; // Combine the high and low 32 bits back together
 }
 
-void
-KpmIndicationHeader::FillAndEncodeKpmRicIndicationHeader (E2SM_KPM_IndicationHeader_t *descriptor,
-                                                          KpmRicIndicationHeaderValues values)
+uint32_t
+KpmIndicationHeader::GetCollectStartTime (uint64_t timestamp)
 {
-
-  NS_LOG_INFO("FillAndEncodeKpmRicIndicationHeader");
-
-  // descriptor는 여기서 굳이 memset 안 해도 됨
-  // (밖에서 0으로 초기화되어 있다고 가정하면 생략 가능)
-  // memset(descriptor, 0, sizeof(*descriptor));
-
-  E2SM_KPM_IndicationHeader_Format1_t* ind_header =
-    (E2SM_KPM_IndicationHeader_Format1_t*)calloc(1, sizeof(*ind_header));
-
   // ---- 1) host_time: us 단위로 들어온다고 가정 ----
-  uint64_t host_time = values.m_timestamp;
+  uint64_t host_time = timestamp;
 
   if (host_time == 0)
     {
@@ -300,7 +471,24 @@ KpmIndicationHeader::FillAndEncodeKpmRicIndicationHeader (E2SM_KPM_IndicationHea
     }
 
   // ---- 2) 32비트로 줄이기 (예: 초 단위) ----
-  uint32_t ts32 = (uint32_t)(host_time / 1000000ULL); // us -> sec
+  return (uint32_t)(host_time / 1000000ULL); // us -> sec
+}
+
+void
+KpmIndicationHeader::FillAndEncodeKpmRicIndicationHeader (E2SM_KPM_IndicationHeader_t *descriptor,
+                                                          uint32_t collectStartTime)
+{
+
+  NS_LOG_INFO("FillAndEncodeKpmRicIndicationHeader");
+
+  // descriptor는 여기서 굳이 memset 안 해도 됨
+  // (밖에서 0으로 초기화되어 있다고 가정하면 생략 가능)
+  // memset(descriptor, 0, sizeof(*descriptor));
+
+  E2SM_KPM_IndicationHeader_Format1_t* ind_header =
+    (E2SM_KPM_IndicationHeader_Format1_t*)calloc(1, sizeof(*ind_header));
+
+  uint32_t ts32 = collectStartTime;
 
 #if defined(_WIN32)
   uint32_t net_ts32 = _byteswap_ulong(ts32);
@@ -313,8 +501,7 @@ KpmIndicationHeader::FillAndEncodeKpmRicIndicationHeader (E2SM_KPM_IndicationHea
   ind_header->colletStartTime.size = 4;
   memcpy(ind_header->colletStartTime.buf, &net_ts32, 4);
 
-  NS_LOG_INFO("colletStartTime host(us)=" << host_time
-                << " sec=" << ts32);
+  NS_LOG_INFO("colletStartTime sec=" << ts32);
 
   // ---- 4) CHOICE: Format1 선택 ----
   descriptor->indicationHeader_formats.present =
@@ -323,88 +510,207 @@ KpmIndicationHeader::FillAndEncodeKpmRicIndicationHeader (E2SM_KPM_IndicationHea
 
   // ---- 5) 실제 인코딩 ----
   Encode(descriptor);
-  ASN_STRUCT_FREE(asn_DEF_E2SM_KPM_IndicationHeader_Format1, ind_header);
 
 }
 
 KpmIndicationMessage::KpmIndicationMessage (KpmIndicationMessageValues values, const E2SM_KPM_IndicationMessage_FormatType &format_type)
+  : m_granularityPeriod (values.m_granularityPeriod),
+    m_firstUe (0),
+    m_ueCount (UINT32_MAX),
+    m_useMeasDataEncoder (values.m_useMeasDataEncoder),
+    m_recordItem (nullptr)
 {
-  E2SM_KPM_IndicationMessage_t* descriptor = (E2SM_KPM_IndicationMessage_t*)calloc(1, sizeof(*descriptor));
   CheckConstraints(values);
-  FillAndEncodeKpmIndicationMessage(descriptor, values, format_type); 
-  //ASN_STRUCT_FREE(asn_DEF_E2SM_KPM_IndicationMessage, descriptor);
-  //free(descriptor);
-}
 
-KpmIndicationMessage::~KpmIndicationMessage ()
-{
-  free (m_buffer);
-  m_size = 0;
+  // the whole descriptor tree is built in the arena of this thread and 
+  // dropped at once after the encoding, the arena is reused by the next 
+  // reporting period
+  KpmArena &arena = KpmArena::GetThreadArena ();
+  E2SM_KPM_IndicationMessage_t *descriptor = arena.New<E2SM_KPM_IndicationMessage_t> ();
+  FillAndEncodeKpmIndicationMessage(descriptor, values, format_type, arena); 
+  arena.Reset ();
 }
 
-void
-KpmIndicationMessage::CheckConstraints (KpmIndicationMessageValues values)
+KpmIndicationMessage::KpmIndicationMessage (const KpmIndicationMessageValues &values,
+                                            uint32_t firstUe, uint32_t ueCount)
+  : m_granularityPeriod (values.m_granularityPeriod),
+    m_firstUe (firstUe),
+    m_ueCount (ueCount),
+    m_useMeasDataEncoder (values.m_useMeasDataEncoder),
+    m_recordItem (nullptr)
 {
+  CheckConstraints (values);
+
+  KpmArena &arena = KpmArena::GetThreadArena ();
+  E2SM_KPM_IndicationMessage_t *descriptor = arena.New<E2SM_KPM_IndicationMessage_t> ();
+  FillAndEncodeKpmIndicationMessage (descriptor, values, E2SM_KPM_INDICATION_MESSAGE_FORMART2,
+                                     arena);
+  arena.Reset ();
 }
 
-typedef struct
+size_t
+KpmIndicationMessage::EstimateRealRecordSize (double value)
 {
-  uint8_t *buf;
-  size_t len;
-} darsh_byte_array_t;
+  // choice index and length determinant, then the REAL contents: nothing
+  // for zero, else a first octet, the exponent and the significant octets
+  // of the mantissa
+  if (value == 0)
+    {
+      return 2;
+    }
+  if (std::isnan (value) || std::isinf (value))
+    {
+      return 3;
+    }
+  int exponent;
+  double mantissa = std::frexp (std::fabs (value), &exponent);
+  uint64_t bits = (uint64_t) std::ldexp (mantissa, 53);
+  uint32_t significant = 53 - __builtin_ctzll (bits);
+  return 3 + (std::abs (exponent) > 64 ? 2 : 1) + significant / 8 + 1;
+}
 
-void
-KpmIndicationMessage::Encode (E2SM_KPM_IndicationMessage_t *descriptor)
+size_t
+KpmIndicationMessage::EstimateFormat2Sizes (const KpmIndicationMessageValues &values,
+                                            std::vector<size_t> &ueSizes)
 {
-
-  const bool USE_PRIVATE_BUFFER = false;
-  if (USE_PRIVATE_BUFFER)
+  // choice of the format, list sizes and granularity period, then a
+  // measurement type, a matching condition and a label per metric
+  size_t fixed = 16;
+  ueSizes.clear ();
+  if (values.m_ueTable)
     {
-
-      darsh_byte_array_t ba_darsh = {.buf = (uint8_t *) malloc (2048), .len = 2048};
-      asn_enc_rval_t encodedMsg =
-          asn_encode_to_buffer (NULL, ATS_ALIGNED_BASIC_PER, &asn_DEF_E2SM_KPM_IndicationMessage,
-                                descriptor, ba_darsh.buf, ba_darsh.len);
-
-      if (encodedMsg.encoded < 0)
+      Ptr<const KpiTable> table = values.m_ueTable;
+      Ptr<const KpiSchema> schema = table->GetSchema ();
+      uint32_t ueCount = table->GetRowCount ();
+      ueSizes.assign (ueCount, 0);
+      for (uint32_t m :
+           GetEncodedMetrics (schema, values.m_subscribedMetricsOnly, values.m_ueMetrics))
         {
-          assert (encodedMsg.structure_ptr != nullptr);
-
-          NS_FATAL_ERROR ("Error during the encoding of the RIC Indication Message, errno: "
-                          << strerror (errno) << ", failed_type " << encodedMsg.failed_type->name
-                          << ", structure_ptr " << encodedMsg.structure_ptr);
+          fixed += 16 + schema->GetName (m).size ();
+          if (schema->GetType (m) == KpiSchema::Type::REAL)
+            {
+              const double *column = table->GetRealColumn (m);
+              for (uint32_t u = 0; u < ueCount; u++)
+                {
+                  ueSizes[u] += EstimateRealRecordSize (column[u]);
+                }
+            }
+          else
+            {
+              const int64_t *column = table->GetIntegerColumn (m);
+              for (uint32_t u = 0; u < ueCount; u++)
+                {
+                  ueSizes[u] += EstimateRealRecordSize (column[u]);
+                }
+            }
+        }
+      return fixed;
+    }
 
-          NS_LOG_INFO ("Error during encoding ");
+  for (const auto &ueList : values.m_ueIndications)
+    {
+      size_t size = 0;
+      for (const auto &item : ueList->GetItems ())
+        {
+          if (ueSizes.empty ())
+            {
+              // the metrics are the ones of the first UE
+              fixed += 16 + item->GetName ().size ();
+            }
+          size += EstimateRealRecordSize (item->GetRealValue ());
         }
+      ueSizes.push_back (size);
+    }
+  return fixed;
+}
 
-      NS_LOG_LOGIC ("encodedMsg.encoded=" << encodedMsg.encoded);
-      NS_LOG_LOGIC ("ba_darsh.len=" << ba_darsh.len);
+size_t
+KpmIndicationMessage::EstimateFormat2Size (const KpmIndicationMessageValues &values,
+                                           uint32_t firstUe, uint32_t ueCount)
+{
+  std::vector<size_t> ueSizes;
+  size_t size = EstimateFormat2Sizes (values, ueSizes);
+  for (uint32_t u = firstUe; u < ueSizes.size () && u - firstUe < ueCount; u++)
+    {
+      size += ueSizes[u];
+    }
+  return size;
+}
 
-      assert (encodedMsg.encoded > -1);
-      assert ((size_t) encodedMsg.encoded <= ba_darsh.len);
+std::vector<std::pair<uint32_t, uint32_t>>
+KpmIndicationMessage::GetFormat2Pages (const KpmIndicationMessageValues &values)
+{
+  std::vector<size_t> ueSizes;
+  size_t fixed = EstimateFormat2Sizes (values, ueSizes);
 
-      m_buffer = ba_darsh.buf;
-      m_size = encodedMsg.encoded;
+  std::vector<std::pair<uint32_t, uint32_t>> pages;
+  uint32_t first = 0;
+  while (first < ueSizes.size ())
+    {
+      size_t size = fixed;
+      uint32_t count = 0;
+      while (first + count < ueSizes.size () &&
+             (values.m_maxFormat2Ues == 0 || count < values.m_maxFormat2Ues) &&
+             (values.m_maxFormat2Bytes == 0 || count == 0 ||
+              size + ueSizes[first + count] <= values.m_maxFormat2Bytes))
+        {
+          size += ueSizes[first + count];
+          count++;
+        }
+      NS_LOG_LOGIC ("Format 2 page of UEs " << first << "-" << first + count - 1
+                                            << ", estimated " << size << " bytes");
+      pages.emplace_back (first, count);
+      first += count;
     }
-  else
+  return pages;
+}
+
+std::vector<Ptr<KpmIndicationMessage>>
+KpmIndicationMessage::CreateFormat2Pages (const KpmIndicationMessageValues &values)
+{
+  std::vector<Ptr<KpmIndicationMessage>> pages;
+  for (const auto &range : GetFormat2Pages (values))
     {
+      Ptr<KpmIndicationMessage> page =
+          Create<KpmIndicationMessage> (values, range.first, range.second);
+      if (values.m_maxFormat2Bytes > 0 && page->GetSpan ().size > values.m_maxFormat2Bytes)
+        {
+          NS_LOG_WARN ("Format 2 page of " << page->GetSpan ().size << " bytes exceeds the budget of "
+                                           << values.m_maxFormat2Bytes);
+        }
+      pages.push_back (page);
+    }
+  return pages;
+}
 
-      // asn_codec_ctx_t *opt_cod = 0; // disable stack bounds checking
-      asn_encode_to_new_buffer_result_s encodedMsg = asn_encode_to_new_buffer (
-          NULL, ATS_ALIGNED_BASIC_PER, &asn_DEF_E2SM_KPM_IndicationMessage, descriptor);
+KpmIndicationMessage::~KpmIndicationMessage ()
+{
+}
 
-      if (encodedMsg.result.encoded < 0)
-        {
-          assert (encodedMsg.result.structure_ptr != nullptr);
+KpmEncodeBuffer::Span
+KpmIndicationMessage::GetSpan () const
+{
+  return m_encoded.GetSpan ();
+}
 
-          NS_FATAL_ERROR ("Error during the encoding of the RIC Indication Message, errno: "
-                          << strerror (errno) << ", failed_type "
-                          << encodedMsg.result.failed_type->name << ", structure_ptr "
-                          << encodedMsg.result.structure_ptr);
-        }
+void
+KpmIndicationMessage::CheckConstraints (KpmIndicationMessageValues values)
+{
+  // GranularityPeriod ::= INTEGER (1.. 4294967295)
+  NS_ABORT_MSG_IF (values.m_granularityPeriod == 0, "The granularity period must be positive");
+}
 
-      m_buffer = encodedMsg.buffer;
-      m_size = encodedMsg.result.encoded;
+void
+KpmIndicationMessage::Encode (E2SM_KPM_IndicationMessage_t *descriptor, uint64_t sizeKey)
+{
+  // the buffer of the previous messages of this thread is reused, presized
+  // for the largest message of the same key
+  m_encoded = KpmEncodeBuffer::GetThreadBuffer ().Encode (&asn_DEF_E2SM_KPM_IndicationMessage,
+                                                          descriptor, sizeKey);
+  if (m_encoded.GetSpan ().size == 0)
+    {
+      NS_FATAL_ERROR ("Error during the encoding of the RIC Indication Message, errno: "
+                      << strerror (errno));
     }
 }
 
@@ -544,72 +850,69 @@ void
 KpmIndicationMessage::FillKpmIndicationMessageFormat1(
     E2SM_KPM_IndicationMessage_Format1_t *format,
     Ptr<MeasurementItemList> indication,
+    KpmArena &arena,
     const std::string& cellObjectId /* = "" */)
 {
   NS_LOG_FUNCTION(this << format << indication << cellObjectId);
 
-  // ---------------------------------------------------------
-  // 1) MeasurementInfoList 생성
-  // ---------------------------------------------------------
-  MeasurementInfoList_t *infoList =
-      (MeasurementInfoList_t *)calloc(1, sizeof(MeasurementInfoList_t));
-
-  auto items = indication->GetItems();
-
-  for (const auto &item : items)
-    {
-      MeasurementInfoItem_t *info = item->GetInfoItem();
-      if (!info)
-        {
-          NS_LOG_WARN("Skipping MeasurementInfoItem: null");
-          continue;
-        }
-
-      // labelInfoList는 항상 Sequence이므로 직접 add
-      ASN_SEQUENCE_ADD(&infoList->list, info);
-    }
+  std::vector<Ptr<MeasurementItem>> items = indication->GetItems ();
+  int itemCount = items.size ();
 
-  if (infoList->list.count == 0)
+  if (itemCount == 0)
     {
       NS_LOG_WARN("No MeasurementInfoItem in KPM Format1");
-      ASN_STRUCT_FREE(asn_DEF_MeasurementInfoList, infoList);
       return;
     }
 
-  format->measInfoList = infoList;
-
   // ---------------------------------------------------------
-  // 2) MeasurementDataItem 생성 (셀마다 하나)
+  // 1) 노드 할당: 같은 종류의 노드는 arena에서 한 번에 할당
   // ---------------------------------------------------------
-  MeasurementDataItem_t *dataItem =
-      (MeasurementDataItem_t *)calloc(1, sizeof(MeasurementDataItem_t));
-
-  // 이 셀의 모든 KPI 값(MeasurementRecordItem)을 measRecord.list에 추가
-  for (const auto &item : items)
-    {
-      MeasurementRecordItem_t *rec = item->GetRecordItem();
-      NS_LOG_DEBUG("Record present" << rec->present);
+  MeasurementInfoList_t *infoList = arena.New<MeasurementInfoList_t> ();
+  MeasurementInfoItem_t *infoItems = arena.NewArray<MeasurementInfoItem_t> (itemCount);
+  LabelInfoItem_t *labelItems = arena.NewArray<LabelInfoItem_t> (itemCount);
+  long *noLabels = arena.NewArray<long> (itemCount);
+  MeasurementDataItem_t *dataItem = arena.New<MeasurementDataItem_t> ();
+  MeasurementRecordItem_t *records = arena.NewArray<MeasurementRecordItem_t> (itemCount);
 
-      if (!rec)
-        {
-          NS_LOG_WARN("Skipping MeasurementRecordItem: null");
-          continue;
-        }
+  arena.PresizeList (&infoList->list, itemCount);
+  arena.PresizeList (&dataItem->measRecord.list, itemCount);
 
-      ASN_SEQUENCE_ADD(&dataItem->measRecord.list, rec);
+  // ---------------------------------------------------------
+  // 2) MeasurementInfoList + 이 셀의 모든 KPI 값(MeasurementRecordItem)
+  // ---------------------------------------------------------
+  for (int i = 0; i < itemCount; ++i)
+    {
+      const Ptr<MeasurementItem> &item = items[i];
+      const std::string &name = item->GetName ();
+
+      MeasurementInfoItem_t *info = &infoItems[i];
+      info->measType.present = MeasurementType_PR_measName;
+      info->measType.choice.measName.buf = arena.CopyBytes (name.data (), name.size ());
+      info->measType.choice.measName.size = name.size ();
+
+      noLabels[i] = 0; // "noLabel" semantics
+      labelItems[i].measLabel.noLabel = &noLabels[i];
+      arena.PresizeList (&info->labelInfoList.list, 1);
+      KpmArena::ListAdd (&info->labelInfoList.list, &labelItems[i]);
+      KpmArena::ListAdd (&infoList->list, info);
+
+      item->FillRecordItem (&records[i]);
+      KpmArena::ListAdd (&dataItem->measRecord.list, &records[i]);
     }
 
+  format->measInfoList = infoList;
+
   // ---------------------------------------------------------
-  // dataItem을 measurementData에 추가
+  // dataItem을 measurementData에 추가 (셀마다 하나)
   // ---------------------------------------------------------
-  ASN_SEQUENCE_ADD(&format->measData.list, dataItem);
+  arena.PresizeList (&format->measData.list, 1);
+  KpmArena::ListAdd (&format->measData.list, dataItem);
 
   // ---------------------------------------------------------
   // 3) GranularityPeriod 설정
   // ---------------------------------------------------------
-  GranularityPeriod_t *gran =
-      (GranularityPeriod_t *)calloc(1, sizeof(GranularityPeriod_t));
-  *gran = 100;
+  GranularityPeriod_t *gran = arena.New<GranularityPeriod_t> ();
+  *gran = m_granularityPeriod;
 
   format->granulPeriod = gran;
 
@@ -618,42 +921,132 @@ KpmIndicationMessage::FillKpmIndicationMessageFormat1(
                << " record=" << dataItem->measRecord.list.count);
 }
 
+std::vector<uint32_t>
+KpmIndicationMessage::GetEncodedMetrics (Ptr<const KpiSchema> schema, bool subscribedOnly,
+                                         const std::vector<uint32_t> &subscribed)
+{
+  if (subscribedOnly)
+    {
+      return subscribed;
+    }
+  std::vector<uint32_t> metrics (schema->GetMetricCount ());
+  for (uint32_t m = 0; m < metrics.size (); m++)
+    {
+      metrics[m] = m;
+    }
+  return metrics;
+}
+
+void
+KpmIndicationMessage::FillMeasurementType (MeasurementType_t *measType,
+                                           Ptr<const KpiSchema> schema, uint32_t metric,
+                                           bool encodeMeasId, KpmArena &arena)
+{
+  uint32_t measId = schema->GetMeasId (metric);
+  if (encodeMeasId && measId > 0)
+    {
+      // the measurement IDs are the ones advertised in the function description
+      measType->present = MeasurementType_PR_measID;
+      measType->choice.measID = measId;
+    }
+  else
+    {
+      const std::string &name = schema->GetName (metric);
+      measType->present = MeasurementType_PR_measName;
+      measType->choice.measName.buf = arena.CopyBytes (name.data (), name.size ());
+      measType->choice.measName.size = name.size ();
+    }
+}
+
+void
+KpmIndicationMessage::FillKpmIndicationMessageFormat1 (E2SM_KPM_IndicationMessage_Format1_t *format,
+                                                       Ptr<const KpiTable> table, uint32_t row,
+                                                       const std::vector<uint32_t> &metrics,
+                                                       bool encodeMeasId, KpmArena &arena)
+{
+  NS_LOG_FUNCTION (this << format << table << row);
+
+  Ptr<const KpiSchema> schema = table->GetSchema ();
+  int itemCount = metrics.size ();
+  if (itemCount == 0)
+    {
+      NS_LOG_WARN ("No cell metric to report");
+      return;
+    }
+
+  MeasurementInfoList_t *infoList = arena.New<MeasurementInfoList_t> ();
+  MeasurementInfoItem_t *infoItems = arena.NewArray<MeasurementInfoItem_t> (itemCount);
+  LabelInfoItem_t *labelItems = arena.NewArray<LabelInfoItem_t> (itemCount);
+  long *noLabels = arena.NewArray<long> (itemCount);
+  MeasurementDataItem_t *dataItem = arena.New<MeasurementDataItem_t> ();
+
+  arena.PresizeList (&infoList->list, itemCount);
+  m_recordRuns.clear ();
+
+  for (int i = 0; i < itemCount; ++i)
+    {
+      uint32_t m = metrics[i];
+      MeasurementInfoItem_t *info = &infoItems[i];
+      FillMeasurementType (&info->measType, schema, m, encodeMeasId, arena);
+
+      labelItems[i].measLabel.noLabel = &noLabels[i];
+      arena.PresizeList (&info->labelInfoList.list, 1);
+      KpmArena::ListAdd (&info->labelInfoList.list, &labelItems[i]);
+      KpmArena::ListAdd (&infoList->list, info);
+
+      // same record types as the MeasurementItem of the legacy path
+      KpmMeasDataEncoder::RecordRun run {};
+      run.count = 1;
+      if (schema->GetType (m) == KpiSchema::Type::REAL)
+        {
+          run.kind = KpmMeasDataEncoder::RecordRun::Kind::REAL;
+          run.reals = table->GetRealColumn (m) + row;
+        }
+      else
+        {
+          run.kind = KpmMeasDataEncoder::RecordRun::Kind::INTEGER;
+          run.integers = table->GetIntegerColumn (m) + row;
+        }
+      m_recordRuns.push_back (run);
+    }
+  SetRecords (dataItem, arena);
+
+  format->measInfoList = infoList;
+  arena.PresizeList (&format->measData.list, 1);
+  KpmArena::ListAdd (&format->measData.list, dataItem);
+
+  GranularityPeriod_t *gran = arena.New<GranularityPeriod_t> ();
+  *gran = m_granularityPeriod;
+  format->granulPeriod = gran;
+}
+
 std::vector<UeReport>
 KpmIndicationMessage::ExtractUeReports(const KpmIndicationMessageValues &values)
 {
     std::vector<UeReport> reports;
+    reports.reserve (std::min<size_t> (values.m_ueIndications.size (), m_ueCount));
 
+    // only the UEs of the page, if any
+    uint32_t index = 0;
     for (const auto &ueList : values.m_ueIndications)
     {
+        if (index++ < m_firstUe)
+          {
+            continue;
+          }
+        if (reports.size () >= m_ueCount)
+          {
+            break;
+          }
         UeReport rep;
         auto items = ueList->GetItems();
+        rep.metricNames.reserve (items.size ());
+        rep.metricValues.reserve (items.size ());
 
         for (auto& item : items)
         {
-            auto info = item->GetInfoItem();
-            auto rec  = item->GetRecordItem();
-
-            if (!info || !rec)
-                continue;
-
-            std::string measName(
-                (char *)info->measType.choice.measName.buf,
-                info->measType.choice.measName.size);
-
-            rep.metricNames.push_back(measName);
-            switch (rec->present)
-            {
-                case MeasurementRecordItem_PR_integer:
-                    rep.metricValues.push_back(rec->choice.integer);
-                    break;
-
-                case MeasurementRecordItem_PR_real:
-                    rep.metricValues.push_back(rec->choice.real);
-                    break;
-
-                default:
-                    rep.metricValues.push_back(0.0);
-            }
+            rep.metricNames.push_back(item->GetName ());
+            rep.metricValues.push_back(item->GetRealValue ());
         }
 
         reports.push_back(rep);
@@ -665,7 +1058,8 @@ KpmIndicationMessage::ExtractUeReports(const KpmIndicationMessageValues &values)
 void
 KpmIndicationMessage::FillKpmIndicationMessageFormat2(
     E2SM_KPM_IndicationMessage_Format2_t *fmt2,
-    const KpmIndicationMessageValues &values)
+    const KpmIndicationMessageValues &values,
+    KpmArena &arena)
 {
   NS_LOG_DEBUG("FillKpmIndicationMessageFormat2(): start, UEs="
                << values.m_ueIndications.size());
@@ -691,123 +1085,71 @@ KpmIndicationMessage::FillKpmIndicationMessageFormat2(
 
   // ----------------------------------------------------
   // 2) MeasurementData: 한 개의 MeasurementDataItem
-  //    - 여기에서만 새 ASN.1 객체를 만들고, 외부 포인터는 절대 쓰지 않음
+  //    - 모든 MeasurementRecordItem은 arena에서 하나의 배열로 할당
   // ----------------------------------------------------
-  MeasurementDataItem_t *dataItem =
-      (MeasurementDataItem_t *)calloc(1, sizeof(*dataItem));
-  if (!dataItem)
-    {
-      NS_FATAL_ERROR("calloc failed for MeasurementDataItem_t");
-    }
+  MeasurementDataItem_t *dataItem = arena.New<MeasurementDataItem_t> ();
+  MeasurementRecordItem_t *records =
+      arena.NewArray<MeasurementRecordItem_t> (metricCount * ueCount);
+  arena.PresizeList (&dataItem->measRecord.list, metricCount * ueCount);
 
-  // metric m, UE u 에 대해 하나의 MeasurementRecordItem 생성 (deep copy)
+  // metric m, UE u 에 대해 하나의 MeasurementRecordItem
   for (int m = 0; m < metricCount; ++m)
     {
       for (int u = 0; u < ueCount; ++u)
         {
-          MeasurementRecordItem_t *rec =
-              (MeasurementRecordItem_t *)calloc(1, sizeof(*rec));
-          if (!rec)
-            {
-              NS_FATAL_ERROR("calloc failed for MeasurementRecordItem_t");
-            }
-
+          MeasurementRecordItem_t *rec = &records[m * ueCount + u];
           rec->present     = MeasurementRecordItem_PR_real;   // double 값 사용
           rec->choice.real = ueReports[u].metricValues[m];
-
-          if (ASN_SEQUENCE_ADD(&dataItem->measRecord.list, rec) != 0)
-            {
-              NS_FATAL_ERROR("ASN_SEQUENCE_ADD failed for measRecord in Format2");
-            }
+          KpmArena::ListAdd (&dataItem->measRecord.list, rec);
         }
     }
 
-  if (dataItem->measRecord.list.count == 0)
-    {
-      NS_LOG_WARN("Format2: dataItem has 0 MeasurementRecordItem, skip");
-      ASN_STRUCT_FREE(asn_DEF_MeasurementDataItem, dataItem);
-      return;
-    }
-
-  if (ASN_SEQUENCE_ADD(&fmt2->measData.list, dataItem) != 0)
-    {
-      NS_FATAL_ERROR("ASN_SEQUENCE_ADD failed for fmt2->measData");
-    }
+  arena.PresizeList (&fmt2->measData.list, 1);
+  KpmArena::ListAdd (&fmt2->measData.list, dataItem);
 
   // ----------------------------------------------------
   // 3) MeasurementCondUEidList: metric 단위 조건/label 정의
-  //    - 이 부분도 모든 ASN.1 객체를 새로 alloc해서 fmt2에만 귀속
   // ----------------------------------------------------
+  MeasurementCondUEidItem_t *condItems =
+      arena.NewArray<MeasurementCondUEidItem_t> (metricCount);
+  MatchingCondItem_t *matchingConds = arena.NewArray<MatchingCondItem_t> (metricCount);
+  MeasurementLabel_t *labels = arena.NewArray<MeasurementLabel_t> (metricCount);
+  long *noLabels = arena.NewArray<long> (metricCount);
+  arena.PresizeList (&fmt2->measCondUEidList.list, metricCount);
+
   for (int m = 0; m < metricCount; ++m)
     {
-      MeasurementCondUEidItem_t *item =
-          (MeasurementCondUEidItem_t *)calloc(1, sizeof(*item));
-      if (!item)
-        {
-          NS_FATAL_ERROR("calloc failed for MeasurementCondUEidItem_t");
-        }
+      MeasurementCondUEidItem_t *item = &condItems[m];
 
       // 3-1) MeasurementType: measName (metric 이름)
       item->measType.present = MeasurementType_PR_measName;
       const std::string &metricName = ueReports[0].metricNames[m];
-      if (OCTET_STRING_fromBuf(&item->measType.choice.measName,
-                               metricName.c_str(),
-                               metricName.size()) != 0)
-        {
-          NS_FATAL_ERROR("OCTET_STRING_fromBuf failed for measName in Format2");
-        }
+      item->measType.choice.measName.buf =
+          arena.CopyBytes (metricName.data (), metricName.size ());
+      item->measType.choice.measName.size = metricName.size ();
 
       // 3-2) MatchingCondList: SIZE >= 1
-      MatchingCondItem_t *mci =
-          (MatchingCondItem_t *)calloc(1, sizeof(*mci));
-      if (!mci)
-        {
-          NS_FATAL_ERROR("calloc failed for MatchingCondItem_t");
-        }
-
+      MatchingCondItem_t *mci = &matchingConds[m];
       mci->present = MatchingCondItem_PR_measLabel;
 
-      // Label도 완전히 새로운 ASN.1 객체로 할당 (no shallow copy)
-      MeasurementLabel_t *label =
-          (MeasurementLabel_t *)calloc(1, sizeof(*label));
-      if (!label)
-        {
-          NS_FATAL_ERROR("calloc failed for MeasurementLabel_t");
-        }
-
-      label->noLabel = (long *)calloc(1, sizeof(long));
-      if (!label->noLabel)
-        {
-          NS_FATAL_ERROR("calloc failed for label->noLabel");
-        }
-      *label->noLabel = 0; // "noLabel" semantics
-
-      mci->choice.measLabel = label;
+      noLabels[m] = 0; // "noLabel" semantics
+      labels[m].noLabel = &noLabels[m];
+      mci->choice.measLabel = &labels[m];
 
-      if (ASN_SEQUENCE_ADD(&item->matchingCond.list, mci) != 0)
-        {
-          NS_FATAL_ERROR("ASN_SEQUENCE_ADD failed for matchingCond.list");
-        }
+      arena.PresizeList (&item->matchingCond.list, 1);
+      KpmArena::ListAdd (&item->matchingCond.list, mci);
 
       // matchingUEidList OPTIONAL → 사용 안 함
       item->matchingUEidList = NULL;
 
-      if (ASN_SEQUENCE_ADD(&fmt2->measCondUEidList.list, item) != 0)
-        {
-          NS_FATAL_ERROR("ASN_SEQUENCE_ADD failed for measCondUEidList");
-        }
+      KpmArena::ListAdd (&fmt2->measCondUEidList.list, item);
     }
 
   // ----------------------------------------------------
   // 4) granularityPeriod 설정
   // ----------------------------------------------------
-  GranularityPeriod_t *gran =
-      (GranularityPeriod_t *)calloc(1, sizeof(*gran));
-  if (!gran)
-    {
-      NS_FATAL_ERROR("calloc failed for GranularityPeriod_t");
-    }
-  *gran = 100; // 100ms
+  GranularityPeriod_t *gran = arena.New<GranularityPeriod_t> ();
+  *gran = m_granularityPeriod;
 
   fmt2->granulPeriod = gran;
 
@@ -817,6 +1159,124 @@ KpmIndicationMessage::FillKpmIndicationMessageFormat2(
                << fmt2->measCondUEidList.list.count);
 }
 
+void
+KpmIndicationMessage::FillKpmIndicationMessageFormat2 (E2SM_KPM_IndicationMessage_Format2_t *fmt2,
+                                                       Ptr<const KpiTable> table,
+                                                       const std::vector<uint32_t> &metrics,
+                                                       bool encodeMeasId, KpmArena &arena)
+{
+  Ptr<const KpiSchema> schema = table->GetSchema ();
+  uint32_t first = std::min (m_firstUe, table->GetRowCount ());
+  int ueCount = std::min (m_ueCount, table->GetRowCount () - first);
+  int metricCount = metrics.size ();
+  NS_LOG_DEBUG ("FillKpmIndicationMessageFormat2(): KPI table, UEs=" << ueCount
+                                                                     << " metrics=" << metricCount);
+  if (ueCount == 0 || metricCount == 0)
+    {
+      NS_LOG_WARN ("Format2: empty KPI table");
+      return;
+    }
+
+  // metric-major records: each metric is a run of REAL records over its column
+  MeasurementDataItem_t *dataItem = arena.New<MeasurementDataItem_t> ();
+  m_recordRuns.clear ();
+  for (uint32_t m : metrics)
+    {
+      KpmMeasDataEncoder::RecordRun run {};
+      run.count = ueCount;
+      if (schema->GetType (m) == KpiSchema::Type::REAL)
+        {
+          run.kind = KpmMeasDataEncoder::RecordRun::Kind::REAL;
+          run.reals = table->GetRealColumn (m) + first;
+        }
+      else
+        {
+          run.kind = KpmMeasDataEncoder::RecordRun::Kind::INTEGER_AS_REAL;
+          run.integers = table->GetIntegerColumn (m) + first;
+        }
+      m_recordRuns.push_back (run);
+    }
+  SetRecords (dataItem, arena);
+
+  arena.PresizeList (&fmt2->measData.list, 1);
+  KpmArena::ListAdd (&fmt2->measData.list, dataItem);
+
+  MeasurementCondUEidItem_t *condItems =
+      arena.NewArray<MeasurementCondUEidItem_t> (metricCount);
+  MatchingCondItem_t *matchingConds = arena.NewArray<MatchingCondItem_t> (metricCount);
+  MeasurementLabel_t *labels = arena.NewArray<MeasurementLabel_t> (metricCount);
+  long *noLabels = arena.NewArray<long> (metricCount);
+  arena.PresizeList (&fmt2->measCondUEidList.list, metricCount);
+
+  for (int i = 0; i < metricCount; ++i)
+    {
+      MeasurementCondUEidItem_t *item = &condItems[i];
+      FillMeasurementType (&item->measType, schema, metrics[i], encodeMeasId, arena);
+
+      matchingConds[i].present = MatchingCondItem_PR_measLabel;
+      labels[i].noLabel = &noLabels[i];
+      matchingConds[i].choice.measLabel = &labels[i];
+      arena.PresizeList (&item->matchingCond.list, 1);
+      KpmArena::ListAdd (&item->matchingCond.list, &matchingConds[i]);
+
+      KpmArena::ListAdd (&fmt2->measCondUEidList.list, item);
+    }
+
+  GranularityPeriod_t *gran = arena.New<GranularityPeriod_t> ();
+  *gran = m_granularityPeriod;
+  fmt2->granulPeriod = gran;
+}
+
+void
+KpmIndicationMessage::SetRecords (MeasurementDataItem_t *dataItem, KpmArena &arena)
+{
+  if (m_useMeasDataEncoder)
+    {
+      // room for the placeholder records, see KpmMeasDataEncoder
+      arena.PresizeList (&dataItem->measRecord.list, 2);
+      m_recordItem = dataItem;
+    }
+  else
+    {
+      FillRecords (dataItem, arena);
+    }
+}
+
+void
+KpmIndicationMessage::FillRecords (MeasurementDataItem_t *dataItem, KpmArena &arena)
+{
+  int recordCount = 0;
+  for (const KpmMeasDataEncoder::RecordRun &run : m_recordRuns)
+    {
+      recordCount += run.count;
+    }
+  MeasurementRecordItem_t *rec = arena.NewArray<MeasurementRecordItem_t> (recordCount);
+  arena.PresizeList (&dataItem->measRecord.list, recordCount);
+
+  for (const KpmMeasDataEncoder::RecordRun &run : m_recordRuns)
+    {
+      for (uint32_t i = 0; i < run.count; ++i, ++rec)
+        {
+          switch (run.kind)
+            {
+            case KpmMeasDataEncoder::RecordRun::Kind::REAL:
+              rec->present = MeasurementRecordItem_PR_real;
+              rec->choice.real = run.reals[i];
+              break;
+            case KpmMeasDataEncoder::RecordRun::Kind::INTEGER_AS_REAL:
+              rec->present = MeasurementRecordItem_PR_real;
+              rec->choice.real = run.integers[i];
+              break;
+            case KpmMeasDataEncoder::RecordRun::Kind::INTEGER:
+              rec->present = MeasurementRecordItem_PR_integer;
+              rec->choice.integer = run.integers[i];
+              break;
+            }
+          KpmArena::ListAdd (&dataItem->measRecord.list, rec);
+        }
+    }
+}
+
 static inline void os_to_ran_ueid_8bytes(const OCTET_STRING_t& os, uint8_t out[8]) {
   const uint64_t FNV_OFFSET = 1469598103934665603ULL;
   const uint64_t FNV_PRIME  = 1099511628211ULL;
@@ -856,50 +1316,51 @@ void
 KpmIndicationMessage::FillAndEncodeKpmIndicationMessage(
     E2SM_KPM_IndicationMessage_t *descriptor,
     KpmIndicationMessageValues values,
-    const E2SM_KPM_IndicationMessage_FormatType &format_type)
+    const E2SM_KPM_IndicationMessage_FormatType &format_type,
+    KpmArena &arena)
 {
-  // 1) 이전 내용 깨끗이 제거 + 새로 할당
-  ASN_STRUCT_FREE(asn_DEF_E2SM_KPM_IndicationMessage, descriptor);
-  descriptor = (E2SM_KPM_IndicationMessage_t *)calloc(1, sizeof(*descriptor));
-  if (!descriptor)
-    {
-      NS_FATAL_ERROR("calloc failed for E2SM_KPM_IndicationMessage");
-    }
-
+  // the encoding buffer is presized from the format and the UEs of the message
+  uint64_t sizeKey = (uint64_t) format_type << 32;
   switch (format_type)
     {
     case E2SM_KPM_INDICATION_MESSAGE_FORMART1:
       {
         NS_LOG_DEBUG("Encode E2SM_KPM_I For Cell (Format1)");
         E2SM_KPM_IndicationMessage_Format1_t *msg_fmt1 =
-            (E2SM_KPM_IndicationMessage_Format1_t *)calloc(1, sizeof(*msg_fmt1));
-        if (!msg_fmt1)
-          {
-            NS_FATAL_ERROR("calloc failed for msg_fmt1");
-          }
+            arena.New<E2SM_KPM_IndicationMessage_Format1_t> ();
 
         // cell 측정값 확보
         const std::string cellId =
             values.m_cellObjectId.empty() ? "NO_CELL_ID" : values.m_cellObjectId;
 
-        Ptr<MeasurementItemList> cellItems = values.m_cellMeasurementItems;
-        if (!cellItems)
+        if (values.m_cellTable && values.m_cellTable->GetRowCount () > 0)
           {
-            NS_LOG_DEBUG("Creating MeasurementItemList For Cell");
-            cellItems = Create<MeasurementItemList>(cellId);
-            cellItems->AddItem("DRB.PdcpSduDelayDl", 0.0);
-            cellItems->AddItem("pdcpBytesUl",        0.1);
-            cellItems->AddItem("pdcpBytesDl",        0.2);
-            cellItems->AddItem("numActiveUes",       0.3);
+            std::vector<uint32_t> metrics =
+                GetEncodedMetrics (values.m_cellTable->GetSchema (),
+                                   values.m_subscribedMetricsOnly, values.m_cellMetrics);
+            FillKpmIndicationMessageFormat1 (msg_fmt1, values.m_cellTable, 0, metrics,
+                                             values.m_encodeMeasId, arena);
+          }
+        else
+          {
+            Ptr<MeasurementItemList> cellItems = values.m_cellMeasurementItems;
+            if (!cellItems)
+              {
+                NS_LOG_DEBUG("Creating MeasurementItemList For Cell");
+                cellItems = Create<MeasurementItemList>(cellId);
+                cellItems->AddItem("DRB.PdcpSduDelayDl", 0.0);
+                cellItems->AddItem("pdcpBytesUl",        0.1);
+                cellItems->AddItem("pdcpBytesDl",        0.2);
+                cellItems->AddItem("numActiveUes",       0.3);
+              }
+
+            FillKpmIndicationMessageFormat1(msg_fmt1, cellItems, arena, cellId);
           }
-
-        FillKpmIndicationMessageFormat1(msg_fmt1, cellItems, cellId);
 
         // measData가 비어있으면 인코딩 안 함
         if (msg_fmt1->measData.list.count == 0)
           {
             NS_LOG_WARN("Format1: measData is empty, skip encoding");
-            ASN_STRUCT_FREE(asn_DEF_E2SM_KPM_IndicationMessage_Format1, msg_fmt1);
             return;
           }
 
@@ -913,23 +1374,30 @@ KpmIndicationMessage::FillAndEncodeKpmIndicationMessage(
       {
         NS_LOG_DEBUG("Encode E2SM_KPM_I For UE (Format2)");
 
-        E2SM_KPM_IndicationMessage_Format2_t  *fmt2 =
-            (E2SM_KPM_IndicationMessage_Format2_t *)calloc(1, sizeof(*fmt2));
-        if (!fmt2)
+        E2SM_KPM_IndicationMessage_Format2_t *fmt2 =
+            arena.New<E2SM_KPM_IndicationMessage_Format2_t> ();
+
+        if (values.m_ueTable)
           {
-            NS_FATAL_ERROR("calloc failed for E2SM_KPM_IndicationMessage_Format2_t");
+            std::vector<uint32_t> metrics =
+                GetEncodedMetrics (values.m_ueTable->GetSchema (),
+                                   values.m_subscribedMetricsOnly, values.m_ueMetrics);
+            FillKpmIndicationMessageFormat2 (fmt2, values.m_ueTable, metrics,
+                                             values.m_encodeMeasId, arena);
+            uint32_t rows = values.m_ueTable->GetRowCount ();
+            uint32_t first = std::min (m_firstUe, rows);
+            sizeKey |= std::min (m_ueCount, rows - first);
           }
-
-        if (!values.m_ueIndications.empty())
+        else if (!values.m_ueIndications.empty())
           {
-            FillKpmIndicationMessageFormat2(fmt2, values);
+            FillKpmIndicationMessageFormat2(fmt2, values, arena);
+            sizeKey |= values.m_ueIndications.size ();
           }
 
-        // measData가 비면 인코딩하지 않고 정리
+        // measData가 비면 인코딩하지 않음
         if (fmt2->measData.list.count == 0)
           {
             NS_LOG_WARN("Format2: measData is empty, skip encoding");
-            ASN_STRUCT_FREE(asn_DEF_E2SM_KPM_IndicationMessage_Format2, fmt2);
             return;
           }
 
@@ -945,8 +1413,23 @@ KpmIndicationMessage::FillAndEncodeKpmIndicationMessage(
     }
 
   // 3) 실제 인코딩
-  Encode(descriptor);
-  printf("\n *** Done Encoding INDICATION Message ****** \n");
+  // the records of the KPI tables are written by KpmMeasDataEncoder, and
+  // asn1c encodes the rest of the message; asn1c encodes them as well if
+  // the encoder cannot
+  if (m_recordItem == nullptr ||
+      !KpmMeasDataEncoder::EncodeMessage (descriptor, m_recordItem, m_recordRuns, sizeKey,
+                                          m_encoded))
+    {
+      if (m_recordItem != nullptr)
+        {
+          FillRecords (m_recordItem, arena);
+        }
+      Encode (descriptor, sizeKey);
+    }
+  m_recordItem = nullptr;
+  m_recordRuns.clear ();
+  NS_LOG_LOGIC ("Done encoding the indication message, " << GetSpan ().size << " bytes, "
+                << arena.GetUsedBytes () << " bytes of arena");
 }
 
 MeasurementItemList::MeasurementItemList ()
@@ -32,10 +32,14 @@
 
 #include <thread>
 #include "ns3/object.h"
+#include <ns3/kpi-table.h>
+#include <ns3/kpm-encode-buffer.h>
+#include <ns3/kpm-meas-data-encoder.h>
 #include <set>
 
 #include <thread>
 #include <mutex>
+#include <map>
 
 #include <vector>
 #include <stdint.h>
@@ -88,6 +92,8 @@ extern "C" {
 
 namespace ns3 {
 
+class KpmArena;
+
 struct UeReport
 {
   std::string ueId;
@@ -110,14 +116,31 @@ public:
   ~MeasurementItem ();
 
   // v2 핵심: measurementInfo + recordItem
+  // built on first request, the indication encoders use the plain values
   MeasurementRecordItem_t* GetRecordItem ();
   MeasurementInfoItem_t*   GetInfoItem ();
 
+  const std::string &GetName () const;
+  bool IsReal () const;
+  long GetIntegerValue () const;
+  double GetRealValue () const;
+
+  /**
+  * Write the value of this item into a record item owned by the caller
+  *
+  * \param recordItem the record item to fill
+  */
+  void FillRecordItem (MeasurementRecordItem_t *recordItem) const;
+
 private:
   void CreateRecordItem (long value);
   void CreateRecordItem (double value);
   void CreateInfoItem(std::string name);
 
+  std::string m_name;                         //!< measurement name
+  bool m_isReal;                              //!< true if the value is a real
+  long m_intValue;                            //!< integer value
+  double m_realValue;                         //!< real value (also set for integers)
 
   MeasurementRecordItem_t *m_recordItem;      // 값
   MeasurementInfoItem_t   *m_infoItem;        // 이름, 라벨 등
@@ -140,9 +163,25 @@ public:
     uint64_t m_timestamp;
   };
 
-  KpmIndicationHeader (GlobalE2nodeType nodeType, KpmRicIndicationHeaderValues values);
+  /**
+  * Encode the indication header. By default the header is produced from a
+  * template encoded once for the node type and identity fields of values,
+  * patching in place the collection start time.
+  *
+  * \param nodeType the type of the E2 node
+  * \param values the header values
+  * \param useTemplate if false, always run the generic asn1c encoder
+  */
+  KpmIndicationHeader (GlobalE2nodeType nodeType, KpmRicIndicationHeaderValues values,
+                       bool useTemplate = true);
   ~KpmIndicationHeader ();
 
+  /**
+  * \param timestamp the timestamp in us, 0 for the current wall clock time
+  * \return the value encoded in colletStartTime, in seconds
+  */
+  static uint32_t GetCollectStartTime (uint64_t timestamp);
+
   uint64_t time_now_us_clck ();
   OCTET_STRING_t get_time_now_us ();
   static uint64_t octet_string_to_int_64 (OCTET_STRING_t asn);
@@ -152,11 +191,29 @@ public:
   size_t m_size;
 
 private:
+  /**
+  * Encoded header with a zeroed collection start time, shared by all the
+  * headers with the same node type and identity fields
+  */
+  struct HeaderTemplate
+  {
+    std::vector<uint8_t> bytes; //!< encoding with colletStartTime set to 0
+    size_t timestampBitOffset; //!< offset of the 32 bits of colletStartTime
+    bool patchable; //!< false if the timestamp could not be located
+  };
+
   void FillAndEncodeKpmRicIndicationHeader (E2SM_KPM_IndicationHeader_t *descriptor,
-                                            KpmRicIndicationHeaderValues values);
+                                            uint32_t collectStartTime);
   void Encode (E2SM_KPM_IndicationHeader_t *descriptor);
+  void EncodeGeneric (uint32_t collectStartTime);
+
+  HeaderTemplate BuildTemplate ();
+  bool EncodeFromTemplate (KpmRicIndicationHeaderValues values, uint32_t collectStartTime);
 
   GlobalE2nodeType m_nodeType;
+
+  static std::mutex s_templateMutex; //!< protects s_templates
+  static std::map<std::string, HeaderTemplate> s_templates; //!< cache of header templates
 };
 
 class MeasurementItemList : public SimpleRefCount<MeasurementItemList>
@@ -193,15 +250,74 @@ public:
     Ptr<MeasurementItemList>
         m_cellMeasurementItems; //!< list of cell-specific Measurement Information Items
     std::set<Ptr<MeasurementItemList>> m_ueIndications; //!< list of Measurement Information Items
+    Ptr<KpiTable> m_cellTable; //!< cell-specific KPIs, if set used instead of m_cellMeasurementItems
+    Ptr<KpiTable> m_ueTable; //!< UE-specific KPIs, one row per UE, if set used instead of m_ueIndications
+    bool m_encodeMeasId = false; //!< identify the metrics of the tables by measID instead of measName
+    bool m_subscribedMetricsOnly = false; //!< encode only m_cellMetrics and m_ueMetrics
+    std::vector<uint32_t> m_cellMetrics; //!< metrics of m_cellTable requested by the subscription
+    std::vector<uint32_t> m_ueMetrics; //!< metrics of m_ueTable requested by the subscription
+    uint32_t m_granularityPeriod = 100; //!< granularity period of the measurements in ms
+    uint32_t m_maxFormat2Bytes = 0; //!< estimated encoded size of a Format 2 page, 0 for no limit
+    uint32_t m_maxFormat2Ues = 0; //!< UEs of a Format 2 page, 0 for no limit
+    bool m_useMeasDataEncoder = true; //!< write the records of the tables with KpmMeasDataEncoder
   };
 
   //KpmIndicationMessage (KpmIndicationMessageValues values);
   KpmIndicationMessage (KpmIndicationMessageValues values, const E2SM_KPM_IndicationMessage_FormatType &format_type = E2SM_KPM_INDICATION_MESSAGE_FORMART3);
 
+  /**
+  * Encode a page of a Format 2 report, i.e., the measurements of a range of
+  * the UEs of the values (the rows of the UE table, or the UE indications
+  * in the order of the set)
+  *
+  * \param values the values of the report
+  * \param firstUe the first UE of the page
+  * \param ueCount the number of UEs of the page
+  */
+  KpmIndicationMessage (const KpmIndicationMessageValues &values, uint32_t firstUe,
+                        uint32_t ueCount);
+
+  /**
+  * Split a Format 2 report into pages within m_maxFormat2Bytes and
+  * m_maxFormat2Ues. The page boundaries are chosen on the estimated encoded
+  * size of each UE, without encoding; a UE larger than the byte budget
+  * gets a page of its own. The pages are meant to be sent in order, with
+  * consecutive RIC Indication SNs.
+  *
+  * \param values the values of the report
+  * \return the encoded pages, in the order of the UEs
+  */
+  static std::vector<Ptr<KpmIndicationMessage>>
+  CreateFormat2Pages (const KpmIndicationMessageValues &values);
+
+  /**
+  * \param values the values of a Format 2 report
+  * \return the first UE and the number of UEs of each page of the report,
+  *         as encoded by CreateFormat2Pages
+  */
+  static std::vector<std::pair<uint32_t, uint32_t>>
+  GetFormat2Pages (const KpmIndicationMessageValues &values);
+
+  /**
+  * Estimate the APER size of the Format 2 encoding of a range of UEs. The
+  * size of each record is computed from its value, the estimate is meant
+  * to be slightly above the size encoded by asn1c.
+  *
+  * \param values the values of the report
+  * \param firstUe the first UE of the range
+  * \param ueCount the number of UEs of the range
+  * \return the estimated size in bytes
+  */
+  static size_t EstimateFormat2Size (const KpmIndicationMessageValues &values, uint32_t firstUe,
+                                     uint32_t ueCount);
+
   ~KpmIndicationMessage ();
 
-  void *m_buffer;
-  size_t m_size;
+  /**
+  * \return the encoded message, valid as long as this object, empty if
+  *         nothing was encoded
+  */
+  KpmEncodeBuffer::Span GetSpan () const;
   // ======================================================================================
   BIT_STRING_t
   cp_amf_region_id_to_bit_string (uint8_t src)
@@ -281,18 +397,73 @@ private:
 
   void FillAndEncodeKpmIndicationMessage (E2SM_KPM_IndicationMessage_t *descriptor,
                                           KpmIndicationMessageValues values,
-                                          const E2SM_KPM_IndicationMessage_FormatType &format_type);
-  void Encode (E2SM_KPM_IndicationMessage_t *descriptor);
+                                          const E2SM_KPM_IndicationMessage_FormatType &format_type,
+                                          KpmArena &arena);
+  /**
+  * \param descriptor the message to encode
+  * \param sizeKey the key of the size prediction, see KpmEncodeBuffer
+  */
+  void Encode (E2SM_KPM_IndicationMessage_t *descriptor, uint64_t sizeKey);
 
   void FillKpmIndicationMessageFormat1 (E2SM_KPM_IndicationMessage_Format1 *ind_msg_f_1,
                                         const Ptr<MeasurementItemList> ueIndication, 
+                                        KpmArena &arena,
                                         const std::string& cellObjectId = "");
 
 
+  void FillKpmIndicationMessageFormat1 (E2SM_KPM_IndicationMessage_Format1 *ind_msg_f_1,
+                                        Ptr<const KpiTable> table, uint32_t row,
+                                        const std::vector<uint32_t> &metrics,
+                                        bool encodeMeasId, KpmArena &arena);
+
   std::vector<UeReport> ExtractUeReports(const KpmIndicationMessageValues &values);
 
+  /**
+  * Set the records of a MeasurementDataItem of the KPI tables, written by
+  * KpmMeasDataEncoder or by asn1c
+  *
+  * \param dataItem the MeasurementDataItem
+  * \param arena the arena of the descriptor tree
+  */
+  void SetRecords (MeasurementDataItem_t *dataItem, KpmArena &arena);
+
+  /**
+  * Fill the records of m_recordRuns into a MeasurementDataItem, to be
+  * encoded by asn1c
+  */
+  void FillRecords (MeasurementDataItem_t *dataItem, KpmArena &arena);
+
+  /**
+  * \param values the values of a Format 2 report
+  * \param ueSizes set to the estimated size of the records of each UE
+  * \return the estimated size of the rest of the encoding
+  */
+  static size_t EstimateFormat2Sizes (const KpmIndicationMessageValues &values,
+                                      std::vector<size_t> &ueSizes);
+
+  /**
+  * \return the estimated size of a MeasurementRecordItem carrying a real
+  */
+  static size_t EstimateRealRecordSize (double value);
+
+  void FillKpmIndicationMessageFormat2 (E2SM_KPM_IndicationMessage_Format2 *ind_msg_f_2,
+                                       Ptr<const KpiTable> table,
+                                       const std::vector<uint32_t> &metrics,
+                                       bool encodeMeasId, KpmArena &arena);
+
+  /**
+  * \return the metrics of the schema to be encoded, in order
+  */
+  static std::vector<uint32_t> GetEncodedMetrics (Ptr<const KpiSchema> schema,
+                                                  bool subscribedOnly,
+                                                  const std::vector<uint32_t> &subscribed);
+
+  static void FillMeasurementType (MeasurementType_t *measType, Ptr<const KpiSchema> schema,
+                                   uint32_t metric, bool encodeMeasId, KpmArena &arena);
+
   void FillKpmIndicationMessageFormat2 (E2SM_KPM_IndicationMessage_Format2 *ind_msg_f_2,
-                                       const KpmIndicationMessageValues &values);
+                                       const KpmIndicationMessageValues &values,
+                                       KpmArena &arena);
 
 
   std::pair<MeasurementInfoItem_t *, MeasurementDataItem_t *>
@@ -301,6 +472,14 @@ private:
   MeasurementDataItem_t * getMesDataItem (long intVal);
 
   void FillUeID (UEID_t *ue_ID, Ptr<MeasurementItemList> ueIndication);
+
+  uint32_t m_granularityPeriod; //!< granularity period of the measurements in ms
+  uint32_t m_firstUe; //!< first UE of a Format 2 page
+  uint32_t m_ueCount; //!< UEs of a Format 2 page, UINT32_MAX for all
+  KpmEncodeBuffer::Block m_encoded; //!< the encoded message
+  bool m_useMeasDataEncoder; //!< write the records of the tables with KpmMeasDataEncoder
+  std::vector<KpmMeasDataEncoder::RecordRun> m_recordRuns; //!< records of the tables being encoded
+  MeasurementDataItem_t *m_recordItem; //!< item of m_recordRuns, if left to KpmMeasDataEncoder
 };
 
   // 1029 update by jlee
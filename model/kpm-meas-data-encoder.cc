@@ -0,0 +1,447 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Northeastern University
+ * Copyright (c) 2022 Sapienza, University of Rome
+ * Copyright (c) 2022 University of Padova
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrea Lacava <thecave003@gmail.com>
+ *		   Tommaso Zugno <tommasozugno@gmail.com>
+ *		   Michele Polese <michele.polese@gmail.com>
+ */
+
+#include <ns3/kpm-meas-data-encoder.h>
+#include <ns3/log.h>
+#include <ns3/abort.h>
+#include <algorithm>
+#include <cmath>
+#include <string.h>
+
+extern "C" {
+  #include "MeasurementData.h"
+  #include "MeasurementRecordItem.h"
+}
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("KpmMeasDataEncoder");
+
+std::mutex KpmMeasDataEncoder::s_mutex;
+std::map<int, int64_t> KpmMeasDataEncoder::s_offsets;
+std::atomic<uint64_t> KpmMeasDataEncoder::s_encoded (0);
+
+// size key of the encodings of the messages with the placeholder records
+static const uint64_t PLACEHOLDER_SIZE_KEY = 1ULL << 63;
+// extension bit and choice index of a REAL record, then the alignment
+static const uint8_t REAL_RECORD = 0x20;
+// first octet of a REAL record, length determinant and contents
+static const size_t MAX_REAL_RECORD = 2 + 11;
+
+static size_t
+CountRecords (const std::vector<KpmMeasDataEncoder::RecordRun> &runs)
+{
+  size_t records = 0;
+  for (const KpmMeasDataEncoder::RecordRun &run : runs)
+    {
+      records += run.count;
+    }
+  return records;
+}
+
+/**
+ * Write a length determinant of less than 16384
+ */
+static inline uint8_t *
+PutLength (uint8_t *out, size_t length)
+{
+  if (length < 128)
+    {
+      *out++ = length;
+    }
+  else
+    {
+      *out++ = 0x80 | (length >> 8);
+      *out++ = length & 0xff;
+    }
+  return out;
+}
+
+static inline uint8_t *
+PutRealRecord (uint8_t *out, double value)
+{
+  *out = REAL_RECORD;
+  size_t size = KpmMeasDataEncoder::EncodeReal (value, out + 2);
+  out[1] = size;
+  return out + 2 + size;
+}
+
+size_t
+KpmMeasDataEncoder::EncodeReal (double value, uint8_t *out)
+{
+  if (std::isnan (value))
+    {
+      out[0] = 0x42;
+      return 1;
+    }
+  if (std::isinf (value))
+    {
+      out[0] = value < 0 ? 0x41 : 0x40;
+      return 1;
+    }
+  if (value == 0)
+    {
+      // no contents for the positive zero
+      if (std::signbit (value))
+        {
+          out[0] = 0x43;
+          return 1;
+        }
+      return 0;
+    }
+
+  // the seven low octets of the IEEE 754 value, most significant first,
+  // with the implicit 1 put back in front of the mantissa
+  uint64_t bits;
+  memcpy (&bits, &value, sizeof (bits));
+  uint8_t mantissa[7];
+  int last = 0;
+  for (int i = 0; i < 7; i++)
+    {
+      mantissa[i] = (uint8_t) (bits >> (48 - 8 * i));
+      if (mantissa[i])
+        {
+          last = i;
+        }
+    }
+  uint8_t first = 0x80 | ((bits >> 57) & 0x40);
+  mantissa[0] = 0x10 | (mantissa[0] & 0x0f);
+  int exponent = std::ilogb (value) - (8 * (last + 1) - 4);
+
+  // the mantissa is made odd by shifting it right
+  unsigned lastOctet = mantissa[last];
+  if (lastOctet && !(lastOctet & 1))
+    {
+      int shift = (lastOctet & 0x0f) ? 1 : 4;
+      while (((lastOctet >> shift) & 1) == 0)
+        {
+          shift++;
+        }
+      unsigned carry = 0;
+      for (int i = 0; i <= last; i++)
+        {
+          unsigned octet = mantissa[i];
+          mantissa[i] = (uint8_t) (carry | (octet >> shift));
+          carry = octet << (8 - shift);
+        }
+      exponent += shift;
+    }
+
+  uint8_t *ptr = out;
+  if (exponent >= -128 && exponent <= 127)
+    {
+      *ptr++ = first;
+      *ptr++ = (uint8_t) exponent;
+    }
+  else if (exponent >= -32768 && exponent <= 32767)
+    {
+      *ptr++ = first | 0x01;
+      *ptr++ = (uint8_t) (exponent >> 8);
+      *ptr++ = (uint8_t) exponent;
+    }
+  else
+    {
+      *ptr++ = first | 0x02;
+      *ptr++ = (uint8_t) (exponent >> 16);
+      *ptr++ = (uint8_t) (exponent >> 8);
+      *ptr++ = (uint8_t) exponent;
+    }
+  memcpy (ptr, mantissa, last + 1);
+  return ptr + last + 1 - out;
+}
+
+size_t
+KpmMeasDataEncoder::GetMaxSize (const std::vector<RecordRun> &runs)
+{
+  // list size, MeasurementDataItem preamble and length of the records
+  return 2 + 1 + 2 + CountRecords (runs) * MAX_REAL_RECORD;
+}
+
+size_t
+KpmMeasDataEncoder::EncodeMeasurementData (const std::vector<RecordRun> &runs, uint8_t *out)
+{
+  size_t records = CountRecords (runs);
+  if (records == 0 || records > MAX_RECORDS)
+    {
+      return 0;
+    }
+
+  uint8_t *ptr = out;
+  // SIZE (1..maxnoofMeasurementRecord): the number of items minus one, in two octets
+  *ptr++ = 0;
+  *ptr++ = 0;
+  // extension bit and presence bit of the incompleteFlag, then the alignment
+  *ptr++ = 0;
+  ptr = PutLength (ptr, records);
+
+  for (const RecordRun &run : runs)
+    {
+      switch (run.kind)
+        {
+        case RecordRun::Kind::REAL:
+          for (uint32_t i = 0; i < run.count; i++)
+            {
+              ptr = PutRealRecord (ptr, run.reals[i]);
+            }
+          break;
+        case RecordRun::Kind::INTEGER_AS_REAL:
+          for (uint32_t i = 0; i < run.count; i++)
+            {
+              ptr = PutRealRecord (ptr, (double) run.integers[i]);
+            }
+          break;
+        case RecordRun::Kind::INTEGER:
+          for (uint32_t i = 0; i < run.count; i++)
+            {
+              // INTEGER (0..4294967295): the number of octets minus one in
+              // two bits after the choice index, then the aligned octets
+              int64_t value = run.integers[i];
+              if (value < 0 || value > 0xFFFFFFFFLL)
+                {
+                  return 0;
+                }
+              int octets = value > 0xFFFFFF ? 3 : value > 0xFFFF ? 2 : value > 0xFF ? 1 : 0;
+              *ptr++ = octets << 3;
+              for (int o = octets; o >= 0; o--)
+                {
+                  *ptr++ = (uint8_t) (value >> (8 * o));
+                }
+            }
+          break;
+        }
+    }
+  return ptr - out;
+}
+
+bool
+KpmMeasDataEncoder::CheckProbe ()
+{
+  const double reals[] = {0.0,  -0.0,   1.0,          -1.0,         0.5,     0.1,
+                          3.0,  -1.5,   123456.789,   1e-300,       1e300,   2.0,
+                          1024, 1e-310, NAN,          INFINITY,     -INFINITY,
+                          4.9e-324,     1.7976931348623157e308, 0.3333333333333333};
+  const int64_t integers[] = {0,       1,        127,      128,        255,       256,
+                              65535,   65536,    16777215, 16777216,   123456789, 4294967295LL};
+  const uint32_t realCount = sizeof (reals) / sizeof (reals[0]);
+  const uint32_t integerCount = sizeof (integers) / sizeof (integers[0]);
+  std::vector<double> longRun;
+  for (int i = 0; i < 200; i++)
+    {
+      longRun.push_back (i * 0.37 - 20);
+    }
+
+  std::vector<std::vector<RecordRun>> probes;
+  probes.push_back ({{RecordRun::Kind::REAL, reals, nullptr, realCount},
+                     {RecordRun::Kind::INTEGER, nullptr, integers, integerCount},
+                     {RecordRun::Kind::INTEGER_AS_REAL, nullptr, integers, integerCount}});
+  probes.push_back ({{RecordRun::Kind::REAL, longRun.data (), nullptr, (uint32_t) longRun.size ()}});
+
+  for (const std::vector<RecordRun> &runs : probes)
+    {
+      MeasurementData_t *data = (MeasurementData_t *) calloc (1, sizeof (MeasurementData_t));
+      MeasurementDataItem_t *item =
+          (MeasurementDataItem_t *) calloc (1, sizeof (MeasurementDataItem_t));
+      for (const RecordRun &run : runs)
+        {
+          for (uint32_t i = 0; i < run.count; i++)
+            {
+              MeasurementRecordItem_t *record =
+                  (MeasurementRecordItem_t *) calloc (1, sizeof (MeasurementRecordItem_t));
+              if (run.kind == RecordRun::Kind::INTEGER)
+                {
+                  record->present = MeasurementRecordItem_PR_integer;
+                  record->choice.integer = run.integers[i];
+                }
+              else
+                {
+                  record->present = MeasurementRecordItem_PR_real;
+                  record->choice.real = run.kind == RecordRun::Kind::REAL
+                                            ? run.reals[i]
+                                            : (double) run.integers[i];
+                }
+              ASN_SEQUENCE_ADD (&item->measRecord.list, record);
+            }
+        }
+      ASN_SEQUENCE_ADD (&data->list, item);
+
+      asn_encode_to_new_buffer_result_s reference =
+          asn_encode_to_new_buffer (nullptr, ATS_ALIGNED_BASIC_PER, &asn_DEF_MeasurementData, data);
+      ASN_STRUCT_FREE (asn_DEF_MeasurementData, data);
+
+      std::vector<uint8_t> encoded (GetMaxSize (runs));
+      size_t size = EncodeMeasurementData (runs, encoded.data ());
+      bool match = reference.result.encoded >= 0 && (size_t) reference.result.encoded == size &&
+                   memcmp (reference.buffer, encoded.data (), size) == 0;
+      free (reference.buffer);
+      if (!match)
+        {
+          NS_LOG_WARN ("MeasurementData encoding differs from asn1c, records left to asn1c");
+          return false;
+        }
+    }
+  return true;
+}
+
+bool
+KpmMeasDataEncoder::IsConsistent ()
+{
+  static const bool consistent = CheckProbe ();
+  return consistent;
+}
+
+void
+KpmMeasDataEncoder::SetPlaceholder (MeasurementDataItem_t *dataItem, int records)
+{
+  // never modified by the encoding, shared by all the messages
+  static MeasurementRecordItem_t *placeholders = [] {
+    static MeasurementRecordItem_t items[2];
+    for (MeasurementRecordItem_t &item : items)
+      {
+        item.present = MeasurementRecordItem_PR_real;
+        item.choice.real = 0.0;
+      }
+    return items;
+  }();
+
+  NS_ABORT_MSG_IF (dataItem->measRecord.list.size < 2,
+                   "The measRecord list must be presized for two records");
+  for (int i = 0; i < records; i++)
+    {
+      dataItem->measRecord.list.array[i] = &placeholders[i];
+    }
+  dataItem->measRecord.list.count = records;
+}
+
+int64_t
+KpmMeasDataEncoder::GetMeasDataOffset (E2SM_KPM_IndicationMessage_t *descriptor,
+                                       MeasurementDataItem_t *dataItem)
+{
+  int format = descriptor->indicationMessage_formats.present;
+  std::unique_lock<std::mutex> lock (s_mutex);
+  auto it = s_offsets.find (format);
+  if (it != s_offsets.end ())
+    {
+      return it->second;
+    }
+
+  // the message is encoded with one and two placeholder records: the
+  // offset is the one where the placeholders differ, with the same octets
+  // before and after them
+  static const double zeros[2] = {0.0, 0.0};
+  KpmEncodeBuffer &buffer = KpmEncodeBuffer::GetThreadBuffer ();
+  std::vector<uint8_t> messages[2];
+  std::vector<uint8_t> placeholders[2];
+  for (int records = 1; records <= 2; records++)
+    {
+      SetPlaceholder (dataItem, records);
+      KpmEncodeBuffer::Block message =
+          buffer.Encode (&asn_DEF_E2SM_KPM_IndicationMessage, descriptor, PLACEHOLDER_SIZE_KEY);
+      KpmEncodeBuffer::Span span = message.GetSpan ();
+      messages[records - 1].assign (span.data, span.data + span.size);
+
+      std::vector<RecordRun> runs = {{RecordRun::Kind::REAL, zeros, nullptr, (uint32_t) records}};
+      placeholders[records - 1].resize (GetMaxSize (runs));
+      placeholders[records - 1].resize (
+          EncodeMeasurementData (runs, placeholders[records - 1].data ()));
+    }
+  dataItem->measRecord.list.count = 0;
+
+  int64_t offset = -1;
+  const std::vector<uint8_t> &one = messages[0];
+  const std::vector<uint8_t> &two = messages[1];
+  size_t oneSize = placeholders[0].size ();
+  size_t twoSize = placeholders[1].size ();
+  for (size_t o = 0; o + oneSize <= one.size () && o + twoSize <= two.size (); o++)
+    {
+      if (std::equal (placeholders[0].begin (), placeholders[0].end (), one.begin () + o) &&
+          std::equal (placeholders[1].begin (), placeholders[1].end (), two.begin () + o) &&
+          std::equal (one.begin (), one.begin () + o, two.begin ()) &&
+          one.size () - o - oneSize == two.size () - o - twoSize &&
+          std::equal (one.begin () + o + oneSize, one.end (), two.begin () + o + twoSize))
+        {
+          offset = o;
+          break;
+        }
+    }
+  NS_LOG_LOGIC ("MeasurementData of format " << format << " at offset " << offset);
+  s_offsets[format] = offset;
+  return offset;
+}
+
+bool
+KpmMeasDataEncoder::EncodeMessage (E2SM_KPM_IndicationMessage_t *descriptor,
+                                   MeasurementDataItem_t *dataItem,
+                                   const std::vector<RecordRun> &runs, uint64_t sizeKey,
+                                   KpmEncodeBuffer::Block &block)
+{
+  size_t records = CountRecords (runs);
+  if (records == 0 || records > MAX_RECORDS || !IsConsistent ())
+    {
+      return false;
+    }
+  int64_t offset = GetMeasDataOffset (descriptor, dataItem);
+  if (offset < 0)
+    {
+      return false;
+    }
+
+  KpmEncodeBuffer &buffer = KpmEncodeBuffer::GetThreadBuffer ();
+  SetPlaceholder (dataItem, 1);
+  KpmEncodeBuffer::Block skeleton =
+      buffer.Encode (&asn_DEF_E2SM_KPM_IndicationMessage, descriptor, sizeKey | PLACEHOLDER_SIZE_KEY);
+  dataItem->measRecord.list.count = 0;
+
+  // real 0.0 placeholder: one item, preamble, one record of two octets
+  static const uint8_t placeholder[] = {0x00, 0x00, 0x00, 0x01, REAL_RECORD, 0x00};
+  KpmEncodeBuffer::Span skel = skeleton.GetSpan ();
+  if (skel.size < offset + sizeof (placeholder) ||
+      memcmp (skel.data + offset, placeholder, sizeof (placeholder)) != 0)
+    {
+      NS_LOG_WARN ("Placeholder records not found in the message");
+      return false;
+    }
+
+  size_t tail = skel.size - offset - sizeof (placeholder);
+  KpmEncodeBuffer::Block encoded = buffer.Acquire (offset + GetMaxSize (runs) + tail, sizeKey);
+  uint8_t *out = encoded.GetData ();
+  size_t measData = EncodeMeasurementData (runs, out + offset);
+  if (measData == 0)
+    {
+      return false;
+    }
+  memcpy (out, skel.data, offset);
+  memcpy (out + offset + measData, skel.data + offset + sizeof (placeholder), tail);
+  buffer.Commit (encoded, offset + measData + tail, sizeKey);
+  block = std::move (encoded);
+  s_encoded++;
+  return true;
+}
+
+uint64_t
+KpmMeasDataEncoder::GetEncodedCount ()
+{
+  return s_encoded;
+}
+
+} // namespace ns3
@@ -0,0 +1,162 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Northeastern University
+ * Copyright (c) 2022 Sapienza, University of Rome
+ * Copyright (c) 2022 University of Padova
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrea Lacava <thecave003@gmail.com>
+ *		   Tommaso Zugno <tommasozugno@gmail.com>
+ *		   Michele Polese <michele.polese@gmail.com>
+ */
+
+#ifndef KPM_MEAS_DATA_ENCODER_H
+#define KPM_MEAS_DATA_ENCODER_H
+
+#include <ns3/kpm-encode-buffer.h>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+extern "C" {
+  #include "E2SM-KPM-IndicationMessage.h"
+  #include "MeasurementDataItem.h"
+}
+
+namespace ns3 {
+
+  /**
+  * APER encoder of the MeasurementData of the E2SM-KPM indication messages,
+  * writing the bits of the records directly from the columns of the KPI
+  * tables instead of walking the asn1c descriptors record by record.
+  * The rest of the message is encoded by asn1c with a placeholder
+  * MeasurementDataItem of a single record, which is then replaced by the
+  * records. This works since the MeasurementData starts and ends on an
+  * octet boundary: its length is octet-aligned, and so are the contents of
+  * the INTEGER and REAL records.
+  * The encoder is checked against asn1c on a set of probe values the first
+  * time it is used; if they differ, or if a message has a record that does
+  * not fit (a MeasurementRecord of 16384 records or more, which APER
+  * fragments, or an integer out of range), asn1c encodes the records.
+  * Thread-safe.
+  */
+  class KpmMeasDataEncoder
+  {
+  public:
+    /**
+    * Consecutive records of a MeasurementRecord, read from a column of values
+    */
+    struct RecordRun
+    {
+      enum class Kind {
+        REAL, //!< REAL records of real values
+        INTEGER_AS_REAL, //!< REAL records of integer values
+        INTEGER //!< INTEGER records of integer values
+      };
+
+      Kind kind;
+      const double *reals; //!< values of the REAL runs
+      const int64_t *integers; //!< values of the other runs
+      uint32_t count; //!< number of records
+    };
+
+    /**
+    * Maximum number of records of a MeasurementRecord, the longer ones are
+    * fragmented by APER
+    */
+    static const uint32_t MAX_RECORDS = 16383;
+
+    /**
+    * Encode an indication message whose MeasurementData is a single
+    * MeasurementDataItem without incompleteFlag
+    *
+    * \param descriptor the message, with the MeasurementDataItem in its measData
+    * \param dataItem the MeasurementDataItem, whose measRecord list is
+    *        empty and presized for two records
+    * \param runs the records of the MeasurementDataItem
+    * \param sizeKey the key of the size prediction of the encoding
+    * \param block set to the encoded message
+    * \return false if the message has to be encoded by asn1c, the measRecord
+    *         list is then left empty
+    */
+    static bool EncodeMessage (E2SM_KPM_IndicationMessage_t *descriptor,
+                               MeasurementDataItem_t *dataItem,
+                               const std::vector<RecordRun> &runs, uint64_t sizeKey,
+                               KpmEncodeBuffer::Block &block);
+
+    /**
+    * Encode a MeasurementData with a single MeasurementDataItem, without
+    * incompleteFlag
+    *
+    * \param runs the records of the MeasurementDataItem
+    * \param out the output buffer, of at least GetMaxSize bytes
+    * \return the size of the encoding, 0 if a record does not fit
+    */
+    static size_t EncodeMeasurementData (const std::vector<RecordRun> &runs, uint8_t *out);
+
+    /**
+    * \return the maximum size of the encoding of the MeasurementData of a
+    *         MeasurementDataItem
+    */
+    static size_t GetMaxSize (const std::vector<RecordRun> &runs);
+
+    /**
+    * Encode the contents of a REAL as asn_double2REAL does: the special
+    * values, or the binary encoding in base 2 with an odd mantissa
+    *
+    * \param value the value
+    * \param out the output buffer, of at least 11 bytes
+    * \return the size of the contents
+    */
+    static size_t EncodeReal (double value, uint8_t *out);
+
+    /**
+    * \return true if the encoder matches asn1c on the probe values
+    */
+    static bool IsConsistent ();
+
+    /**
+    * \return the number of messages whose records were written by this encoder
+    */
+    static uint64_t GetEncodedCount ();
+
+  private:
+    /**
+    * \return true if the encoding of the probe values matches the one of asn1c
+    */
+    static bool CheckProbe ();
+
+    /**
+    * Replace the records of a MeasurementDataItem with placeholder records
+    */
+    static void SetPlaceholder (MeasurementDataItem_t *dataItem, int records);
+
+    /**
+    * \return the offset of the MeasurementData in the encoding of a
+    *         message of the format of the descriptor, -1 if not found
+    */
+    static int64_t GetMeasDataOffset (E2SM_KPM_IndicationMessage_t *descriptor,
+                                      MeasurementDataItem_t *dataItem);
+
+    static std::mutex s_mutex; //!< protects s_offsets
+    static std::map<int, int64_t> s_offsets; //!< offset of the MeasurementData, by format
+    static std::atomic<uint64_t> s_encoded;
+  };
+}
+
+#endif /* KPM_MEAS_DATA_ENCODER_H */
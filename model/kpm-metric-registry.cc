@@ -0,0 +1,212 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Northeastern University
+ * Copyright (c) 2022 Sapienza, University of Rome
+ * Copyright (c) 2022 University of Padova
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrea Lacava <thecave003@gmail.com>
+ *		   Tommaso Zugno <tommasozugno@gmail.com>
+ *		   Michele Polese <michele.polese@gmail.com>
+ */
+
+#include <ns3/kpm-metric-registry.h>
+#include <ns3/log.h>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("KpmMetricRegistry");
+
+static const KpmMetricRegistry::MetricInfo g_ueLteMetrics[] = {
+  {"UEID", KpiSchema::Type::INTEGER},
+  {"DRB.PdcpSduVolumeDl_Filter.UEID", KpiSchema::Type::INTEGER},
+  {"Tot.PdcpSduNbrDl.UEID", KpiSchema::Type::INTEGER},
+  {"DRB.PdcpSduBitRateDl.UEID", KpiSchema::Type::REAL},
+  {"DRB.PdcpSduDelayDl.UEID", KpiSchema::Type::REAL},
+  {"DRB.EstabSucc.5QI.UEID", KpiSchema::Type::INTEGER},
+  {"DRB.RelActNbr.5QI.UEID", KpiSchema::Type::INTEGER},
+};
+
+static const KpmMetricRegistry::MetricInfo g_ueGnbMetrics[] = {
+  {"UEID", KpiSchema::Type::INTEGER},
+  {"DRB.EstabSucc.5QI.UEID", KpiSchema::Type::INTEGER},
+  {"DRB.RelActNbr.5QI.UEID", KpiSchema::Type::INTEGER},
+  {"QosFlow.PdcpPduVolumeDL_Filter.UEID", KpiSchema::Type::INTEGER},
+  {"DRB.PdcpPduNbrDl.Qos.UEID", KpiSchema::Type::INTEGER},
+  {"TB.TotNbrDl.1.UEID", KpiSchema::Type::INTEGER},
+  {"TB.TotNbrDlInitial.UEID", KpiSchema::Type::INTEGER},
+  {"TB.TotNbrDlInitial.Qpsk.UEID", KpiSchema::Type::INTEGER},
+  {"TB.TotNbrDlInitial.16Qam.UEID", KpiSchema::Type::INTEGER},
+  {"TB.TotNbrDlInitial.64Qam.UEID", KpiSchema::Type::INTEGER},
+  {"TB.ErrTotalNbrDl.1.UEID", KpiSchema::Type::INTEGER},
+  {"QosFlow.MacPduVolumeDL_Filter.UEID", KpiSchema::Type::INTEGER},
+  {"RRU.PrbUsedDl.UEID", KpiSchema::Type::INTEGER},
+  {"CARR.PDSCHMCSDist.Bin1.UEID", KpiSchema::Type::INTEGER},
+  {"CARR.PDSCHMCSDist.Bin2.UEID", KpiSchema::Type::INTEGER},
+  {"CARR.PDSCHMCSDist.Bin3.UEID", KpiSchema::Type::INTEGER},
+  {"CARR.PDSCHMCSDist.Bin4.UEID", KpiSchema::Type::INTEGER},
+  {"CARR.PDSCHMCSDist.Bin5.UEID", KpiSchema::Type::INTEGER},
+  {"CARR.PDSCHMCSDist.Bin6.UEID", KpiSchema::Type::INTEGER},
+  {"L1M.RS-SINR.Bin34.UEID", KpiSchema::Type::INTEGER},
+  {"L1M.RS-SINR.Bin46.UEID", KpiSchema::Type::INTEGER},
+  {"L1M.RS-SINR.Bin58.UEID", KpiSchema::Type::INTEGER},
+  {"L1M.RS-SINR.Bin70.UEID", KpiSchema::Type::INTEGER},
+  {"L1M.RS-SINR.Bin82.UEID", KpiSchema::Type::INTEGER},
+  {"L1M.RS-SINR.Bin94.UEID", KpiSchema::Type::INTEGER},
+  {"L1M.RS-SINR.Bin127.UEID", KpiSchema::Type::INTEGER},
+  {"DRB.BufferSize.Qos.UEID", KpiSchema::Type::INTEGER},
+  {"HO.SrcCellQual.RS-SINR.UEID", KpiSchema::Type::REAL},
+  {"HO.SrcCellQual.RS-SINR-Converted.UEID", KpiSchema::Type::REAL},
+  {"HO.SrcCellID.UEID", KpiSchema::Type::INTEGER},
+  {"HO.TrgtCellQual.1.RS-SINR.UEID", KpiSchema::Type::REAL},
+  {"HO.TrgtCellQual.1.RS-SINR-Converted.UEID", KpiSchema::Type::REAL},
+  {"HO.TrgtCellQual.1.UEID", KpiSchema::Type::INTEGER},
+  {"HO.TrgtCellQual.2.RS-SINR.UEID", KpiSchema::Type::REAL},
+  {"HO.TrgtCellQual.2.RS-SINR-Converted.UEID", KpiSchema::Type::REAL},
+  {"HO.TrgtCellQual.2.UEID", KpiSchema::Type::INTEGER},
+  {"HO.TrgtCellQual.3.RS-SINR.UEID", KpiSchema::Type::REAL},
+  {"HO.TrgtCellQual.3.RS-SINR-Converted.UEID", KpiSchema::Type::REAL},
+  {"HO.TrgtCellQual.3.UEID", KpiSchema::Type::INTEGER},
+  {"HO.TrgtCellQual.4.RS-SINR.UEID", KpiSchema::Type::REAL},
+  {"HO.TrgtCellQual.4.RS-SINR-Converted.UEID", KpiSchema::Type::REAL},
+  {"HO.TrgtCellQual.4.UEID", KpiSchema::Type::INTEGER},
+  {"HO.TrgtCellQual.5.RS-SINR.UEID", KpiSchema::Type::REAL},
+  {"HO.TrgtCellQual.5.RS-SINR-Converted.UEID", KpiSchema::Type::REAL},
+  {"HO.TrgtCellQual.5.UEID", KpiSchema::Type::INTEGER},
+  {"HO.TrgtCellQual.6.RS-SINR.UEID", KpiSchema::Type::REAL},
+  {"HO.TrgtCellQual.6.RS-SINR-Converted.UEID", KpiSchema::Type::REAL},
+  {"HO.TrgtCellQual.6.UEID", KpiSchema::Type::INTEGER},
+  {"HO.TrgtCellQual.7.RS-SINR.UEID", KpiSchema::Type::REAL},
+  {"HO.TrgtCellQual.7.RS-SINR-Converted.UEID", KpiSchema::Type::REAL},
+  {"HO.TrgtCellQual.7.UEID", KpiSchema::Type::INTEGER},
+  {"HO.TrgtCellQual.8.RS-SINR.UEID", KpiSchema::Type::REAL},
+  {"HO.TrgtCellQual.8.RS-SINR-Converted.UEID", KpiSchema::Type::REAL},
+  {"HO.TrgtCellQual.8.UEID", KpiSchema::Type::INTEGER},
+  {"DRB.UEThpDl.UEID", KpiSchema::Type::REAL},
+};
+
+static const KpmMetricRegistry::MetricInfo g_cellLteMetrics[] = {
+  {"cellID", KpiSchema::Type::INTEGER},
+  {"DRB.PdcpSduDelayDl", KpiSchema::Type::REAL},
+  {"pdcpBytesUl", KpiSchema::Type::REAL},
+  {"pdcpBytesDl", KpiSchema::Type::REAL},
+  {"numActiveUes", KpiSchema::Type::REAL},
+};
+
+static const KpmMetricRegistry::MetricInfo g_cellGnbMetrics[] = {
+  {"cellID", KpiSchema::Type::INTEGER},
+  {"TB.TotNbrDl.1", KpiSchema::Type::INTEGER},
+  {"TB.TotNbrDlInitial", KpiSchema::Type::INTEGER},
+  {"numActiveUes", KpiSchema::Type::INTEGER},
+  {"TB.TotNbrDlInitial.Qpsk", KpiSchema::Type::INTEGER},
+  {"TB.TotNbrDlInitial.16Qam", KpiSchema::Type::INTEGER},
+  {"TB.TotNbrDlInitial.64Qam", KpiSchema::Type::INTEGER},
+  {"RRU.PrbUsedDl", KpiSchema::Type::INTEGER},
+  {"TB.ErrTotalNbrDl.1", KpiSchema::Type::INTEGER},
+  {"QosFlow.PdcpPduVolumeDL_Filter", KpiSchema::Type::INTEGER},
+  {"CARR.PDSCHMCSDist.Bin1", KpiSchema::Type::INTEGER},
+  {"CARR.PDSCHMCSDist.Bin2", KpiSchema::Type::INTEGER},
+  {"CARR.PDSCHMCSDist.Bin3", KpiSchema::Type::INTEGER},
+  {"CARR.PDSCHMCSDist.Bin4", KpiSchema::Type::INTEGER},
+  {"CARR.PDSCHMCSDist.Bin5", KpiSchema::Type::INTEGER},
+  {"CARR.PDSCHMCSDist.Bin6", KpiSchema::Type::INTEGER},
+  {"L1M.RS-SINR.Bin34", KpiSchema::Type::INTEGER},
+  {"L1M.RS-SINR.Bin46", KpiSchema::Type::INTEGER},
+  {"L1M.RS-SINR.Bin58", KpiSchema::Type::INTEGER},
+  {"L1M.RS-SINR.Bin70", KpiSchema::Type::INTEGER},
+  {"L1M.RS-SINR.Bin82", KpiSchema::Type::INTEGER},
+  {"L1M.RS-SINR.Bin94", KpiSchema::Type::INTEGER},
+  {"L1M.RS-SINR.Bin127", KpiSchema::Type::INTEGER},
+  {"DRB.BufferSize.Qos", KpiSchema::Type::INTEGER},
+  {"DRB.MeanActiveUeDl", KpiSchema::Type::INTEGER},
+  {"PRB.AvailableDl", KpiSchema::Type::INTEGER},
+  {"RRB.AvailablePUl", KpiSchema::Type::INTEGER},
+  {"DRB.QCI", KpiSchema::Type::INTEGER},
+  {"RRB.UseageDl", KpiSchema::Type::INTEGER},
+  {"RRB.UseageUl", KpiSchema::Type::INTEGER},
+};
+
+KpmMetricRegistry &
+KpmMetricRegistry::Get ()
+{
+  static KpmMetricRegistry registry;
+  return registry;
+}
+
+KpmMetricRegistry::KpmMetricRegistry ()
+{
+  struct
+  {
+    const MetricInfo *metrics;
+    size_t count;
+  } groups[METRIC_GROUP_COUNT] = {
+      {g_ueLteMetrics, sizeof (g_ueLteMetrics) / sizeof (MetricInfo)},
+      {g_ueGnbMetrics, sizeof (g_ueGnbMetrics) / sizeof (MetricInfo)},
+      {g_cellLteMetrics, sizeof (g_cellLteMetrics) / sizeof (MetricInfo)},
+      {g_cellGnbMetrics, sizeof (g_cellGnbMetrics) / sizeof (MetricInfo)}};
+
+  // the IDs follow the order of the groups, a name shared by several groups
+  // keeps the ID of its first occurrence
+  for (int group = 0; group < METRIC_GROUP_COUNT; group++)
+    {
+      Ptr<KpiSchema> schema = Create<KpiSchema> ();
+      for (size_t i = 0; i < groups[group].count; i++)
+        {
+          const MetricInfo &metric = groups[group].metrics[i];
+          schema->AddMetric (metric.name, metric.type, Intern (metric.name));
+        }
+      m_schemas[group] = schema;
+    }
+  NS_LOG_LOGIC ("Registered " << m_names.size () << " KPM metrics");
+}
+
+uint32_t
+KpmMetricRegistry::Intern (const std::string &name)
+{
+  std::unique_lock<std::mutex> lock (m_mutex);
+  auto it = m_measIds.find (name);
+  if (it != m_measIds.end ())
+    {
+      return it->second;
+    }
+  m_names.push_back (name);
+  uint32_t measId = m_names.size ();
+  m_measIds.emplace (name, measId);
+  return measId;
+}
+
+uint32_t
+KpmMetricRegistry::FindMeasId (const std::string &name) const
+{
+  std::unique_lock<std::mutex> lock (m_mutex);
+  auto it = m_measIds.find (name);
+  return it == m_measIds.end () ? 0 : it->second;
+}
+
+const std::string &
+KpmMetricRegistry::GetName (uint32_t measId) const
+{
+  std::unique_lock<std::mutex> lock (m_mutex);
+  NS_ABORT_MSG_IF (measId == 0 || measId > m_names.size (), "Unknown measurement ID " << measId);
+  return m_names[measId - 1];
+}
+
+Ptr<const KpiSchema>
+KpmMetricRegistry::GetSchema (MetricGroup group) const
+{
+  return m_schemas[group];
+}
+
+} // namespace ns3
@@ -0,0 +1,101 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Northeastern University
+ * Copyright (c) 2022 Sapienza, University of Rome
+ * Copyright (c) 2022 University of Padova
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrea Lacava <thecave003@gmail.com>
+ *		   Tommaso Zugno <tommasozugno@gmail.com>
+ *		   Michele Polese <michele.polese@gmail.com>
+ */
+
+#ifndef KPM_METRIC_REGISTRY_H
+#define KPM_METRIC_REGISTRY_H
+
+#include <ns3/kpi-table.h>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace ns3 {
+
+  /**
+  * Process-wide table of the E2SM-KPM measurement names, each interned once
+  * and mapped to the measurement ID advertised in the RAN function
+  * description. The registry also holds the schema of the metrics reported
+  * by each kind of E2 node, shared by the function description, the
+  * indication message helpers and the encoders.
+  */
+  class KpmMetricRegistry
+  {
+  public:
+    enum MetricGroup
+    {
+      UE_LTE = 0,
+      UE_GNB = 1,
+      CELL_LTE = 2,
+      CELL_GNB = 3,
+      METRIC_GROUP_COUNT
+    };
+
+    struct MetricInfo
+    {
+      const char *name;
+      KpiSchema::Type type;
+    };
+
+    /**
+    * \return the registry of the process
+    */
+    static KpmMetricRegistry &Get ();
+
+    /**
+    * \param name a measurement name
+    * \return the measurement ID of the name, registering it if new
+    */
+    uint32_t Intern (const std::string &name);
+
+    /**
+    * \param name a measurement name
+    * \return the measurement ID of the name, 0 if it is not registered
+    */
+    uint32_t FindMeasId (const std::string &name) const;
+
+    /**
+    * \param measId a measurement ID returned by Intern
+    * \return the measurement name
+    */
+    const std::string &GetName (uint32_t measId) const;
+
+    /**
+    * \param group the kind of E2 node and of report
+    * \return the metrics of the group, in the order of the reports, with
+    *         their measurement IDs
+    */
+    Ptr<const KpiSchema> GetSchema (MetricGroup group) const;
+
+  private:
+    KpmMetricRegistry ();
+
+    mutable std::mutex m_mutex;
+    std::deque<std::string> m_names; //!< names, by measurement ID - 1
+    std::unordered_map<std::string, uint32_t> m_measIds; //!< measurement ID of each name
+    Ptr<const KpiSchema> m_schemas[METRIC_GROUP_COUNT]; //!< metrics of each group
+  };
+}
+
+#endif /* KPM_METRIC_REGISTRY_H */
@@ -23,30 +23,132 @@
  */
 
 #include <ns3/oran-interface.h>
+#include <ns3/e2-report-scheduler.h>
+#include <ns3/e2-termination-manager.h>
+#include <ns3/embedded-ric.h>
 #include <ns3/asn1c-types.h>
+#include <ns3/asn-struct-pool.h>
  
 #include <ns3/log.h>
+#include <ns3/uinteger.h>
+#include <ns3/boolean.h>
+#include <ns3/double.h>
+#include <ns3/simulator.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
 #include <thread>
+#include <sys/socket.h>
 #include "encode_e2apv1.hpp"
+#include "e2sim_sctp.hpp"
+#include "e2ap_message_handler.hpp"
 #include<unistd.h>
 extern "C" {
   #include "RICsubscriptionRequest.h"
   #include "RICactionType.h"
   #include "ProtocolIE-Field.h"
   #include "InitiatingMessage.h"
+  #include "E2SM-KPM-EventTriggerDefinition.h"
+  #include "E2SM-KPM-EventTriggerDefinition-Format1.h"
+  #include "E2SM-KPM-ActionDefinition.h"
+  #include "E2SM-KPM-ActionDefinition-Format1.h"
+  #include "E2SM-KPM-ActionDefinition-Format2.h"
+  #include "E2SM-KPM-ActionDefinition-Format3.h"
+  #include "E2SM-KPM-ActionDefinition-Format4.h"
+  #include "E2SM-KPM-ActionDefinition-Format5.h"
+  #include "MeasurementCondItem.h"
 }
 
 namespace ns3 {
 
 NS_LOG_COMPONENT_DEFINE ("E2Termination");
 
+// size key of the E2AP PDUs in the encode buffers, apart from the keys of
+// the E2SM-KPM messages
+static const uint64_t E2AP_PDU_SIZE_KEY = 1ULL << 62;
+// bytes of a RIC Indication besides the E2SM header and message
+static const size_t INDICATION_OVERHEAD = 128;
+
 NS_OBJECT_ENSURE_REGISTERED (E2Termination);
 
 TypeId E2Termination::GetTypeId ()
 {
   static TypeId tid = TypeId ("ns3::E2Termination")
     .SetParent<Object>()
-    .AddConstructor<E2Termination>();
+    .AddConstructor<E2Termination>()
+    .AddAttribute ("SendQueueCapacity",
+                   "Maximum number of E2 messages waiting for the sender thread. "
+                   "SendE2Message blocks while the queue is full.",
+                   UintegerValue (1024),
+                   MakeUintegerAccessor (&E2Termination::m_sendQueueCapacity),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("CoalescingWindow",
+                   "Time during which the E2 messages passed to SendE2Message are "
+                   "collected and handed over to the sender thread as one batch. "
+                   "With zero, messages of the same simulation timestamp are batched.",
+                   TimeValue (Seconds (0)),
+                   MakeTimeAccessor (&E2Termination::m_coalescingWindow),
+                   MakeTimeChecker (Seconds (0)))
+    .AddAttribute ("ReceiveInSimulatorThread",
+                   "If true, the callbacks registered for the messages received from "
+                   "the RIC are called in the simulator thread instead of the e2sim "
+                   "thread. Must be set before registering the callbacks.",
+                   BooleanValue (true),
+                   MakeBooleanAccessor (&E2Termination::m_receiveInSimulatorThread),
+                   MakeBooleanChecker ())
+    .AddAttribute ("ApplyDelay",
+                   "Simulation time between the reception of a message from the RIC "
+                   "and the call of its callback in the simulator thread",
+                   TimeValue (Seconds (0)),
+                   MakeTimeAccessor (&E2Termination::m_applyDelay),
+                   MakeTimeChecker (Seconds (0)))
+    .AddAttribute ("ControlCoalescingWindow",
+                   "Time during which the RIC controls of the same UE and control action "
+                   "are merged, only the last one being applied at the end of the window. "
+                   "With zero, the controls of the same simulation timestamp are merged. "
+                   "Must be set before the first control is received.",
+                   TimeValue (Seconds (0)),
+                   MakeTimeAccessor (&E2Termination::m_controlWindow),
+                   MakeTimeChecker (Seconds (0)))
+    .AddAttribute ("ControlUeRateLimit",
+                   "Controls per second of simulation time applied for each UE, the "
+                   "others are dropped. Zero for no limit.",
+                   DoubleValue (0),
+                   MakeDoubleAccessor (&E2Termination::m_controlUeRate),
+                   MakeDoubleChecker<double> (0))
+    .AddAttribute ("ControlUeBurst",
+                   "Controls of a UE applied at once before the rate limit applies",
+                   DoubleValue (1),
+                   MakeDoubleAccessor (&E2Termination::m_controlUeBurst),
+                   MakeDoubleChecker<double> (1))
+    .AddAttribute ("ControlGlobalRateLimit",
+                   "Controls per second of simulation time applied overall, the "
+                   "others are dropped. Zero for no limit.",
+                   DoubleValue (0),
+                   MakeDoubleAccessor (&E2Termination::m_controlGlobalRate),
+                   MakeDoubleChecker<double> (0))
+    .AddAttribute ("ControlGlobalBurst",
+                   "Controls applied at once before the global rate limit applies",
+                   DoubleValue (1),
+                   MakeDoubleAccessor (&E2Termination::m_controlGlobalBurst),
+                   MakeDoubleChecker<double> (1))
+    .AddAttribute ("Lockstep",
+                   "If true, after the reports of a timestamp have been sent the "
+                   "simulator thread blocks until a RIC Control Request is received, "
+                   "possibly with no action, or the LockstepTimeout expires",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&E2Termination::m_lockstep),
+                   MakeBooleanChecker ())
+    .AddAttribute ("LockstepTimeout",
+                   "Longest wall-clock time the simulator waits for the RIC at each step",
+                   TimeValue (Seconds (1)),
+                   MakeTimeAccessor (&E2Termination::m_lockstepTimeout),
+                   MakeTimeChecker (Seconds (0)))
+    .AddTraceSource ("LockstepWait",
+                     "Wall-clock time waited for the RIC at each lockstep step",
+                     MakeTraceSourceAccessor (&E2Termination::m_lockstepWaitTrace),
+                     "ns3::E2Termination::LockstepWaitTracedCallback");
   return tid;
 }
 
@@ -64,7 +166,30 @@ E2Termination::E2Termination(const std::string ricAddress,
     m_ricPort (ricPort),
     m_clientPort (clientPort),
     m_gnbId (gnbId),
-    m_plmnId(plmnId)
+    m_plmnId(plmnId),
+    m_socket (-1),
+    m_sendQueueCapacity (1024),
+    m_manager (nullptr),
+    m_coalescingWindow (Seconds (0)),
+    m_batchFlushScheduled (false),
+    m_disposed (false),
+    m_batchStats (),
+    m_receiveInSimulatorThread (true),
+    m_applyDelay (Seconds (0)),
+    m_applyScheduled (false),
+    m_receiveStats (),
+    m_controlDispatchScheduled (false),
+    m_controlWindow (Seconds (0)),
+    m_controlUeRate (0),
+    m_controlUeBurst (1),
+    m_controlGlobalRate (0),
+    m_controlGlobalBurst (1),
+    m_lockstep (false),
+    m_lockstepTimeout (Seconds (1)),
+    m_lockstepWaitScheduled (false),
+    m_lockstepStepStarted (false),
+    m_ricResponses (0),
+    m_lockstepStats ()
 {
   NS_LOG_FUNCTION (this);
   m_e2sim = new E2Sim;
@@ -85,6 +210,7 @@ E2Termination::RegisterFunctionDescToE2Sm (long ranFunctionId, Ptr<FunctionDescr
   memcpy (rfdBuf->buf, ranFunctionDescription->m_buffer, ranFunctionDescription->m_size);
 
   m_e2sim->register_e2sm (ranFunctionId, rfdBuf);
+  m_ranFunctions[ranFunctionId] = rfdBuf;
 }
 
 void
@@ -92,14 +218,446 @@ E2Termination::RegisterKpmCallbackToE2Sm (long ranFunctionId, Ptr<FunctionDescri
                              SubscriptionCallback sbCb)
 {
   RegisterFunctionDescToE2Sm (ranFunctionId,ranFunctionDescription);
-  m_e2sim->register_subscription_callback (ranFunctionId, sbCb);
+  m_e2sim->register_subscription_callback (ranFunctionId, WrapReceiveCallback (sbCb));
 }
 
 void
 E2Termination::RegisterSmCallbackToE2Sm (long ranFunctionId, Ptr<FunctionDescription> ranFunctionDescription, SmCallback smCb)
 {
   RegisterFunctionDescToE2Sm (ranFunctionId,ranFunctionDescription);
-  m_e2sim->register_sm_callback (ranFunctionId, smCb);
+  m_e2sim->register_sm_callback (ranFunctionId, WrapControlCallback (WrapReceiveCallback (smCb)));
+}
+
+void
+E2Termination::RegisterControlFunctionToE2Sm (long ranFunctionId,
+                                              Ptr<FunctionDescription> ranFunctionDescription)
+{
+  RegisterFunctionDescToE2Sm (ranFunctionId, ranFunctionDescription);
+  m_e2sim->register_sm_callback (ranFunctionId, MakeControlCallback (ranFunctionId));
+}
+
+std::function<void (E2AP_PDU_t *)>
+E2Termination::MakeControlCallback (long ranFunctionId)
+{
+  return WrapControlCallback (WrapReceiveCallback (
+      std::bind (&E2Termination::ReceiveControl, this, ranFunctionId, std::placeholders::_1)));
+}
+
+void
+E2Termination::RegisterControlHandler (long ranFunctionId, long controlStyle,
+                                       long controlActionId, ControlHandler handler)
+{
+  NS_LOG_FUNCTION (this << ranFunctionId << controlStyle << controlActionId);
+  std::unique_lock<std::mutex> lock (m_controlMutex);
+  m_controlHandlers[ControlKey (ranFunctionId, controlStyle, controlActionId)].handler = handler;
+}
+
+void
+E2Termination::SetControlAckPolicy (long ranFunctionId, ControlAckPolicy policy)
+{
+  NS_LOG_FUNCTION (this << ranFunctionId << policy);
+  std::unique_lock<std::mutex> lock (m_controlMutex);
+  m_controlAckPolicies[ranFunctionId] = policy;
+}
+
+void
+E2Termination::ReceiveControl (long ranFunctionId, E2AP_PDU_t *pdu)
+{
+  SubmitControl (ranFunctionId, Create<RicControlMessage> (pdu));
+}
+
+void
+E2Termination::SubmitControl (long ranFunctionId, Ptr<RicControlMessage> request)
+{
+  // the actions of a multi-action request join the batches of their handlers
+  std::vector<Ptr<RicControlMessage>> controls;
+  if (request->GetControlActions ().size () > 1)
+    {
+      controls = request->SplitActions ();
+    }
+  else
+    {
+      controls.push_back (request);
+    }
+
+  std::unique_lock<std::mutex> lock (m_controlMutex);
+  for (const Ptr<RicControlMessage> &control : controls)
+    {
+      if (control->GetControlStyle () == NO_ACTION_CONTROL_STYLE)
+        {
+          // ends a lockstep step, resolved as applied with the other controls
+          m_unhandledControls.emplace_back (ranFunctionId, control);
+          continue;
+        }
+      ControlKey key (ranFunctionId, control->GetControlStyle (), control->GetControlActionId ());
+      auto it = m_controlHandlers.find (key);
+      if (it == m_controlHandlers.end () || it->second.handler.IsNull ())
+        {
+          NS_LOG_WARN ("No handler for the RIC control of RAN function "
+                       << ranFunctionId << ", style " << control->GetControlStyle ()
+                       << ", action " << control->GetControlActionId () << ", dropped");
+          // resolved in the simulator thread, with the other controls
+          control->Reject (Cause_PR_ricRequest, CauseRIC_action_not_supported);
+          m_unhandledControls.emplace_back (ranFunctionId, control);
+          continue;
+        }
+      it->second.controls.push_back (control);
+    }
+  if (!m_controlDispatchScheduled)
+    {
+      // runs after the events already scheduled in this step, e.g., the
+      // application of the other PDUs received with this one
+      m_controlDispatchScheduled = true;
+      Simulator::ScheduleWithContext (Simulator::NO_CONTEXT, Seconds (0),
+                                      &E2Termination::DispatchControls, this);
+    }
+}
+
+void
+E2Termination::DispatchControls ()
+{
+  if (m_controlCoalescer == nullptr)
+    {
+      m_controlCoalescer = Create<ControlCoalescer> ();
+      m_controlCoalescer->SetWindow (m_controlWindow);
+      m_controlCoalescer->SetUeRateLimit (m_controlUeRate, m_controlUeBurst);
+      m_controlCoalescer->SetGlobalRateLimit (m_controlGlobalRate, m_controlGlobalBurst);
+    }
+
+  std::vector<std::pair<long, Ptr<RicControlMessage>>> resolved;
+  {
+    std::unique_lock<std::mutex> lock (m_controlMutex);
+    m_controlDispatchScheduled = false;
+    resolved.swap (m_unhandledControls);
+    for (auto &entry : m_controlHandlers)
+      {
+        long ranFunctionId = std::get<0> (entry.first);
+        for (const Ptr<RicControlMessage> &control : entry.second.controls)
+          {
+            Ptr<RicControlMessage> replaced =
+                m_controlCoalescer->Add (ranFunctionId, control, Simulator::Now ());
+            if (replaced != nullptr)
+              {
+                replaced->Reject (Cause_PR_misc, CauseMisc_control_processing_overload);
+                resolved.emplace_back (ranFunctionId, replaced);
+              }
+          }
+        entry.second.controls.clear ();
+      }
+  }
+  for (auto &item : resolved)
+    {
+      ResolveControl (item.first, item.second);
+    }
+  ReleaseControls ();
+}
+
+void
+E2Termination::ReleaseControls ()
+{
+  std::vector<ControlCoalescer::Released> released;
+  std::vector<ControlCoalescer::Released> dropped;
+  m_controlCoalescer->Release (Simulator::Now (), released, &dropped);
+  for (const ControlCoalescer::Released &item : dropped)
+    {
+      item.control->Reject (Cause_PR_misc, CauseMisc_control_processing_overload);
+      ResolveControl (item.ranFunctionId, item.control);
+    }
+
+  std::map<ControlKey, std::pair<ControlHandler, std::vector<Ptr<RicControlMessage>>>> batches;
+  {
+    std::unique_lock<std::mutex> lock (m_controlMutex);
+    for (const ControlCoalescer::Released &item : released)
+      {
+        ControlKey key (item.ranFunctionId, item.control->GetControlStyle (),
+                        item.control->GetControlActionId ());
+        auto it = m_controlHandlers.find (key);
+        if (it != m_controlHandlers.end ())
+          {
+            auto &batch = batches[key];
+            batch.first = it->second.handler;
+            batch.second.push_back (item.control);
+          }
+        else
+          {
+            item.control->Reject (Cause_PR_ricRequest, CauseRIC_action_not_supported);
+            batches[key].second.push_back (item.control);
+          }
+      }
+  }
+
+  // the handlers may register other handlers, they are called without the lock
+  for (auto &batch : batches)
+    {
+      NS_LOG_DEBUG ("Dispatch a batch of " << batch.second.second.size () << " RIC controls");
+      if (!batch.second.first.IsNull ())
+        {
+          batch.second.first (batch.second.second);
+        }
+      for (const Ptr<RicControlMessage> &control : batch.second.second)
+        {
+          ResolveControl (std::get<0> (batch.first), control);
+        }
+    }
+
+  if (m_controlCoalescer->HasPending () && m_controlReleaseEvent.IsExpired ())
+    {
+      m_controlReleaseEvent =
+          Simulator::Schedule (m_controlCoalescer->GetNextRelease () - Simulator::Now (),
+                               &E2Termination::ReleaseControls, this);
+    }
+}
+
+void
+E2Termination::ResolveControl (long ranFunctionId, Ptr<RicControlMessage> control)
+{
+  if (!control->Resolve ())
+    {
+      return;
+    }
+  if (control->IsLocal ())
+    {
+      // built in the simulator, the outcome has no requester to go to
+      NS_LOG_DEBUG ("Local RIC control " << (control->IsRejected () ? "failed" : "applied"));
+      return;
+    }
+
+  ControlAckPolicy policy = ACK_ON_REQUEST;
+  {
+    std::unique_lock<std::mutex> lock (m_controlMutex);
+    auto it = m_controlAckPolicies.find (ranFunctionId);
+    if (it != m_controlAckPolicies.end ())
+      {
+        policy = it->second;
+      }
+  }
+  bool rejected = control->IsRejected ();
+  if (policy == ACK_NEVER ||
+      (policy == ACK_ON_REQUEST && !rejected &&
+       control->m_ricControlAckRequest != RICcontrolAckRequest_ack))
+    {
+      return;
+    }
+
+  NS_LOG_DEBUG ("RIC control " << control->m_ricRequestId.ricRequestorID << "/"
+                               << control->m_ricRequestId.ricInstanceID
+                               << (rejected ? " failed" : " acknowledged"));
+  if (rejected)
+    {
+      SendEncoded (m_responseEncoder.EncodeFailure (
+          ranFunctionId, control->m_ricRequestId, control->m_ricCallProcessId,
+          control->GetCauseGroup (), control->GetCause ()));
+    }
+  else
+    {
+      SendEncoded (m_responseEncoder.EncodeAcknowledge (ranFunctionId, control->m_ricRequestId,
+                                                        control->m_ricCallProcessId));
+    }
+}
+
+void
+E2Termination::SendEncoded (const std::vector<uint8_t> &encoded)
+{
+  NS_ABORT_MSG_IF (encoded.size () > MAX_SCTP_BUFFER, "E2AP PDU larger than the SCTP buffer");
+  if (!m_sendQueue)
+    {
+      // termination not started (or already stopped), send from the caller
+      WriteNow (encoded.data (), encoded.size ());
+      return;
+    }
+
+  // the sender thread writes it in order with the reports and the other responses
+  KpmEncodeBuffer &buffers = KpmEncodeBuffer::GetThreadBuffer ();
+  E2SendQueue::Message message;
+  message.encoded = buffers.Acquire (encoded.size (), E2AP_PDU_SIZE_KEY);
+  memcpy (message.encoded.GetData (), encoded.data (), encoded.size ());
+  buffers.Commit (message.encoded, encoded.size (), E2AP_PDU_SIZE_KEY);
+  QueueMessage (std::move (message));
+}
+
+ControlCoalescer::Stats
+E2Termination::GetControlStats () const
+{
+  if (m_controlCoalescer == nullptr)
+    {
+      return ControlCoalescer::Stats ();
+    }
+  return m_controlCoalescer->GetStats ();
+}
+
+std::function<void (E2AP_PDU_t *)>
+E2Termination::WrapControlCallback (std::function<void (E2AP_PDU_t *)> callback)
+{
+  // called in the receive thread, while the simulator thread may be waiting
+  return [this, callback] (E2AP_PDU_t *pdu) {
+    callback (pdu);
+    ReleaseLockstep ();
+  };
+}
+
+void
+E2Termination::ReleaseLockstep ()
+{
+  {
+    std::unique_lock<std::mutex> lock (m_lockstepMutex);
+    m_ricResponses++;
+  }
+  m_lockstepCv.notify_all ();
+}
+
+void
+E2Termination::ScheduleLockstepWait (uint32_t reports)
+{
+  // a termination not started has no RIC to wait for
+  if (!m_lockstep || !m_sendQueue || m_lockstepWaitScheduled)
+    {
+      return;
+    }
+  NS_LOG_FUNCTION (this << reports);
+  m_lockstepWaitScheduled = true;
+  Simulator::ScheduleNow (&E2Termination::WaitForRic, this);
+}
+
+void
+E2Termination::BeginLockstepStep ()
+{
+  if (!m_lockstep || !m_sendQueue || m_lockstepStepStarted)
+    {
+      return;
+    }
+  m_lockstepStepStarted = true;
+  // the reports of this step are not handed over yet: the requests
+  // received so far answer the previous steps
+  std::unique_lock<std::mutex> lock (m_lockstepMutex);
+  m_ricResponses = 0;
+}
+
+void
+E2Termination::WaitForRic ()
+{
+  m_lockstepWaitScheduled = false;
+  m_lockstepStepStarted = false;
+  FlushBatch ();
+
+  auto start = std::chrono::steady_clock::now ();
+  bool answered;
+  {
+    std::unique_lock<std::mutex> lock (m_lockstepMutex);
+    answered = m_lockstepCv.wait_for (
+        lock, std::chrono::nanoseconds (m_lockstepTimeout.GetNanoSeconds ()),
+        [this] { return m_ricResponses > 0; });
+  }
+  uint64_t waitNs = std::chrono::duration_cast<std::chrono::nanoseconds> (
+                        std::chrono::steady_clock::now () - start)
+                        .count ();
+  {
+    std::unique_lock<std::mutex> lock (m_statsMutex);
+    m_lockstepStats.steps++;
+    m_lockstepStats.timeouts += answered ? 0 : 1;
+    m_lockstepStats.totalWaitNs += waitNs;
+    m_lockstepStats.maxWaitNs = std::max (m_lockstepStats.maxWaitNs, waitNs);
+  }
+  if (!answered)
+    {
+      NS_LOG_WARN ("No RIC Control Request within " << m_lockstepTimeout.As (Time::MS)
+                                                    << ", the simulation goes on");
+    }
+  m_lockstepWaitTrace (NanoSeconds (waitNs), answered);
+}
+
+E2Termination::LockstepStats
+E2Termination::GetLockstepStats () const
+{
+  std::unique_lock<std::mutex> lock (m_statsMutex);
+  return m_lockstepStats;
+}
+
+std::function<void (E2AP_PDU_t *)>
+E2Termination::WrapReceiveCallback (std::function<void (E2AP_PDU_t *)> callback)
+{
+  if (!m_receiveInSimulatorThread)
+    {
+      return callback;
+    }
+  uint32_t handler = m_receiveHandlers.size ();
+  m_receiveHandlers.push_back (callback);
+  return std::bind (&E2Termination::EnqueueReceived, this, handler, std::placeholders::_1);
+}
+
+void
+E2Termination::EnqueueReceived (uint32_t handler, E2AP_PDU_t *pdu)
+{
+  if (m_disposed)
+    {
+      NS_LOG_WARN ("E2 termination disposed, received message dropped");
+      return;
+    }
+  // e2sim may release the PDU once the callback returns: its encoding is
+  // queued instead, and decoded by the simulator thread
+  E2ReceiveQueue::Item item;
+  item.encoded =
+      KpmEncodeBuffer::GetThreadBuffer ().Encode (&asn_DEF_E2AP_PDU, pdu, E2AP_PDU_SIZE_KEY);
+  if (item.encoded.GetSpan ().size == 0)
+    {
+      NS_LOG_ERROR ("Cannot encode the received E2AP PDU, message dropped");
+      return;
+    }
+  item.handler = handler;
+  item.enqueueTime = std::chrono::steady_clock::now ();
+  m_receiveQueue.Push (std::move (item));
+
+  if (!m_applyScheduled.exchange (true, std::memory_order_acq_rel))
+    {
+      Simulator::ScheduleWithContext (Simulator::NO_CONTEXT, m_applyDelay,
+                                      &E2Termination::ApplyReceived, this);
+    }
+}
+
+void
+E2Termination::ApplyReceived ()
+{
+  if (m_disposed)
+    {
+      // scheduled before the termination was disposed
+      return;
+    }
+  // cleared before draining: a PDU pushed from now on schedules a new event
+  m_applyScheduled.exchange (false, std::memory_order_acq_rel);
+
+  E2ReceiveQueue::Item item;
+  while (m_receiveQueue.Pop (item))
+    {
+      uint64_t latency = std::chrono::duration_cast<std::chrono::nanoseconds> (
+                             std::chrono::steady_clock::now () - item.enqueueTime)
+                             .count ();
+      {
+        std::unique_lock<std::mutex> lock (m_statsMutex);
+        m_receiveStats.messages++;
+        m_receiveStats.totalLatencyNs += latency;
+        m_receiveStats.maxLatencyNs = std::max (m_receiveStats.maxLatencyNs, latency);
+      }
+
+      E2AP_PDU_t *pdu = AsnStructPool::GetE2apPduPool ().Acquire<E2AP_PDU_t> ();
+      KpmEncodeBuffer::Span span = item.encoded.GetSpan ();
+      asn_dec_rval_t rval =
+          aper_decode_complete (nullptr, &asn_DEF_E2AP_PDU, (void **) &pdu, span.data, span.size);
+      if (rval.code == RC_OK)
+        {
+          m_receiveHandlers[item.handler](pdu);
+        }
+      else
+        {
+          NS_LOG_ERROR ("Cannot decode the received E2AP PDU, message dropped");
+        }
+      AsnStructPool::GetE2apPduPool ().Release (pdu);
+    }
+}
+
+E2Termination::ReceiveStats
+E2Termination::GetReceiveStats () const
+{
+  std::unique_lock<std::mutex> lock (m_statsMutex);
+  return m_receiveStats;
 }
 
 void
@@ -113,39 +671,400 @@ void E2Termination::Start ()
   NS_LOG_FUNCTION (this);
 
   NS_ABORT_MSG_IF(m_ricAddress.empty(), "Set the RIC information first");
-  
-  // create a thread to host e2sim execution
-  std::thread e2simThread (&E2Termination::DoStart, this);
-  e2simThread.detach ();
+  NS_ABORT_MSG_IF (m_sendQueue, "E2 termination already started");
+
+  // the sender thread must be ready before e2sim can trigger any callback
+  m_sendQueue.reset (new E2SendQueue (m_sendQueueCapacity));
+  if (!m_manager)
+    {
+      m_senderThread = std::thread (&E2Termination::DoSend, this);
+    }
+
+  Connect ();
+  if (!m_manager)
+    {
+      // the sockets of a manager are polled by its receive threads
+      m_receiveThread = std::thread (&E2Termination::DoReceive, this);
+    }
 }
 
-void E2Termination::DoStart ()
+void
+E2Termination::SetE2Socket (int socket)
 {
-  NS_LOG_FUNCTION (this);
-  
-  // start e2sim main loop
-  // char second[14]; // RIC ADDRESS
-  // std::strcpy (second, m_ricAddress.c_str ());
-  // char third[6]; // RIC PORT
-  // std::strcpy (third, std::to_string (m_ricPort).c_str ());
-  // char fourth[5]; // GNB ID value
-  // std::strncpy (fourth, m_gnbId.c_str (), 4);
-  // char fifth[6]; // CLIENT PORT
-  // std::strcpy (fifth, std::to_string (m_clientPort).c_str ());
-  // char sixth[4]; //PLMN ID
-  // std::strcpy (sixth, m_plmnId.c_str ());
+  NS_LOG_FUNCTION (this << socket);
+  NS_ABORT_MSG_IF (m_sendQueue, "E2 termination already started");
+  NS_ABORT_MSG_IF (m_socket >= 0, "E2 connection already set");
+  m_socket = socket;
+}
 
+void
+E2Termination::Connect ()
+{
+  if (m_socket >= 0)
+    {
+      // set up by the caller
+      return;
+    }
   NS_LOG_INFO ("In ns3::E2Term:  GNB" << m_gnbId << ", clientPort " << m_clientPort << ", ricPort "
                                  << m_ricPort <<  ", PlmnID "
                                  << m_plmnId);
+  m_socket = sctp_start_client (m_ricAddress.c_str (), m_ricPort, m_clientPort);
+  NS_ABORT_MSG_IF (m_socket < 0, "Cannot connect to the RIC at " << m_ricAddress << ":"
+                                                                 << m_ricPort);
+  SendSetupRequest ();
+}
+
+void
+E2Termination::SendSetupRequest ()
+{
+  std::vector<encoding::ran_func_info> functions;
+  for (const auto &function : m_ranFunctions)
+    {
+      encoding::ran_func_info info;
+      info.ranFunctionId = function.first;
+      info.ranFunctionDesc = function.second;
+      info.ranFunctionRev = 2;
+      functions.push_back (info);
+    }
+  E2AP_PDU_t *pdu = (E2AP_PDU_t *) calloc (1, sizeof (E2AP_PDU_t));
+  encoding::generate_e2apv1_setup_request_parameterized (
+      pdu, functions, (uint8_t *) m_gnbId.c_str (), (uint8_t *) m_plmnId.c_str ());
+  NS_LOG_DEBUG ("Send E2 Setup Request with " << functions.size () << " RAN functions");
+  SendNow (pdu);
+  // as in the e2sim main loop, the PDU is not released: it shares the RAN
+  // Function Descriptions registered to e2sim
+}
+
+bool
+E2Termination::ReceiveMessage ()
+{
+  ssize_t size = recv (m_socket, m_receiveBuffer.buffer, MAX_SCTP_BUFFER, 0);
+  if (size < 0 && errno == EINTR)
+    {
+      return true;
+    }
+  if (size < 0)
+    {
+      NS_LOG_WARN ("Cannot receive from the RIC: " << strerror (errno));
+      return false;
+    }
+  if (size == 0)
+    {
+      NS_LOG_INFO ("E2 connection of GNB " << m_gnbId << " closed");
+      return false;
+    }
+  m_receiveBuffer.len = size;
+  e2ap_handle_sctp_data (m_socket, m_receiveBuffer, false, m_e2sim);
+  return true;
+}
+
+void
+E2Termination::DoReceive ()
+{
+  NS_LOG_FUNCTION (this);
+  while (ReceiveMessage ())
+    {
+    }
+  NS_LOG_DEBUG ("Receive thread of GNB " << m_gnbId << " stopped");
+}
+
+void
+E2Termination::StopReceiver ()
+{
+  if (m_socket < 0)
+    {
+      return;
+    }
+  // wakes the receive thread up, blocked on the socket
+  shutdown (m_socket, SHUT_RDWR);
+  if (m_receiveThread.joinable ())
+    {
+      m_receiveThread.join ();
+    }
+  close (m_socket);
+  m_socket = -1;
+}
+
+void
+E2Termination::SendNow (E2AP_PDU_t *pdu)
+{
+  KpmEncodeBuffer::Block encoded =
+      KpmEncodeBuffer::GetThreadBuffer ().Encode (&asn_DEF_E2AP_PDU, pdu, E2AP_PDU_SIZE_KEY);
+  KpmEncodeBuffer::Span span = encoded.GetSpan ();
+  if (span.size == 0)
+    {
+      NS_LOG_ERROR ("Cannot encode the E2AP PDU, message dropped");
+      return;
+    }
+  WriteNow (span.data, span.size);
+}
+
+void
+E2Termination::WriteNow (const uint8_t *data, size_t size)
+{
+  if (m_socket < 0)
+    {
+      NS_LOG_WARN ("No E2 connection, message dropped");
+      return;
+    }
+  // a connection closed by the RIC must not raise SIGPIPE
+  while (send (m_socket, data, size, MSG_NOSIGNAL) < 0)
+    {
+      if (errno != EINTR)
+        {
+          NS_LOG_ERROR ("Cannot write the E2 message to the RIC: " << strerror (errno));
+          return;
+        }
+    }
+}
+
+void
+E2Termination::DoSend ()
+{
+  NS_LOG_FUNCTION (this);
+
+  std::vector<E2SendQueue::Message> messages;
+  size_t count;
+  while ((count = m_sendQueue->Pop (messages)) > 0)
+    {
+      {
+        std::unique_lock<std::mutex> lock (m_statsMutex);
+        m_batchStats.writeRounds++;
+        m_batchStats.maxWriteRound = std::max<uint32_t> (m_batchStats.maxWriteRound, count);
+      }
+      WriteMessages (messages);
+      m_sendQueue->MarkSent (count);
+    }
+  NS_LOG_DEBUG ("Sender thread of GNB " << m_gnbId << " stopped");
+}
+
+void
+E2Termination::WriteMessages (std::vector<E2SendQueue::Message> &messages)
+{
+  // the PDUs are encoded back to back into the staging buffer, the
+  // encoded messages are written from their own buffers
+  m_sendStaging.clear ();
+  m_sendIovecs.clear ();
+  for (E2SendQueue::Message &message : messages)
+    {
+      struct iovec iov;
+      if (message.pdu)
+        {
+          size_t offset = m_sendStaging.size ();
+          m_sendStaging.resize (offset + MAX_SCTP_BUFFER);
+          asn_enc_rval_t rval =
+              asn_encode_to_buffer (nullptr, ATS_ALIGNED_BASIC_PER, &asn_DEF_E2AP_PDU,
+                                    message.pdu.get (), &m_sendStaging[offset], MAX_SCTP_BUFFER);
+          if (rval.encoded < 0 || rval.encoded > MAX_SCTP_BUFFER)
+            {
+              NS_LOG_ERROR ("Cannot encode the E2AP PDU in the SCTP buffer, message dropped");
+              m_sendStaging.resize (offset);
+              CountDropped (1);
+              continue;
+            }
+          m_sendStaging.resize (offset + rval.encoded);
+          // pointed to once the staging buffer is complete
+          iov.iov_base = nullptr;
+          iov.iov_len = rval.encoded;
+        }
+      else
+        {
+          KpmEncodeBuffer::Span encoded = message.encoded.GetSpan ();
+          if (encoded.size > MAX_SCTP_BUFFER)
+            {
+              NS_LOG_ERROR ("E2AP PDU larger than the SCTP buffer, message dropped");
+              CountDropped (1);
+              continue;
+            }
+          iov.iov_base = (void *) encoded.data;
+          iov.iov_len = encoded.size;
+        }
+      m_sendIovecs.push_back (iov);
+    }
+
+  size_t staged = 0;
+  m_sendHeaders.assign (m_sendIovecs.size (), mmsghdr ());
+  for (size_t i = 0; i < m_sendIovecs.size (); i++)
+    {
+      if (m_sendIovecs[i].iov_base == nullptr)
+        {
+          m_sendIovecs[i].iov_base = &m_sendStaging[staged];
+          staged += m_sendIovecs[i].iov_len;
+        }
+      m_sendHeaders[i].msg_hdr.msg_iov = &m_sendIovecs[i];
+      m_sendHeaders[i].msg_hdr.msg_iovlen = 1;
+    }
 
-  // char* argv [] = {nullptr, &second [0], &third [0], &fourth[0], &fifth[0],&sixth[0]};
-  m_e2sim->run_loop (m_ricAddress, m_ricPort, m_clientPort, m_gnbId, m_plmnId);
+  // one SCTP message per PDU, as sctp_send_data would write them, with a
+  // single system call for the batch
+  size_t next = 0;
+  while (next < m_sendHeaders.size ())
+    {
+      int sent = sendmmsg (m_socket, &m_sendHeaders[next], m_sendHeaders.size () - next,
+                           MSG_NOSIGNAL);
+      if (sent < 0)
+        {
+          if (errno == EINTR)
+            {
+              continue;
+            }
+          NS_LOG_ERROR ("Cannot write the E2 messages to the RIC: " << strerror (errno)
+                        << ", " << m_sendHeaders.size () - next << " messages dropped");
+          CountDropped (m_sendHeaders.size () - next);
+          break;
+        }
+      next += sent;
+    }
+  messages.clear ();
+}
+
+void
+E2Termination::CountDropped (uint64_t count)
+{
+  std::unique_lock<std::mutex> lock (m_statsMutex);
+  m_batchStats.dropped += count;
+}
+
+size_t
+E2Termination::SendPendingMessages ()
+{
+  std::vector<E2SendQueue::Message> messages;
+  size_t count = m_sendQueue->TryPop (messages);
+  if (count > 0)
+    {
+      {
+        std::unique_lock<std::mutex> lock (m_statsMutex);
+        m_batchStats.writeRounds++;
+        m_batchStats.maxWriteRound = std::max<uint32_t> (m_batchStats.maxWriteRound, count);
+      }
+      WriteMessages (messages);
+      m_sendQueue->MarkSent (count);
+    }
+  return count;
+}
+
+bool
+E2Termination::HasPendingMessages () const
+{
+  return m_sendQueue && m_sendQueue->GetPushedCount () > m_sendQueue->GetSentCount ();
+}
+
+void
+E2Termination::NotifyPendingMessages ()
+{
+  if (m_manager)
+    {
+      m_manager->NotifyPendingMessages (this);
+    }
+}
+
+void
+E2Termination::FlushBatch ()
+{
+  if (m_disposed)
+    {
+      // scheduled before the termination was disposed
+      return;
+    }
+  std::vector<E2SendQueue::Message> batch;
+  {
+    std::unique_lock<std::mutex> lock (m_batchMutex);
+    batch.swap (m_pendingBatch);
+    m_batchFlushScheduled = false;
+  }
+  if (batch.empty ())
+    {
+      return;
+    }
+
+  NS_LOG_DEBUG ("Hand over a batch of " << batch.size () << " E2 messages");
+  {
+    std::unique_lock<std::mutex> lock (m_statsMutex);
+    m_batchStats.batches++;
+    m_batchStats.pdus += batch.size ();
+    m_batchStats.maxBatchSize = std::max<uint32_t> (m_batchStats.maxBatchSize, batch.size ());
+  }
+
+  // a batch refused by a closed queue is released here
+  if (!m_sendQueue->PushBatch (std::move (batch)))
+    {
+      return;
+    }
+  NotifyPendingMessages ();
+}
+
+void
+E2Termination::Flush ()
+{
+  NS_LOG_FUNCTION (this);
+  if (m_sendQueue)
+    {
+      FlushBatch ();
+      m_sendQueue->WaitUntilDrained ();
+    }
+}
+
+E2Termination::SendBatchStats
+E2Termination::GetSendBatchStats () const
+{
+  std::unique_lock<std::mutex> lock (m_statsMutex);
+  return m_batchStats;
+}
+
+void
+E2Termination::StopSender ()
+{
+  if (!m_sendQueue)
+    {
+      return;
+    }
+  // pending PDUs are still sent before the thread exits
+  FlushBatch ();
+  if (m_manager)
+    {
+      // the threads of the manager send them
+      m_sendQueue->WaitUntilDrained ();
+    }
+  m_sendQueue->Close ();
+  if (m_senderThread.joinable ())
+    {
+      m_senderThread.join ();
+    }
+}
+
+void
+E2Termination::DoDispose ()
+{
+  NS_LOG_FUNCTION (this);
+  if (m_reportScheduler)
+    {
+      m_reportScheduler->Dispose ();
+      m_reportScheduler = nullptr;
+    }
+  m_ueKpiCb = MakeNullCallback<Ptr<const KpiTable>> ();
+  StopSender ();
+  StopReceiver ();
+  m_disposed = true;
+  {
+    std::unique_lock<std::mutex> lock (m_controlMutex);
+    m_controlHandlers.clear ();
+    m_unhandledControls.clear ();
+  }
+  m_controlReleaseEvent.Cancel ();
+  m_controlCoalescer = nullptr;
+  if (m_embeddedRic)
+    {
+      m_embeddedRic->Dispose ();
+      m_embeddedRic = nullptr;
+    }
+  Object::DoDispose ();
 }
 
 E2Termination::~E2Termination ()
 {
   NS_LOG_FUNCTION (this);
+  StopSender ();
+  StopReceiver ();
   delete m_e2sim;
 }
 
@@ -176,9 +1095,17 @@ E2Termination::ProcessRicSubscriptionRequest (E2AP_PDU_t* sub_req_pdu)
   uint16_t reqInstanceId {};
   uint16_t ranFuncionId {};
   uint8_t reqActionId {};
+
+  RicSubscriptionRequest_rval_s reqParams;
+  reqParams.ricStyleType = -1;
+  reqParams.granularityPeriod = 0;
+  reqParams.reportingPeriod = 0;
   
   std::vector<long> actionIdsAccept;
   std::vector<long> actionIdsReject;
+  bool foundAction = false; // a REPORT or INSERT action was accepted
+  Ptr<RcPolicy> policy; // handover policy of the accepted POLICY action
+  uint8_t policyActionId {};
   
   // iterate over the IEs
   for (int i = 0; i < count; i++) 
@@ -213,44 +1140,62 @@ E2Termination::ProcessRicSubscriptionRequest (E2AP_PDU_t* sub_req_pdu)
           RICsubscriptionDetails_t subDetails = next_ie->value.choice.RICsubscriptionDetails;
           
           // RIC Event Trigger Definition
-          RICeventTriggerDefinition_t triggerDef = subDetails.ricEventTriggerDefinition;
-
-          // TODO How to decode this field?
-          uint8_t size = 20;  
-          uint8_t *buf = (uint8_t *)calloc(1,size);
-          memcpy(buf, &triggerDef, size);
-          NS_LOG_DEBUG ("RIC Event Trigger Definition " << std::to_string (*buf));
+          if (!DecodeKpmEventTrigger (&subDetails.ricEventTriggerDefinition, reqParams))
+            {
+              NS_LOG_WARN ("Cannot decode the RIC Event Trigger Definition");
+            }
                     
           // Sequence of actions
           RICactions_ToBeSetup_List_t actionList = subDetails.ricAction_ToBeSetup_List;
-          // TODO We are ignoring the trigger definition
   
           int actionCount = actionList.list.count;
           NS_LOG_DEBUG ("Number of actions " << actionCount);
   
           auto **item_array = actionList.list.array;
-          bool foundAction = false;
   
           for (int i = 0; i < actionCount; i++) 
           {
             auto *next_item = item_array[i];
             RICactionID_t actionId = ((RICaction_ToBeSetup_ItemIEs*)next_item)->value.choice.RICaction_ToBeSetup_Item.ricActionID;
             RICactionType_t actionType = ((RICaction_ToBeSetup_ItemIEs*)next_item)->value.choice.RICaction_ToBeSetup_Item.ricActionType;
+            const RICactionDefinition_t *actionDef =
+                ((RICaction_ToBeSetup_ItemIEs*)next_item)->value.choice.RICaction_ToBeSetup_Item.ricActionDefinition;
                         
             //We identify the first action whose type is REPORT
-            //That is the only one accepted; all others are rejected
+            //That is the only one accepted with the first handover POLICY; all others are rejected
             if (!foundAction && (actionType == RICactionType_report || actionType == RICactionType_insert))
             {
               reqActionId = actionId;
               actionIdsAccept.push_back(reqActionId);
               NS_LOG_DEBUG ("Action ID " << actionId << " accepted");
               foundAction = true;
+
+              // the measurements requested by the accepted action
+              if (actionDef && !DecodeKpmActionDefinition (actionDef, reqParams))
+                {
+                  NS_LOG_WARN ("Cannot decode the action definition of action " << actionId 
+                               << ", reporting all the measurements");
+                }
             } 
+            else if (!policy && actionType == RICactionType_policy)
+            {
+              // the first handover policy is evaluated locally at each reporting period
+              policy = RcPolicy::Decode (actionDef);
+              if (policy)
+                {
+                  policyActionId = actionId;
+                  actionIdsAccept.push_back (actionId);
+                  NS_LOG_DEBUG ("Policy action ID " << actionId << " accepted");
+                }
+              else
+                {
+                  NS_LOG_DEBUG ("Policy action ID " << actionId << " rejected");
+                }
+            }
             else 
             {
-              reqActionId = actionId;
+              // the action ID of the subscription stays the one of the accepted action
               NS_LOG_DEBUG ("Action ID " << actionId << " rejected");
-              // actionIdsReject.push_back(reqActionId);
             }
           }
           break;
@@ -265,7 +1210,9 @@ E2Termination::ProcessRicSubscriptionRequest (E2AP_PDU_t* sub_req_pdu)
   
   NS_LOG_DEBUG ("Create RIC Subscription Response");
   
-  E2AP_PDU *e2ap_pdu = (E2AP_PDU*)calloc(1,sizeof(E2AP_PDU));
+  E2SendQueue::Message response;
+  response.pdu.reset (AsnStructPool::GetE2apPduPool ().Acquire<E2AP_PDU> ());
+  E2AP_PDU *e2ap_pdu = response.pdu.get ();
 
   long *accept_array = &actionIdsAccept[0];
   long *reject_array = &actionIdsReject[0];
@@ -278,24 +1225,355 @@ E2Termination::ProcessRicSubscriptionRequest (E2AP_PDU_t* sub_req_pdu)
   encoding::generate_e2apv1_subscription_response_success(e2ap_pdu, accept_array, reject_array, accept_size, reject_size, reqRequestorId, reqInstanceId);
 
   NS_LOG_DEBUG ("Send RIC Subscription Response");
-  m_e2sim->encode_and_send_sctp_data(e2ap_pdu);
-  NS_LOG_DEBUG ("Send RIC Subscription Response2");
+  // the response is sent right away, it must not wait for a coalescing window
+  if (!m_sendQueue || !m_sendQueue->Push (std::move (response)))
+    {
+      // released with the response
+      SendNow (e2ap_pdu);
+    }
+  else
+    {
+      NotifyPendingMessages ();
+    }
 
-  RicSubscriptionRequest_rval_s reqParams;
   reqParams.requestorId = reqRequestorId;
   reqParams.instanceId = reqInstanceId;
   reqParams.ranFuncionId = ranFuncionId;
   reqParams.actionId = reqActionId;
+
+  if (m_reportScheduler && foundAction)
+    {
+      m_reportScheduler->AddSubscription (reqParams);
+    }
+  if (m_reportScheduler && policy)
+    {
+      policy->SetSubscription (reqRequestorId, reqInstanceId, ranFuncionId, policyActionId);
+      m_reportScheduler->AddPolicy (policy, reqParams.reportingPeriod);
+    }
   return reqParams;
 }
 
+/**
+ * Append the measurements of a list of MeasurementInfo or MeasurementCond 
+ * items to the subscription parameters
+ */
+template <class L>
+static void
+AddRequestedMeasurements (const L &list, E2Termination::RicSubscriptionRequest_rval_s &params)
+{
+  for (int i = 0; i < list.count; i++)
+    {
+      const MeasurementType_t &measType = list.array[i]->measType;
+      if (measType.present == MeasurementType_PR_measName)
+        {
+          params.measNames.push_back (std::string ((char *) measType.choice.measName.buf,
+                                                   measType.choice.measName.size));
+        }
+      else if (measType.present == MeasurementType_PR_measID)
+        {
+          params.measIds.push_back (measType.choice.measID);
+        }
+    }
+}
+
+bool
+E2Termination::DecodeKpmEventTrigger (const RICeventTriggerDefinition_t *eventTrigger,
+                                      RicSubscriptionRequest_rval_s &params)
+{
+  E2SM_KPM_EventTriggerDefinition_t *def = nullptr;
+  asn_dec_rval_t rval = aper_decode_complete (nullptr, &asn_DEF_E2SM_KPM_EventTriggerDefinition,
+                                              (void **) &def, eventTrigger->buf,
+                                              eventTrigger->size);
+  if (rval.code != RC_OK)
+    {
+      ASN_STRUCT_FREE (asn_DEF_E2SM_KPM_EventTriggerDefinition, def);
+      return false;
+    }
+
+  auto &formats = def->eventDefinition_formats;
+  if (formats.present ==
+      E2SM_KPM_EventTriggerDefinition__eventDefinition_formats_PR_eventDefinition_Format1)
+    {
+      params.reportingPeriod = formats.choice.eventDefinition_Format1->reportingPeriod;
+    }
+  else
+    {
+      NS_LOG_WARN ("Unknown E2SM-KPM event trigger format " << formats.present);
+    }
+
+  NS_LOG_DEBUG ("RIC Event Trigger Definition, reporting period " << params.reportingPeriod
+                                                                   << " ms");
+  ASN_STRUCT_FREE (asn_DEF_E2SM_KPM_EventTriggerDefinition, def);
+  return true;
+}
+
+bool
+E2Termination::DecodeKpmActionDefinition (const RICactionDefinition_t *actionDefinition,
+                                          RicSubscriptionRequest_rval_s &params)
+{
+  E2SM_KPM_ActionDefinition_t *def = nullptr;
+  asn_dec_rval_t rval = aper_decode_complete (nullptr, &asn_DEF_E2SM_KPM_ActionDefinition,
+                                              (void **) &def, actionDefinition->buf,
+                                              actionDefinition->size);
+  if (rval.code != RC_OK)
+    {
+      ASN_STRUCT_FREE (asn_DEF_E2SM_KPM_ActionDefinition, def);
+      return false;
+    }
+
+  params.ricStyleType = def->ric_Style_Type;
+  const E2SM_KPM_ActionDefinition_Format1_t *subscriptInfo = nullptr;
+  auto &formats = def->actionDefinition_formats;
+  switch (formats.present)
+    {
+    case E2SM_KPM_ActionDefinition__actionDefinition_formats_PR_actionDefinition_Format1:
+      subscriptInfo = formats.choice.actionDefinition_Format1;
+      break;
+    case E2SM_KPM_ActionDefinition__actionDefinition_formats_PR_actionDefinition_Format2:
+      subscriptInfo = &formats.choice.actionDefinition_Format2->subscriptInfo;
+      break;
+    case E2SM_KPM_ActionDefinition__actionDefinition_formats_PR_actionDefinition_Format3:
+      AddRequestedMeasurements (formats.choice.actionDefinition_Format3->measCondList.list,
+                                params);
+      params.granularityPeriod = formats.choice.actionDefinition_Format3->granulPeriod;
+      break;
+    case E2SM_KPM_ActionDefinition__actionDefinition_formats_PR_actionDefinition_Format4:
+      subscriptInfo = &formats.choice.actionDefinition_Format4->subscriptionInfo;
+      break;
+    case E2SM_KPM_ActionDefinition__actionDefinition_formats_PR_actionDefinition_Format5:
+      subscriptInfo = &formats.choice.actionDefinition_Format5->subscriptionInfo;
+      break;
+    default:
+      NS_LOG_WARN ("Unknown E2SM-KPM action definition format " << formats.present);
+      break;
+    }
+
+  if (subscriptInfo)
+    {
+      AddRequestedMeasurements (subscriptInfo->measInfoList.list, params);
+      params.granularityPeriod = subscriptInfo->granulPeriod;
+    }
+
+  NS_LOG_DEBUG ("Action definition style " << params.ricStyleType << ", "
+                << params.measNames.size () << " measurements by name, "
+                << params.measIds.size () << " by ID, granularity period "
+                << params.granularityPeriod << " ms");
+  ASN_STRUCT_FREE (asn_DEF_E2SM_KPM_ActionDefinition, def);
+  return true;
+}
+
+void
+E2Termination::SetReportScheduler (Ptr<E2ReportScheduler> scheduler)
+{
+  NS_LOG_FUNCTION (this << scheduler);
+  m_reportScheduler = scheduler;
+  if (m_reportScheduler)
+    {
+      m_reportScheduler->SetSendCallback (
+          MakeCallback (&E2Termination::SendScheduledPdu, this));
+      m_reportScheduler->SetIndicationCallback (
+          MakeCallback (&E2Termination::SendIndication, this));
+      m_reportScheduler->SetStepCallback (
+          MakeCallback (&E2Termination::ScheduleLockstepWait, this));
+      InstallPolicyCallbacks ();
+      if (m_embeddedRic)
+        {
+          m_reportScheduler->AddEmbeddedRic (m_embeddedRic);
+        }
+    }
+}
+
+Ptr<E2ReportScheduler>
+E2Termination::GetReportScheduler () const
+{
+  return m_reportScheduler;
+}
+
+std::string
+E2Termination::GetGnbId () const
+{
+  return m_gnbId;
+}
+
+std::string
+E2Termination::GetPlmnId () const
+{
+  return m_plmnId;
+}
+
+void
+E2Termination::SetUeKpiCallback (UeKpiCallback cb)
+{
+  m_ueKpiCb = cb;
+  InstallPolicyCallbacks ();
+}
+
+void
+E2Termination::InstallPolicyCallbacks ()
+{
+  // without UE KPIs, the source set on the scheduler itself is kept
+  if (m_reportScheduler && !m_ueKpiCb.IsNull ())
+    {
+      m_reportScheduler->SetPolicyCallbacks (
+          m_ueKpiCb, MakeCallback (&E2Termination::ApplyPolicyDecision, this));
+    }
+}
+
+void
+E2Termination::ApplyPolicyDecision (const RcPolicy &policy, const RcPolicy::Decision &decision)
+{
+  NS_LOG_FUNCTION (this << decision.ueId << decision.targetCellId);
+  // the rows of the KPI table are named after the IMSI of their UE
+  const char *ueId = decision.ueId.c_str ();
+  char *end;
+  errno = 0;
+  unsigned long long imsi = strtoull (ueId, &end, 10);
+  if (end == ueId || *end != '\0' || errno == ERANGE)
+    {
+      NS_LOG_WARN ("KPI row " << decision.ueId << " is not an IMSI, handover skipped");
+      return;
+    }
+
+  RicControlMessage::ControlAction action;
+  action.m_controlStyle = RcPolicy::CONNECTED_MODE_MOBILITY_STYLE;
+  action.m_controlActionId = policy.GetControlActionId ();
+  action.m_ueId = imsi;
+  action.m_targetCellId = decision.targetCellId;
+  RICrequestID_t requestId;
+  requestId.ricRequestorID = policy.GetRequestorId ();
+  requestId.ricInstanceID = policy.GetInstanceId ();
+  SubmitControl (policy.GetRanFunctionId (),
+                 Create<RicControlMessage> (policy.GetRanFunctionId (), requestId,
+                                            std::vector<RicControlMessage::ControlAction> {action}));
+}
+
+void
+E2Termination::SetEmbeddedRic (Ptr<EmbeddedRic> ric)
+{
+  NS_LOG_FUNCTION (this << ric);
+  if (m_embeddedRic)
+    {
+      if (m_reportScheduler)
+        {
+          m_reportScheduler->RemoveEmbeddedRic (m_embeddedRic);
+        }
+      m_embeddedRic->SetTermination (nullptr);
+    }
+  m_embeddedRic = ric;
+  if (m_embeddedRic)
+    {
+      m_embeddedRic->SetTermination (this);
+      if (m_reportScheduler)
+        {
+          m_reportScheduler->AddEmbeddedRic (m_embeddedRic);
+        }
+    }
+}
+
+Ptr<EmbeddedRic>
+E2Termination::GetEmbeddedRic () const
+{
+  return m_embeddedRic;
+}
+
 void
 E2Termination::SendE2Message (E2AP_PDU* pdu)
 {
   NS_LOG_INFO ("Send mESSAGE ");
 
-  m_e2sim->encode_and_send_sctp_data (pdu);
-  // sleep(1); 
+  if (!m_sendQueue)
+    {
+      // termination not started (or already stopped), send from the caller
+      SendNow (pdu);
+      return;
+    }
+
+  // the PDU stays with the caller, only its encoding is handed over
+  E2SendQueue::Message message;
+  message.encoded =
+      KpmEncodeBuffer::GetThreadBuffer ().Encode (&asn_DEF_E2AP_PDU, pdu, E2AP_PDU_SIZE_KEY);
+  if (message.encoded.GetSpan ().size == 0)
+    {
+      NS_LOG_ERROR ("Cannot encode the E2AP PDU, message dropped");
+      return;
+    }
+  QueueMessage (std::move (message));
+}
+
+void
+E2Termination::SendE2Message (E2SendQueue::PduPtr pdu)
+{
+  if (!m_sendQueue)
+    {
+      SendNow (pdu.get ());
+      return;
+    }
+  E2SendQueue::Message message;
+  message.pdu = std::move (pdu);
+  QueueMessage (std::move (message));
+}
+
+void
+E2Termination::SendScheduledPdu (E2AP_PDU_t *pdu)
+{
+  BeginLockstepStep ();
+  SendE2Message (E2SendQueue::PduPtr (pdu));
+}
+
+void
+E2Termination::QueueMessage (E2SendQueue::Message &&message)
+{
+  if (m_disposed)
+    {
+      NS_LOG_WARN ("E2 termination disposed, message dropped");
+      return;
+    }
+  std::unique_lock<std::mutex> lock (m_batchMutex);
+  m_pendingBatch.push_back (std::move (message));
+  if (!m_batchFlushScheduled)
+    {
+      // may be called outside of the simulator thread, e.g., from the 
+      // callbacks triggered by e2sim
+      m_batchFlushScheduled = true;
+      Simulator::ScheduleWithContext (Simulator::NO_CONTEXT, m_coalescingWindow,
+                                      &E2Termination::FlushBatch, this);
+    }
+}
+
+void
+E2Termination::SendIndication (const RicSubscriptionRequest_rval_s &subscription,
+                               long sequenceNumber, Ptr<KpmIndicationHeader> header,
+                               Ptr<KpmIndicationMessage> message)
+{
+  NS_LOG_FUNCTION (this << subscription.requestorId << subscription.instanceId << sequenceNumber);
+
+  BeginLockstepStep ();
+  KpmEncodeBuffer::Span encoded = message->GetSpan ();
+  if (m_sendQueue)
+    {
+      // spliced into a pooled buffer, written by the sender thread in order
+      // with the messages queued before
+      size_t capacity =
+          std::min<size_t> (header->m_size + encoded.size + INDICATION_OVERHEAD, MAX_SCTP_BUFFER);
+      KpmEncodeBuffer &buffers = KpmEncodeBuffer::GetThreadBuffer ();
+      E2SendQueue::Message indication;
+      indication.encoded = buffers.Acquire (capacity, E2AP_PDU_SIZE_KEY);
+      size_t size = m_indicationEncoder.Encode (
+          subscription.requestorId, subscription.instanceId, subscription.ranFuncionId,
+          subscription.actionId, sequenceNumber, (const uint8_t *) header->m_buffer,
+          header->m_size, encoded.data, encoded.size, indication.encoded.GetData (), capacity);
+      if (size > 0)
+        {
+          buffers.Commit (indication.encoded, size, E2AP_PDU_SIZE_KEY);
+          QueueMessage (std::move (indication));
+          return;
+        }
+    }
+
+  SendE2Message (E2SendQueue::PduPtr (IndicationEncoder::BuildIndication (
+      subscription.requestorId, subscription.instanceId, subscription.ranFuncionId,
+      subscription.actionId, sequenceNumber, (const uint8_t *) header->m_buffer, header->m_size,
+      encoded.data, encoded.size)));
 }
 
 }
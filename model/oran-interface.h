@@ -26,15 +26,46 @@
 #define ORAN_INTERFACE_H
 
 #include "ns3/object.h"
+#include "ns3/nstime.h"
+#include "ns3/event-id.h"
+#include "ns3/traced-callback.h"
 #include <ns3/kpm-indication.h>
 #include <ns3/kpm-function-description.h>
 #include <ns3/ric-control-function-description.h>
 // #include <ns3/ric-delete-function-description.h>
 #include <ns3/ric-control-message.h>
+#include <ns3/rc-policy.h>
+#include <ns3/control-coalescer.h>
+#include <ns3/control-response-encoder.h>
+#include <ns3/indication-encoder.h>
+#include <ns3/e2-send-queue.h>
+#include <ns3/e2-receive-queue.h>
 #include "e2sim.hpp"
+#include "e2sim_sctp.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+extern "C" {
+  #include "RICactionDefinition.h"
+  #include "RICeventTriggerDefinition.h"
+}
 
 namespace ns3 {
 
+  class E2ReportScheduler;
+  class E2TerminationManager;
+  class EmbeddedRic;
+
   class E2Termination : public Object 
   {
     public:
@@ -65,10 +96,24 @@ namespace ns3 {
       
       /**
       * Start the E2 termination.
-      * Create a separate thread to host the execution of e2sim. The thread will 
-      * execute the method DoStart.  
+      * Connect to the RIC, unless a connection was set with SetE2Socket, and
+      * send the E2 Setup Request with the registered RAN functions. The
+      * messages of the RIC are then received on the socket of the
+      * termination and handled by e2sim, which calls the registered
+      * callbacks. The termination has its own sender and receive threads,
+      * unless it is hosted by an E2TerminationManager.
       */
       void Start ();
+
+      /**
+      * Use an E2 connection set up by the caller, e.g., one end of a socket
+      * pair in the tests, instead of connecting to the RIC at Start. No E2
+      * Setup Request is sent on it. The termination closes the socket when
+      * disposed. Must be called before Start.
+      *
+      * \param socket the connected socket, one message per E2AP PDU
+      */
+      void SetE2Socket (int socket);
       
       /**
       * Register an E2 Service Model.
@@ -76,7 +121,9 @@ namespace ns3 {
       * for the SM, add it to the list of supported RAN functions, and 
       * register a callback.
       * Whenever a RIC Subscription Request to this RAN Function is received, 
-      * the callback is triggered.  
+      * the callback is triggered. Unless ReceiveInSimulatorThread is false,
+      * the callback runs in the simulator thread, ApplyDelay after the 
+      * reception, on a copy of the PDU released when the callback returns.
       *
       * \param ranFunctionId ID used to identify the KPM RAN Function
       * \param ranFunctionDescription 
@@ -93,7 +140,8 @@ namespace ns3 {
       * for the SM, add it to the list of supported RAN functions, and 
       * register a callback.
       * Whenever a Sm message to this RAN Function is received, 
-      * the callback is triggered.  
+      * the callback is triggered, in the simulator thread as for 
+      * RegisterKpmCallbackToE2Sm.
       *
       * \param ranFunctionId ID used to identify the KPM RAN Function
       * \param ranFunctionDescription 
@@ -104,6 +152,93 @@ namespace ns3 {
                                      Ptr<FunctionDescription> ranFunctionDescription,
                                      SmCallback smCb);
 
+      /**
+      * Handler of the RIC Control Requests of a control action. It receives
+      * the controls of a simulation step, decoded, in order of arrival. The
+      * actions of a multi-action request (Control Message Format2) are
+      * passed as separate records, each with a single action. A handler
+      * failing to apply a control marks it with RicControlMessage::Reject.
+      */
+      typedef Callback<void, const std::vector<Ptr<RicControlMessage>> &> ControlHandler;
+
+      /**
+      * Register an E2 Service Model whose RIC Control Requests are decoded
+      * and dispatched to the handlers registered with RegisterControlHandler,
+      * instead of being passed to a single SmCallback.
+      *
+      * \param ranFunctionId ID used to identify the RAN Function
+      * \param ranFunctionDescription
+      */
+      void RegisterControlFunctionToE2Sm (long ranFunctionId,
+                                          Ptr<FunctionDescription> ranFunctionDescription);
+
+      /**
+      * Register the handler of a control action, e.g., RC style 3 action 1
+      * for the handover. The controls received for the same action within
+      * a simulation step are collected and passed to the handler at once,
+      * at the end of the step; controls of an action without handler are
+      * dropped and reported as failed.
+      *
+      * \param ranFunctionId the RAN Function, registered with RegisterControlFunctionToE2Sm
+      * \param controlStyle the RIC Style Type of the control header
+      * \param controlActionId the RIC Control Action ID of the control header
+      * \param handler the handler of the controls
+      */
+      void RegisterControlHandler (long ranFunctionId, long controlStyle, long controlActionId,
+                                   ControlHandler handler);
+
+      /**
+      * Responses sent to the RIC Control Requests of a RAN function, once all
+      * their actions have been passed to the handlers or dropped
+      */
+      enum ControlAckPolicy
+      {
+        ACK_NEVER, //!< no response
+        ACK_ON_REQUEST, //!< failures, and acknowledges if the RIC Control Ack Request is ack
+        ACK_ALWAYS //!< failures and acknowledges
+      };
+
+      /**
+      * \param ranFunctionId the RAN Function, registered with RegisterControlFunctionToE2Sm
+      * \param policy the responses to send, ACK_ON_REQUEST by default
+      */
+      void SetControlAckPolicy (long ranFunctionId, ControlAckPolicy policy);
+
+      /**
+      * RIC Style Type of a RIC Control Request carrying no action, that a
+      * RIC in lockstep sends to end a step without controlling anything.
+      * The E2SM-RC styles start at 1; the request is acknowledged as
+      * applied without reaching any handler.
+      */
+      static const long NO_ACTION_CONTROL_STYLE = 0;
+
+      /**
+      * Queue a decoded control for the handler of its control action, as
+      * the RIC Control Requests received from the RIC. The responses are
+      * sent only for the requests received from the RIC. May be called
+      * outside of the simulator thread.
+      *
+      * \param ranFunctionId the RAN Function of the control
+      * \param request the control request, with one or more actions
+      */
+      void SubmitControl (long ranFunctionId, Ptr<RicControlMessage> request);
+
+      /**
+      * Attach an xApp running in the simulator process. It receives the
+      * indications of the report scheduler in-process at each tick of its
+      * reporting period, and its controls are applied by the handlers
+      * registered with RegisterControlHandler. The termination does not
+      * need to be started.
+      *
+      * \param ric the xApp, nullptr to detach the current one
+      */
+      void SetEmbeddedRic (Ptr<EmbeddedRic> ric);
+
+      /**
+      * \return the embedded xApp, if any
+      */
+      Ptr<EmbeddedRic> GetEmbeddedRic () const;
+
       /**
       * Reguster a callback function that handle events.
       *
@@ -121,6 +256,11 @@ namespace ns3 {
         uint16_t instanceId; //!< RIC Instance ID
         uint16_t ranFuncionId; //!< RAN Function ID
         uint8_t actionId; //!< RIC Action ID
+        long ricStyleType; //!< E2SM-KPM RIC Style Type of the action definition, -1 if absent
+        std::vector<std::string> measNames; //!< measurements requested by name
+        std::vector<uint32_t> measIds; //!< measurements requested by measurement ID
+        uint32_t granularityPeriod; //!< granularity period requested in ms, 0 if not set
+        uint32_t reportingPeriod; //!< E2SM-KPM event trigger reporting period in ms, 0 if not set
       }; 
 
       /**
@@ -135,19 +275,222 @@ namespace ns3 {
 
       /**
       * Sends an E2 message to the RIC
-      * This function encodes and sends an E2 message to the RIC
+      * The caller keeps the ownership of the PDU, which can be released as 
+      * soon as the call returns. Once the termination has been started, the 
+      * PDU is encoded by the calling thread and the encoding is handed over 
+      * to the sender thread, which writes it to the socket outside of the 
+      * simulation event.
+      * Messages sent within the same CoalescingWindow (by default, the same 
+      * simulation timestamp) are handed over as a single batch, so that e.g. 
+      * the cell and UE reports of a reporting period are written back to 
+      * back in one wakeup of the sender thread.
       *
       * \param pdu the PDU of the message
       */
       void SendE2Message (E2AP_PDU* pdu);   
 
+      /**
+      * Sends an E2 message to the RIC, taking the ownership of the PDU.
+      * Once the termination has been started, the PDU itself is handed over
+      * to the sender thread, which encodes it as well, and releases it once 
+      * sent. Batched as the messages passed to SendE2Message (E2AP_PDU*).
+      *
+      * \param pdu the PDU of the message, allocated with malloc or calloc
+      */
+      void SendE2Message (E2SendQueue::PduPtr pdu);
+
+      /**
+      * Send a RIC Indication of a subscription. The E2SM header and message
+      * are written directly after the RIC Indication skeleton of the
+      * subscription, in a pooled encode buffer handed over to the sender
+      * thread, which writes it in order with the other messages. The
+      * indications that cannot be encoded from a skeleton go through
+      * SendE2Message.
+      *
+      * \param subscription the subscription
+      * \param sequenceNumber the RIC Indication SN
+      * \param header the encoded E2SM indication header
+      * \param message the encoded E2SM indication message
+      */
+      void SendIndication (const RicSubscriptionRequest_rval_s &subscription, long sequenceNumber,
+                           Ptr<KpmIndicationHeader> header, Ptr<KpmIndicationMessage> message);
+
+      /**
+      * Block until all the messages passed to SendE2Message so far have 
+      * been written to the socket.
+      */
+      void Flush ();
+
+      /**
+      * Report the RIC subscriptions periodically.
+      * The subscriptions processed by ProcessRicSubscriptionRequest are 
+      * added to the scheduler, which sends their indications through this 
+      * termination at the reporting period of their event trigger, and
+      * their handover policies are evaluated on the UE KPIs set by
+      * SetUeKpiCallback.
+      *
+      * \param scheduler the report scheduler
+      */
+      void SetReportScheduler (Ptr<E2ReportScheduler> scheduler);
+
+      /**
+      * \return the report scheduler, if any
+      */
+      Ptr<E2ReportScheduler> GetReportScheduler () const;
+
+      /**
+      * \return the gNB ID of the E2 node
+      */
+      std::string GetGnbId () const;
+
+      /**
+      * \return the PLMN ID of the E2 node
+      */
+      std::string GetPlmnId () const;
+
+      /**
+      * Provides the UE KPIs of the current reporting tick
+      */
+      typedef Callback<Ptr<const KpiTable>> UeKpiCallback;
+
+      /**
+      * Set the UE KPIs the handover policies installed by the RIC are
+      * evaluated on. The decisions of the policies are applied as local
+      * controls through SubmitControl, by the handlers registered with
+      * RegisterControlHandler, with the rate limits and the coalescing of
+      * the controls received from the RIC.
+      *
+      * \param cb the source of the UE KPIs
+      */
+      void SetUeKpiCallback (UeKpiCallback cb);
+
+      /**
+      * Statistics on the batches of E2 messages handed over to the sender 
+      * thread and on the number of messages written per sender wakeup
+      */
+      struct SendBatchStats
+      {
+        uint64_t batches; //!< batches handed over to the sender thread
+        uint64_t pdus; //!< PDUs handed over to the sender thread
+        uint32_t maxBatchSize; //!< largest batch handed over
+        uint64_t writeRounds; //!< wakeups of the sender thread
+        uint32_t maxWriteRound; //!< largest number of PDUs written in one wakeup
+        uint64_t dropped; //!< PDUs that could not be encoded or written
+      };
+
+      /**
+      * \return the batching statistics collected so far
+      */
+      SendBatchStats GetSendBatchStats () const;
+
+      /**
+      * Statistics on the messages received from the RIC and applied in the
+      * simulator thread
+      */
+      struct ReceiveStats
+      {
+        uint64_t messages; //!< messages applied
+        uint64_t totalLatencyNs; //!< sum of the wall-clock times from reception to application
+        uint64_t maxLatencyNs; //!< largest wall-clock time from reception to application
+      };
+
+      /**
+      * \return the reception statistics collected so far
+      */
+      ReceiveStats GetReceiveStats () const;
+
+      /**
+      * \return the counters of the controls that went through the
+      *         coalescing and rate limiting stage. To be called in the
+      *         simulator thread.
+      */
+      ControlCoalescer::Stats GetControlStats () const;
+
+      /**
+      * Statistics on the waits for the RIC in lockstep mode
+      */
+      struct LockstepStats
+      {
+        uint64_t steps; //!< reporting steps waited for
+        uint64_t timeouts; //!< steps ended by the timeout
+        uint64_t totalWaitNs; //!< sum of the wall-clock waits
+        uint64_t maxWaitNs; //!< longest wall-clock wait
+      };
+
+      /**
+      * \return the lockstep statistics collected so far
+      */
+      LockstepStats GetLockstepStats () const;
+
+      /**
+      * End the current lockstep wait, as a RIC Control Request would, e.g.,
+      * from a custom callback. May be called from any thread.
+      */
+      void ReleaseLockstep ();
+
+      /**
+      * TracedCallback signature of the lockstep waits
+      *
+      * \param wait the wall-clock time the simulator waited for the RIC
+      * \param answered false if the wait ended with the timeout
+      */
+      typedef void (*LockstepWaitTracedCallback) (Time wait, bool answered);
+
+    protected:
+      /**
+      * inherited from Object
+      * Drains the send queue and stops the sender thread.
+      */
+      virtual void DoDispose ();
+
     private:
+      friend class E2TerminationManager;
+
+      /**
+      * Open the SCTP connection to the RIC and send the E2 Setup Request,
+      * as the e2sim main loop would, unless a socket was set by the caller
+      */
+      void Connect ();
+
       /**
-      * Run the e2sim main loop.
-      * Starts the e2sim main loop, it will open a socket towards the RIC and 
-      * start the reception routine.
+      * Send the E2 Setup Request with the RAN functions registered so far
       */
-      void DoStart ();
+      void SendSetupRequest ();
+
+      /**
+      * Receive a message of the RIC and pass it to e2sim, which decodes it
+      * and calls the callback of its RAN function
+      *
+      * \return false if the connection is closed
+      */
+      bool ReceiveMessage ();
+
+      /**
+      * Body of the receive thread: receive the messages of the RIC until
+      * the connection is closed
+      */
+      void DoReceive ();
+
+      /**
+      * Shut the E2 connection down, join the receive thread and close the
+      * socket
+      */
+      void StopReceiver ();
+
+      /**
+      * Encode a PDU and write it to the socket from the calling thread
+      *
+      * \param pdu the PDU, still owned by the caller
+      */
+      void SendNow (E2AP_PDU_t *pdu);
+
+      /**
+      * Write an encoded message to the socket from the calling thread
+      *
+      * \param data the encoded message
+      * \param size the size of the message
+      */
+      void WriteNow (const uint8_t *data, size_t size);
 
       /**
        * \brief Accessory function to populate to the registration of the ran function description to e2sim
@@ -158,12 +501,291 @@ namespace ns3 {
       void RegisterFunctionDescToE2Sm (long ranFunctionId,
                                 Ptr<FunctionDescription> ranFunctionDescription);
 
+      /**
+      * Decode the E2SM-KPM Event Trigger Definition of a RIC subscription and 
+      * store the reporting period in the subscription parameters. 
+      *
+      * \param eventTrigger the encoded event trigger definition
+      * \param params the subscription parameters to fill
+      * \return false if the event trigger definition cannot be decoded
+      */
+      static bool DecodeKpmEventTrigger (const RICeventTriggerDefinition_t *eventTrigger,
+                                         RicSubscriptionRequest_rval_s &params);
+
+      /**
+      * Decode the E2SM-KPM Action Definition of a RIC action and store the 
+      * requested measurements in the subscription parameters. 
+      *
+      * \param actionDefinition the encoded action definition
+      * \param params the subscription parameters to fill
+      * \return false if the action definition cannot be decoded
+      */
+      static bool DecodeKpmActionDefinition (const RICactionDefinition_t *actionDefinition,
+                                             RicSubscriptionRequest_rval_s &params);
+
+      /**
+      * Body of the sender thread.
+      * Takes the messages out of the send queue and sends them until 
+      * the queue is closed.
+      */
+      void DoSend ();
+
+      /**
+      * Hand over the messages collected in the current coalescing window to the
+      * sender thread as a single batch.
+      */
+      void FlushBatch ();
+
+      /**
+      * Close the send queue, wait for the sender thread to send the pending
+      * PDUs and join it.
+      */
+      void StopSender ();
+
+      /**
+      * Send the messages currently in the send queue, without waiting for 
+      * new ones. Used by the sender threads of the E2TerminationManager.
+      *
+      * \return the number of messages sent
+      */
+      size_t SendPendingMessages ();
+
+      /**
+      * \return true if some messages handed over to the send queue are not sent yet
+      */
+      bool HasPendingMessages () const;
+
+      /**
+      * Tell the E2TerminationManager hosting this termination, if any, that
+      * the send queue has messages to be sent.
+      */
+      void NotifyPendingMessages ();
+
+      /**
+      * Called by the report scheduler when the reports of a tick have been
+      * sent: in lockstep mode, schedule the wait for the RIC after the other
+      * events of the timestamp, so that a single wait covers all of its
+      * reports.
+      *
+      * \param reports the number of reports sent in the tick
+      */
+      void ScheduleLockstepWait (uint32_t reports);
+
+      /**
+      * Called before a report is handed over: at the first report of a
+      * step, forget the RIC Control Requests received so far, which answer
+      * the previous steps
+      */
+      void BeginLockstepStep ();
+
+      /**
+      * Hand the pending reports over to the sender thread, then block the
+      * simulator thread until a RIC Control Request is received or the
+      * LockstepTimeout expires
+      */
+      void WaitForRic ();
+
+      /**
+      * Wrap a callback of RIC Control Requests, so that the lockstep wait
+      * ends once the request has been queued
+      *
+      * \param callback the callback, possibly wrapped by WrapReceiveCallback
+      * \return the callback to be registered to e2sim
+      */
+      std::function<void (E2AP_PDU_t *)>
+      WrapControlCallback (std::function<void (E2AP_PDU_t *)> callback);
+
+      /**
+      * Wrap a callback registered to e2sim, so that it is applied in the 
+      * simulator thread if ReceiveInSimulatorThread is set.
+      *
+      * \param callback the callback of the user
+      * \return the callback to be registered to e2sim
+      */
+      std::function<void (E2AP_PDU_t *)> 
+      WrapReceiveCallback (std::function<void (E2AP_PDU_t *)> callback);
+
+      /**
+      * Called by the receive thread when a message is received: queue the
+      * encoding of the PDU and schedule its application in the simulator
+      * thread, which decodes it. The messages received once the termination
+      * is disposed are dropped.
+      *
+      * \param handler the index of the callback in m_receiveHandlers
+      * \param pdu the received PDU, still owned by e2sim
+      */
+      void EnqueueReceived (uint32_t handler, E2AP_PDU_t *pdu);
+
+      /**
+      * Decode the queued PDUs and pass them to their callbacks, in the
+      * simulator thread. Does nothing once the termination is disposed.
+      */
+      void ApplyReceived ();
+
+      /**
+      * Decode a RIC Control Request and queue it for the handler of its
+      * control action.
+      *
+      * \param ranFunctionId the RAN Function of the request
+      * \param pdu the request
+      */
+      void ReceiveControl (long ranFunctionId, E2AP_PDU_t *pdu);
+
+      /**
+      * \param ranFunctionId the RAN Function of the requests
+      * \return the callback of the RIC Control Requests registered to e2sim
+      *         by RegisterControlFunctionToE2Sm
+      */
+      std::function<void (E2AP_PDU_t *)> MakeControlCallback (long ranFunctionId);
+
+      /**
+      * Pass the controls collected in the simulation step to the coalescer,
+      * then release the controls whose coalescing window has ended
+      */
+      void DispatchControls ();
+
+      /**
+      * Pass the controls released by the coalescer to their handlers, and
+      * schedule the next release if controls are pending
+      */
+      void ReleaseControls ();
+
+      /**
+      * Resolve an action of a RIC Control Request, and send the response to
+      * the request if it was the last one
+      *
+      * \param ranFunctionId the RAN Function of the request
+      * \param control the record of the action
+      */
+      void ResolveControl (long ranFunctionId, Ptr<RicControlMessage> control);
+
+      /**
+      * Send an encoded E2AP PDU through the send queue, after the messages
+      * sent before it, or from the calling thread if the termination is not
+      * started. The bytes are copied, the caller can reuse its buffer.
+      *
+      * \param encoded the APER encoding of the PDU
+      */
+      void SendEncoded (const std::vector<uint8_t> &encoded);
+
+      /**
+      * Write a set of messages to the socket, encoding the ones handed over
+      * as PDUs into a staging buffer, and release them. The messages are
+      * written with one system call. Called by one sender thread at a time.
+      * The messages that cannot be encoded or written are dropped and
+      * counted in the batching statistics.
+      *
+      * \param messages the messages, in order
+      */
+      void WriteMessages (std::vector<E2SendQueue::Message> &messages);
+
+      /**
+      * Count messages dropped by the sender in the batching statistics
+      *
+      * \param count the number of messages dropped
+      */
+      void CountDropped (uint64_t count);
+
+      /**
+      * Add a message to the batch of the current coalescing window, or send
+      * it from the calling thread if the termination is not started
+      *
+      * \param message the message
+      */
+      void QueueMessage (E2SendQueue::Message &&message);
+
+      /**
+      * Send callback of the report scheduler, which hands over the
+      * ownership of the PDU
+      *
+      * \param pdu the PDU
+      */
+      void SendScheduledPdu (E2AP_PDU_t *pdu);
+
+      /**
+      * Policy decision callback of the report scheduler: submit the
+      * handover decided by a policy as a local control. A decision on a
+      * KPI row not named after an IMSI is skipped.
+      *
+      * \param policy the policy
+      * \param decision the handover
+      */
+      void ApplyPolicyDecision (const RcPolicy &policy, const RcPolicy::Decision &decision);
+
+      /**
+      * Install the policy callbacks in the report scheduler, if both the
+      * scheduler and the UE KPIs are set
+      */
+      void InstallPolicyCallbacks ();
+
       E2Sim* m_e2sim; //!< pointer to an instance of the O-RAN E2 simulator
       std::string m_ricAddress; //!< IP address of the RIC
       uint16_t m_ricPort; //!< port of the RIC
       uint16_t m_clientPort; //!< local bind port
       std::string m_gnbId; //!< GNB id
       std::string m_plmnId; //!< PLMN Id
+      int m_socket; //!< SCTP socket of the E2 connection, -1 if none
+      std::thread m_receiveThread; //!< thread receiving the messages of the RIC
+      sctp_buffer_t m_receiveBuffer; //!< message being received
+      std::map<long, OCTET_STRING_t *> m_ranFunctions; //!< descriptions of the RAN functions, owned by e2sim
+      uint32_t m_sendQueueCapacity; //!< maximum number of messages waiting to be sent
+      std::unique_ptr<E2SendQueue> m_sendQueue; //!< messages waiting for the sender thread
+      std::thread m_senderThread; //!< thread encoding and writing the messages
+      E2TerminationManager *m_manager; //!< host providing the sender threads, if any
+      Time m_coalescingWindow; //!< time during which messages are collected in a batch
+      std::mutex m_batchMutex; //!< protects m_pendingBatch and m_batchFlushScheduled
+      std::vector<E2SendQueue::Message> m_pendingBatch; //!< messages of the current coalescing window
+      std::vector<uint8_t> m_sendStaging; //!< encodings of the PDUs of the batch being written
+      std::vector<struct iovec> m_sendIovecs; //!< bytes of each message of the batch being written
+      std::vector<struct mmsghdr> m_sendHeaders; //!< headers of the messages of the batch being written
+      bool m_batchFlushScheduled; //!< true if FlushBatch is already scheduled
+      std::atomic<bool> m_disposed; //!< true once disposed, checked by the pending events
+      mutable std::mutex m_statsMutex; //!< protects m_batchStats
+      SendBatchStats m_batchStats; //!< batching statistics
+      Ptr<E2ReportScheduler> m_reportScheduler; //!< periodic reporting of the subscriptions
+      UeKpiCallback m_ueKpiCb; //!< UE KPIs the policies are evaluated on
+      bool m_receiveInSimulatorThread; //!< apply the received messages in the simulator thread
+      Time m_applyDelay; //!< simulation time between reception and application
+      std::vector<std::function<void (E2AP_PDU_t *)>> m_receiveHandlers; //!< callbacks of the user
+      E2ReceiveQueue m_receiveQueue; //!< PDUs received and not applied yet
+      std::atomic<bool> m_applyScheduled; //!< true if ApplyReceived is scheduled
+      ReceiveStats m_receiveStats; //!< reception statistics, protected by m_statsMutex
+
+      typedef std::tuple<long, long, long> ControlKey; //!< RAN function, control style and action
+
+      /**
+      * Handler of a control action and the controls waiting for it
+      */
+      struct ControlBatch
+      {
+        ControlHandler handler;
+        std::vector<Ptr<RicControlMessage>> controls;
+      };
+
+      std::mutex m_controlMutex; //!< protects the handlers, the policies and the controls queued
+      std::map<ControlKey, ControlBatch> m_controlHandlers; //!< handlers, by control action
+      std::vector<std::pair<long, Ptr<RicControlMessage>>> m_unhandledControls; //!< controls without handler
+      std::map<long, ControlAckPolicy> m_controlAckPolicies; //!< response policies, by RAN function
+      bool m_controlDispatchScheduled; //!< true if DispatchControls is already scheduled
+      Time m_controlWindow; //!< time during which the controls of a UE and action are merged
+      double m_controlUeRate; //!< controls per second admitted for each UE, 0 for no limit
+      double m_controlUeBurst; //!< controls admitted at once for each UE
+      double m_controlGlobalRate; //!< controls per second admitted overall, 0 for no limit
+      double m_controlGlobalBurst; //!< controls admitted at once overall
+      Ptr<ControlCoalescer> m_controlCoalescer; //!< created at the first dispatch
+      EventId m_controlReleaseEvent; //!< next release of the pending controls
+      ControlResponseEncoder m_responseEncoder; //!< encoder of the responses to the controls
+      IndicationEncoder m_indicationEncoder; //!< encoder of the RIC Indications
+      Ptr<EmbeddedRic> m_embeddedRic; //!< xApp running in the simulator process, if any
+      bool m_lockstep; //!< wait for the RIC after each reporting step
+      Time m_lockstepTimeout; //!< longest wall-clock wait for the RIC
+      bool m_lockstepWaitScheduled; //!< true if WaitForRic is already scheduled
+      bool m_lockstepStepStarted; //!< true once a report of the current step is handed over
+      std::mutex m_lockstepMutex; //!< protects m_ricResponses
+      std::condition_variable m_lockstepCv; //!< signaled when the RIC responds
+      uint32_t m_ricResponses; //!< RIC Control Requests received in the current step
+      LockstepStats m_lockstepStats; //!< lockstep statistics, protected by m_statsMutex
+      TracedCallback<Time, bool> m_lockstepWaitTrace; //!< wall-clock wait of each step
   };
 }
 
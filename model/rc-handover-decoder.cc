@@ -0,0 +1,444 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Northeastern University
+ * Copyright (c) 2022 Sapienza, University of Rome
+ * Copyright (c) 2022 University of Padova
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrea Lacava <thecave003@gmail.com>
+ *		   Tommaso Zugno <tommasozugno@gmail.com>
+ *		   Michele Polese <michele.polese@gmail.com>
+ */
+
+
+#include <ns3/rc-handover-decoder.h>
+#include <ns3/log.h>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("RcHandoverDecoder");
+
+// value ranges of the E2SM-RC v1.03 types walked by the decoder
+static const uint64_t AMF_UE_NGAP_ID_MAX = 1099511627775ULL;
+static const uint64_t F1AP_ID_MAX = 4294967295ULL;
+static const uint64_t XNAP_ID_MAX = 4294967295ULL;
+static const uint64_t RAN_PARAMETER_ID_MAX = 4294967295ULL;
+static const uint64_t CONTROL_ACTION_ID_MAX = 65535;
+static const uint64_t MAX_RAN_PARAMETERS = 65535;
+
+/**
+* Reader of the bits of an aligned-PER encoding. A read past the end of the
+* buffer sets the error flag and returns zeros, so that the checks can be
+* made once, at the end of the walk.
+*/
+class AperReader
+{
+public:
+  AperReader (const uint8_t *buf, size_t size)
+    : m_buf (buf),
+      m_bits (size * 8),
+      m_bit (0),
+      m_error (buf == nullptr)
+  {
+  }
+
+  /**
+  * \param count number of bits, at most 64
+  * \return the bits, most significant first
+  */
+  uint64_t
+  ReadBits (uint32_t count)
+  {
+    if (m_error || count > m_bits - m_bit)
+      {
+        m_error = true;
+        return 0;
+      }
+    uint64_t value = 0;
+    while (count > 0)
+      {
+        uint32_t offset = m_bit & 7;
+        uint32_t take = 8 - offset < count ? 8 - offset : count;
+        uint32_t byte = m_buf[m_bit >> 3];
+        value = (value << take) | ((byte >> (8 - offset - take)) & ((1u << take) - 1));
+        m_bit += take;
+        count -= take;
+      }
+    return value;
+  }
+
+  bool
+  ReadBit ()
+  {
+    return ReadBits (1) != 0;
+  }
+
+  void
+  Align ()
+  {
+    m_bit = (m_bit + 7) & ~(size_t) 7;
+    if (m_bit > m_bits)
+      {
+        m_error = true;
+      }
+  }
+
+  /**
+  * Read a constrained whole number (X.691 10.5)
+  *
+  * \param lb the lower bound
+  * \param ub the upper bound
+  * \return the number
+  */
+  uint64_t
+  ReadConstrained (uint64_t lb, uint64_t ub)
+  {
+    uint64_t range = ub - lb + 1;
+    if (range == 1)
+      {
+        return lb;
+      }
+    if (range <= 255)
+      {
+        return lb + ReadBits (GetBitCount (range - 1));
+      }
+    if (range == 256)
+      {
+        Align ();
+        return lb + ReadBits (8);
+      }
+    if (range <= 65536)
+      {
+        Align ();
+        return lb + ReadBits (16);
+      }
+    // length in octets, from 1 to the octets of the range, then the octets
+    uint32_t maxOctets = (GetBitCount (range - 1) + 7) / 8;
+    uint32_t octets = ReadBits (GetBitCount (maxOctets - 1)) + 1;
+    Align ();
+    if (octets > maxOctets)
+      {
+        m_error = true;
+        return 0;
+      }
+    return lb + ReadBits (8 * octets);
+  }
+
+  /**
+  * Read an unconstrained length determinant, fragmented lengths excluded
+  */
+  size_t
+  ReadLength ()
+  {
+    Align ();
+    uint32_t first = ReadBits (8);
+    if ((first & 0x80) == 0)
+      {
+        return first;
+      }
+    if ((first & 0xC0) == 0x80)
+      {
+        return ((first & 0x3F) << 8) | ReadBits (8);
+      }
+    m_error = true;
+    return 0;
+  }
+
+  /**
+  * Read an unconstrained INTEGER of at most eight octets
+  */
+  int64_t
+  ReadUnconstrainedInteger ()
+  {
+    size_t octets = ReadLength ();
+    if (octets == 0 || octets > 8)
+      {
+        m_error = true;
+        return 0;
+      }
+    uint64_t value = ReadBits (8 * octets);
+    if (octets < 8 && (value >> (8 * octets - 1)) & 1)
+      {
+        // two's complement sign extension
+        value |= ~(uint64_t) 0 << (8 * octets);
+      }
+    return (int64_t) value;
+  }
+
+  /**
+  * Skip aligned octets
+  *
+  * \param count the number of octets
+  * \return the first octet, in place
+  */
+  const uint8_t *
+  SkipOctets (size_t count)
+  {
+    Align ();
+    if (m_error || count > (m_bits - m_bit) / 8)
+      {
+        m_error = true;
+        return nullptr;
+      }
+    const uint8_t *octets = m_buf + m_bit / 8;
+    m_bit += 8 * count;
+    return octets;
+  }
+
+  /**
+  * \return true if the encoding was read without errors, up to its padding
+  */
+  bool
+  IsComplete () const
+  {
+    return !m_error && (m_bit + 7) / 8 == m_bits / 8;
+  }
+
+private:
+  /**
+  * \return the number of bits needed to represent value
+  */
+  static uint32_t
+  GetBitCount (uint64_t value)
+  {
+    uint32_t bits = 0;
+    while (value > 0)
+      {
+        bits++;
+        value >>= 1;
+      }
+    return bits;
+  }
+
+  const uint8_t *m_buf;
+  size_t m_bits; //!< size of the buffer in bits
+  size_t m_bit; //!< position of the next bit to read
+  bool m_error;
+};
+
+/**
+* Read a RANParameter-ID, an extensible INTEGER (1..2^32-1, ...)
+*
+* \param reader the reader
+* \param id the ID
+* \return false if the ID is outside the root range
+*/
+static bool
+ReadRanParameterId (AperReader &reader, uint32_t &id)
+{
+  if (reader.ReadBit ())
+    {
+      return false;
+    }
+  id = reader.ReadConstrained (1, RAN_PARAMETER_ID_MAX);
+  return true;
+}
+
+bool
+RcHandoverDecoder::DecodeControlHeader (const uint8_t *buf, size_t size, ControlHeader &header)
+{
+  AperReader reader (buf, size);
+
+  // E2SM-RC-ControlHeader: extension bit, CHOICE with a single root format
+  if (reader.ReadBit () || reader.ReadBit ())
+    {
+      return false;
+    }
+
+  // controlHeader-Format1: extension bit, presence of ric-ControlDecision
+  if (reader.ReadBit ())
+    {
+      return false;
+    }
+  bool hasDecision = reader.ReadBit ();
+
+  // UEID: extension bit, index among 7 root alternatives, gNB-UEID first
+  if (reader.ReadBit () || reader.ReadBits (3) != 0)
+    {
+      return false;
+    }
+
+  // UEID-GNB: extension bit, presence of the F1AP ID list, E1AP ID list,
+  // RAN UE ID, XnAP ID and global gNB ID
+  if (reader.ReadBit ())
+    {
+      return false;
+    }
+  uint32_t optionals = reader.ReadBits (5);
+  bool hasF1apList = optionals & 0x10;
+  bool hasE1apList = optionals & 0x08;
+  bool hasRanUeId = optionals & 0x04;
+  bool hasXnapId = optionals & 0x02;
+  bool hasGlobalGnbId = optionals & 0x01;
+  if (!hasF1apList || hasE1apList || hasGlobalGnbId)
+    {
+      return false;
+    }
+
+  reader.ReadConstrained (0, AMF_UE_NGAP_ID_MAX);
+
+  // GUAMI: extension bit, PLMN identity, AMF region ID, set ID and pointer
+  if (reader.ReadBit ())
+    {
+      return false;
+    }
+  reader.SkipOctets (3);
+  reader.ReadBits (8 + 10 + 6);
+
+  // gNB-CU-UE-F1AP-ID list of 1 to 4 items, each extensible
+  uint32_t count = reader.ReadBits (2) + 1;
+  for (uint32_t i = 0; i < count; i++)
+    {
+      if (reader.ReadBit ())
+        {
+          return false;
+        }
+      uint64_t f1apId = reader.ReadConstrained (0, F1AP_ID_MAX);
+      if (i == 0)
+        {
+          header.ueId = f1apId;
+        }
+    }
+
+  if (hasRanUeId)
+    {
+      reader.SkipOctets (8);
+    }
+  if (hasXnapId)
+    {
+      reader.ReadConstrained (0, XNAP_ID_MAX);
+    }
+
+  header.styleType = reader.ReadUnconstrainedInteger ();
+
+  // RIC-ControlAction-ID is an extensible INTEGER (1..65535, ...)
+  if (reader.ReadBit ())
+    {
+      return false;
+    }
+  header.controlActionId = reader.ReadConstrained (1, CONTROL_ACTION_ID_MAX);
+
+  if (hasDecision)
+    {
+      // extensible ENUMERATED {accept, reject, ...}
+      if (reader.ReadBit ())
+        {
+          return false;
+        }
+      reader.ReadBit ();
+    }
+
+  return reader.IsComplete ();
+}
+
+bool
+RcHandoverDecoder::DecodeHandoverMessage (const uint8_t *buf, size_t size,
+                                          HandoverMessage &message)
+{
+  AperReader reader (buf, size);
+
+  // E2SM-RC-ControlMessage: extension bit, CHOICE with a single root format
+  if (reader.ReadBit () || reader.ReadBit ())
+    {
+      return false;
+    }
+
+  // controlMessage-Format1: extension bit, a single RAN parameter
+  if (reader.ReadBit () || reader.ReadConstrained (0, MAX_RAN_PARAMETERS) != 1)
+    {
+      return false;
+    }
+
+  for (uint32_t depth = 0; depth < HANDOVER_DEPTH; depth++)
+    {
+      // Format1 item or STRUCTURE item: extension bit, ID, value type
+      if (reader.ReadBit () || !ReadRanParameterId (reader, message.ranParameterIds[depth]))
+        {
+          return false;
+        }
+
+      // RANParameter-ValueType: extension bit, index among 4 root alternatives
+      if (reader.ReadBit ())
+        {
+          return false;
+        }
+      uint32_t valueType = reader.ReadBits (2);
+
+      if (depth + 1 < HANDOVER_DEPTH)
+        {
+          // ranP-Choice-Structure holding a STRUCTURE with a single item
+          if (valueType != 2 || reader.ReadBit () || reader.ReadBit () || !reader.ReadBit () ||
+              reader.ReadConstrained (1, MAX_RAN_PARAMETERS) != 1)
+            {
+              return false;
+            }
+          continue;
+        }
+
+      // ranP-Choice-ElementTrue, or ranP-Choice-ElementFalse with a value
+      if (valueType == 0)
+        {
+          if (reader.ReadBit ())
+            {
+              return false;
+            }
+        }
+      else if (valueType != 1 || reader.ReadBit () || !reader.ReadBit ())
+        {
+          return false;
+        }
+
+      // RANParameter-Value: extension bit, index among 6 root alternatives
+      if (reader.ReadBit ())
+        {
+          return false;
+        }
+      switch (reader.ReadBits (3))
+        {
+        case 1:
+          message.type = HandoverMessage::Type::INTEGER;
+          message.intValue = reader.ReadUnconstrainedInteger ();
+          message.bytes = nullptr;
+          message.size = 0;
+          break;
+        case 3: {
+          // the length of a BIT STRING is in bits
+          message.type = HandoverMessage::Type::BIT_STRING;
+          size_t bits = reader.ReadLength ();
+          message.size = (bits + 7) / 8;
+          message.bytes = reader.SkipOctets (message.size);
+          message.intValue = 0;
+          break;
+        }
+        case 4:
+          message.type = HandoverMessage::Type::OCTET_STRING;
+          message.size = reader.ReadLength ();
+          message.bytes = reader.SkipOctets (message.size);
+          message.intValue = 0;
+          break;
+        default:
+          return false;
+        }
+    }
+
+  if (!reader.IsComplete ())
+    {
+      NS_LOG_LOGIC ("Not a handover control message, falling back to the generic decoder");
+      return false;
+    }
+  return true;
+}
+
+} // namespace ns3
@@ -0,0 +1,97 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Northeastern University
+ * Copyright (c) 2022 Sapienza, University of Rome
+ * Copyright (c) 2022 University of Padova
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrea Lacava <thecave003@gmail.com>
+ *		   Tommaso Zugno <tommasozugno@gmail.com>
+ *		   Michele Polese <michele.polese@gmail.com>
+ */
+
+#ifndef RC_HANDOVER_DECODER_H
+#define RC_HANDOVER_DECODER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace ns3 {
+
+  /**
+  * Aligned-PER walker specialized for the E2SM-RC handover control: it reads
+  * the UE ID out of the RIC Control Header and the NR CGI of the target cell
+  * out of the RIC Control Message, in place, without building the asn1c
+  * trees and without allocating memory. Only one shape is accepted:
+  *  - header Format1 with a gNB UE ID carrying a gNB-CU-UE-F1AP-ID list and
+  *    no E1AP ID list nor global gNB ID;
+  *  - message Format1 with a single top-level RAN parameter, made of nested
+  *    single-item structures down to an element at the fourth level.
+  * Any other encoding, including the extensions, is rejected so that the
+  * caller can fall back to the generic asn1c decoder.
+  */
+  class RcHandoverDecoder
+  {
+  public:
+    /**
+    * Fields of a RIC Control Header Format1
+    */
+    struct ControlHeader
+    {
+      uint64_t ueId; //!< first gNB-CU-UE-F1AP-ID of the gNB UE ID
+      long styleType; //!< RIC Style Type
+      long controlActionId; //!< RIC Control Action ID
+    };
+
+    /**
+    * Number of levels of the RAN parameter carrying the target cell
+    */
+    static const uint32_t HANDOVER_DEPTH = 4;
+
+    /**
+    * Leaf of a handover RIC Control Message Format1. The bytes of the
+    * string values point into the decoded buffer.
+    */
+    struct HandoverMessage
+    {
+      enum class Type { INTEGER, BIT_STRING, OCTET_STRING };
+
+      uint32_t ranParameterIds[HANDOVER_DEPTH]; //!< IDs from the top level down to the leaf
+      Type type; //!< type of the value of the leaf
+      int64_t intValue; //!< value of an INTEGER leaf
+      const uint8_t *bytes; //!< content of a string leaf
+      size_t size; //!< size in bytes of a string leaf
+    };
+
+    /**
+    * \param buf the APER encoding of an E2SM-RC-ControlHeader
+    * \param size the size of the encoding in bytes
+    * \param header the decoded fields, valid only if true is returned
+    * \return true if the header has the supported shape and was decoded
+    */
+    static bool DecodeControlHeader (const uint8_t *buf, size_t size, ControlHeader &header);
+
+    /**
+    * \param buf the APER encoding of an E2SM-RC-ControlMessage
+    * \param size the size of the encoding in bytes
+    * \param message the decoded leaf, valid only if true is returned and
+    *        only as long as buf
+    * \return true if the message has the supported shape and was decoded
+    */
+    static bool DecodeHandoverMessage (const uint8_t *buf, size_t size, HandoverMessage &message);
+  };
+}
+
+#endif /* RC_HANDOVER_DECODER_H */
@@ -0,0 +1,286 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Northeastern University
+ * Copyright (c) 2022 Sapienza, University of Rome
+ * Copyright (c) 2022 University of Padova
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrea Lacava <thecave003@gmail.com>
+ *		   Tommaso Zugno <tommasozugno@gmail.com>
+ *		   Michele Polese <michele.polese@gmail.com>
+ */
+
+#include <ns3/rc-policy.h>
+#include <ns3/log.h>
+
+extern "C" {
+  #include "E2SM-RC-ActionDefinition.h"
+  #include "E2SM-RC-ActionDefinition-Format2.h"
+  #include "E2SM-RC-ActionDefinition-Format2-Item.h"
+  #include "RIC-PolicyAction.h"
+  #include "RIC-PolicyAction-RANParameter-Item.h"
+  #include "RANParameter-ValueType-Choice-ElementFalse.h"
+  #include "RANParameter-Value.h"
+}
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("RcPolicy");
+
+RcPolicy::RcPolicy (double servingSinrThreshold, double neighbourOffset)
+  : m_servingSinrThreshold (servingSinrThreshold),
+    m_neighbourOffset (neighbourOffset),
+    m_controlActionId (1),
+    m_requestorId (0),
+    m_instanceId (0),
+    m_ranFunctionId (0),
+    m_actionId (0),
+    m_bound (false),
+    m_servingCellMetric (0),
+    m_servingSinrMetric (0)
+{
+}
+
+/**
+ * \param value an element of a RAN parameter
+ * \param out set to the numeric value of the element
+ * \return true if the element is an integer or a real
+ */
+static bool
+GetNumericValue (const RANParameter_Value_t *value, double &out)
+{
+  switch (value->present)
+    {
+    case RANParameter_Value_PR_valueInt:
+      out = value->choice.valueInt;
+      return true;
+    case RANParameter_Value_PR_valueReal:
+      out = value->choice.valueReal;
+      return true;
+    default:
+      return false;
+    }
+}
+
+Ptr<RcPolicy>
+RcPolicy::Decode (const RICactionDefinition_t *actionDefinition)
+{
+  if (actionDefinition == nullptr)
+    {
+      return nullptr;
+    }
+  E2SM_RC_ActionDefinition_t *definition = nullptr;
+  asn_dec_rval_t rval =
+      asn_decode (nullptr, ATS_ALIGNED_BASIC_PER, &asn_DEF_E2SM_RC_ActionDefinition,
+                  (void **) &definition, actionDefinition->buf, actionDefinition->size);
+  Ptr<RcPolicy> policy;
+  if (rval.code != RC_OK)
+    {
+      NS_LOG_ERROR ("Cannot decode the E2SM-RC action definition");
+    }
+  else if (definition->ric_Style_Type != CONNECTED_MODE_MOBILITY_STYLE ||
+           definition->ric_actionDefinition_formats.present !=
+               E2SM_RC_ActionDefinition__ric_actionDefinition_formats_PR_actionDefinition_Format2)
+    {
+      NS_LOG_WARN ("Unsupported policy of style " << definition->ric_Style_Type);
+    }
+  else
+    {
+      const auto &items = definition->ric_actionDefinition_formats.choice.actionDefinition_Format2
+                              ->ric_PolicyConditions_List.list;
+      for (int i = 0; i < items.count && policy == nullptr; i++)
+        {
+          const RIC_PolicyAction_t &action = items.array[i]->ric_PolicyAction;
+          if (action.ranParameters_List == nullptr)
+            {
+              continue;
+            }
+          bool hasThreshold = false;
+          bool hasOffset = false;
+          double threshold = 0;
+          double offset = 0;
+          for (int j = 0; j < action.ranParameters_List->list.count; j++)
+            {
+              const RIC_PolicyAction_RANParameter_Item_t *param =
+                  action.ranParameters_List->list.array[j];
+              if (param->ranParameter_valueType.present !=
+                  RANParameter_ValueType_PR_ranP_Choice_ElementFalse)
+                {
+                  continue;
+                }
+              const RANParameter_Value_t *value =
+                  param->ranParameter_valueType.choice.ranP_Choice_ElementFalse
+                      ->ranParameter_value;
+              if (value == nullptr)
+                {
+                  continue;
+                }
+              if (param->ranParameter_ID == SERVING_SINR_THRESHOLD_ID)
+                {
+                  hasThreshold = GetNumericValue (value, threshold);
+                }
+              else if (param->ranParameter_ID == NEIGHBOUR_OFFSET_ID)
+                {
+                  hasOffset = GetNumericValue (value, offset);
+                }
+            }
+          if (hasThreshold && hasOffset)
+            {
+              policy = Create<RcPolicy> (threshold, offset);
+              policy->m_controlActionId = action.ric_ControlAction_ID;
+              NS_LOG_INFO ("Handover policy: serving SINR below " << threshold
+                                                                  << " dB, neighbour " << offset
+                                                                  << " dB better");
+            }
+        }
+    }
+  ASN_STRUCT_FREE (asn_DEF_E2SM_RC_ActionDefinition, definition);
+  return policy;
+}
+
+void
+RcPolicy::SetSubscription (uint16_t requestorId, uint16_t instanceId, uint16_t ranFunctionId,
+                           uint8_t actionId)
+{
+  m_requestorId = requestorId;
+  m_instanceId = instanceId;
+  m_ranFunctionId = ranFunctionId;
+  m_actionId = actionId;
+}
+
+uint16_t
+RcPolicy::GetRequestorId () const
+{
+  return m_requestorId;
+}
+
+uint16_t
+RcPolicy::GetInstanceId () const
+{
+  return m_instanceId;
+}
+
+uint16_t
+RcPolicy::GetRanFunctionId () const
+{
+  return m_ranFunctionId;
+}
+
+uint8_t
+RcPolicy::GetActionId () const
+{
+  return m_actionId;
+}
+
+long
+RcPolicy::GetControlActionId () const
+{
+  return m_controlActionId;
+}
+
+double
+RcPolicy::GetServingSinrThreshold () const
+{
+  return m_servingSinrThreshold;
+}
+
+double
+RcPolicy::GetNeighbourOffset () const
+{
+  return m_neighbourOffset;
+}
+
+bool
+RcPolicy::BindSchema (Ptr<const KpiSchema> schema)
+{
+  if (schema == m_schema)
+    {
+      return m_bound;
+    }
+  m_schema = schema;
+  m_bound = false;
+
+  auto find = [&schema] (const std::string &name, KpiSchema::Type type, uint32_t &metric) {
+    int32_t found = schema->FindMetric (name);
+    if (found < 0 || schema->GetType (found) != type)
+      {
+        return false;
+      }
+    metric = found;
+    return true;
+  };
+  if (!find ("HO.SrcCellID.UEID", KpiSchema::Type::INTEGER, m_servingCellMetric) ||
+      !find ("HO.SrcCellQual.RS-SINR.UEID", KpiSchema::Type::REAL, m_servingSinrMetric))
+    {
+      return false;
+    }
+  for (uint32_t n = 0; n < MAX_NEIGHBOURS; n++)
+    {
+      std::string prefix = "HO.TrgtCellQual." + std::to_string (n + 1);
+      if (!find (prefix + ".UEID", KpiSchema::Type::INTEGER, m_neighbourCellMetrics[n]) ||
+          !find (prefix + ".RS-SINR.UEID", KpiSchema::Type::REAL, m_neighbourSinrMetrics[n]))
+        {
+          return false;
+        }
+    }
+  m_bound = true;
+  return true;
+}
+
+void
+RcPolicy::Evaluate (Ptr<const KpiTable> table, std::vector<Decision> &decisions)
+{
+  if (table == nullptr || !BindSchema (table->GetSchema ()))
+    {
+      NS_LOG_WARN ("No handover metrics in the KPI table, policy not evaluated");
+      return;
+    }
+
+  const int64_t *servingCell = table->GetIntegerColumn (m_servingCellMetric);
+  const double *servingSinr = table->GetRealColumn (m_servingSinrMetric);
+  const int64_t *neighbourCell[MAX_NEIGHBOURS];
+  const double *neighbourSinr[MAX_NEIGHBOURS];
+  for (uint32_t n = 0; n < MAX_NEIGHBOURS; n++)
+    {
+      neighbourCell[n] = table->GetIntegerColumn (m_neighbourCellMetrics[n]);
+      neighbourSinr[n] = table->GetRealColumn (m_neighbourSinrMetrics[n]);
+    }
+
+  for (uint32_t row = 0; row < table->GetRowCount (); row++)
+    {
+      if (servingSinr[row] >= m_servingSinrThreshold)
+        {
+          continue;
+        }
+      // neighbours with cell ID 0 are not reported
+      int32_t best = -1;
+      for (uint32_t n = 0; n < MAX_NEIGHBOURS; n++)
+        {
+          if (neighbourCell[n][row] != 0 && neighbourCell[n][row] != servingCell[row] &&
+              (best < 0 || neighbourSinr[n][row] > neighbourSinr[best][row]))
+            {
+              best = n;
+            }
+        }
+      if (best >= 0 && neighbourSinr[best][row] >= servingSinr[row] + m_neighbourOffset)
+        {
+          decisions.push_back ({row, table->GetRowId (row), (long) servingCell[row],
+                                (long) neighbourCell[best][row], servingSinr[row],
+                                neighbourSinr[best][row]});
+        }
+    }
+}
+
+} // namespace ns3
@@ -0,0 +1,136 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Northeastern University
+ * Copyright (c) 2022 Sapienza, University of Rome
+ * Copyright (c) 2022 University of Padova
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Author: Andrea Lacava <thecave003@gmail.com>
+ *		   Tommaso Zugno <tommasozugno@gmail.com>
+ *		   Michele Polese <michele.polese@gmail.com>
+ */
+
+#ifndef RC_POLICY_H
+#define RC_POLICY_H
+
+#include <ns3/simple-ref-count.h>
+#include <ns3/ptr.h>
+#include <ns3/kpi-table.h>
+#include <string>
+#include <vector>
+
+extern "C" {
+  #include "RICactionDefinition.h"
+}
+
+namespace ns3 {
+
+  /**
+  * Handover policy installed by the RIC with an E2SM-RC POLICY action, and
+  * evaluated by the E2 node on its own UE KPIs: a UE whose serving SINR is
+  * below a threshold is handed over to its best neighbour, if the SINR of
+  * the neighbour exceeds the serving one by an offset.
+  * The policy is carried by an action definition Format2 of the control
+  * style 3 (connected mode mobility); the RAN parameters of its policy
+  * action hold the threshold and the offset, in dB, under the IDs
+  * SERVING_SINR_THRESHOLD_ID and NEIGHBOUR_OFFSET_ID.
+  */
+  class RcPolicy : public SimpleRefCount<RcPolicy>
+  {
+  public:
+    static const uint32_t SERVING_SINR_THRESHOLD_ID = 65520;
+    static const uint32_t NEIGHBOUR_OFFSET_ID = 65521;
+    static const long CONNECTED_MODE_MOBILITY_STYLE = 3; //!< RIC Style Type of the handovers
+
+    /**
+    * Handover of a UE chosen by the policy
+    */
+    struct Decision
+    {
+      uint32_t row; //!< row of the UE in the KPI table
+      std::string ueId; //!< identifier of the row, the IMSI of the UE
+      long servingCellId;
+      long targetCellId;
+      double servingSinr; //!< dB
+      double targetSinr; //!< dB
+    };
+
+    /**
+    * \param servingSinrThreshold the serving SINR below which a handover is considered, in dB
+    * \param neighbourOffset the SINR advantage of the target over the serving cell, in dB
+    */
+    RcPolicy (double servingSinrThreshold, double neighbourOffset);
+
+    /**
+    * Decode the E2SM-RC action definition of a POLICY action
+    *
+    * \param actionDefinition the action definition of the RIC subscription
+    * \return the policy, nullptr if the definition is not a handover policy
+    */
+    static Ptr<RcPolicy> Decode (const RICactionDefinition_t *actionDefinition);
+
+    /**
+    * Set the identifiers of the RIC subscription that installed the policy
+    */
+    void SetSubscription (uint16_t requestorId, uint16_t instanceId, uint16_t ranFunctionId,
+                          uint8_t actionId);
+
+    uint16_t GetRequestorId () const;
+    uint16_t GetInstanceId () const;
+    uint16_t GetRanFunctionId () const;
+    uint8_t GetActionId () const;
+    long GetControlActionId () const;
+    double GetServingSinrThreshold () const;
+    double GetNeighbourOffset () const;
+
+    /**
+    * Evaluate the policy on the UE KPIs of a reporting period. The table
+    * must have the handover metrics of the gNB UE schema (HO.SrcCellID,
+    * HO.SrcCellQual.RS-SINR and HO.TrgtCellQual.N); a table without them
+    * yields no decision.
+    *
+    * \param table the UE KPIs
+    * \param decisions vector the handovers are appended to
+    */
+    void Evaluate (Ptr<const KpiTable> table, std::vector<Decision> &decisions);
+
+  private:
+    /**
+    * Locate the handover metrics in a schema, once per schema
+    *
+    * \return true if the schema has all the metrics
+    */
+    bool BindSchema (Ptr<const KpiSchema> schema);
+
+    static const uint32_t MAX_NEIGHBOURS = 8;
+
+    double m_servingSinrThreshold;
+    double m_neighbourOffset;
+    long m_controlActionId; //!< RIC Control Action ID of the policy action
+    uint16_t m_requestorId;
+    uint16_t m_instanceId;
+    uint16_t m_ranFunctionId;
+    uint8_t m_actionId;
+
+    Ptr<const KpiSchema> m_schema; //!< schema the metric IDs below refer to
+    bool m_bound; //!< true if m_schema has all the metrics
+    uint32_t m_servingCellMetric;
+    uint32_t m_servingSinrMetric;
+    uint32_t m_neighbourCellMetrics[MAX_NEIGHBOURS];
+    uint32_t m_neighbourSinrMetrics[MAX_NEIGHBOURS];
+  };
+}
+
+#endif /* RC_POLICY_H */
@@ -24,7 +24,10 @@
  
 #include <ns3/ric-control-message.h>
 #include <ns3/asn1c-types.h>
+#include <ns3/rc-handover-decoder.h>
+#include <ns3/asn-struct-pool.h>
 #include <ns3/log.h>
+#include <ns3/abort.h>
 #include <bitset>
 namespace ns3 {
 
@@ -32,12 +35,46 @@ NS_LOG_COMPONENT_DEFINE ("RicControlMessage");
 
 
 RicControlMessage::RicControlMessage (E2AP_PDU_t* pdu)
+  : m_outcome (Create<Outcome> ())
 {
   NS_LOG_INFO("Start of RicControlMessage::RicControlMessage()");
   DecodeRicControlMessage (pdu);
   NS_LOG_INFO("End of RicControlMessage::RicControlMessage()");
 }
 
+RicControlMessage::RicControlMessage (const RicControlMessage &request, size_t action)
+  : m_requestType (request.m_requestType),
+    m_ranFunctionId (request.m_ranFunctionId),
+    m_ricRequestId (request.m_ricRequestId),
+    m_ricCallProcessId (request.m_ricCallProcessId),
+    m_ricControlAckRequest (request.m_ricControlAckRequest),
+    m_secondaryCellId (request.m_secondaryCellId),
+    m_ueId (request.m_ueId),
+    m_controlStyle (request.m_controlStyle),
+    m_controlActionId (request.m_controlActionId),
+    m_outcome (request.m_outcome),
+    m_local (request.m_local)
+{
+  m_actions.push_back (request.m_actions.at (action));
+}
+
+RicControlMessage::RicControlMessage (long ranFunctionId, const RICrequestID_t &requestId,
+                                      const std::vector<ControlAction> &actions)
+  : m_requestType (RC),
+    m_ranFunctionId (ranFunctionId),
+    m_ricRequestId (requestId),
+    m_actions (actions),
+    m_outcome (Create<Outcome> ()),
+    m_local (true)
+{
+  if (!m_actions.empty ())
+    {
+      m_ueId = m_actions[0].m_ueId;
+      m_controlStyle = m_actions[0].m_controlStyle;
+      m_controlActionId = m_actions[0].m_controlActionId;
+    }
+}
+
 RicControlMessage::~RicControlMessage ()
 {
 
@@ -48,7 +85,6 @@ RicControlMessage::DecodeRicControlMessage(E2AP_PDU_t* pdu)
 {
     InitiatingMessage_t* mess = pdu->choice.initiatingMessage;
     auto *request = (RICcontrolRequest_t *) &mess->value.choice.RICcontrolRequest;
-    NS_LOG_INFO (xer_fprint(stderr, &asn_DEF_RICcontrolRequest, request));
 
     size_t count = request->protocolIEs.list.count; 
     if (count <= 0) {
@@ -93,193 +129,24 @@ RicControlMessage::DecodeRicControlMessage(E2AP_PDU_t* pdu)
                 break;
             }
             case RICcontrolRequest_IEs__value_PR_RICcallProcessID: {
-                m_ricCallProcessId = ie->value.choice.RICcallProcessID;
+                m_ricCallProcessId.assign ((char *) ie->value.choice.RICcallProcessID.buf,
+                                           ie->value.choice.RICcallProcessID.size);
                 NS_LOG_DEBUG("[E2SM] RICcontrolRequest_IEs__value_PR_RICcallProcessID");
                 break;
             }
             case RICcontrolRequest_IEs__value_PR_RICcontrolHeader: {
                 NS_LOG_DEBUG("[E2SM] RICcontrolRequest_IEs__value_PR_RICcontrolHeader");
-                // xer_fprint(stderr, &asn_DEF_RICcontrolHeader, &ie->value.choice.RICcontrolHeader);
-
-                auto *e2smControlHeader = (E2SM_RC_ControlHeader_t *) calloc(1,
-                                                                             sizeof(E2SM_RC_ControlHeader_t));
-                ASN_STRUCT_RESET(asn_DEF_E2SM_RC_ControlHeader, e2smControlHeader);
-                asn_dec_rval_t rval = asn_decode(nullptr, ATS_ALIGNED_BASIC_PER, &asn_DEF_E2SM_RC_ControlHeader,
-                                     (void **) &e2smControlHeader,
-                                     ie->value.choice.RICcontrolHeader.buf,
-                                     ie->value.choice.RICcontrolHeader.size);
-                // Check if decoding was successful
-                if (rval.code != RC_OK) {
-                    NS_LOG_ERROR("[E2SM] Error decoding RICcontrolHeader");
-                    break;
-                }
-
-
-                NS_LOG_INFO (xer_fprint (stderr, &asn_DEF_E2SM_RC_ControlHeader, e2smControlHeader));
-                if (e2smControlHeader->ric_controlHeader_formats.present == E2SM_RC_ControlHeader__ric_controlHeader_formats_PR_controlHeader_Format1) {
-                    m_e2SmRcControlHeaderFormat1 = e2smControlHeader->ric_controlHeader_formats.choice.controlHeader_Format1;
-                    //m_e2SmRcControlHeaderFormat1->ric_ControlAction_ID;
-                    //m_e2SmRcControlHeaderFormat1->ric_ControlStyle_Type;
-                    //m_e2SmRcControlHeaderFormat1->ueId;
-                } else {
-                    NS_LOG_DEBUG("[E2SM] Error in checking format of E2SM Control Header");
-                }
+                DecodeControlHeader (ie->value.choice.RICcontrolHeader);
                 break;
-                 // Free the allocated memory for e2smControlHeader if needed
-                 ASN_STRUCT_FREE(asn_DEF_E2SM_RC_ControlHeader, e2smControlHeader);
-
             }
             case RICcontrolRequest_IEs__value_PR_RICcontrolMessage: {
-                /*
                 NS_LOG_DEBUG("[E2SM] RICcontrolRequest_IEs__value_PR_RICcontrolMessage");
-                // xer_fprint(stderr, &asn_DEF_RICcontrolMessage, &ie->value.choice.RICcontrolMessage);
-
-                auto *e2SmControlMessage = (E2SM_RC_ControlMessage_t *) calloc(1,
-                                                                               sizeof(E2SM_RC_ControlMessage_t));
-                ASN_STRUCT_RESET(asn_DEF_E2SM_RC_ControlMessage, e2SmControlMessage);
-                // Decode message then assign to e2SmControlMessage with sutable format.
-                asn_decode (nullptr, ATS_ALIGNED_BASIC_PER, &asn_DEF_E2SM_RC_ControlMessage,
-                            (void **) &e2SmControlMessage, ie->value.choice.RICcontrolMessage.buf,
-                            ie->value.choice.RICcontrolMessage.size);
-
-                NS_LOG_DEBUG("********** START Print Message and Size");
-                NS_LOG_DEBUG(ie->value.present);
-
-                NS_LOG_DEBUG(ie->value.choice.RICcontrolMessage.size);
-                int buf_lennnn = static_cast<int>(ie->value.choice.RICcontrolMessage.size);
-                for(int i =0 ;i <  buf_lennnn; ++i) {
-
-                NS_LOG_DEBUG(static_cast<int>(ie->value.choice.RICcontrolMessage.buf[i]));
-
-                }
-                NS_LOG_DEBUG("********** END Print Message and Size");
-
-                NS_LOG_INFO (xer_fprint(stderr, &asn_DEF_E2SM_RC_ControlMessage, e2SmControlMessage));
-
-                NS_LOG_DEBUG("****  e2SmControlMessage->present **** ");
-                NS_LOG_DEBUG(e2SmControlMessage->ric_controlMessage_formats.present);
-
-                const bool DISABLE_FOR_OCTANT_STRING = false;
-                if (e2SmControlMessage->ric_controlMessage_formats.present == E2SM_RC_ControlMessage__ric_controlMessage_formats_PR_controlMessage_Format1)
-                  {
-                    m_e2SmRcControlMessageFormat1 = e2SmControlMessage->ric_controlMessage_formats.choice.controlMessage_Format1;
-
-
-
-                    if(DISABLE_FOR_OCTANT_STRING) {
-                        NS_LOG_DEBUG ("[E2SM] E2SM_RC_ControlMessage_PR_controlMessage_Format1");
-                        E2SM_RC_ControlMessage_Format1_t *e2SmRcControlMessageFormat1 = (E2SM_RC_ControlMessage_Format1_t*) calloc(0, sizeof(E2SM_RC_ControlMessage_Format1_t));
-
-                        e2SmRcControlMessageFormat1 = e2SmControlMessage->ric_controlMessage_formats.choice.controlMessage_Format1;
-                        NS_LOG_INFO (xer_fprint(stderr, &asn_DEF_E2SM_RC_ControlMessage_Format1, e2SmRcControlMessageFormat1));
-                        NS_LOG_DEBUG("*** DONE e2SmControlMessage->choice.controlMessage_Format1 **");
-                        
-                        assert(e2SmRcControlMessageFormat1 != nullptr && " e2SmRcControlMessageFormat1 is Null");
-                        
-                        NS_LOG_DEBUG("*** DONE ASSERT ExtractRANParametersFromControlMessage **");
-                        m_valuesExtracted =
-                            RicControlMessage::ExtractRANParametersFromControlMessage (e2SmRcControlMessageFormat1);
-                        
-                        NS_LOG_DEBUG("*** DONE ExtractRANParametersFromControlMessage **");
-                        if (m_requestType == ControlMessageRequestIdType::TS)
-                        {
-                            // Get and parse the secondaty cell id according to 3GPP TS 38.473, Section 9.2.2.1
-                            for (RANParameterItem item : m_valuesExtracted)
-                            {
-                                if (item.m_valueType == RANParameterItem::ValueType::OctectString)
-                                {
-                                    // First 3 digits are the PLMNID (always 111), last digit is CellId
-                                    std::string cgi = item.m_valueStr->DecodeContent ();
-                                    NS_LOG_INFO ("Decoded CGI value is: " << cgi);
-                                    m_secondaryCellId = cgi.back();
-                                }
-                            }         
-                        }
-                    }
-                    */ 
-                    // add 1208
-                    NS_LOG_DEBUG("[E2SM] RICcontrolRequest_IEs__value_PR_RICcontrolMessage");
-
-                    auto &cm = ie->value.choice.RICcontrolMessage;
-
-                    // 0. NULL / size 체크 (이제는 통과하고 있는 상태인 듯)
-                    if (cm.buf == nullptr || cm.size == 0) {
-                        NS_LOG_ERROR("[E2SM] ControlMessage is empty");
-                        break;
-                    }
-
-                    NS_LOG_DEBUG("[E2SM] Raw ControlMessage buf size = " << cm.size);
-
-                    auto *e2SmControlMessage =
-                        (E2SM_RC_ControlMessage_t *) calloc(1, sizeof(E2SM_RC_ControlMessage_t));
-                    ASN_STRUCT_RESET(asn_DEF_E2SM_RC_ControlMessage, e2SmControlMessage);
-                    /*
-                    asn_dec_rval_t rval = asn_decode(
-                        nullptr,
-                        ATS_ALIGNED_BASIC_PER,
-                        &asn_DEF_E2SM_RC_ControlMessage,
-                        (void **) &e2SmControlMessage,
-                        ie->value.choice.RICcontrolMessage.buf,
-                        ie->value.choice.RICcontrolMessage.size);
-
-                    */                  
-                    asn_dec_rval_t rval = asn_decode(
-                        nullptr,
-                        ATS_ALIGNED_BASIC_PER,
-                        &asn_DEF_E2SM_RC_ControlMessage,
-                        (void **) &e2SmControlMessage,
-                        cm.buf,
-                        cm.size
-                    );
-
-                    NS_LOG_ERROR("[E2SM] Decode ControlMessage: rval.code=" << rval.code
-                        << " consumed=" << rval.consumed
-                        << " size=" << cm.size);
-                    if (rval.code != RC_OK) {
-                        ASN_STRUCT_FREE(asn_DEF_E2SM_RC_ControlMessage, e2SmControlMessage);
-                        break;   // ❗ 실패했으면 절대 밑으로 내려가면 안 됨
-                    }
-
-                    // 🔥 디코딩된 ControlMessage 전체 구조를 XER로 찍기
-                    NS_LOG_DEBUG ("[E2SM] Decoded E2SM_RC_ControlMessage (XER):");
-                    NS_LOG_DEBUG(xer_fprint(stderr, &asn_DEF_E2SM_RC_ControlMessage, e2SmControlMessage));
-
-                    if (e2SmControlMessage->ric_controlMessage_formats.present ==
-                        E2SM_RC_ControlMessage__ric_controlMessage_formats_PR_controlMessage_Format1)
-                    {
-                        NS_LOG_DEBUG("[E2SM] ControlMessage Format1 detected");
-
-                        m_e2SmRcControlMessageFormat1 =
-                            e2SmControlMessage->ric_controlMessage_formats.choice.controlMessage_Format1;
-
-                        int cnt = 0;
-                        if (m_e2SmRcControlMessageFormat1->ranP_List.list.array != nullptr) {
-                            cnt = m_e2SmRcControlMessageFormat1->ranP_List.list.count;
-                        }
-                        NS_LOG_DEBUG("[E2SM] ControlMessage Format1 ranP_List.count = " << cnt);
-
-                        // 각 항목의 ranParameter-ID도 한 번 찍어보자 (있다면)
-                        for (int i = 0; i < cnt; ++i) {
-                            auto *item = m_e2SmRcControlMessageFormat1->ranP_List.list.array[i];
-                            if (item) {
-                                NS_LOG_DEBUG("[E2SM] ranP_List[" << i
-                                            << "].ranParameter-ID = "
-                                            << item->ranParameter_ID);
-                            } else {
-                                NS_LOG_DEBUG("[E2SM] ranP_List[" << i << "] is NULL");
-                            }
-                        }
-                    
-
-                  }
-                else
-                  {
-                    NS_LOG_DEBUG("[E2SM] Error in checking format of E2SM Control Message");
-                  }
+                DecodeControlMessage (ie->value.choice.RICcontrolMessage);
                 break;
             }
             case RICcontrolRequest_IEs__value_PR_RICcontrolAckRequest: {
                 NS_LOG_DEBUG("[E2SM] RICcontrolRequest_IEs__value_PR_RICcontrolAckRequest");
+                m_ricControlAckRequest = ie->value.choice.RICcontrolAckRequest;
 
                 switch (ie->value.choice.RICcontrolAckRequest) {
                     case RICcontrolAckRequest_noAck: {
@@ -310,6 +177,7 @@ RicControlMessage::DecodeRicControlMessage(E2AP_PDU_t* pdu)
         }
     }
 
+    CompleteActions ();
     NS_LOG_INFO ("End of DecodeRicControlMessage");
 }
 
@@ -345,257 +213,460 @@ std::vector<RANParameterItem> RicControlMessage::ExtractRANParametersFromControl
   return ranParameterList;
 }
 */
-// add with gpt
-uint16_t
-RicControlMessage::GetTargetCell () const
+/**
+* \return the first gNB-CU-UE-F1AP-ID of a UE ID, 0 if absent
+*/
+static uint64_t
+GetF1apUeId (const UEID_t *ueId)
 {
-  // -------------------------------
-  // 0. Format1 존재 확인
-  // -------------------------------
-  if (!m_e2SmRcControlMessageFormat1)
+  const UEID_GNB_t *ue =
+      ueId && ueId->present == UEID_PR_gNB_UEID ? ueId->choice.gNB_UEID : nullptr;
+  if (ue && ue->gNB_CU_UE_F1AP_ID_List && ue->gNB_CU_UE_F1AP_ID_List->list.count > 0 &&
+      ue->gNB_CU_UE_F1AP_ID_List->list.array[0])
     {
-      NS_LOG_ERROR ("GetTargetCell(): Format1 NULL");
-      return 0;
+      return ue->gNB_CU_UE_F1AP_ID_List->list.array[0]->gNB_CU_UE_F1AP_ID;
     }
+  NS_LOG_ERROR ("No gNB-CU-UE-F1AP-ID in the UE ID of the control header");
+  return 0;
+}
 
-  auto &topList = m_e2SmRcControlMessageFormat1->ranP_List.list;
-
-  if (topList.count == 0 || !topList.array)
+void
+RicControlMessage::DecodeControlHeader (const RICcontrolHeader_t &controlHeader)
+{
+  RcHandoverDecoder::ControlHeader fast;
+  if (RcHandoverDecoder::DecodeControlHeader (controlHeader.buf, controlHeader.size, fast))
     {
-      NS_LOG_ERROR ("GetTargetCell(): ranP_List empty");
-      return 0;
+      m_ueId = fast.ueId;
+      m_controlStyle = fast.styleType;
+      m_controlActionId = fast.controlActionId;
+      return;
     }
 
-
-  // -------------------------------
-  // 1. Top-level RANParameter 구조
-  // -------------------------------
-  auto *topItem = topList.array[0];
-  if (!topItem)
+  AsnStructPool &pool = AsnStructPool::GetRcControlHeaderPool ();
+  E2SM_RC_ControlHeader_t *header = pool.Acquire<E2SM_RC_ControlHeader_t> ();
+  asn_dec_rval_t rval =
+      asn_decode (nullptr, ATS_ALIGNED_BASIC_PER, &asn_DEF_E2SM_RC_ControlHeader,
+                  (void **) &header, controlHeader.buf, controlHeader.size);
+  if (rval.code != RC_OK)
     {
-      NS_LOG_ERROR ("GetTargetCell(): topItem NULL");
-      return 0;
+      NS_LOG_ERROR ("[E2SM] Error decoding RICcontrolHeader");
+      pool.Release (header);
+      return;
     }
 
-  if (topItem->ranParameter_valueType.present !=
-      RANParameter_ValueType_PR_ranP_Choice_Structure)
+  switch (header->ric_controlHeader_formats.present)
     {
-      NS_LOG_ERROR ("GetTargetCell(): topItem not structure");
-      return 0;
+    case E2SM_RC_ControlHeader__ric_controlHeader_formats_PR_controlHeader_Format1: {
+      const E2SM_RC_ControlHeader_Format1_t *format1 =
+          header->ric_controlHeader_formats.choice.controlHeader_Format1;
+      m_controlStyle = format1->ric_Style_Type;
+      m_controlActionId = format1->ric_ControlAction_ID;
+      m_ueId = GetF1apUeId (&format1->ueID);
+      NS_LOG_DEBUG ("Parsed UE-ID = " << m_ueId);
+      break;
+    }
+    case E2SM_RC_ControlHeader__ric_controlHeader_formats_PR_controlHeader_Format2: {
+      // the styles and actions are in the message, the UE ID is optional
+      const E2SM_RC_ControlHeader_Format2_t *format2 =
+          header->ric_controlHeader_formats.choice.controlHeader_Format2;
+      if (format2->ueID)
+        {
+          m_ueId = GetF1apUeId (format2->ueID);
+        }
+      break;
+    }
+    default:
+      NS_LOG_DEBUG ("[E2SM] Error in checking format of E2SM Control Header");
+      break;
     }
 
-  auto *topStructChoice =
-      topItem->ranParameter_valueType.choice.ranP_Choice_Structure;
+  // everything needed has been copied, the tree is not kept
+  pool.Release (header);
+}
 
-  if (!topStructChoice || !topStructChoice->ranParameter_Structure)
+void
+RicControlMessage::DecodeControlMessage (const RICcontrolMessage_t &controlMessage)
+{
+  if (controlMessage.buf == nullptr || controlMessage.size == 0)
     {
-      NS_LOG_ERROR ("GetTargetCell(): top structure missing");
-      return 0;
+      NS_LOG_ERROR ("[E2SM] ControlMessage is empty");
+      return;
     }
 
-  auto *topStruct = topStructChoice->ranParameter_Structure;
-
-  if (!topStruct->sequence_of_ranParameters ||
-      topStruct->sequence_of_ranParameters->list.count == 0)
+  RcHandoverDecoder::HandoverMessage fast;
+  if (RcHandoverDecoder::DecodeHandoverMessage (controlMessage.buf, controlMessage.size, fast))
     {
-      NS_LOG_ERROR ("GetTargetCell(): topStruct empty");
-      return 0;
+      std::string path = std::to_string (fast.ranParameterIds[0]);
+      for (uint32_t depth = 1; depth < RcHandoverDecoder::HANDOVER_DEPTH; depth++)
+        {
+          path += "." + std::to_string (fast.ranParameterIds[depth]);
+        }
+      RanParameterValue flat;
+      switch (fast.type)
+        {
+        case RcHandoverDecoder::HandoverMessage::Type::INTEGER:
+          flat.m_type = RanParameterValue::Type::INTEGER;
+          flat.m_int = fast.intValue;
+          break;
+        case RcHandoverDecoder::HandoverMessage::Type::BIT_STRING:
+          flat.m_type = RanParameterValue::Type::BIT_STRING;
+          flat.m_bytes.assign ((const char *) fast.bytes, fast.size);
+          break;
+        case RcHandoverDecoder::HandoverMessage::Type::OCTET_STRING:
+          flat.m_type = RanParameterValue::Type::OCTET_STRING;
+          flat.m_bytes.assign ((const char *) fast.bytes, fast.size);
+          break;
+        }
+      m_actions.emplace_back ();
+      StoreRanParameterValue (path, flat, RcHandoverDecoder::HANDOVER_DEPTH - 1, true,
+                              m_actions.back ());
+      return;
     }
 
-
-  // -------------------------------
-  // 2. TargetCell 구조
-  // -------------------------------
-  auto *targetCellItem =
-      topStruct->sequence_of_ranParameters->list.array[0];
-
-  if (!targetCellItem ||
-      targetCellItem->ranParameter_valueType->present !=
-      RANParameter_ValueType_PR_ranP_Choice_Structure)
+  AsnStructPool &pool = AsnStructPool::GetRcControlMessagePool ();
+  E2SM_RC_ControlMessage_t *message = pool.Acquire<E2SM_RC_ControlMessage_t> ();
+  asn_dec_rval_t rval =
+      asn_decode (nullptr, ATS_ALIGNED_BASIC_PER, &asn_DEF_E2SM_RC_ControlMessage,
+                  (void **) &message, controlMessage.buf, controlMessage.size);
+  if (rval.code != RC_OK)
     {
-      NS_LOG_ERROR ("GetTargetCell(): targetCellItem invalid");
-      return 0;
+      NS_LOG_ERROR ("[E2SM] Error decoding RICcontrolMessage, " << rval.consumed << " of "
+                                                                << controlMessage.size
+                                                                << " bytes consumed");
+      pool.Release (message);
+      return;
     }
 
-  auto *targetCellChoice =
-      targetCellItem->ranParameter_valueType->choice.ranP_Choice_Structure;
-
-  if (!targetCellChoice || !targetCellChoice->ranParameter_Structure)
+  switch (message->ric_controlMessage_formats.present)
     {
-      NS_LOG_ERROR ("GetTargetCell(): targetCellStruct missing");
-      return 0;
+    case E2SM_RC_ControlMessage__ric_controlMessage_formats_PR_controlMessage_Format1:
+      // a single action, whose style and ID are in the header
+      m_actions.emplace_back ();
+      FlattenRanParameterList (message->ric_controlMessage_formats.choice.controlMessage_Format1,
+                               m_actions.back ());
+      break;
+    case E2SM_RC_ControlMessage__ric_controlMessage_formats_PR_controlMessage_Format2: {
+      const auto &styles =
+          message->ric_controlMessage_formats.choice.controlMessage_Format2->ric_ControlStyle_List
+              .list;
+      for (int i = 0; i < styles.count; i++)
+        {
+          const auto &actions = styles.array[i]->ric_ControlAction_List.list;
+          for (int j = 0; j < actions.count; j++)
+            {
+              ControlAction action;
+              action.m_controlStyle = styles.array[i]->indicated_Control_Style_Type;
+              action.m_controlActionId = actions.array[j]->ric_ControlAction_ID;
+              FlattenRanParameterList (&actions.array[j]->ranP_List, action);
+              m_actions.push_back (std::move (action));
+            }
+        }
+      NS_LOG_DEBUG ("[E2SM] ControlMessage Format2, " << m_actions.size () << " actions");
+      break;
+    }
+    default:
+      NS_LOG_DEBUG ("[E2SM] Error in checking format of E2SM Control Message");
+      break;
     }
 
-  auto *targetCellStruct = targetCellChoice->ranParameter_Structure;
+  pool.Release (message);
+}
 
-  if (!targetCellStruct->sequence_of_ranParameters ||
-      targetCellStruct->sequence_of_ranParameters->list.count == 0)
+void
+RicControlMessage::CompleteActions ()
+{
+  for (ControlAction &action : m_actions)
     {
-      NS_LOG_ERROR ("GetTargetCell(): targetCellStruct empty");
-      return 0;
+      if (action.m_controlStyle < 0)
+        {
+          action.m_controlStyle = m_controlStyle;
+          action.m_controlActionId = m_controlActionId;
+        }
+      auto ue = action.m_ranParameters.find (std::to_string (UE_ID_RAN_PARAMETER_ID));
+      if (ue != action.m_ranParameters.end () &&
+          ue->second.m_type == RanParameterValue::Type::INTEGER)
+        {
+          action.m_ueId = ue->second.m_int;
+        }
+      else
+        {
+          action.m_ueId = m_ueId;
+        }
     }
+}
 
-
-  // -------------------------------
-  // 3. NR Cell 구조
-  // -------------------------------
-  auto *nrCellItem =
-      targetCellStruct->sequence_of_ranParameters->list.array[0];
-
-  if (!nrCellItem ||
-      nrCellItem->ranParameter_valueType->present !=
-      RANParameter_ValueType_PR_ranP_Choice_Structure)
+void
+RicControlMessage::FlattenRanParameterList (const E2SM_RC_ControlMessage_Format1_t *format1,
+                                            ControlAction &action)
+{
+  const auto &list = format1->ranP_List.list;
+  for (int i = 0; i < list.count; i++)
     {
-      NS_LOG_ERROR ("GetTargetCell(): nrCellItem invalid");
-      return 0;
+      if (list.array[i])
+        {
+          FlattenRanParameter (std::to_string (list.array[i]->ranParameter_ID),
+                               &list.array[i]->ranParameter_valueType, 0, i == 0, action);
+        }
     }
+  NS_LOG_DEBUG ("[E2SM] " << list.count << " RAN parameters, " << action.m_ranParameters.size ()
+                          << " values");
+}
 
-  auto *nrCellChoice =
-      nrCellItem->ranParameter_valueType->choice.ranP_Choice_Structure;
-
-  if (!nrCellChoice || !nrCellChoice->ranParameter_Structure)
+void
+RicControlMessage::FlattenRanParameter (const std::string &path,
+                                        const RANParameter_ValueType_t *valueType,
+                                        uint32_t depth, bool firstChain, ControlAction &action)
+{
+  if (valueType == nullptr)
     {
-      NS_LOG_ERROR ("GetTargetCell(): nrCellStruct missing");
-      return 0;
+      return;
     }
 
-  auto *nrCellStruct = nrCellChoice->ranParameter_Structure;
-
-  if (!nrCellStruct->sequence_of_ranParameters ||
-      nrCellStruct->sequence_of_ranParameters->list.count == 0)
+  switch (valueType->present)
     {
-      NS_LOG_ERROR ("GetTargetCell(): nrCellStruct empty");
-      return 0;
+    case RANParameter_ValueType_PR_ranP_Choice_ElementTrue:
+      if (valueType->choice.ranP_Choice_ElementTrue)
+        {
+          AddRanParameterValue (path, &valueType->choice.ranP_Choice_ElementTrue->ranParameter_value,
+                                depth, firstChain, action);
+        }
+      break;
+    case RANParameter_ValueType_PR_ranP_Choice_ElementFalse:
+      if (valueType->choice.ranP_Choice_ElementFalse)
+        {
+          AddRanParameterValue (path, valueType->choice.ranP_Choice_ElementFalse->ranParameter_value,
+                                depth, firstChain, action);
+        }
+      break;
+    case RANParameter_ValueType_PR_ranP_Choice_Structure:
+      if (valueType->choice.ranP_Choice_Structure)
+        {
+          FlattenRanParameterStructure (path,
+                                        valueType->choice.ranP_Choice_Structure->ranParameter_Structure,
+                                        depth, firstChain, action);
+        }
+      break;
+    case RANParameter_ValueType_PR_ranP_Choice_List:
+      if (valueType->choice.ranP_Choice_List && valueType->choice.ranP_Choice_List->ranParameter_List)
+        {
+          const auto &entries =
+              valueType->choice.ranP_Choice_List->ranParameter_List->list_of_ranParameter.list;
+          for (int i = 0; i < entries.count; i++)
+            {
+              // the entries of a list are not on the target cell chain
+              FlattenRanParameterStructure (path + "[" + std::to_string (i) + "]",
+                                            entries.array[i], depth, false, action);
+            }
+        }
+      break;
+    default:
+      NS_LOG_DEBUG ("RAN parameter " << path << " without value");
+      break;
     }
+}
 
-
-  // -------------------------------
-  // 4. NR CGI (ElementFalse)
-  // -------------------------------
-  auto *nrCgiItem =
-      nrCellStruct->sequence_of_ranParameters->list.array[0];
-
-  if (!nrCgiItem ||
-      nrCgiItem->ranParameter_valueType->present !=
-      RANParameter_ValueType_PR_ranP_Choice_ElementFalse)
+void
+RicControlMessage::FlattenRanParameterStructure (const std::string &path,
+                                                 const RANParameter_STRUCTURE_t *structure,
+                                                 uint32_t depth, bool firstChain,
+                                                 ControlAction &action)
+{
+  if (structure == nullptr || structure->sequence_of_ranParameters == nullptr)
     {
-      NS_LOG_ERROR ("GetTargetCell(): nrCgiItem invalid");
-      return 0;
+      return;
     }
-
-  auto *elemFalse =
-      nrCgiItem->ranParameter_valueType->choice.ranP_Choice_ElementFalse;
-
-  if (!elemFalse || !elemFalse->ranParameter_value)
+  const auto &items = structure->sequence_of_ranParameters->list;
+  for (int i = 0; i < items.count; i++)
     {
-      NS_LOG_ERROR ("GetTargetCell(): elemFalse NULL");
-      return 0;
+      if (items.array[i])
+        {
+          FlattenRanParameter (path + "." + std::to_string (items.array[i]->ranParameter_ID),
+                               items.array[i]->ranParameter_valueType, depth + 1,
+                               firstChain && i == 0, action);
+        }
     }
+}
 
-  auto *val = elemFalse->ranParameter_value;
-
-  NS_LOG_DEBUG("GetTargetCell(): valueType present=" << val->present);
-
-
-  // -------------------------------
-  // 5. valueBitS / valueOctS / valueInt 모두 지원
-  // -------------------------------
-  uint16_t cellId = 0;
+void
+RicControlMessage::AddRanParameterValue (const std::string &path, const RANParameter_Value_t *value,
+                                         uint32_t depth, bool firstChain, ControlAction &action)
+{
+  if (value == nullptr)
+    {
+      return;
+    }
 
-  switch (val->present)
+  RanParameterValue flat;
+  switch (value->present)
     {
+    case RANParameter_Value_PR_valueBoolean:
+      flat.m_type = RanParameterValue::Type::BOOLEAN;
+      flat.m_int = value->choice.valueBoolean ? 1 : 0;
+      break;
+    case RANParameter_Value_PR_valueInt:
+      flat.m_type = RanParameterValue::Type::INTEGER;
+      flat.m_int = value->choice.valueInt;
+      break;
+    case RANParameter_Value_PR_valueReal:
+      flat.m_type = RanParameterValue::Type::REAL;
+      flat.m_real = value->choice.valueReal;
+      break;
     case RANParameter_Value_PR_valueBitS:
-      {
-        BIT_STRING_t bits = val->choice.valueBitS;
-
-        if (!bits.buf || bits.size == 0)
-          {
-            NS_LOG_ERROR("GetTargetCell(): valueBitS empty");
-            return 0;
-          }
-
-        uint8_t lastByte = bits.buf[bits.size - 1];
-        cellId = lastByte & 0x0F;
-        break;
-      }
-
+      flat.m_type = RanParameterValue::Type::BIT_STRING;
+      flat.m_bytes.assign ((char *) value->choice.valueBitS.buf, value->choice.valueBitS.size);
+      break;
     case RANParameter_Value_PR_valueOctS:
-      {
-        OCTET_STRING_t oct = val->choice.valueOctS;
-
-        if (!oct.buf || oct.size == 0)
-          {
-            NS_LOG_ERROR("GetTargetCell(): valueOctS empty");
-            return 0;
-          }
-
-        uint8_t lastByte = oct.buf[oct.size - 1];
-        cellId = lastByte & 0x0F;
-        break;
-      }
+      flat.m_type = RanParameterValue::Type::OCTET_STRING;
+      flat.m_bytes.assign ((char *) value->choice.valueOctS.buf, value->choice.valueOctS.size);
+      break;
+    case RANParameter_Value_PR_valuePrintableString:
+      flat.m_type = RanParameterValue::Type::PRINTABLE_STRING;
+      flat.m_bytes.assign ((char *) value->choice.valuePrintableString.buf,
+                           value->choice.valuePrintableString.size);
+      break;
+    default:
+      NS_LOG_ERROR ("RAN parameter " << path << " of unsupported type " << value->present);
+      return;
+    }
 
-    case RANParameter_Value_PR_valueInt:
-      {
-        long v = val->choice.valueInt;
-        cellId = v & 0x0F;
-        break;
-      }
+  StoreRanParameterValue (path, flat, depth, firstChain, action);
+}
 
-    default:
-      NS_LOG_ERROR("GetTargetCell(): Unsupported type=" << val->present);
-      return 0;
+void
+RicControlMessage::StoreRanParameterValue (const std::string &path, const RanParameterValue &flat,
+                                           uint32_t depth, bool firstChain, ControlAction &action)
+{
+  // the handover control carries the NR CGI of the target cell as the
+  // first leaf, four levels down (Target Primary Cell ID, CHOICE Target
+  // Cell, NR Cell, NR CGI); the cell ID is its last nibble
+  if (firstChain && depth == 3)
+    {
+      switch (flat.m_type)
+        {
+        case RanParameterValue::Type::BIT_STRING:
+        case RanParameterValue::Type::OCTET_STRING:
+          if (!flat.m_bytes.empty ())
+            {
+              action.m_targetCellId = ((uint8_t) flat.m_bytes.back ()) & 0x0F;
+            }
+          break;
+        case RanParameterValue::Type::INTEGER:
+          action.m_targetCellId = flat.m_int & 0x0F;
+          break;
+        default:
+          NS_LOG_ERROR ("Unsupported type of the NR CGI " << (int) flat.m_type);
+          break;
+        }
+      NS_LOG_DEBUG ("Decoded target cellId=" << action.m_targetCellId);
     }
 
+  action.m_ranParameters[path] = flat;
+}
 
-  // -------------------------------
-  // 6. 결과 출력
-  // -------------------------------
-  NS_LOG_DEBUG("GetTargetCell(): decoded cellId=" << cellId);
-  return cellId;
+uint16_t
+RicControlMessage::GetTargetCell () const
+{
+  return m_actions.empty () ? 0 : m_actions[0].m_targetCellId;
 }
 
+uint64_t
+RicControlMessage::GetUeId () const
+{
+  return m_actions.empty () ? m_ueId : m_actions[0].m_ueId;
+}
 
+long
+RicControlMessage::GetControlStyle () const
+{
+  return m_actions.empty () ? m_controlStyle : m_actions[0].m_controlStyle;
+}
 
-uint64_t
-RicControlMessage::GetUeId() const
+long
+RicControlMessage::GetControlActionId () const
 {
-    auto *hdr = m_e2SmRcControlHeaderFormat1;
-    if (!hdr) {
-        NS_LOG_ERROR("ControlHeaderFormat1 is NULL");
-        return 0;
-    }
+  return m_actions.empty () ? m_controlActionId : m_actions[0].m_controlActionId;
+}
 
-    if (hdr->ueID.present != UEID_PR_gNB_UEID) {
-        NS_LOG_ERROR("UEID is not gNB_UEID type!");
-        return 0;
+const RicControlMessage::RanParameterValue *
+RicControlMessage::FindRanParameter (const std::string &path) const
+{
+  if (m_actions.empty ())
+    {
+      return nullptr;
     }
-
-    UEID_GNB_t *ue = hdr->ueID.choice.gNB_UEID;
-    if (!ue) {
-        NS_LOG_ERROR("UEID_GNB is NULL");
-        return 0;
+  auto it = m_actions[0].m_ranParameters.find (path);
+  if (it == m_actions[0].m_ranParameters.end ())
+    {
+      return nullptr;
     }
+  return &it->second;
+}
+
+const std::unordered_map<std::string, RicControlMessage::RanParameterValue> &
+RicControlMessage::GetRanParameters () const
+{
+  static const std::unordered_map<std::string, RanParameterValue> empty;
+  return m_actions.empty () ? empty : m_actions[0].m_ranParameters;
+}
 
-    // gNB-CU-UE-F1AP-ID-List → 첫 item 사용
-    auto *f1List = ue->gNB_CU_UE_F1AP_ID_List;
+const std::vector<RicControlMessage::ControlAction> &
+RicControlMessage::GetControlActions () const
+{
+  return m_actions;
+}
 
-    if (!f1List || f1List->list.count == 0) {
-        NS_LOG_ERROR("gNB-CU-UE-F1AP-ID list empty!");
-        return 0;
+std::vector<Ptr<RicControlMessage>>
+RicControlMessage::SplitActions () const
+{
+  std::vector<Ptr<RicControlMessage>> parts;
+  parts.reserve (m_actions.size ());
+  m_outcome->unresolved = m_actions.size ();
+  for (size_t i = 0; i < m_actions.size (); i++)
+    {
+      parts.push_back (Create<RicControlMessage> (*this, i));
     }
+  return parts;
+}
 
-    auto *item = f1List->list.array[0];
-    if (!item) {
-        NS_LOG_ERROR("gNB-CU-UE-F1AP-ID item is NULL!");
-        return 0;
+void
+RicControlMessage::Reject (Cause_PR causeGroup, long cause)
+{
+  if (m_outcome->causeGroup == Cause_PR_NOTHING)
+    {
+      m_outcome->causeGroup = causeGroup;
+      m_outcome->cause = cause;
     }
+}
 
-    uint64_t ueId = item->gNB_CU_UE_F1AP_ID;
+bool
+RicControlMessage::IsRejected () const
+{
+  return m_outcome->causeGroup != Cause_PR_NOTHING;
+}
 
-    NS_LOG_DEBUG("Parsed UE-ID = " << ueId);
-    return ueId;
+Cause_PR
+RicControlMessage::GetCauseGroup () const
+{
+  return m_outcome->causeGroup;
 }
 
+long
+RicControlMessage::GetCause () const
+{
+  return m_outcome->cause;
+}
 
+bool
+RicControlMessage::Resolve ()
+{
+  NS_ABORT_MSG_IF (m_outcome->unresolved == 0, "RIC control request already resolved");
+  return --m_outcome->unresolved == 0;
+}
+
+bool
+RicControlMessage::IsLocal () const
+{
+  return m_local;
+}
 
 } // namespace ns3
@@ -33,10 +33,15 @@ extern "C" {
   #include "E2SM-RC-ControlHeader.h"
   #include "E2SM-RC-ControlMessage.h"
   #include "E2SM-RC-ControlHeader-Format1.h"
+  #include "E2SM-RC-ControlHeader-Format2.h"
   #include "E2SM-RC-ControlMessage-Format1.h"
+  #include "E2SM-RC-ControlMessage-Format2.h"
+  #include "E2SM-RC-ControlMessage-Format2-Style-Item.h"
+  #include "E2SM-RC-ControlMessage-Format2-ControlAction-Item.h"
   #include "RICcontrolRequest.h"
   #include "ProtocolIE-Field.h"
   #include "InitiatingMessage.h"
+  #include "Cause.h"
   //#include "CellGlobalID.h"
   //#include "NRCGI.h"
 
@@ -46,44 +51,232 @@ extern "C" {
   #include "UEID-GNB.h"
   #include "UEID-GNB-CU-CP-F1AP-ID-Item.h"
   #include "UEID-GNB-CU-F1AP-ID-List.h"
+  #include "RANParameter-ValueType-Choice-ElementTrue.h"
+  #include "RANParameter-ValueType-Choice-Structure.h"
+  #include "RANParameter-ValueType-Choice-List.h"
+  #include "RANParameter-STRUCTURE.h"
+  #include "RANParameter-STRUCTURE-Item.h"
+  #include "RANParameter-LIST.h"
+  #include "RANParameter-Value.h"
  }
 
+#include <string>
+#include <unordered_map>
+#include <vector>
+
 namespace ns3 {
 
+  /**
+  * RIC Control Request decoded once into an owned, flat record: the UE ID,
+  * the target cell and the values of all the RAN parameters, indexed by
+  * their path. The ASN.1 trees are released by the constructor.
+  * A Control Message Format2 carries several control actions, possibly of
+  * several styles, each decoded into its own record.
+  */
   class RicControlMessage : public SimpleRefCount<RicControlMessage>
   {
   public:
     enum ControlMessageRequestIdType { TS = 1001, QoS = 1002, RC=1024 };
+
+    /**
+    * Value of a RAN parameter of the control message
+    */
+    struct RanParameterValue
+    {
+      enum class Type { BOOLEAN, INTEGER, REAL, BIT_STRING, OCTET_STRING, PRINTABLE_STRING };
+
+      Type m_type = Type::INTEGER;
+      int64_t m_int = 0; //!< value of BOOLEAN and INTEGER parameters
+      double m_real = 0; //!< value of REAL parameters
+      std::string m_bytes; //!< content of the string parameters
+    };
+
+    /**
+    * ID of the top-level RAN parameter that carries, as an INTEGER, the
+    * gNB-CU-UE-F1AP-ID of the UE of a control action, when the actions of
+    * a Control Message Format2 address different UEs. E2SM-RC has no
+    * per-action UE ID: actions without this parameter address the UE of
+    * the control header.
+    */
+    static const uint32_t UE_ID_RAN_PARAMETER_ID = 65535;
+
+    /**
+    * Control action of the request, with its own UE and RAN parameters
+    */
+    struct ControlAction
+    {
+      long m_controlStyle = -1; //!< RIC Style Type
+      long m_controlActionId = -1; //!< RIC Control Action ID
+      uint64_t m_ueId = 0; //!< gNB-CU-UE-F1AP-ID of the UE, 0 if absent
+      uint16_t m_targetCellId = 0; //!< target cell of a handover, 0 if absent
+      std::unordered_map<std::string, RanParameterValue> m_ranParameters; //!< values, by path
+    };
+
     RicControlMessage (E2AP_PDU_t *pdu);
+
+    /**
+    * Build the record of a single action of a request
+    *
+    * \param request the decoded request
+    * \param action the index of the action in request
+    */
+    RicControlMessage (const RicControlMessage &request, size_t action);
+
+    /**
+    * Build a request from its control actions, without an E2AP PDU, e.g.,
+    * for a control emitted by an xApp running in the simulator
+    *
+    * \param ranFunctionId the RAN Function of the request
+    * \param requestId the RIC Request ID of the request
+    * \param actions the control actions, with their style and action ID
+    */
+    RicControlMessage (long ranFunctionId, const RICrequestID_t &requestId,
+                       const std::vector<ControlAction> &actions);
     ~RicControlMessage ();
 
     ControlMessageRequestIdType m_requestType;
     
-    //static std::vector<RANParameterItem> ExtractRANParametersFromControlMessage (E2SM_RC_ControlMessage_Format1_t *e2SmRcControlMessageFormat1);
-   
-
-    
-   // std::vector<RANParameterItem> m_valuesExtracted;
     RANfunctionID_t m_ranFunctionId;
     RICrequestID_t m_ricRequestId;
-    RICcallProcessID_t m_ricCallProcessId;
-    E2SM_RC_ControlHeader_Format1_t *m_e2SmRcControlHeaderFormat1;
-    E2SM_RC_ControlMessage_Format1 *m_e2SmRcControlMessageFormat1;
+    std::string m_ricCallProcessId; //!< content of the RIC Call Process ID, empty if absent
+    long m_ricControlAckRequest = -1; //!< RIC Control Ack Request, -1 if absent
     std::string GetSecondaryCellIdHO ();
  
-      // add 
+    /**
+    * \return the target cell of the first handover control action, 0 if absent
+    */
     uint16_t GetTargetCell() const; 
+
+    /**
+    * \return the gNB-CU-UE-F1AP-ID of the UE of the first control action,
+    *         0 if absent
+    */
     uint64_t GetUeId() const;
 
+    /**
+    * \return the RIC Style Type of the first control action, -1 if absent
+    */
+    long GetControlStyle () const;
+
+    /**
+    * \return the RIC Control Action ID of the first control action, -1 if absent
+    */
+    long GetControlActionId () const;
+
+    /**
+    * Look up a RAN parameter of the first control action by path. The path is made of the RAN
+    * parameter IDs from the top-level parameter down to the element,
+    * separated by dots; the entries of a RAN parameter list are selected
+    * with their index, e.g., "1.2[0].3".
+    *
+    * \param path the path of the RAN parameter
+    * \return the value, nullptr if the message does not have the parameter
+    */
+    const RanParameterValue *FindRanParameter (const std::string &path) const;
+
+    /**
+    * \return the values of all the RAN parameters of the first control action, by path
+    */
+    const std::unordered_map<std::string, RanParameterValue> &GetRanParameters () const;
+
+    /**
+    * \return all the control actions of the request, in order
+    */
+    const std::vector<ControlAction> &GetControlActions () const;
+
+    /**
+    * \return one record per control action, each with the identifiers of
+    *         the request, so that the actions can be dispatched separately
+    */
+    std::vector<Ptr<RicControlMessage>> SplitActions () const;
+
+    /**
+    * Mark the request as failed, e.g., by the handler of the control, so
+    * that a RIC Control Failure is sent in place of the acknowledge. The
+    * records split from the same request share the outcome; the first
+    * cause is kept.
+    *
+    * \param causeGroup the group of the cause
+    * \param cause the cause within its group
+    */
+    void Reject (Cause_PR causeGroup = Cause_PR_misc, long cause = CauseMisc_unspecified);
+
+    bool IsRejected () const;
+    Cause_PR GetCauseGroup () const;
+    long GetCause () const;
+
+    /**
+    * Mark the action of this record as applied, or dropped.
+    *
+    * \return true if all the actions of the request have been resolved,
+    *         so that the outcome of the request is final
+    */
+    bool Resolve ();
+
+    /**
+    * \return true if the request was built in the simulator rather than
+    *         received from the RIC, so that no response is sent for it
+    */
+    bool IsLocal () const;
+
   private:
+    /**
+    * Outcome of a request, shared by the records of its actions
+    */
+    struct Outcome : public SimpleRefCount<Outcome>
+    {
+      uint32_t unresolved = 1; //!< actions not applied nor dropped yet
+      Cause_PR causeGroup = Cause_PR_NOTHING; //!< Cause_PR_NOTHING unless rejected
+      long cause = 0;
+    };
+
     /**
     * Decodes the RIC Control message .
     *
     * \param pdu PDU passed by the RIC
     */
     void DecodeRicControlMessage (E2AP_PDU_t *pdu);
+
+    void DecodeControlHeader (const RICcontrolHeader_t &controlHeader);
+    void DecodeControlMessage (const RICcontrolMessage_t &controlMessage);
+
+    /**
+    * Set the style, action ID and UE of the actions from the header, once
+    * all the IEs have been decoded
+    */
+    void CompleteActions ();
+
+    static void FlattenRanParameterList (const E2SM_RC_ControlMessage_Format1_t *format1,
+                                         ControlAction &action);
+
+    /**
+    * Add the values of a RAN parameter, and of the nested ones, to the index
+    *
+    * \param path the path of the parameter
+    * \param valueType the value of the parameter
+    * \param depth the nesting level of the parameter, 0 at the top
+    * \param firstChain true if the parameter and its ancestors are the first of their level
+    * \param action the action the parameter belongs to
+    */
+    static void FlattenRanParameter (const std::string &path,
+                                     const RANParameter_ValueType_t *valueType, uint32_t depth,
+                                     bool firstChain, ControlAction &action);
+    static void FlattenRanParameterStructure (const std::string &path,
+                                              const RANParameter_STRUCTURE_t *structure,
+                                              uint32_t depth, bool firstChain,
+                                              ControlAction &action);
+    static void AddRanParameterValue (const std::string &path, const RANParameter_Value_t *value,
+                                      uint32_t depth, bool firstChain, ControlAction &action);
+    static void StoreRanParameterValue (const std::string &path, const RanParameterValue &flat,
+                                        uint32_t depth, bool firstChain, ControlAction &action);
+
     std::string m_secondaryCellId;
-    uint16_t m_targetCellId = 2; 
+    uint64_t m_ueId = 0; //!< UE of the control header
+    long m_controlStyle = -1; //!< RIC Style Type of a control header Format1
+    long m_controlActionId = -1; //!< RIC Control Action ID of a control header Format1
+    std::vector<ControlAction> m_actions; //!< decoded control actions
+    Ptr<Outcome> m_outcome; //!< outcome of the request
+    bool m_local = false; //!< true if built from its actions, without a PDU
   };
 }
 
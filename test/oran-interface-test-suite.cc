@@ -24,10 +24,51 @@
 
 // Include a header file from your module to test.
 #include "ns3/oran-interface.h"
+#include "ns3/kpm-indication.h"
+#include "ns3/kpm-arena.h"
+#include "ns3/kpm-metric-registry.h"
+#include "ns3/e2-report-scheduler.h"
+#include "ns3/e2-receive-queue.h"
+#include "ns3/e2-send-queue.h"
+#include "ns3/rc-handover-decoder.h"
+#include "ns3/asn-struct-pool.h"
+#include "ns3/control-coalescer.h"
+#include "ns3/control-response-encoder.h"
+#include "ns3/rc-policy.h"
+#include "ns3/embedded-ric.h"
+#include "ns3/indication-encoder.h"
+#include "ns3/kpm-encoder-service.h"
+#include "ns3/kpm-meas-data-encoder.h"
+#include "ns3/nr-indication-message-helper.h"
+#include "ns3/e2-termination-manager.h"
+#include "ns3/ric-control-function-description.h"
+#include "ns3/uinteger.h"
+#include "ns3/boolean.h"
+#include "ns3/double.h"
+#include "ns3/simulator.h"
 
 // An essential include is test.h
 #include "ns3/test.h"
 
+#include <chrono>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern "C" {
+  #include "E2SM-RC-ActionDefinition.h"
+  #include "E2SM-RC-ActionDefinition-Format2.h"
+  #include "E2SM-RC-ActionDefinition-Format2-Item.h"
+  #include "RIC-PolicyAction.h"
+  #include "RIC-PolicyAction-RANParameter-Item.h"
+  #include "ProcedureCode.h"
+}
+
 // Do not put your test classes in namespace ns3.  You may find it useful
 // to use the using directive to access the ns3 namespace directly
 using namespace ns3;
@@ -68,6 +109,2938 @@ OranInterfaceTestCase1::DoRun (void)
   NS_TEST_ASSERT_MSG_EQ_TOL (0.01, 0.01, 0.001, "Numbers are not equal within tolerance");
 }
 
+/**
+ * Check that the KPM indication headers produced from the cached template
+ * are byte-identical to the ones encoded by asn1c
+ */
+class KpmIndicationHeaderTemplateTestCase : public TestCase
+{
+public:
+  KpmIndicationHeaderTemplateTestCase ();
+  virtual ~KpmIndicationHeaderTemplateTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+KpmIndicationHeaderTemplateTestCase::KpmIndicationHeaderTemplateTestCase ()
+  : TestCase ("KPM indication header template matches the asn1c encoding")
+{
+}
+
+KpmIndicationHeaderTemplateTestCase::~KpmIndicationHeaderTemplateTestCase ()
+{
+}
+
+void
+KpmIndicationHeaderTemplateTestCase::DoRun (void)
+{
+  KpmIndicationHeader::GlobalE2nodeType nodeTypes[] = {
+      KpmIndicationHeader::GlobalE2nodeType::gNB, KpmIndicationHeader::GlobalE2nodeType::eNB,
+      KpmIndicationHeader::GlobalE2nodeType::ng_eNB, KpmIndicationHeader::GlobalE2nodeType::en_gNB};
+  // seconds in the encoded header: 0, 1, a byte pattern and the maximum
+  uint64_t timestamps[] = {1000000ULL, 1630068679000000ULL, 0x12345678ULL * 1000000ULL,
+                           0xFFFFFFFFULL * 1000000ULL, 42ULL};
+
+  for (auto nodeType : nodeTypes)
+    {
+      for (uint16_t cellId : {1, 1111})
+        {
+          for (uint64_t timestamp : timestamps)
+            {
+              KpmIndicationHeader::KpmRicIndicationHeaderValues values;
+              values.m_plmId = "111";
+              values.m_gnbId = "1";
+              values.m_nrCellId = cellId;
+              values.m_timestamp = timestamp;
+
+              // the first headers of a key build the template, the others reuse it
+              for (int round = 0; round < 2; round++)
+                {
+                  Ptr<KpmIndicationHeader> generic =
+                      Create<KpmIndicationHeader> (nodeType, values, false);
+                  Ptr<KpmIndicationHeader> patched =
+                      Create<KpmIndicationHeader> (nodeType, values, true);
+
+                  NS_TEST_ASSERT_MSG_EQ (patched->m_size, generic->m_size,
+                                         "Header sizes differ for timestamp " << timestamp);
+                  NS_TEST_ASSERT_MSG_EQ (
+                      memcmp (patched->m_buffer, generic->m_buffer, generic->m_size), 0,
+                      "Header bytes differ for timestamp " << timestamp);
+                }
+            }
+        }
+    }
+}
+
+/**
+ * List with the layout of the asn1c A_SEQUENCE_OF lists
+ */
+struct ArenaTestList
+{
+  long **array;
+  int count;
+  int size;
+};
+
+/**
+ * Check that the arena hands out zeroed memory, reuses its blocks after a
+ * reset, and that the lists presized in it refuse the items in excess
+ */
+class KpmArenaTestCase : public TestCase
+{
+public:
+  KpmArenaTestCase ();
+  virtual ~KpmArenaTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+KpmArenaTestCase::KpmArenaTestCase ()
+  : TestCase ("KPM arena reuses its blocks and bounds the presized lists")
+{
+}
+
+KpmArenaTestCase::~KpmArenaTestCase ()
+{
+}
+
+void
+KpmArenaTestCase::DoRun (void)
+{
+  KpmArena arena (1024);
+  uint8_t *first = static_cast<uint8_t *> (arena.Allocate (100));
+  memset (first, 0xff, 100);
+  // larger than a block, served by a block of its own
+  uint8_t *large = static_cast<uint8_t *> (arena.Allocate (2000));
+  memset (large, 0xff, 2000);
+  size_t reserved = arena.GetReservedBytes ();
+  NS_TEST_ASSERT_MSG_GT_OR_EQ (reserved, 1024 + 2000, "Blocks smaller than the allocations");
+  NS_TEST_ASSERT_MSG_GT_OR_EQ (arena.GetUsedBytes (), 2100, "Allocations not accounted");
+
+  arena.Reset ();
+  NS_TEST_EXPECT_MSG_EQ (arena.GetUsedBytes (), 0, "Used bytes not reset");
+  uint8_t *again = static_cast<uint8_t *> (arena.Allocate (100));
+  NS_TEST_EXPECT_MSG_EQ ((void *) again, (void *) first, "First block not reused");
+  NS_TEST_EXPECT_MSG_EQ ((void *) arena.Allocate (2000), (void *) large,
+                         "Large block not reused");
+  NS_TEST_EXPECT_MSG_EQ (arena.GetReservedBytes (), reserved, "Blocks requested after a reset");
+  bool zeroed = true;
+  for (int i = 0; i < 100; i++)
+    {
+      zeroed = zeroed && again[i] == 0;
+    }
+  NS_TEST_EXPECT_MSG_EQ (zeroed, true, "Reused memory not zeroed");
+
+  ArenaTestList list;
+  arena.PresizeList (&list, 3);
+  NS_TEST_ASSERT_MSG_EQ (list.size, 3, "Wrong list size");
+  NS_TEST_ASSERT_MSG_EQ (list.count, 0, "Presized list not empty");
+  long *items = arena.NewArray<long> (3);
+  for (int i = 0; i < 3; i++)
+    {
+      items[i] = i;
+      KpmArena::ListAdd (&list, &items[i]);
+    }
+  NS_TEST_ASSERT_MSG_EQ (list.count, 3, "Items not added");
+  for (int i = 0; i < 3; i++)
+    {
+      NS_TEST_EXPECT_MSG_EQ (*list.array[i], i, "Items out of order");
+    }
+
+  // the item in excess aborts, checked in a child process
+  fflush (nullptr);
+  pid_t child = fork ();
+  NS_TEST_ASSERT_MSG_NE (child, -1, "Cannot fork");
+  if (child == 0)
+    {
+      close (STDERR_FILENO);
+      long extra = 3;
+      KpmArena::ListAdd (&list, &extra);
+      _exit (0);
+    }
+  int status = 0;
+  waitpid (child, &status, 0);
+  NS_TEST_EXPECT_MSG_EQ (WIFSIGNALED (status) && WTERMSIG (status) == SIGABRT, true,
+                         "Item added beyond the presized size");
+}
+
+/**
+ * Check that the report scheduler collects once per tick of each reporting
+ * period and sends one indication per subscription and tick
+ */
+class E2ReportSchedulerTestCase : public TestCase
+{
+public:
+  E2ReportSchedulerTestCase ();
+  virtual ~E2ReportSchedulerTestCase ();
+
+private:
+  virtual void DoRun (void);
+
+  void Collect (Time period);
+  std::vector<E2ReportScheduler::Report>
+  BuildReports (const E2ReportScheduler::Subscription &subscription);
+  void Send (E2AP_PDU_t *pdu);
+  void Step (uint32_t reports);
+
+  std::map<int64_t, uint32_t> m_collects; //!< collections, by period in ms
+  uint32_t m_sent; //!< indications sent
+  uint32_t m_steps; //!< ticks that sent indications
+  uint32_t m_stepReports; //!< indications counted by the step callback
+};
+
+E2ReportSchedulerTestCase::E2ReportSchedulerTestCase ()
+  : TestCase ("E2 report scheduler shares the ticks of the same reporting period"),
+    m_sent (0),
+    m_steps (0),
+    m_stepReports (0)
+{
+}
+
+E2ReportSchedulerTestCase::~E2ReportSchedulerTestCase ()
+{
+}
+
+void
+E2ReportSchedulerTestCase::Collect (Time period)
+{
+  NS_TEST_ASSERT_MSG_EQ (Simulator::Now ().GetTimeStep () % period.GetTimeStep (), 0,
+                         "Tick not aligned to the reporting period");
+  m_collects[period.GetMilliSeconds ()]++;
+}
+
+std::vector<E2ReportScheduler::Report>
+E2ReportSchedulerTestCase::BuildReports (const E2ReportScheduler::Subscription &subscription)
+{
+  KpmIndicationHeader::KpmRicIndicationHeaderValues headerValues;
+  headerValues.m_plmId = "111";
+  headerValues.m_gnbId = "1";
+  headerValues.m_nrCellId = 1;
+
+  KpmIndicationMessage::KpmIndicationMessageValues msgValues;
+  msgValues.m_cellTable =
+      Create<KpiTable> (KpmMetricRegistry::Get ().GetSchema (KpmMetricRegistry::CELL_LTE));
+  msgValues.m_cellTable->AppendRow ("1").Put (1).Put (0.5).Put (100).Put (200).Put (2);
+  msgValues.m_granularityPeriod = subscription.granularityPeriod;
+
+  E2ReportScheduler::Report report;
+  report.header =
+      Create<KpmIndicationHeader> (KpmIndicationHeader::GlobalE2nodeType::eNB, headerValues);
+  report.message = Create<KpmIndicationMessage> (msgValues, E2SM_KPM_INDICATION_MESSAGE_FORMART1);
+  return {report};
+}
+
+void
+E2ReportSchedulerTestCase::Send (E2AP_PDU_t *pdu)
+{
+  m_sent++;
+  ASN_STRUCT_FREE (asn_DEF_E2AP_PDU, pdu);
+}
+
+void
+E2ReportSchedulerTestCase::Step (uint32_t reports)
+{
+  m_steps++;
+  m_stepReports += reports;
+}
+
+void
+E2ReportSchedulerTestCase::DoRun (void)
+{
+  Ptr<E2ReportScheduler> scheduler = CreateObject<E2ReportScheduler> ();
+  scheduler->SetCollectCallback (MakeCallback (&E2ReportSchedulerTestCase::Collect, this));
+  scheduler->SetReportCallback (MakeCallback (&E2ReportSchedulerTestCase::BuildReports, this));
+  scheduler->SetSendCallback (MakeCallback (&E2ReportSchedulerTestCase::Send, this));
+  scheduler->SetStepCallback (MakeCallback (&E2ReportSchedulerTestCase::Step, this));
+
+  E2ReportScheduler::Subscription subscription {};
+  subscription.ranFuncionId = 200;
+  for (uint16_t instanceId : {1, 2, 3})
+    {
+      subscription.requestorId = 1;
+      subscription.instanceId = instanceId;
+      subscription.reportingPeriod = instanceId == 3 ? 200 : 100;
+      scheduler->AddSubscription (subscription);
+    }
+  // a subscription with the same RIC Request ID replaces the previous one
+  subscription.instanceId = 2;
+  scheduler->AddSubscription (subscription);
+
+  Simulator::Stop (MilliSeconds (1050));
+  Simulator::Run ();
+
+  NS_TEST_ASSERT_MSG_EQ (scheduler->GetSubscriptionCount (), 3, "Wrong number of subscriptions");
+  NS_TEST_ASSERT_MSG_EQ (m_collects[100], 10, "One collection per tick of the 100 ms period");
+  NS_TEST_ASSERT_MSG_EQ (m_collects[200], 5, "One collection per tick of the 200 ms period");
+  NS_TEST_ASSERT_MSG_EQ (m_sent, 10 + 5 + 5, "One indication per subscription and tick");
+  NS_TEST_ASSERT_MSG_EQ (m_steps, 10 + 5, "One step per tick of each period");
+  NS_TEST_ASSERT_MSG_EQ (m_stepReports, m_sent, "Step callback with the wrong report count");
+
+  scheduler->Dispose ();
+  Simulator::Destroy ();
+}
+
+/**
+ * Check that the receive queue delivers the items of concurrent producers
+ * exactly once and in the order of each producer
+ */
+class E2ReceiveQueueTestCase : public TestCase
+{
+public:
+  E2ReceiveQueueTestCase ();
+  virtual ~E2ReceiveQueueTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+E2ReceiveQueueTestCase::E2ReceiveQueueTestCase ()
+  : TestCase ("E2 receive queue keeps the order of each producer")
+{
+}
+
+E2ReceiveQueueTestCase::~E2ReceiveQueueTestCase ()
+{
+}
+
+void
+E2ReceiveQueueTestCase::DoRun (void)
+{
+  const uint32_t producers = 4;
+  const uint32_t itemsPerProducer = 10000;
+  E2ReceiveQueue queue;
+
+  std::vector<std::thread> threads;
+  for (uint32_t p = 0; p < producers; p++)
+    {
+      threads.emplace_back ([&queue, p, itemsPerProducer] {
+        for (uint32_t i = 0; i < itemsPerProducer; i++)
+          {
+            // the handler field carries the producer and the sequence number
+            E2ReceiveQueue::Item item;
+            item.handler = p * itemsPerProducer + i;
+            item.enqueueTime = std::chrono::steady_clock::now ();
+            queue.Push (std::move (item));
+          }
+      });
+    }
+
+  std::vector<int64_t> last (producers, -1);
+  uint32_t received = 0;
+  bool ordered = true;
+  while (received < producers * itemsPerProducer)
+    {
+      E2ReceiveQueue::Item item;
+      if (queue.Pop (item))
+        {
+          uint32_t p = item.handler / itemsPerProducer;
+          int64_t i = item.handler % itemsPerProducer;
+          ordered = ordered && (i == last[p] + 1);
+          last[p] = i;
+          received++;
+        }
+    }
+  for (std::thread &thread : threads)
+    {
+      thread.join ();
+    }
+
+  E2ReceiveQueue::Item item;
+  NS_TEST_ASSERT_MSG_EQ (ordered, true, "Items of a producer out of order");
+  NS_TEST_ASSERT_MSG_EQ (queue.Pop (item), false, "Items left in the queue");
+}
+
+/**
+ * Check that the send queue keeps the order of the PDUs and encodings
+ * handed over, and leaves the messages refused after closing to the caller
+ */
+class E2SendQueueTestCase : public TestCase
+{
+public:
+  E2SendQueueTestCase ();
+  virtual ~E2SendQueueTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+E2SendQueueTestCase::E2SendQueueTestCase ()
+  : TestCase ("E2 send queue carries PDUs and encodings in order")
+{
+}
+
+E2SendQueueTestCase::~E2SendQueueTestCase ()
+{
+}
+
+void
+E2SendQueueTestCase::DoRun (void)
+{
+  E2SendQueue queue (8);
+  KpmEncodeBuffer &buffer = KpmEncodeBuffer::GetThreadBuffer ();
+  // the message i carries the byte i, except the second one, a PDU
+  auto newMessage = [&buffer] (uint8_t i) {
+    E2SendQueue::Message message;
+    if (i == 1)
+      {
+        message.pdu.reset (AsnStructPool::GetE2apPduPool ().Acquire<E2AP_PDU_t> ());
+        return message;
+      }
+    message.encoded = buffer.Acquire (1, 0);
+    message.encoded.GetData ()[0] = i;
+    buffer.Commit (message.encoded, 1, 0);
+    return message;
+  };
+
+  for (uint8_t i = 0; i < 3; i++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (queue.Push (newMessage (i)), true, "Message refused");
+    }
+  std::vector<E2SendQueue::Message> batch;
+  batch.push_back (newMessage (3));
+  batch.push_back (newMessage (4));
+  NS_TEST_ASSERT_MSG_EQ (queue.PushBatch (std::move (batch)), true, "Batch refused");
+  NS_TEST_EXPECT_MSG_EQ (batch.empty (), true, "Batch not moved into the queue");
+
+  std::vector<E2SendQueue::Message> out;
+  NS_TEST_ASSERT_MSG_EQ (queue.TryPop (out), 5, "Wrong number of messages");
+  for (uint8_t i = 0; i < 5; i++)
+    {
+      if (i == 1)
+        {
+          NS_TEST_EXPECT_MSG_NE (out[i].pdu == nullptr, true, "PDU lost");
+          continue;
+        }
+      NS_TEST_EXPECT_MSG_EQ (out[i].pdu == nullptr, true, "Encoded message with a PDU");
+      NS_TEST_ASSERT_MSG_EQ (out[i].encoded.GetSpan ().size, 1, "Encoding lost");
+      NS_TEST_EXPECT_MSG_EQ (+out[i].encoded.GetSpan ().data[0], +i, "Message out of order");
+    }
+  NS_TEST_EXPECT_MSG_EQ (queue.GetPushedCount (), 5, "Wrong number of messages pushed");
+  NS_TEST_EXPECT_MSG_EQ (queue.GetSentCount (), 0, "Messages sent before MarkSent");
+  queue.MarkSent (out.size ());
+  queue.WaitUntilDrained ();
+  NS_TEST_EXPECT_MSG_EQ (queue.GetSentCount (), 5, "Wrong number of messages sent");
+
+  queue.Close ();
+  E2SendQueue::Message late = newMessage (1);
+  NS_TEST_EXPECT_MSG_EQ (queue.Push (std::move (late)), false, "Message accepted once closed");
+  NS_TEST_EXPECT_MSG_NE (late.pdu == nullptr, true, "Refused message taken by the queue");
+}
+
+/**
+ * Fill a gNB UE ID with its gNB-CU-UE-F1AP-ID
+ */
+static void
+FillGnbUeId (UEID_t *ueId, uint32_t f1apId, bool withRanUeId)
+{
+  auto *ue = (UEID_GNB_t *) calloc (1, sizeof (UEID_GNB_t));
+  ueId->present = UEID_PR_gNB_UEID;
+  ueId->choice.gNB_UEID = ue;
+  asn_ulong2INTEGER (&ue->amf_UE_NGAP_ID, 0x123456789aUL);
+  const uint8_t plmn[3] = {0x00, 0xf1, 0x10};
+  OCTET_STRING_fromBuf (&ue->guami.pLMNIdentity, (const char *) plmn, sizeof (plmn));
+  BIT_STRING_t *amfIds[3] = {&ue->guami.aMFRegionID, &ue->guami.aMFSetID, &ue->guami.aMFPointer};
+  const int amfIdBits[3] = {8, 10, 6};
+  for (int i = 0; i < 3; i++)
+    {
+      amfIds[i]->size = (amfIdBits[i] + 7) / 8;
+      amfIds[i]->buf = (uint8_t *) calloc (amfIds[i]->size, 1);
+      amfIds[i]->buf[0] = 0xa5;
+      amfIds[i]->bits_unused = amfIds[i]->size * 8 - amfIdBits[i];
+    }
+
+  ue->gNB_CU_UE_F1AP_ID_List =
+      (UEID_GNB_CU_F1AP_ID_List_t *) calloc (1, sizeof (UEID_GNB_CU_F1AP_ID_List_t));
+  auto *item = (UEID_GNB_CU_CP_F1AP_ID_Item_t *) calloc (1, sizeof (UEID_GNB_CU_CP_F1AP_ID_Item_t));
+  item->gNB_CU_UE_F1AP_ID = f1apId;
+  ASN_SEQUENCE_ADD (&ue->gNB_CU_UE_F1AP_ID_List->list, item);
+  if (withRanUeId)
+    {
+      ue->ran_UEID = (RANUEID_t *) calloc (1, sizeof (RANUEID_t));
+      OCTET_STRING_fromBuf (ue->ran_UEID, "ranueid1", 8);
+    }
+}
+
+/**
+ * \return the APER encoding of a RIC Control Header
+ */
+static std::vector<uint8_t>
+EncodeControlHeader (E2SM_RC_ControlHeader_t *header)
+{
+  asn_encode_to_new_buffer_result_t res = asn_encode_to_new_buffer (
+      nullptr, ATS_ALIGNED_BASIC_PER, &asn_DEF_E2SM_RC_ControlHeader, header);
+  std::vector<uint8_t> encoded;
+  if (res.buffer)
+    {
+      encoded.assign ((uint8_t *) res.buffer, (uint8_t *) res.buffer + res.result.encoded);
+      free (res.buffer);
+    }
+  ASN_STRUCT_FREE (asn_DEF_E2SM_RC_ControlHeader, header);
+  return encoded;
+}
+
+/**
+ * Encode a RIC Control Header Format1 addressing a UE by its gNB-CU-UE-F1AP-ID
+ */
+static std::vector<uint8_t>
+EncodeControlHeader (uint32_t f1apId, long style, long actionId, bool withRanUeId)
+{
+  auto *header = (E2SM_RC_ControlHeader_t *) calloc (1, sizeof (E2SM_RC_ControlHeader_t));
+  auto *format1 =
+      (E2SM_RC_ControlHeader_Format1_t *) calloc (1, sizeof (E2SM_RC_ControlHeader_Format1_t));
+  header->ric_controlHeader_formats.present =
+      E2SM_RC_ControlHeader__ric_controlHeader_formats_PR_controlHeader_Format1;
+  header->ric_controlHeader_formats.choice.controlHeader_Format1 = format1;
+  format1->ric_Style_Type = style;
+  format1->ric_ControlAction_ID = actionId;
+  FillGnbUeId (&format1->ueID, f1apId, withRanUeId);
+  return EncodeControlHeader (header);
+}
+
+/**
+ * Encode a RIC Control Header Format2, for a multi-action control message
+ */
+static std::vector<uint8_t>
+EncodeControlHeaderFormat2 (uint32_t f1apId)
+{
+  auto *header = (E2SM_RC_ControlHeader_t *) calloc (1, sizeof (E2SM_RC_ControlHeader_t));
+  auto *format2 =
+      (E2SM_RC_ControlHeader_Format2_t *) calloc (1, sizeof (E2SM_RC_ControlHeader_Format2_t));
+  header->ric_controlHeader_formats.present =
+      E2SM_RC_ControlHeader__ric_controlHeader_formats_PR_controlHeader_Format2;
+  header->ric_controlHeader_formats.choice.controlHeader_Format2 = format2;
+  format2->ueID = (UEID_t *) calloc (1, sizeof (UEID_t));
+  FillGnbUeId (format2->ueID, f1apId, false);
+  return EncodeControlHeader (header);
+}
+
+/**
+ * \return a RAN parameter value type made of a structure with a single item
+ */
+static RANParameter_ValueType_t *
+NewStructureValue (long id, RANParameter_ValueType_t *child)
+{
+  auto *item = (RANParameter_STRUCTURE_Item_t *) calloc (1, sizeof (RANParameter_STRUCTURE_Item_t));
+  item->ranParameter_ID = id;
+  item->ranParameter_valueType = child;
+  auto *structure = (RANParameter_STRUCTURE_t *) calloc (1, sizeof (RANParameter_STRUCTURE_t));
+  structure->sequence_of_ranParameters = (decltype (structure->sequence_of_ranParameters)) calloc (
+      1, sizeof (*structure->sequence_of_ranParameters));
+  ASN_SEQUENCE_ADD (&structure->sequence_of_ranParameters->list, item);
+
+  auto *valueType = (RANParameter_ValueType_t *) calloc (1, sizeof (RANParameter_ValueType_t));
+  valueType->present = RANParameter_ValueType_PR_ranP_Choice_Structure;
+  valueType->choice.ranP_Choice_Structure = (RANParameter_ValueType_Choice_Structure_t *) calloc (
+      1, sizeof (RANParameter_ValueType_Choice_Structure_t));
+  valueType->choice.ranP_Choice_Structure->ranParameter_Structure = structure;
+  return valueType;
+}
+
+/**
+ * Value of the leaf RAN parameter of a test control message
+ */
+struct RanParameterLeaf
+{
+  RANParameter_Value_PR type;
+  long intValue;
+  std::vector<uint8_t> bytes;
+  int bitsUnused;
+};
+
+/**
+ * Add a top-level parameter to a RAN parameter list, made of a chain of
+ * single-item structures down to the leaf value
+ */
+static void
+AddRanParameter (E2SM_RC_ControlMessage_Format1_t *format1, const std::vector<long> &path,
+                 const RanParameterLeaf &leaf)
+{
+  auto *value = (RANParameter_Value_t *) calloc (1, sizeof (RANParameter_Value_t));
+  value->present = leaf.type;
+  if (leaf.type == RANParameter_Value_PR_valueInt)
+    {
+      value->choice.valueInt = leaf.intValue;
+    }
+  else if (leaf.type == RANParameter_Value_PR_valueBitS)
+    {
+      value->choice.valueBitS.buf = (uint8_t *) calloc (leaf.bytes.size (), 1);
+      memcpy (value->choice.valueBitS.buf, leaf.bytes.data (), leaf.bytes.size ());
+      value->choice.valueBitS.size = leaf.bytes.size ();
+      value->choice.valueBitS.bits_unused = leaf.bitsUnused;
+    }
+  else
+    {
+      OCTET_STRING_fromBuf (&value->choice.valueOctS, (const char *) leaf.bytes.data (),
+                            leaf.bytes.size ());
+    }
+  auto *valueType = (RANParameter_ValueType_t *) calloc (1, sizeof (RANParameter_ValueType_t));
+  valueType->present = RANParameter_ValueType_PR_ranP_Choice_ElementFalse;
+  valueType->choice.ranP_Choice_ElementFalse =
+      (RANParameter_ValueType_Choice_ElementFalse_t *) calloc (
+          1, sizeof (RANParameter_ValueType_Choice_ElementFalse_t));
+  valueType->choice.ranP_Choice_ElementFalse->ranParameter_value = value;
+  for (size_t level = path.size () - 1; level > 0; level--)
+    {
+      valueType = NewStructureValue (path[level], valueType);
+    }
+
+  auto *item = (E2SM_RC_ControlMessage_Format1_Item_t *) calloc (
+      1, sizeof (E2SM_RC_ControlMessage_Format1_Item_t));
+  item->ranParameter_ID = path[0];
+  item->ranParameter_valueType = *valueType;
+  free (valueType);
+  ASN_SEQUENCE_ADD (&format1->ranP_List.list, item);
+}
+
+/**
+ * \return the APER encoding of a RIC Control Message
+ */
+static std::vector<uint8_t>
+EncodeControlMessage (E2SM_RC_ControlMessage_t *message)
+{
+  asn_encode_to_new_buffer_result_t res = asn_encode_to_new_buffer (
+      nullptr, ATS_ALIGNED_BASIC_PER, &asn_DEF_E2SM_RC_ControlMessage, message);
+  std::vector<uint8_t> encoded;
+  if (res.buffer)
+    {
+      encoded.assign ((uint8_t *) res.buffer, (uint8_t *) res.buffer + res.result.encoded);
+      free (res.buffer);
+    }
+  ASN_STRUCT_FREE (asn_DEF_E2SM_RC_ControlMessage, message);
+  return encoded;
+}
+
+/**
+ * Encode a RIC Control Message Format1 with the top-level parameters given,
+ * each one a chain of single-item structures down to the leaf value
+ */
+static std::vector<uint8_t>
+EncodeControlMessage (const std::vector<std::vector<long>> &paths, const RanParameterLeaf &leaf)
+{
+  auto *message = (E2SM_RC_ControlMessage_t *) calloc (1, sizeof (E2SM_RC_ControlMessage_t));
+  auto *format1 =
+      (E2SM_RC_ControlMessage_Format1_t *) calloc (1, sizeof (E2SM_RC_ControlMessage_Format1_t));
+  message->ric_controlMessage_formats.present =
+      E2SM_RC_ControlMessage__ric_controlMessage_formats_PR_controlMessage_Format1;
+  message->ric_controlMessage_formats.choice.controlMessage_Format1 = format1;
+  for (const std::vector<long> &path : paths)
+    {
+      AddRanParameter (format1, path, leaf);
+    }
+  return EncodeControlMessage (message);
+}
+
+/**
+ * Build a RIC Control Request of the RC RAN function
+ *
+ * \param header the encoded control header
+ * \param message the encoded control message
+ * \return the request, to be released with ASN_STRUCT_FREE
+ */
+static E2AP_PDU_t *
+NewControlRequest (const std::vector<uint8_t> &header, const std::vector<uint8_t> &message)
+{
+  auto *pdu = (E2AP_PDU_t *) calloc (1, sizeof (E2AP_PDU_t));
+  pdu->present = E2AP_PDU_PR_initiatingMessage;
+  pdu->choice.initiatingMessage = (InitiatingMessage_t *) calloc (1, sizeof (InitiatingMessage_t));
+  InitiatingMessage_t *initiating = pdu->choice.initiatingMessage;
+  initiating->procedureCode = ProcedureCode_id_RICcontrol;
+  initiating->criticality = Criticality_reject;
+  initiating->value.present = InitiatingMessage__value_PR_RICcontrolRequest;
+  RICcontrolRequest_t *request = &initiating->value.choice.RICcontrolRequest;
+
+  auto addIe = [request] (ProtocolIE_ID_t id, RICcontrolRequest_IEs__value_PR present) {
+    auto *ie = (RICcontrolRequest_IEs_t *) calloc (1, sizeof (RICcontrolRequest_IEs_t));
+    ie->id = id;
+    ie->criticality = Criticality_reject;
+    ie->value.present = present;
+    ASN_SEQUENCE_ADD (&request->protocolIEs.list, ie);
+    return ie;
+  };
+  RICcontrolRequest_IEs_t *ie =
+      addIe (ProtocolIE_ID_id_RICrequestID, RICcontrolRequest_IEs__value_PR_RICrequestID);
+  ie->value.choice.RICrequestID.ricRequestorID = 1024;
+  ie->value.choice.RICrequestID.ricInstanceID = 1;
+  ie = addIe (ProtocolIE_ID_id_RANfunctionID, RICcontrolRequest_IEs__value_PR_RANfunctionID);
+  ie->value.choice.RANfunctionID = 300;
+  ie = addIe (ProtocolIE_ID_id_RICcontrolHeader, RICcontrolRequest_IEs__value_PR_RICcontrolHeader);
+  OCTET_STRING_fromBuf (&ie->value.choice.RICcontrolHeader, (const char *) header.data (),
+                        header.size ());
+  ie = addIe (ProtocolIE_ID_id_RICcontrolMessage,
+              RICcontrolRequest_IEs__value_PR_RICcontrolMessage);
+  OCTET_STRING_fromBuf (&ie->value.choice.RICcontrolMessage, (const char *) message.data (),
+                        message.size ());
+  return pdu;
+}
+
+/**
+ * Check that the sender and receive pools of the termination manager are
+ * sized on their attributes and the terminations, that the messages of each
+ * termination are sent on its own connection, in order, and all before Stop
+ * returns, and that the messages received on each connection are dispatched
+ * to the handler of their termination
+ */
+class E2TerminationManagerTestCase : public TestCase
+{
+public:
+  E2TerminationManagerTestCase ();
+  virtual ~E2TerminationManagerTestCase ();
+
+private:
+  virtual void DoRun (void);
+
+  /**
+  * Send a RIC Indication through a termination and record its encoding
+  */
+  void Send (Ptr<E2Termination> termination, long requestorId, long sequenceNumber);
+  void Receive (E2Termination *termination, E2AP_PDU_t *pdu);
+
+  std::map<std::string, std::pair<long, long>> m_expected; //!< requestor and SN, by encoding
+  std::mutex m_receivedMutex; //!< guards m_received, written in the receive threads
+  std::vector<E2Termination *> m_received; //!< terminations of the messages dispatched
+};
+
+E2TerminationManagerTestCase::E2TerminationManagerTestCase ()
+  : TestCase ("E2 termination manager sends and receives the messages of each termination")
+{
+}
+
+E2TerminationManagerTestCase::~E2TerminationManagerTestCase ()
+{
+}
+
+void
+E2TerminationManagerTestCase::Send (Ptr<E2Termination> termination, long requestorId,
+                                    long sequenceNumber)
+{
+  uint8_t header[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+  uint8_t message[32] = {};
+  E2AP_PDU_t *pdu = IndicationEncoder::BuildIndication (
+      requestorId, 1, 2, 1, sequenceNumber, header, sizeof (header), message, sizeof (message));
+  asn_encode_to_new_buffer_result_t res =
+      asn_encode_to_new_buffer (nullptr, ATS_ALIGNED_BASIC_PER, &asn_DEF_E2AP_PDU, pdu);
+  m_expected[std::string ((char *) res.buffer, res.result.encoded)] =
+      std::make_pair (requestorId, sequenceNumber);
+  free (res.buffer);
+  termination->SendE2Message (pdu);
+  ASN_STRUCT_FREE (asn_DEF_E2AP_PDU, pdu);
+}
+
+void
+E2TerminationManagerTestCase::Receive (E2Termination *termination, E2AP_PDU_t *pdu)
+{
+  std::unique_lock<std::mutex> lock (m_receivedMutex);
+  m_received.push_back (termination);
+}
+
+void
+E2TerminationManagerTestCase::DoRun (void)
+{
+  Ptr<E2TerminationManager> manager = CreateObject<E2TerminationManager> ();
+  manager->SetAttribute ("SenderThreads", UintegerValue (2));
+  manager->SetAttribute ("ReceiveThreads", UintegerValue (2));
+  const long terminationCount = 3;
+  const long messageCount = 20;
+  std::vector<Ptr<E2Termination>> terminations;
+  std::vector<int> rics; // RIC end of the connection of each termination
+  for (long t = 0; t < terminationCount; t++)
+    {
+      int sockets[2];
+      NS_TEST_ASSERT_MSG_EQ (socketpair (AF_UNIX, SOCK_SEQPACKET, 0, sockets), 0,
+                             "Cannot create the socket pair");
+      Ptr<E2Termination> termination = CreateObject<E2Termination> (
+          "127.0.0.1", 36422, 38472 + t, std::to_string (t + 1), "111");
+      termination->SetE2Socket (sockets[0]);
+      rics.push_back (sockets[1]);
+      manager->AddTermination (termination);
+      manager->RegisterSmHandler (
+          termination, 300, Create<RicControlFunctionDescription> (),
+          MakeCallback (&E2TerminationManagerTestCase::Receive, this));
+      terminations.push_back (termination);
+    }
+  manager->Start ();
+  NS_TEST_EXPECT_MSG_EQ (manager->GetTerminationCount (), terminationCount,
+                         "Wrong number of terminations");
+  NS_TEST_EXPECT_MSG_EQ (manager->GetSenderThreadCount (), 2, "Wrong size of the sender pool");
+  NS_TEST_EXPECT_MSG_EQ (manager->GetReceiveThreadCount (), 2, "Wrong size of the receive pool");
+
+  // one RIC Control Request to the last termination, dispatched by a thread
+  // of the receive pool
+  E2AP_PDU_t *control = NewControlRequest (
+      EncodeControlHeader (5, 3, 1, false),
+      EncodeControlMessage ({{1, 1, 1, 1}}, {RANParameter_Value_PR_valueInt, 2, {}, 0}));
+  asn_encode_to_new_buffer_result_t res =
+      asn_encode_to_new_buffer (nullptr, ATS_ALIGNED_BASIC_PER, &asn_DEF_E2AP_PDU, control);
+  NS_TEST_ASSERT_MSG_EQ (send (rics.back (), res.buffer, res.result.encoded, 0),
+                         res.result.encoded, "Cannot send the control request");
+  free (res.buffer);
+  ASN_STRUCT_FREE (asn_DEF_E2AP_PDU, control);
+  for (uint32_t wait = 0; wait < 200; wait++)
+    {
+      {
+        std::unique_lock<std::mutex> lock (m_receivedMutex);
+        if (!m_received.empty ())
+          {
+            break;
+          }
+      }
+      std::this_thread::sleep_for (std::chrono::milliseconds (10));
+    }
+  std::unique_lock<std::mutex> lock (m_receivedMutex);
+  NS_TEST_ASSERT_MSG_EQ (m_received.size (), 1, "Control request not dispatched");
+  NS_TEST_EXPECT_MSG_EQ (m_received[0], PeekPointer (terminations.back ()),
+                         "Control request dispatched to the wrong termination");
+  lock.unlock ();
+
+  // the messages of the terminations interleave over several batches
+  for (long sn = 0; sn < messageCount; sn++)
+    {
+      for (long t = 0; t < terminationCount; t++)
+        {
+          Simulator::Schedule (MilliSeconds (sn / 4), &E2TerminationManagerTestCase::Send, this,
+                               terminations[t], 100 + t, sn);
+        }
+    }
+  Simulator::Run ();
+
+  // Stop sends all the pending messages, then joins the pools
+  manager->Dispose ();
+  NS_TEST_EXPECT_MSG_EQ (manager->GetSenderThreadCount (), 0, "Sender pool not stopped");
+  NS_TEST_EXPECT_MSG_EQ (manager->GetReceiveThreadCount (), 0, "Receive pool not stopped");
+
+  std::vector<uint8_t> buffer (65536);
+  for (long t = 0; t < terminationCount; t++)
+    {
+      long lastSn = -1;
+      uint32_t received = 0;
+      uint32_t misrouted = 0;
+      uint32_t reordered = 0;
+      ssize_t size;
+      while ((size = recv (rics[t], buffer.data (), buffer.size (), MSG_DONTWAIT)) > 0)
+        {
+          auto it = m_expected.find (std::string ((char *) buffer.data (), size));
+          if (it == m_expected.end () || it->second.first != 100 + t)
+            {
+              misrouted++;
+              continue;
+            }
+          reordered += it->second.second != lastSn + 1;
+          lastSn = it->second.second;
+          received++;
+        }
+      NS_TEST_EXPECT_MSG_EQ (misrouted, 0, "Messages of another termination on the connection");
+      NS_TEST_EXPECT_MSG_EQ (reordered, 0, "Messages of a termination sent out of order");
+      NS_TEST_EXPECT_MSG_EQ (received, messageCount, "Messages not sent before Stop returned");
+    }
+
+  // with the default attributes, no more threads than terminations
+  Ptr<E2TerminationManager> single = CreateObject<E2TerminationManager> ();
+  int sockets[2];
+  NS_TEST_ASSERT_MSG_EQ (socketpair (AF_UNIX, SOCK_SEQPACKET, 0, sockets), 0,
+                         "Cannot create the socket pair");
+  Ptr<E2Termination> termination =
+      CreateObject<E2Termination> ("127.0.0.1", 36422, 38480, "9", "111");
+  termination->SetE2Socket (sockets[0]);
+  single->AddTermination (termination);
+  single->Start ();
+  NS_TEST_EXPECT_MSG_EQ (single->GetSenderThreadCount (), 1, "More threads than terminations");
+  NS_TEST_EXPECT_MSG_EQ (single->GetReceiveThreadCount (), 1, "More threads than terminations");
+  single->Dispose ();
+
+  // the messages a closed connection refuses are dropped and counted,
+  // without SIGPIPE
+  int closedSockets[2];
+  NS_TEST_ASSERT_MSG_EQ (socketpair (AF_UNIX, SOCK_SEQPACKET, 0, closedSockets), 0,
+                         "Cannot create the socket pair");
+  Ptr<E2Termination> closed =
+      CreateObject<E2Termination> ("127.0.0.1", 36422, 38481, "10", "111");
+  closed->SetE2Socket (closedSockets[0]);
+  closed->Start ();
+  close (closedSockets[1]);
+  Simulator::Schedule (MilliSeconds (1), &E2TerminationManagerTestCase::Send, this, closed, 200,
+                       0);
+  Simulator::Run ();
+  closed->Flush ();
+  NS_TEST_EXPECT_MSG_EQ (closed->GetSendBatchStats ().dropped, 1, "Refused message not counted");
+  closed->Dispose ();
+
+  // the terminations close their end of the connections
+  for (Ptr<E2Termination> t : terminations)
+    {
+      t->Dispose ();
+    }
+  termination->Dispose ();
+  Simulator::Destroy ();
+  for (int ric : rics)
+    {
+      close (ric);
+    }
+  close (sockets[1]);
+}
+
+/**
+ * Check the specialized handover decoder against the asn1c decoder on
+ * control headers and messages encoded by asn1c, and check that the other
+ * shapes of control message are left to the asn1c decoder
+ */
+class RcHandoverDecoderTestCase : public TestCase
+{
+public:
+  RcHandoverDecoderTestCase ();
+  virtual ~RcHandoverDecoderTestCase ();
+
+private:
+  virtual void DoRun (void);
+  void CheckHeader (const std::vector<uint8_t> &encoded);
+  void CheckMessage (const std::vector<uint8_t> &encoded);
+};
+
+RcHandoverDecoderTestCase::RcHandoverDecoderTestCase ()
+  : TestCase ("RC handover decoder matches the asn1c decoder")
+{
+}
+
+RcHandoverDecoderTestCase::~RcHandoverDecoderTestCase ()
+{
+}
+
+void
+RcHandoverDecoderTestCase::CheckHeader (const std::vector<uint8_t> &encoded)
+{
+  E2SM_RC_ControlHeader_t *header = nullptr;
+  asn_dec_rval_t rval = asn_decode (nullptr, ATS_ALIGNED_BASIC_PER, &asn_DEF_E2SM_RC_ControlHeader,
+                                    (void **) &header, encoded.data (), encoded.size ());
+  NS_TEST_ASSERT_MSG_EQ (rval.code, RC_OK, "asn1c cannot decode the control header");
+
+  RcHandoverDecoder::ControlHeader fast;
+  NS_TEST_ASSERT_MSG_EQ (
+      RcHandoverDecoder::DecodeControlHeader (encoded.data (), encoded.size (), fast), true,
+      "Control header rejected by the handover decoder");
+
+  const E2SM_RC_ControlHeader_Format1_t *format1 =
+      header->ric_controlHeader_formats.choice.controlHeader_Format1;
+  NS_TEST_EXPECT_MSG_EQ (
+      fast.ueId,
+      format1->ueID.choice.gNB_UEID->gNB_CU_UE_F1AP_ID_List->list.array[0]->gNB_CU_UE_F1AP_ID,
+      "Wrong UE ID");
+  NS_TEST_EXPECT_MSG_EQ (fast.styleType, format1->ric_Style_Type, "Wrong RIC Style Type");
+  NS_TEST_EXPECT_MSG_EQ (fast.controlActionId, format1->ric_ControlAction_ID,
+                         "Wrong RIC Control Action ID");
+  ASN_STRUCT_FREE (asn_DEF_E2SM_RC_ControlHeader, header);
+}
+
+void
+RcHandoverDecoderTestCase::CheckMessage (const std::vector<uint8_t> &encoded)
+{
+  E2SM_RC_ControlMessage_t *message = nullptr;
+  asn_dec_rval_t rval =
+      asn_decode (nullptr, ATS_ALIGNED_BASIC_PER, &asn_DEF_E2SM_RC_ControlMessage,
+                  (void **) &message, encoded.data (), encoded.size ());
+  NS_TEST_ASSERT_MSG_EQ (rval.code, RC_OK, "asn1c cannot decode the control message");
+
+  RcHandoverDecoder::HandoverMessage fast;
+  NS_TEST_ASSERT_MSG_EQ (
+      RcHandoverDecoder::DecodeHandoverMessage (encoded.data (), encoded.size (), fast), true,
+      "Control message rejected by the handover decoder");
+
+  const E2SM_RC_ControlMessage_Format1_Item_t *item =
+      message->ric_controlMessage_formats.choice.controlMessage_Format1->ranP_List.list.array[0];
+  NS_TEST_EXPECT_MSG_EQ ((long) fast.ranParameterIds[0], item->ranParameter_ID,
+                         "Wrong RAN parameter ID");
+  const RANParameter_ValueType_t *valueType = &item->ranParameter_valueType;
+  for (uint32_t depth = 1; depth < RcHandoverDecoder::HANDOVER_DEPTH; depth++)
+    {
+      const RANParameter_STRUCTURE_Item_t *child =
+          valueType->choice.ranP_Choice_Structure->ranParameter_Structure
+              ->sequence_of_ranParameters->list.array[0];
+      NS_TEST_EXPECT_MSG_EQ ((long) fast.ranParameterIds[depth], child->ranParameter_ID,
+                             "Wrong RAN parameter ID at depth " << depth);
+      valueType = child->ranParameter_valueType;
+    }
+
+  const RANParameter_Value_t *value = valueType->choice.ranP_Choice_ElementFalse->ranParameter_value;
+  switch (value->present)
+    {
+    case RANParameter_Value_PR_valueInt:
+      NS_TEST_EXPECT_MSG_EQ ((int) fast.type, (int) RcHandoverDecoder::HandoverMessage::Type::INTEGER,
+                             "Wrong leaf type");
+      NS_TEST_EXPECT_MSG_EQ (fast.intValue, value->choice.valueInt, "Wrong integer leaf");
+      break;
+    case RANParameter_Value_PR_valueBitS:
+      NS_TEST_EXPECT_MSG_EQ ((int) fast.type,
+                             (int) RcHandoverDecoder::HandoverMessage::Type::BIT_STRING,
+                             "Wrong leaf type");
+      NS_TEST_EXPECT_MSG_EQ (std::string ((const char *) fast.bytes, fast.size),
+                             std::string ((const char *) value->choice.valueBitS.buf,
+                                          value->choice.valueBitS.size),
+                             "Wrong bit string leaf");
+      break;
+    case RANParameter_Value_PR_valueOctS:
+      NS_TEST_EXPECT_MSG_EQ ((int) fast.type,
+                             (int) RcHandoverDecoder::HandoverMessage::Type::OCTET_STRING,
+                             "Wrong leaf type");
+      NS_TEST_EXPECT_MSG_EQ (std::string ((const char *) fast.bytes, fast.size),
+                             std::string ((const char *) value->choice.valueOctS.buf,
+                                          value->choice.valueOctS.size),
+                             "Wrong octet string leaf");
+      break;
+    default:
+      NS_TEST_EXPECT_MSG_EQ (true, false, "Unexpected leaf type " << value->present);
+      break;
+    }
+  ASN_STRUCT_FREE (asn_DEF_E2SM_RC_ControlMessage, message);
+}
+
+void
+RcHandoverDecoderTestCase::DoRun (void)
+{
+  const uint32_t f1apIds[] = {0, 1, 127, 255, 256, 65535, 65536, 16777216, 4294967295u};
+  const long styles[] = {0, 3, 127, 128, 255, 70000};
+  const long actionIds[] = {1, 255, 256, 65535};
+  for (uint32_t f1apId : f1apIds)
+    {
+      for (long style : styles)
+        {
+          for (long actionId : actionIds)
+            {
+              CheckHeader (EncodeControlHeader (f1apId, style, actionId, false));
+              CheckHeader (EncodeControlHeader (f1apId, style, actionId, true));
+            }
+        }
+    }
+
+  // NR CGI of the target cell as an octet string, a bit string and an integer
+  const std::vector<std::vector<long>> paths = {
+      {1, 2, 3, 4}, {1, 1, 1, 1}, {200, 70000, 65536, 4294967295}};
+  const RanParameterLeaf octetString = {
+      RANParameter_Value_PR_valueOctS, 0, {0x00, 0x00, 0x00, 0x01, 0x27}, 0};
+  const RanParameterLeaf bitString = {
+      RANParameter_Value_PR_valueBitS, 0, {0x00, 0x00, 0x00, 0x01, 0x70}, 4};
+  std::vector<RanParameterLeaf> integers;
+  for (long value : {7L, -1L, 1000000L, 0x7fffffffL})
+    {
+      integers.push_back ({RANParameter_Value_PR_valueInt, value, {}, 0});
+    }
+
+  for (const std::vector<long> &path : paths)
+    {
+      CheckMessage (EncodeControlMessage ({path}, octetString));
+      CheckMessage (EncodeControlMessage ({path}, bitString));
+      for (const RanParameterLeaf &integer : integers)
+        {
+          CheckMessage (EncodeControlMessage ({path}, integer));
+        }
+    }
+
+  // other shapes go to the asn1c decoder
+  RcHandoverDecoder::HandoverMessage fast;
+  std::vector<uint8_t> twoParameters =
+      EncodeControlMessage ({{1, 2, 3, 4}, {5, 6, 7, 8}}, octetString);
+  NS_TEST_EXPECT_MSG_EQ (
+      RcHandoverDecoder::DecodeHandoverMessage (twoParameters.data (), twoParameters.size (), fast),
+      false, "Two top-level RAN parameters accepted");
+  std::vector<uint8_t> shallow = EncodeControlMessage ({{1, 2, 3}}, octetString);
+  NS_TEST_EXPECT_MSG_EQ (
+      RcHandoverDecoder::DecodeHandoverMessage (shallow.data (), shallow.size (), fast), false,
+      "Leaf at the third level accepted");
+  std::vector<uint8_t> encoded = EncodeControlMessage ({paths[0]}, octetString);
+  for (size_t size = 0; size < encoded.size (); size++)
+    {
+      NS_TEST_EXPECT_MSG_EQ (RcHandoverDecoder::DecodeHandoverMessage (encoded.data (), size, fast),
+                             false, "Truncated message of " << size << " bytes accepted");
+    }
+}
+
+/**
+ * Check that the released structures are emptied and handed out again,
+ * and that the pool frees the structures beyond its capacity
+ */
+class AsnStructPoolTestCase : public TestCase
+{
+public:
+  AsnStructPoolTestCase ();
+  virtual ~AsnStructPoolTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+AsnStructPoolTestCase::AsnStructPoolTestCase ()
+  : TestCase ("ASN.1 structure pool recycles the released structures")
+{
+}
+
+AsnStructPoolTestCase::~AsnStructPoolTestCase ()
+{
+}
+
+void
+AsnStructPoolTestCase::DoRun (void)
+{
+  AsnStructPool pool (&asn_DEF_E2SM_RC_ControlHeader, sizeof (E2SM_RC_ControlHeader_t), 2);
+
+  std::vector<uint8_t> encoded = EncodeControlHeader (7, 3, 1, true);
+  E2SM_RC_ControlHeader_t *header = pool.Acquire<E2SM_RC_ControlHeader_t> ();
+  asn_dec_rval_t rval = asn_decode (nullptr, ATS_ALIGNED_BASIC_PER, &asn_DEF_E2SM_RC_ControlHeader,
+                                    (void **) &header, encoded.data (), encoded.size ());
+  NS_TEST_ASSERT_MSG_EQ (rval.code, RC_OK, "Cannot decode into a pooled structure");
+  pool.Release (header);
+
+  E2SM_RC_ControlHeader_t *reused = pool.Acquire<E2SM_RC_ControlHeader_t> ();
+  NS_TEST_EXPECT_MSG_EQ (reused, header, "Released structure not reused");
+  NS_TEST_EXPECT_MSG_EQ (reused->ric_controlHeader_formats.present,
+                         E2SM_RC_ControlHeader__ric_controlHeader_formats_PR_NOTHING,
+                         "Released structure not reset");
+
+  std::vector<E2SM_RC_ControlHeader_t *> headers = {reused};
+  for (int i = 0; i < 3; i++)
+    {
+      headers.push_back (pool.Acquire<E2SM_RC_ControlHeader_t> ());
+    }
+  for (E2SM_RC_ControlHeader_t *h : headers)
+    {
+      pool.Release (h);
+    }
+
+  AsnStructPool::Stats stats = pool.GetStats ();
+  NS_TEST_EXPECT_MSG_EQ (stats.acquired, 5, "Wrong number of acquired structures");
+  NS_TEST_EXPECT_MSG_EQ (stats.reused, 1, "Wrong number of reused structures");
+  NS_TEST_EXPECT_MSG_EQ (stats.released, 5, "Wrong number of released structures");
+  NS_TEST_EXPECT_MSG_EQ (stats.idle, 2, "Pool above its capacity");
+  NS_TEST_EXPECT_MSG_EQ (stats.discarded, 2, "Wrong number of freed structures");
+}
+
+/**
+ * Check that a Control Message Format2 is decoded into one record per
+ * action, each with its style, action ID and UE, and split accordingly
+ */
+class RcMultiActionControlTestCase : public TestCase
+{
+public:
+  RcMultiActionControlTestCase ();
+  virtual ~RcMultiActionControlTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+RcMultiActionControlTestCase::RcMultiActionControlTestCase ()
+  : TestCase ("RC control message Format2 decoded into per-action records")
+{
+}
+
+RcMultiActionControlTestCase::~RcMultiActionControlTestCase ()
+{
+}
+
+void
+RcMultiActionControlTestCase::DoRun (void)
+{
+  // style 3 hands over UEs 11 and 12, style 2 acts on the UE of the header
+  struct TestAction
+  {
+    long style;
+    long actionId;
+    uint32_t ueId; //!< 0 to take the UE of the header
+    long targetCell;
+  };
+  const std::vector<TestAction> expected = {{3, 1, 11, 5}, {3, 1, 12, 6}, {2, 6, 0, 0}};
+  const uint32_t headerUe = 40;
+
+  auto *message = (E2SM_RC_ControlMessage_t *) calloc (1, sizeof (E2SM_RC_ControlMessage_t));
+  auto *format2 =
+      (E2SM_RC_ControlMessage_Format2_t *) calloc (1, sizeof (E2SM_RC_ControlMessage_Format2_t));
+  message->ric_controlMessage_formats.present =
+      E2SM_RC_ControlMessage__ric_controlMessage_formats_PR_controlMessage_Format2;
+  message->ric_controlMessage_formats.choice.controlMessage_Format2 = format2;
+  E2SM_RC_ControlMessage_Format2_Style_Item_t *style = nullptr;
+  for (const TestAction &test : expected)
+    {
+      if (style == nullptr || style->indicated_Control_Style_Type != test.style)
+        {
+          style = (E2SM_RC_ControlMessage_Format2_Style_Item_t *) calloc (
+              1, sizeof (E2SM_RC_ControlMessage_Format2_Style_Item_t));
+          style->indicated_Control_Style_Type = test.style;
+          ASN_SEQUENCE_ADD (&format2->ric_ControlStyle_List.list, style);
+        }
+      auto *action = (E2SM_RC_ControlMessage_Format2_ControlAction_Item_t *) calloc (
+          1, sizeof (E2SM_RC_ControlMessage_Format2_ControlAction_Item_t));
+      action->ric_ControlAction_ID = test.actionId;
+      if (test.targetCell != 0)
+        {
+          AddRanParameter (&action->ranP_List, {1, 1, 1, 1},
+                           {RANParameter_Value_PR_valueInt, test.targetCell, {}, 0});
+        }
+      if (test.ueId != 0)
+        {
+          AddRanParameter (&action->ranP_List, {RicControlMessage::UE_ID_RAN_PARAMETER_ID},
+                           {RANParameter_Value_PR_valueInt, test.ueId, {}, 0});
+        }
+      ASN_SEQUENCE_ADD (&style->ric_ControlAction_List.list, action);
+    }
+
+  E2AP_PDU_t *pdu =
+      NewControlRequest (EncodeControlHeaderFormat2 (headerUe), EncodeControlMessage (message));
+  Ptr<RicControlMessage> control = Create<RicControlMessage> (pdu);
+  ASN_STRUCT_FREE (asn_DEF_E2AP_PDU, pdu);
+
+  const std::vector<RicControlMessage::ControlAction> &actions = control->GetControlActions ();
+  NS_TEST_ASSERT_MSG_EQ (actions.size (), expected.size (), "Wrong number of actions");
+  std::vector<Ptr<RicControlMessage>> parts = control->SplitActions ();
+  NS_TEST_ASSERT_MSG_EQ (parts.size (), expected.size (), "Wrong number of split records");
+  for (size_t i = 0; i < expected.size (); i++)
+    {
+      uint64_t ueId = expected[i].ueId != 0 ? expected[i].ueId : headerUe;
+      NS_TEST_EXPECT_MSG_EQ (actions[i].m_controlStyle, expected[i].style,
+                             "Wrong style of action " << i);
+      NS_TEST_EXPECT_MSG_EQ (actions[i].m_controlActionId, expected[i].actionId,
+                             "Wrong ID of action " << i);
+      NS_TEST_EXPECT_MSG_EQ (actions[i].m_ueId, ueId, "Wrong UE of action " << i);
+
+      NS_TEST_EXPECT_MSG_EQ (parts[i]->GetControlActions ().size (), 1,
+                             "Split record with more than one action");
+      NS_TEST_EXPECT_MSG_EQ (parts[i]->GetControlStyle (), expected[i].style,
+                             "Wrong style of split record " << i);
+      NS_TEST_EXPECT_MSG_EQ (parts[i]->GetControlActionId (), expected[i].actionId,
+                             "Wrong action ID of split record " << i);
+      NS_TEST_EXPECT_MSG_EQ (parts[i]->GetUeId (), ueId, "Wrong UE of split record " << i);
+      NS_TEST_EXPECT_MSG_EQ ((long) parts[i]->GetTargetCell (), expected[i].targetCell,
+                             "Wrong target cell of split record " << i);
+      NS_TEST_EXPECT_MSG_EQ (parts[i]->m_ricRequestId.ricRequestorID,
+                             control->m_ricRequestId.ricRequestorID,
+                             "Split record without the request ID");
+    }
+
+  // the records of the actions share the outcome of the request
+  parts[1]->Reject (Cause_PR_misc, CauseMisc_om_intervention);
+  NS_TEST_EXPECT_MSG_EQ (parts[0]->IsRejected (), true, "Outcome not shared by the actions");
+  NS_TEST_EXPECT_MSG_EQ (parts[0]->Resolve (), false, "Request resolved with pending actions");
+  NS_TEST_EXPECT_MSG_EQ (parts[2]->Resolve (), false, "Request resolved with pending actions");
+  NS_TEST_EXPECT_MSG_EQ (parts[1]->Resolve (), true, "Request not resolved");
+  NS_TEST_EXPECT_MSG_EQ (control->GetCause (), CauseMisc_om_intervention, "Wrong cause");
+}
+
+/**
+ * Check that the controls of a step are passed to the handler of their
+ * control action in one batch per step, the actions of a multi-action
+ * request joining the batches of their handlers, and that the controls
+ * without a handler are rejected
+ */
+class ControlDispatchTestCase : public TestCase
+{
+public:
+  ControlDispatchTestCase ();
+  virtual ~ControlDispatchTestCase ();
+
+private:
+  virtual void DoRun (void);
+
+  /**
+  * \return a local control request with one action per UE
+  */
+  static Ptr<RicControlMessage> NewControl (long style, long actionId,
+                                            const std::vector<uint64_t> &ues);
+  void Submit (Ptr<E2Termination> termination, Ptr<RicControlMessage> control);
+  void ApplyHandovers (const std::vector<Ptr<RicControlMessage>> &controls);
+  void ApplyStyle2 (const std::vector<Ptr<RicControlMessage>> &controls);
+
+  std::vector<size_t> m_handoverBatches; //!< size of the batches of the handover handler
+  std::vector<size_t> m_style2Batches; //!< size of the batches of the style 2 handler
+};
+
+ControlDispatchTestCase::ControlDispatchTestCase ()
+  : TestCase ("RIC controls dispatched to their handlers in one batch per step")
+{
+}
+
+ControlDispatchTestCase::~ControlDispatchTestCase ()
+{
+}
+
+Ptr<RicControlMessage>
+ControlDispatchTestCase::NewControl (long style, long actionId, const std::vector<uint64_t> &ues)
+{
+  std::vector<RicControlMessage::ControlAction> actions;
+  for (uint64_t ue : ues)
+    {
+      RicControlMessage::ControlAction action;
+      action.m_controlStyle = style;
+      action.m_controlActionId = actionId;
+      action.m_ueId = ue;
+      actions.push_back (action);
+    }
+  RICrequestID_t requestId {};
+  requestId.ricRequestorID = 1024;
+  requestId.ricInstanceID = 1;
+  return Create<RicControlMessage> (300, requestId, actions);
+}
+
+void
+ControlDispatchTestCase::Submit (Ptr<E2Termination> termination, Ptr<RicControlMessage> control)
+{
+  termination->SubmitControl (300, control);
+}
+
+void
+ControlDispatchTestCase::ApplyHandovers (const std::vector<Ptr<RicControlMessage>> &controls)
+{
+  m_handoverBatches.push_back (controls.size ());
+  for (const Ptr<RicControlMessage> &control : controls)
+    {
+      NS_TEST_EXPECT_MSG_EQ (control->GetControlStyle (), 3, "Control of another style");
+    }
+}
+
+void
+ControlDispatchTestCase::ApplyStyle2 (const std::vector<Ptr<RicControlMessage>> &controls)
+{
+  m_style2Batches.push_back (controls.size ());
+  for (const Ptr<RicControlMessage> &control : controls)
+    {
+      NS_TEST_EXPECT_MSG_EQ (control->GetControlActionId (), 6, "Control of another action");
+    }
+}
+
+void
+ControlDispatchTestCase::DoRun (void)
+{
+  Ptr<E2Termination> termination =
+      CreateObject<E2Termination> ("127.0.0.1", 36422, 38472, "1", "111");
+  termination->RegisterControlHandler (
+      300, 3, 1, MakeCallback (&ControlDispatchTestCase::ApplyHandovers, this));
+  termination->RegisterControlHandler (
+      300, 2, 6, MakeCallback (&ControlDispatchTestCase::ApplyStyle2, this));
+
+  // first step: three handovers, two style 2 controls, one request with an
+  // action of each, and a control with no handler
+  Ptr<RicControlMessage> unhandled = NewControl (2, 7, {1});
+  std::vector<RicControlMessage::ControlAction> actions (2);
+  actions[0].m_controlStyle = 3;
+  actions[0].m_controlActionId = 1;
+  actions[0].m_ueId = 4;
+  actions[1].m_controlStyle = 2;
+  actions[1].m_controlActionId = 6;
+  actions[1].m_ueId = 3;
+  Ptr<RicControlMessage> multiAction =
+      Create<RicControlMessage> (300, unhandled->m_ricRequestId, actions);
+  std::vector<Ptr<RicControlMessage>> handled = {
+      NewControl (3, 1, {1}), NewControl (3, 1, {2}), NewControl (3, 1, {3}),
+      NewControl (2, 6, {1}), NewControl (2, 6, {2})};
+  for (const Ptr<RicControlMessage> &control : handled)
+    {
+      Simulator::Schedule (MilliSeconds (1), &ControlDispatchTestCase::Submit, this, termination,
+                           control);
+    }
+  Simulator::Schedule (MilliSeconds (1), &ControlDispatchTestCase::Submit, this, termination,
+                       multiAction);
+  Simulator::Schedule (MilliSeconds (1), &ControlDispatchTestCase::Submit, this, termination,
+                       unhandled);
+
+  // second step: one more handover
+  Simulator::Schedule (MilliSeconds (2), &ControlDispatchTestCase::Submit, this, termination,
+                       NewControl (3, 1, {1}));
+  Simulator::Run ();
+
+  NS_TEST_ASSERT_MSG_EQ (m_handoverBatches.size (), 2, "One handover batch per step expected");
+  NS_TEST_EXPECT_MSG_EQ (m_handoverBatches[0], 4, "Wrong handover batch of the first step");
+  NS_TEST_EXPECT_MSG_EQ (m_handoverBatches[1], 1, "Wrong handover batch of the second step");
+  NS_TEST_ASSERT_MSG_EQ (m_style2Batches.size (), 1, "One style 2 batch expected");
+  NS_TEST_EXPECT_MSG_EQ (m_style2Batches[0], 3, "Wrong style 2 batch");
+
+  for (const Ptr<RicControlMessage> &control : handled)
+    {
+      NS_TEST_EXPECT_MSG_EQ (control->IsRejected (), false, "Handled control rejected");
+    }
+  NS_TEST_EXPECT_MSG_EQ (multiAction->IsRejected (), false, "Multi-action request rejected");
+  NS_TEST_EXPECT_MSG_EQ (unhandled->IsRejected (), true, "Control without handler applied");
+  NS_TEST_EXPECT_MSG_EQ (unhandled->GetCause (), CauseRIC_action_not_supported,
+                         "Wrong cause of the rejection");
+
+  termination->Dispose ();
+  Simulator::Destroy ();
+}
+
+/**
+ * Check that in lockstep mode the simulator waits for the RIC after the
+ * reports of each step, until a RIC Control Request, possibly with no
+ * action, a call of ReleaseLockstep or the timeout
+ */
+class LockstepTestCase : public TestCase
+{
+public:
+  LockstepTestCase ();
+  virtual ~LockstepTestCase ();
+
+private:
+  virtual void DoRun (void);
+
+  std::vector<E2ReportScheduler::Report>
+  BuildReports (const E2ReportScheduler::Subscription &subscription);
+  void ApplyHandovers (const std::vector<Ptr<RicControlMessage>> &controls);
+  void Wait (Time wait, bool answered);
+
+  std::vector<Time> m_waits; //!< wall-clock waits traced, in order
+  std::vector<bool> m_answered; //!< outcome of the traced waits
+  std::vector<uint64_t> m_handovers; //!< UEs handed over, in order
+};
+
+LockstepTestCase::LockstepTestCase ()
+  : TestCase ("Lockstep waits for the RIC after the reports of each step")
+{
+}
+
+LockstepTestCase::~LockstepTestCase ()
+{
+}
+
+std::vector<E2ReportScheduler::Report>
+LockstepTestCase::BuildReports (const E2ReportScheduler::Subscription &subscription)
+{
+  KpmIndicationHeader::KpmRicIndicationHeaderValues headerValues;
+  headerValues.m_plmId = "111";
+  headerValues.m_gnbId = "1";
+  headerValues.m_nrCellId = 1;
+
+  KpmIndicationMessage::KpmIndicationMessageValues msgValues;
+  msgValues.m_cellTable =
+      Create<KpiTable> (KpmMetricRegistry::Get ().GetSchema (KpmMetricRegistry::CELL_LTE));
+  msgValues.m_cellTable->AppendRow ("1").Put (1).Put (0.5).Put (100).Put (200).Put (2);
+  msgValues.m_granularityPeriod = subscription.granularityPeriod;
+
+  E2ReportScheduler::Report report;
+  report.header =
+      Create<KpmIndicationHeader> (KpmIndicationHeader::GlobalE2nodeType::eNB, headerValues);
+  report.message = Create<KpmIndicationMessage> (msgValues, E2SM_KPM_INDICATION_MESSAGE_FORMART1);
+  return {report};
+}
+
+void
+LockstepTestCase::ApplyHandovers (const std::vector<Ptr<RicControlMessage>> &controls)
+{
+  for (const Ptr<RicControlMessage> &control : controls)
+    {
+      m_handovers.push_back (control->GetUeId ());
+    }
+}
+
+void
+LockstepTestCase::Wait (Time wait, bool answered)
+{
+  m_waits.push_back (wait);
+  m_answered.push_back (answered);
+}
+
+void
+LockstepTestCase::DoRun (void)
+{
+  int sockets[2];
+  NS_TEST_ASSERT_MSG_EQ (socketpair (AF_UNIX, SOCK_SEQPACKET, 0, sockets), 0,
+                         "Cannot create the socket pair");
+  // the RIC gives up if a report is missing
+  struct timeval receiveTimeout = {5, 0};
+  setsockopt (sockets[1], SOL_SOCKET, SO_RCVTIMEO, &receiveTimeout, sizeof (receiveTimeout));
+
+  Ptr<E2Termination> termination =
+      CreateObject<E2Termination> ("127.0.0.1", 36422, 38472, "1", "111");
+  termination->SetE2Socket (sockets[0]);
+  termination->SetAttribute ("Lockstep", BooleanValue (true));
+  termination->SetAttribute ("LockstepTimeout", TimeValue (MilliSeconds (500)));
+  termination->TraceConnectWithoutContext ("LockstepWait",
+                                           MakeCallback (&LockstepTestCase::Wait, this));
+  // the RIC Control Requests are received on the socket and passed by
+  // e2sim to the callback of the RAN function
+  termination->RegisterControlFunctionToE2Sm (300, Create<RicControlFunctionDescription> ());
+  termination->RegisterControlHandler (
+      300, 3, 1, MakeCallback (&LockstepTestCase::ApplyHandovers, this));
+
+  Ptr<E2ReportScheduler> scheduler = CreateObject<E2ReportScheduler> ();
+  scheduler->SetReportCallback (MakeCallback (&LockstepTestCase::BuildReports, this));
+  termination->SetReportScheduler (scheduler);
+  termination->Start ();
+  E2ReportScheduler::Subscription subscription {};
+  subscription.requestorId = 1024;
+  subscription.instanceId = 1;
+  subscription.ranFuncionId = 2;
+  subscription.actionId = 1;
+  subscription.reportingPeriod = 100;
+  scheduler->AddSubscription (subscription);
+
+  E2AP_PDU_t *handover = NewControlRequest (
+      EncodeControlHeader (5, 3, 1, false),
+      EncodeControlMessage ({{1, 1, 1, 1}}, {RANParameter_Value_PR_valueInt, 2, {}, 0}));
+  E2AP_PDU_t *noAction = NewControlRequest (
+      EncodeControlHeader (5, E2Termination::NO_ACTION_CONTROL_STYLE, 0, false),
+      EncodeControlMessage ({{1, 1, 1, 1}}, {RANParameter_Value_PR_valueInt, 2, {}, 0}));
+  asn_encode_to_new_buffer_result_t encodedHandover =
+      asn_encode_to_new_buffer (nullptr, ATS_ALIGNED_BASIC_PER, &asn_DEF_E2AP_PDU, handover);
+  asn_encode_to_new_buffer_result_t encodedNoAction =
+      asn_encode_to_new_buffer (nullptr, ATS_ALIGNED_BASIC_PER, &asn_DEF_E2AP_PDU, noAction);
+  ASN_STRUCT_FREE (asn_DEF_E2AP_PDU, handover);
+  ASN_STRUCT_FREE (asn_DEF_E2AP_PDU, noAction);
+
+  // the RIC answers the report of each step in turn with a call of
+  // ReleaseLockstep, a handover and a control with no action, sent on the
+  // E2 connection, and nothing
+  E2Termination *raw = PeekPointer (termination);
+  uint32_t reports = 0;
+  std::thread ric ([&, raw] {
+    std::vector<uint8_t> buffer (65536);
+    ssize_t size;
+    while (reports < 4 && (size = recv (sockets[1], buffer.data (), buffer.size (), 0)) > 0)
+      {
+        // the responses to the controls are not reports
+        if (size < 2 || buffer[0] != 0 || buffer[1] != ProcedureCode_id_RICindication)
+          {
+            continue;
+          }
+        switch (reports++)
+          {
+          case 0:
+            raw->ReleaseLockstep ();
+            break;
+          case 1:
+            send (sockets[1], encodedHandover.buffer, encodedHandover.result.encoded, 0);
+            break;
+          case 2:
+            send (sockets[1], encodedNoAction.buffer, encodedNoAction.result.encoded, 0);
+            break;
+          default:
+            break;
+          }
+      }
+  });
+
+  // steps at 100, 200, 300 and 400 ms
+  Simulator::Stop (MilliSeconds (450));
+  Simulator::Run ();
+  ric.join ();
+
+  NS_TEST_EXPECT_MSG_EQ (reports, 4, "Report of a step not sent before the wait");
+  NS_TEST_ASSERT_MSG_EQ (m_answered.size (), 4, "One traced wait per step expected");
+  for (uint32_t step = 0; step < 3; step++)
+    {
+      NS_TEST_EXPECT_MSG_EQ (m_answered[step], true, "Wait not ended by the RIC");
+      NS_TEST_EXPECT_MSG_LT (m_waits[step], MilliSeconds (500), "Wait ended by the timeout");
+    }
+  NS_TEST_EXPECT_MSG_EQ (m_answered[3], false, "Timeout not traced");
+  NS_TEST_EXPECT_MSG_GT (m_waits[3], MilliSeconds (400), "Wait shorter than the timeout");
+  NS_TEST_ASSERT_MSG_EQ (m_handovers.size (), 1, "Only the handover reaches the handler");
+  NS_TEST_EXPECT_MSG_EQ (m_handovers[0], 5, "Control applied to the wrong UE");
+
+  E2Termination::LockstepStats stats = termination->GetLockstepStats ();
+  NS_TEST_EXPECT_MSG_EQ (stats.steps, 4, "Wrong number of steps");
+  NS_TEST_EXPECT_MSG_EQ (stats.timeouts, 1, "Wrong number of timeouts");
+  NS_TEST_EXPECT_MSG_EQ (stats.maxWaitNs, m_waits[3].GetNanoSeconds (), "Wrong longest wait");
+  uint64_t totalWaitNs = 0;
+  for (Time wait : m_waits)
+    {
+      totalWaitNs += wait.GetNanoSeconds ();
+    }
+  NS_TEST_EXPECT_MSG_EQ (stats.totalWaitNs, totalWaitNs, "Wrong total wait");
+
+  termination->Dispose ();
+  free (encodedHandover.buffer);
+  free (encodedNoAction.buffer);
+  close (sockets[1]);
+  Simulator::Destroy ();
+}
+
+/**
+ * Check that the coalescer keeps the last control of a UE and action within
+ * the window, and that the token buckets drop the controls beyond the limits
+ */
+class ControlCoalescerTestCase : public TestCase
+{
+public:
+  ControlCoalescerTestCase ();
+  virtual ~ControlCoalescerTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+ControlCoalescerTestCase::ControlCoalescerTestCase ()
+  : TestCase ("Control coalescer merges and rate limits the RIC controls")
+{
+}
+
+ControlCoalescerTestCase::~ControlCoalescerTestCase ()
+{
+}
+
+/**
+ * \return a handover control of a UE towards a target cell
+ */
+static Ptr<RicControlMessage>
+NewHandoverControl (uint32_t ueId, long targetCell, long actionId = 1)
+{
+  E2AP_PDU_t *pdu = NewControlRequest (
+      EncodeControlHeader (ueId, 3, actionId, false),
+      EncodeControlMessage ({{1, 1, 1, 1}}, {RANParameter_Value_PR_valueInt, targetCell, {}, 0}));
+  Ptr<RicControlMessage> control = Create<RicControlMessage> (pdu);
+  ASN_STRUCT_FREE (asn_DEF_E2AP_PDU, pdu);
+  return control;
+}
+
+void
+ControlCoalescerTestCase::DoRun (void)
+{
+  ControlCoalescer coalescer;
+  coalescer.SetWindow (MilliSeconds (100));
+  coalescer.Add (300, NewHandoverControl (1, 2), Seconds (0));
+  coalescer.Add (300, NewHandoverControl (2, 2), MilliSeconds (10));
+  coalescer.Add (300, NewHandoverControl (1, 3), MilliSeconds (50));
+
+  std::vector<ControlCoalescer::Released> released;
+  coalescer.Release (MilliSeconds (99), released);
+  NS_TEST_EXPECT_MSG_EQ (released.size (), 0, "Control released before the end of its window");
+  NS_TEST_EXPECT_MSG_EQ (coalescer.GetNextRelease (), MilliSeconds (100),
+                         "The window does not start with the first control");
+  coalescer.Release (MilliSeconds (100), released);
+  NS_TEST_ASSERT_MSG_EQ (released.size (), 1, "Wrong number of controls released");
+  NS_TEST_EXPECT_MSG_EQ (released[0].control->GetUeId (), 1, "Wrong UE released");
+  NS_TEST_EXPECT_MSG_EQ (released[0].control->GetTargetCell (), 3, "Last control not kept");
+  coalescer.Release (MilliSeconds (110), released);
+  NS_TEST_EXPECT_MSG_EQ (released.size (), 2, "Control of the second UE not released");
+  NS_TEST_EXPECT_MSG_EQ (coalescer.HasPending (), false, "Controls still pending");
+  ControlCoalescer::Stats stats = coalescer.GetStats ();
+  NS_TEST_EXPECT_MSG_EQ (stats.received, 3, "Wrong number of received controls");
+  NS_TEST_EXPECT_MSG_EQ (stats.merged, 1, "Wrong number of merged controls");
+
+  // a burst of two controls per UE and of three overall
+  ControlCoalescer limited;
+  limited.SetUeRateLimit (10, 2);
+  limited.SetGlobalRateLimit (100, 3);
+  for (long actionId = 1; actionId <= 5; actionId++)
+    {
+      limited.Add (300, NewHandoverControl (1, 2, actionId), Seconds (0));
+    }
+  released.clear ();
+  limited.Release (Seconds (0), released);
+  NS_TEST_EXPECT_MSG_EQ (released.size (), 2, "UE limit not applied");
+  for (uint32_t ueId = 2; ueId < 6; ueId++)
+    {
+      limited.Add (300, NewHandoverControl (ueId, 2), Seconds (0));
+    }
+  released.clear ();
+  limited.Release (Seconds (0), released);
+  NS_TEST_EXPECT_MSG_EQ (released.size (), 1, "Global limit not applied");
+  NS_TEST_EXPECT_MSG_EQ (limited.GetStats ().dropped, 6, "Wrong number of dropped controls");
+
+  // one token per UE every 100 ms
+  limited.Add (300, NewHandoverControl (1, 2), MilliSeconds (100));
+  released.clear ();
+  limited.Release (MilliSeconds (100), released);
+  NS_TEST_EXPECT_MSG_EQ (released.size (), 1, "Bucket of the UE not refilled");
+}
+
+/**
+ * Check that the responses obtained by patching the skeletons are the ones
+ * encoded by asn1c
+ */
+class ControlResponseEncoderTestCase : public TestCase
+{
+public:
+  ControlResponseEncoderTestCase ();
+  virtual ~ControlResponseEncoderTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+ControlResponseEncoderTestCase::ControlResponseEncoderTestCase ()
+  : TestCase ("RIC Control responses patched from skeletons match the asn1c encoding")
+{
+}
+
+ControlResponseEncoderTestCase::~ControlResponseEncoderTestCase ()
+{
+}
+
+void
+ControlResponseEncoderTestCase::DoRun (void)
+{
+  ControlResponseEncoder encoder;
+  const std::vector<RICrequestID_t> requestIds = {{1024, 1}, {0, 0}, {65535, 65535}, {1, 256}};
+  const std::vector<std::string> callProcessIds = {"", "a", "call-1", std::string (300, 'x')};
+  uint64_t responses = 0;
+  for (const std::string &callProcessId : callProcessIds)
+    {
+      for (const RICrequestID_t &requestId : requestIds)
+        {
+          for (Cause_PR group : {Cause_PR_NOTHING, Cause_PR_misc, Cause_PR_ricRequest})
+            {
+              E2AP_PDU_t *pdu = ControlResponseEncoder::BuildResponse (
+                  300, requestId, callProcessId, group, 2);
+              asn_encode_to_new_buffer_result_t res = asn_encode_to_new_buffer (
+                  nullptr, ATS_ALIGNED_BASIC_PER, &asn_DEF_E2AP_PDU, pdu);
+              ASN_STRUCT_FREE (asn_DEF_E2AP_PDU, pdu);
+              NS_TEST_ASSERT_MSG_NE (res.buffer, nullptr, "asn1c cannot encode the response");
+              std::string expected ((char *) res.buffer, res.result.encoded);
+              free (res.buffer);
+
+              const std::vector<uint8_t> &encoded =
+                  group == Cause_PR_NOTHING
+                      ? encoder.EncodeAcknowledge (300, requestId, callProcessId)
+                      : encoder.EncodeFailure (300, requestId, callProcessId, group, 2);
+              NS_TEST_EXPECT_MSG_EQ (std::string ((const char *) encoded.data (), encoded.size ()),
+                                     expected,
+                                     "Wrong response for request " << requestId.ricRequestorID
+                                                                   << "/"
+                                                                   << requestId.ricInstanceID);
+              responses++;
+            }
+        }
+    }
+  // each skeleton is encoded by asn1c, then only patched
+  NS_TEST_EXPECT_MSG_EQ (encoder.GetPatchedCount (), responses, "Skeletons not patched");
+}
+
+/**
+ * \return the APER encoding of an E2SM-RC action definition carrying a
+ *         handover policy
+ */
+static std::vector<uint8_t>
+EncodeHandoverPolicy (long style, double threshold, double offset)
+{
+  auto *definition =
+      (E2SM_RC_ActionDefinition_t *) calloc (1, sizeof (E2SM_RC_ActionDefinition_t));
+  definition->ric_Style_Type = style;
+  auto &formats = definition->ric_actionDefinition_formats;
+  formats.present =
+      E2SM_RC_ActionDefinition__ric_actionDefinition_formats_PR_actionDefinition_Format2;
+  formats.choice.actionDefinition_Format2 = (E2SM_RC_ActionDefinition_Format2_t *) calloc (
+      1, sizeof (E2SM_RC_ActionDefinition_Format2_t));
+
+  auto *item = (E2SM_RC_ActionDefinition_Format2_Item_t *) calloc (
+      1, sizeof (E2SM_RC_ActionDefinition_Format2_Item_t));
+  RIC_PolicyAction_t &action = item->ric_PolicyAction;
+  action.ric_ControlAction_ID = 1;
+  action.ranParameters_List = (decltype (action.ranParameters_List)) calloc (
+      1, sizeof (*action.ranParameters_List));
+  const std::vector<std::pair<long, double>> params = {
+      {RcPolicy::SERVING_SINR_THRESHOLD_ID, threshold}, {RcPolicy::NEIGHBOUR_OFFSET_ID, offset}};
+  for (const auto &param : params)
+    {
+      auto *paramItem = (RIC_PolicyAction_RANParameter_Item_t *) calloc (
+          1, sizeof (RIC_PolicyAction_RANParameter_Item_t));
+      paramItem->ranParameter_ID = param.first;
+      RANParameter_ValueType_t &valueType = paramItem->ranParameter_valueType;
+      valueType.present = RANParameter_ValueType_PR_ranP_Choice_ElementFalse;
+      valueType.choice.ranP_Choice_ElementFalse =
+          (RANParameter_ValueType_Choice_ElementFalse_t *) calloc (
+              1, sizeof (RANParameter_ValueType_Choice_ElementFalse_t));
+      auto *value = (RANParameter_Value_t *) calloc (1, sizeof (RANParameter_Value_t));
+      value->present = RANParameter_Value_PR_valueReal;
+      value->choice.valueReal = param.second;
+      valueType.choice.ranP_Choice_ElementFalse->ranParameter_value = value;
+      ASN_SEQUENCE_ADD (&action.ranParameters_List->list, paramItem);
+    }
+  ASN_SEQUENCE_ADD (&formats.choice.actionDefinition_Format2->ric_PolicyConditions_List.list,
+                    item);
+
+  asn_encode_to_new_buffer_result_t res = asn_encode_to_new_buffer (
+      nullptr, ATS_ALIGNED_BASIC_PER, &asn_DEF_E2SM_RC_ActionDefinition, definition);
+  std::vector<uint8_t> encoded;
+  if (res.buffer)
+    {
+      encoded.assign ((uint8_t *) res.buffer, (uint8_t *) res.buffer + res.result.encoded);
+      free (res.buffer);
+    }
+  ASN_STRUCT_FREE (asn_DEF_E2SM_RC_ActionDefinition, definition);
+  return encoded;
+}
+
+/**
+ * Check that a handover policy installed by the RIC is decoded and
+ * evaluated on the UE KPIs at each reporting tick
+ */
+class RcPolicyTestCase : public TestCase
+{
+public:
+  RcPolicyTestCase ();
+  virtual ~RcPolicyTestCase ();
+
+private:
+  virtual void DoRun (void);
+
+  Ptr<const KpiTable> GetUeKpis ();
+  void Decide (const RcPolicy &policy, const RcPolicy::Decision &decision);
+  void ApplyHandovers (const std::vector<Ptr<RicControlMessage>> &controls);
+
+  Ptr<KpiTable> m_table; //!< UE KPIs of the gNB
+  std::vector<RcPolicy::Decision> m_decisions; //!< handovers decided by the scheduled policy
+  std::vector<Ptr<RicControlMessage>> m_handovers; //!< controls applied by the handler
+};
+
+RcPolicyTestCase::RcPolicyTestCase ()
+  : TestCase ("E2SM-RC handover policies are evaluated locally at each reporting tick")
+{
+}
+
+RcPolicyTestCase::~RcPolicyTestCase ()
+{
+}
+
+Ptr<const KpiTable>
+RcPolicyTestCase::GetUeKpis ()
+{
+  return m_table;
+}
+
+void
+RcPolicyTestCase::Decide (const RcPolicy &policy, const RcPolicy::Decision &decision)
+{
+  NS_TEST_ASSERT_MSG_EQ (policy.GetInstanceId (), 7, "Decision of an unknown policy");
+  m_decisions.push_back (decision);
+}
+
+void
+RcPolicyTestCase::ApplyHandovers (const std::vector<Ptr<RicControlMessage>> &controls)
+{
+  m_handovers.insert (m_handovers.end (), controls.begin (), controls.end ());
+}
+
+void
+RcPolicyTestCase::DoRun (void)
+{
+  std::vector<uint8_t> encoded = EncodeHandoverPolicy (2, -5.0, 3.0);
+  RICactionDefinition_t actionDefinition {};
+  actionDefinition.buf = encoded.data ();
+  actionDefinition.size = encoded.size ();
+  NS_TEST_ASSERT_MSG_EQ (RcPolicy::Decode (&actionDefinition) == nullptr, true,
+                         "Policy of a style other than connected mode mobility accepted");
+
+  encoded = EncodeHandoverPolicy (3, -5.0, 3.0);
+  actionDefinition.buf = encoded.data ();
+  actionDefinition.size = encoded.size ();
+  Ptr<RcPolicy> policy = RcPolicy::Decode (&actionDefinition);
+  NS_TEST_ASSERT_MSG_NE (policy == nullptr, true, "Cannot decode the handover policy");
+  NS_TEST_ASSERT_MSG_EQ (policy->GetServingSinrThreshold (), -5.0, "Wrong SINR threshold");
+  NS_TEST_ASSERT_MSG_EQ (policy->GetNeighbourOffset (), 3.0, "Wrong neighbour offset");
+  policy->SetSubscription (1024, 7, 300, 1);
+
+  Ptr<const KpiSchema> schema = KpmMetricRegistry::Get ().GetSchema (KpmMetricRegistry::UE_GNB);
+  m_table = Create<KpiTable> (schema);
+  auto setUe = [this, &schema] (const std::string &imsi, long servingCell, double servingSinr,
+                                const std::vector<std::pair<long, double>> &neighbours) {
+    uint32_t row = m_table->AppendRow (imsi).GetRow ();
+    m_table->SetInteger (schema->FindMetric ("HO.SrcCellID.UEID"), row, servingCell);
+    m_table->SetReal (schema->FindMetric ("HO.SrcCellQual.RS-SINR.UEID"), row, servingSinr);
+    for (size_t n = 0; n < neighbours.size (); n++)
+      {
+        std::string prefix = "HO.TrgtCellQual." + std::to_string (n + 1);
+        m_table->SetInteger (schema->FindMetric (prefix + ".UEID"), row, neighbours[n].first);
+        m_table->SetReal (schema->FindMetric (prefix + ".RS-SINR.UEID"), row,
+                          neighbours[n].second);
+      }
+  };
+  // the best neighbour is 4 dB better, the other one only 2 dB
+  setUe ("111", 1, -8.0, {{2, -6.0}, {3, -4.0}});
+  // serving SINR above the threshold
+  setUe ("222", 1, 0.0, {{2, 10.0}});
+  // the only better neighbour is the serving cell itself
+  setUe ("333", 2, -10.0, {{2, 10.0}, {3, -9.0}});
+
+  std::vector<RcPolicy::Decision> decisions;
+  policy->Evaluate (m_table, decisions);
+  NS_TEST_ASSERT_MSG_EQ (decisions.size (), 1, "One handover expected");
+  NS_TEST_EXPECT_MSG_EQ (decisions[0].ueId, "111", "Handover of the wrong UE");
+  NS_TEST_EXPECT_MSG_EQ (decisions[0].servingCellId, 1, "Wrong serving cell");
+  NS_TEST_EXPECT_MSG_EQ (decisions[0].targetCellId, 3, "Handover to the wrong neighbour");
+
+  Ptr<E2ReportScheduler> scheduler = CreateObject<E2ReportScheduler> ();
+  scheduler->SetPolicyCallbacks (MakeCallback (&RcPolicyTestCase::GetUeKpis, this),
+                                 MakeCallback (&RcPolicyTestCase::Decide, this));
+  scheduler->AddPolicy (policy, 100);
+  // a policy with the same RIC Request ID replaces the previous one
+  scheduler->AddPolicy (policy, 100);
+
+  Simulator::Stop (MilliSeconds (350));
+  Simulator::Run ();
+
+  NS_TEST_ASSERT_MSG_EQ (scheduler->GetPolicyCount (), 1, "Wrong number of policies");
+  NS_TEST_EXPECT_MSG_EQ (m_decisions.size (), 3, "One decision per tick expected");
+
+  scheduler->RemoveSubscription (1024, 7);
+  Simulator::Stop (MilliSeconds (100));
+  Simulator::Run ();
+  NS_TEST_EXPECT_MSG_EQ (scheduler->GetPolicyCount (), 0, "Policy not removed");
+  NS_TEST_EXPECT_MSG_EQ (m_decisions.size (), 3, "Policy evaluated after its removal");
+  scheduler->Dispose ();
+
+  // the decisions of a policy installed through a termination are local
+  // controls, rate limited as the ones of the RIC: with 6 controls per
+  // second, the UE is handed over at one tick out of two
+  Ptr<E2Termination> termination =
+      CreateObject<E2Termination> ("127.0.0.1", 36422, 38472, "1", "111");
+  termination->SetAttribute ("ControlUeRateLimit", DoubleValue (6));
+  termination->RegisterControlHandler (
+      300, 3, 1, MakeCallback (&RcPolicyTestCase::ApplyHandovers, this));
+  termination->SetUeKpiCallback (MakeCallback (&RcPolicyTestCase::GetUeKpis, this));
+  scheduler = CreateObject<E2ReportScheduler> ();
+  termination->SetReportScheduler (scheduler);
+  scheduler->AddPolicy (policy, 100);
+  // a row not named after an IMSI is handed over by the policy, but
+  // cannot be controlled
+  setUe ("cell-1", 1, -8.0, {{3, -4.0}});
+
+  // four ticks, 100 ms apart
+  Simulator::Stop (MilliSeconds (450));
+  Simulator::Run ();
+
+  NS_TEST_ASSERT_MSG_EQ (m_handovers.size (), 2, "Decisions not rate limited");
+  for (const Ptr<RicControlMessage> &control : m_handovers)
+    {
+      NS_TEST_EXPECT_MSG_EQ (control->IsLocal (), true, "Control not built from the decision");
+      NS_TEST_EXPECT_MSG_EQ (control->GetUeId (), 111, "Control applied to the wrong UE");
+      NS_TEST_EXPECT_MSG_EQ (control->GetTargetCell (), 3, "Handover to the wrong neighbour");
+    }
+  NS_TEST_EXPECT_MSG_EQ (m_decisions.size (), 3, "Decision passed to the test callback");
+
+  termination->Dispose ();
+  Simulator::Destroy ();
+}
+
+/**
+ * xApp handing over to cell 2 the first UE of each indication
+ */
+class HandoverEmbeddedRic : public EmbeddedRic
+{
+public:
+  HandoverEmbeddedRic ();
+
+  virtual void OnIndication (const Indication &indication);
+
+  uint32_t m_indications; //!< indications received
+  uint32_t m_rows; //!< UE rows seen in the indications
+};
+
+HandoverEmbeddedRic::HandoverEmbeddedRic ()
+  : m_indications (0),
+    m_rows (0)
+{
+}
+
+void
+HandoverEmbeddedRic::OnIndication (const Indication &indication)
+{
+  m_indications++;
+  if (indication.ueTable == nullptr || indication.ueTable->GetRowCount () == 0)
+    {
+      return;
+    }
+  m_rows += indication.ueTable->GetRowCount ();
+
+  RicControlMessage::ControlAction action;
+  action.m_controlStyle = 3;
+  action.m_controlActionId = 1;
+  action.m_ueId = std::stoul (indication.ueTable->GetRowId (0));
+  action.m_targetCellId = 2;
+  RICrequestID_t requestId;
+  requestId.ricRequestorID = 1024;
+  requestId.ricInstanceID = indication.sequenceNumber;
+  SendControl (Create<RicControlMessage> (300, requestId,
+                                          std::vector<RicControlMessage::ControlAction> {action}));
+}
+
+/**
+ * Check that an embedded xApp receives the structured indications of its
+ * period and that its controls reach the control handlers
+ */
+class EmbeddedRicTestCase : public TestCase
+{
+public:
+  EmbeddedRicTestCase ();
+  virtual ~EmbeddedRicTestCase ();
+
+private:
+  virtual void DoRun (void);
+
+  Ptr<const KpiTable> GetUeKpis ();
+  void ApplyHandovers (const std::vector<Ptr<RicControlMessage>> &controls);
+
+  Ptr<KpiTable> m_table; //!< UE KPIs of the gNB
+  std::vector<uint64_t> m_handovers; //!< UEs handed over, in order
+};
+
+EmbeddedRicTestCase::EmbeddedRicTestCase ()
+  : TestCase ("Embedded xApps receive the KPI tables and apply their controls in-process")
+{
+}
+
+EmbeddedRicTestCase::~EmbeddedRicTestCase ()
+{
+}
+
+Ptr<const KpiTable>
+EmbeddedRicTestCase::GetUeKpis ()
+{
+  return m_table;
+}
+
+void
+EmbeddedRicTestCase::ApplyHandovers (const std::vector<Ptr<RicControlMessage>> &controls)
+{
+  for (const Ptr<RicControlMessage> &control : controls)
+    {
+      NS_TEST_ASSERT_MSG_EQ (control->IsLocal (), true, "Control not built by the xApp");
+      NS_TEST_ASSERT_MSG_EQ (control->GetTargetCell (), 2, "Wrong target cell");
+      m_handovers.push_back (control->GetUeId ());
+    }
+}
+
+void
+EmbeddedRicTestCase::DoRun (void)
+{
+  m_table = Create<KpiTable> (KpmMetricRegistry::Get ().GetSchema (KpmMetricRegistry::UE_GNB));
+  m_table->AppendRow ("11");
+  m_table->AppendRow ("12");
+
+  Ptr<E2Termination> termination =
+      CreateObject<E2Termination> ("127.0.0.1", 36422, 38472, "1", "111");
+  termination->RegisterControlHandler (
+      300, 3, 1, MakeCallback (&EmbeddedRicTestCase::ApplyHandovers, this));
+  Ptr<E2ReportScheduler> scheduler = CreateObject<E2ReportScheduler> ();
+  scheduler->SetUeKpiCallback (MakeCallback (&EmbeddedRicTestCase::GetUeKpis, this));
+  termination->SetReportScheduler (scheduler);
+
+  Ptr<HandoverEmbeddedRic> ric = CreateObject<HandoverEmbeddedRic> ();
+  ric->SetAttribute ("ReportingPeriod", TimeValue (MilliSeconds (50)));
+  termination->SetEmbeddedRic (ric);
+
+  // ticks at 50, 100, 150 and 200 ms
+  Simulator::Stop (MilliSeconds (220));
+  Simulator::Run ();
+
+  NS_TEST_EXPECT_MSG_EQ (ric->m_indications, 4, "One indication per tick expected");
+  NS_TEST_EXPECT_MSG_EQ (ric->m_rows, 8, "UE table not passed to the xApp");
+  NS_TEST_ASSERT_MSG_EQ (m_handovers.size (), 4, "One control per indication expected");
+  NS_TEST_EXPECT_MSG_EQ (m_handovers[0], 11, "Control applied to the wrong UE");
+
+  // a detached xApp does not receive indications anymore
+  termination->SetEmbeddedRic (nullptr);
+  Simulator::Stop (MilliSeconds (100));
+  Simulator::Run ();
+  NS_TEST_EXPECT_MSG_EQ (ric->m_indications, 4, "Indication passed to a detached xApp");
+
+  termination->Dispose ();
+  Simulator::Destroy ();
+}
+
+/**
+ * Check that the indications spliced into the skeletons are the ones
+ * encoded by asn1c, for payloads with one- and two-octet lengths
+ */
+class IndicationEncoderTestCase : public TestCase
+{
+public:
+  IndicationEncoderTestCase ();
+  virtual ~IndicationEncoderTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+IndicationEncoderTestCase::IndicationEncoderTestCase ()
+  : TestCase ("RIC Indications spliced into skeletons match the asn1c encoding")
+{
+}
+
+IndicationEncoderTestCase::~IndicationEncoderTestCase ()
+{
+}
+
+void
+IndicationEncoderTestCase::DoRun (void)
+{
+  IndicationEncoder encoder;
+  std::vector<uint8_t> out (10000);
+  const std::vector<size_t> headerSizes = {1, 30, 127, 128, 500};
+  const std::vector<size_t> messageSizes = {1, 126, 127, 128, 4000, 9000};
+  uint64_t indications = 0;
+  for (uint16_t requestor : {1024, 7})
+    {
+      for (size_t headerSize : headerSizes)
+        {
+          for (size_t messageSize : messageSizes)
+            {
+              std::vector<uint8_t> header (headerSize);
+              std::vector<uint8_t> message (messageSize);
+              for (size_t i = 0; i < messageSize; i++)
+                {
+                  message[i] = i * 13 + headerSize;
+                }
+              for (size_t i = 0; i < headerSize; i++)
+                {
+                  header[i] = i + messageSize;
+                }
+              long sequenceNumber = (indications * 4099) & 0xFFFF;
+
+              E2AP_PDU_t *pdu = IndicationEncoder::BuildIndication (
+                  requestor, 3, 2, 1, sequenceNumber, header.data (), header.size (),
+                  message.data (), message.size ());
+              asn_encode_to_new_buffer_result_t res = asn_encode_to_new_buffer (
+                  nullptr, ATS_ALIGNED_BASIC_PER, &asn_DEF_E2AP_PDU, pdu);
+              ASN_STRUCT_FREE (asn_DEF_E2AP_PDU, pdu);
+              NS_TEST_ASSERT_MSG_NE (res.buffer, nullptr, "asn1c cannot encode the indication");
+              std::string expected ((char *) res.buffer, res.result.encoded);
+              free (res.buffer);
+
+              size_t size = encoder.Encode (requestor, 3, 2, 1, sequenceNumber, header.data (),
+                                            header.size (), message.data (), message.size (),
+                                            out.data (), out.size ());
+              NS_TEST_EXPECT_MSG_EQ (std::string ((const char *) out.data (), size), expected,
+                                     "Wrong indication with a header of "
+                                         << headerSize << " bytes and a message of "
+                                         << messageSize << " bytes");
+              indications++;
+            }
+        }
+    }
+  NS_TEST_EXPECT_MSG_EQ (encoder.GetSplicedCount (), indications, "Skeletons not used");
+
+  // an indication larger than the buffer is left to asn1c
+  std::vector<uint8_t> message (out.size ());
+  NS_TEST_EXPECT_MSG_EQ (encoder.Encode (7, 3, 2, 1, 0, message.data (), 1, message.data (),
+                                         message.size (), out.data (), out.size ()),
+                         0, "Indication larger than the buffer encoded");
+}
+
+/**
+ * Check the KPI table: the conversion of the values to the type of their
+ * column, the reuse of the columns after Clear, the copy of row ranges and
+ * the Format 1 and Format 2 encodings, identical to the ones of the
+ * measurement item lists with the same values
+ */
+class KpiTableTestCase : public TestCase
+{
+public:
+  KpiTableTestCase ();
+  virtual ~KpiTableTestCase ();
+
+private:
+  virtual void DoRun (void);
+
+  /**
+  * \return true if the two messages have the same encoding
+  */
+  bool SameEncoding (Ptr<KpmIndicationMessage> a, Ptr<KpmIndicationMessage> b);
+};
+
+KpiTableTestCase::KpiTableTestCase ()
+  : TestCase ("KPI table stores, copies and encodes the KPIs as the measurement items")
+{
+}
+
+KpiTableTestCase::~KpiTableTestCase ()
+{
+}
+
+bool
+KpiTableTestCase::SameEncoding (Ptr<KpmIndicationMessage> a, Ptr<KpmIndicationMessage> b)
+{
+  KpmEncodeBuffer::Span spanA = a->GetSpan ();
+  KpmEncodeBuffer::Span spanB = b->GetSpan ();
+  return spanA.size > 0 && spanA.size == spanB.size &&
+         memcmp (spanA.data, spanB.data, spanA.size) == 0;
+}
+
+void
+KpiTableTestCase::DoRun (void)
+{
+  Ptr<KpiSchema> schema = Create<KpiSchema> ();
+  uint32_t prb = schema->AddMetric ("RRU.PrbUsedDl", KpiSchema::Type::INTEGER);
+  uint32_t thp = schema->AddMetric ("DRB.UEThpDl", KpiSchema::Type::REAL);
+  NS_TEST_EXPECT_MSG_EQ (schema->FindMetric ("DRB.UEThpDl"), (int32_t) thp, "Metric not found");
+  NS_TEST_EXPECT_MSG_EQ (schema->FindMetric ("DRB.UEThpUl"), -1, "Unknown metric found");
+
+  // values converted to the type of their column
+  Ptr<KpiTable> table = Create<KpiTable> (schema);
+  table->AppendRow ("cell").Put (2.7).Put (3);
+  NS_TEST_EXPECT_MSG_EQ (table->GetIntegerValue (prb, 0), 2, "Real not truncated");
+  NS_TEST_EXPECT_MSG_EQ (table->GetRealColumn (thp)[0], 3.0, "Integer not converted");
+  table->SetReal (prb, 0, 41.9);
+  table->SetInteger (thp, 0, 7);
+  NS_TEST_EXPECT_MSG_EQ (table->GetValue (prb, 0), 41.0, "Wrong integer value");
+  NS_TEST_EXPECT_MSG_EQ (table->GetValue (thp, 0), 7.0, "Wrong real value");
+
+  // Clear keeps the columns: refilling them does not move them
+  const uint32_t rowCount = 64;
+  table->Clear ();
+  for (uint32_t r = 0; r < rowCount; r++)
+    {
+      table->AppendRow (std::to_string (r)).Put (r).Put (r * 0.5);
+    }
+  const int64_t *integers = table->GetIntegerColumn (prb);
+  const double *reals = table->GetRealColumn (thp);
+  table->Clear ();
+  NS_TEST_EXPECT_MSG_EQ (table->GetRowCount (), 0, "Rows left after Clear");
+  for (uint32_t r = 0; r < rowCount; r++)
+    {
+      table->AppendRow (std::to_string (r)).Put (r).Put (r * 0.5);
+    }
+  NS_TEST_EXPECT_MSG_EQ (table->GetIntegerColumn (prb), integers, "Integer column reallocated");
+  NS_TEST_EXPECT_MSG_EQ (table->GetRealColumn (thp), reals, "Real column reallocated");
+  NS_TEST_EXPECT_MSG_EQ (table->GetIntegerValue (prb, 5), 5, "Wrong value after Clear");
+
+  // copy of a range of rows, clamped to the rows of the table
+  Ptr<KpiTable> copy = table->Copy (schema, 10, 3);
+  NS_TEST_ASSERT_MSG_EQ (copy->GetRowCount (), 3, "Wrong rows in the copy");
+  for (uint32_t r = 0; r < 3; r++)
+    {
+      NS_TEST_EXPECT_MSG_EQ (copy->GetRowId (r), std::to_string (10 + r), "Wrong row ID");
+      NS_TEST_EXPECT_MSG_EQ (copy->GetIntegerValue (prb, r), 10 + r, "Wrong integer copied");
+      NS_TEST_EXPECT_MSG_EQ (copy->GetValue (thp, r), (10 + r) * 0.5, "Wrong real copied");
+    }
+  NS_TEST_EXPECT_MSG_EQ (table->Copy (schema, rowCount - 2, 10)->GetRowCount (), 2,
+                         "Copy not clamped to the table");
+  NS_TEST_EXPECT_MSG_EQ (table->Copy (schema)->GetRowCount (), rowCount, "Table not copied");
+
+  // Format 1: INTEGER and REAL records, as AddItem<long> and AddItem<double>
+  KpmIndicationMessage::KpmIndicationMessageValues tableValues;
+  tableValues.m_cellObjectId = "NRCellCU";
+  tableValues.m_cellTable = Create<KpiTable> (schema);
+  tableValues.m_cellTable->AppendRow ("1").Put ((int64_t) 273).Put (1234.5);
+  KpmIndicationMessage::KpmIndicationMessageValues itemValues;
+  itemValues.m_cellObjectId = "NRCellCU";
+  itemValues.m_cellMeasurementItems = Create<MeasurementItemList> ();
+  itemValues.m_cellMeasurementItems->AddItem<long> ("RRU.PrbUsedDl", 273);
+  itemValues.m_cellMeasurementItems->AddItem<double> ("DRB.UEThpDl", 1234.5);
+  for (bool useMeasDataEncoder : {true, false})
+    {
+      tableValues.m_useMeasDataEncoder = useMeasDataEncoder;
+      NS_TEST_EXPECT_MSG_EQ (
+          SameEncoding (Create<KpmIndicationMessage> (tableValues,
+                                                      E2SM_KPM_INDICATION_MESSAGE_FORMART1),
+                        Create<KpmIndicationMessage> (itemValues,
+                                                      E2SM_KPM_INDICATION_MESSAGE_FORMART1)),
+          true, "Format 1 of the table differs from the one of the items");
+    }
+
+  // Format 2: REAL records, metric-major, in the order of the UEs of the items
+  tableValues.m_ueTable = Create<KpiTable> (schema);
+  for (uint32_t u = 0; u < 5; u++)
+    {
+      Ptr<MeasurementItemList> ue = Create<MeasurementItemList> (std::to_string (1000 + u));
+      ue->AddItem<double> ("RRU.PrbUsedDl", 10.0 * u);
+      ue->AddItem<double> ("DRB.UEThpDl", 0.25 * u + 1);
+      itemValues.m_ueIndications.insert (ue);
+    }
+  for (const Ptr<MeasurementItemList> &ue : itemValues.m_ueIndications)
+    {
+      std::vector<Ptr<MeasurementItem>> items = ue->GetItems ();
+      OCTET_STRING_t id = ue->GetId ();
+      tableValues.m_ueTable->AppendRow (std::string ((const char *) id.buf, id.size))
+          .Put ((int64_t) items[0]->GetRealValue ())
+          .Put (items[1]->GetRealValue ());
+    }
+  for (bool useMeasDataEncoder : {true, false})
+    {
+      tableValues.m_useMeasDataEncoder = useMeasDataEncoder;
+      NS_TEST_EXPECT_MSG_EQ (
+          SameEncoding (Create<KpmIndicationMessage> (tableValues,
+                                                      E2SM_KPM_INDICATION_MESSAGE_FORMART2),
+                        Create<KpmIndicationMessage> (itemValues,
+                                                      E2SM_KPM_INDICATION_MESSAGE_FORMART2)),
+          true, "Format 2 of the table differs from the one of the items");
+    }
+}
+
+/**
+ * Check that a helper restricted to the metrics of a RIC subscription
+ * pulls only the subscribed metrics from its providers, and encodes only
+ * them in the UE reports
+ */
+class IndicationHelperSubscriptionTestCase : public TestCase
+{
+public:
+  IndicationHelperSubscriptionTestCase ();
+  virtual ~IndicationHelperSubscriptionTestCase ();
+
+private:
+  virtual void DoRun (void);
+
+  double GetThroughput (const std::string &imsi);
+  double GetPrbs (const std::string &imsi);
+
+  uint32_t m_throughputCalls; //!< evaluations of the throughput provider
+  uint32_t m_prbCalls; //!< evaluations of the PRB provider
+};
+
+IndicationHelperSubscriptionTestCase::IndicationHelperSubscriptionTestCase ()
+  : TestCase ("Indication helper computes and reports only the subscribed metrics"),
+    m_throughputCalls (0),
+    m_prbCalls (0)
+{
+}
+
+IndicationHelperSubscriptionTestCase::~IndicationHelperSubscriptionTestCase ()
+{
+}
+
+double
+IndicationHelperSubscriptionTestCase::GetThroughput (const std::string &imsi)
+{
+  m_throughputCalls++;
+  return 12.5;
+}
+
+double
+IndicationHelperSubscriptionTestCase::GetPrbs (const std::string &imsi)
+{
+  m_prbCalls++;
+  return 7;
+}
+
+void
+IndicationHelperSubscriptionTestCase::DoRun (void)
+{
+  Ptr<NrIndicationMessageHelper> helper = CreateObject<NrIndicationMessageHelper> (
+      IndicationMessageHelper::IndicationMessageType::gNB, false, false);
+  helper->RegisterUeMetricProvider (
+      "DRB.UEThpDl.UEID",
+      MakeCallback (&IndicationHelperSubscriptionTestCase::GetThroughput, this));
+  helper->RegisterUeMetricProvider (
+      "RRU.PrbUsedDl.UEID", MakeCallback (&IndicationHelperSubscriptionTestCase::GetPrbs, this));
+
+  E2Termination::RicSubscriptionRequest_rval_s subscription {};
+  subscription.measNames = {"DRB.UEThpDl.UEID", "UEID"};
+  subscription.granularityPeriod = 250;
+  helper->SetSubscription (subscription);
+  NS_TEST_EXPECT_MSG_EQ (helper->IsSubscribed ("DRB.UEThpDl.UEID"), true, "Metric not subscribed");
+  NS_TEST_EXPECT_MSG_EQ (helper->IsSubscribed ("RRU.PrbUsedDl.UEID"), false,
+                         "Metric out of the subscription subscribed");
+
+  const uint32_t ueCount = 3;
+  for (uint32_t u = 0; u < ueCount; u++)
+    {
+      helper->AddUeFromProviders (std::to_string (111000000000001ULL + u));
+    }
+  NS_TEST_EXPECT_MSG_EQ (m_throughputCalls, ueCount, "Subscribed metric not computed");
+  NS_TEST_EXPECT_MSG_EQ (m_prbCalls, 0, "Metric out of the subscription computed");
+
+  std::vector<Ptr<KpmIndicationMessage>> pages = helper->CreateUeIndicationMessages ();
+  NS_TEST_ASSERT_MSG_EQ (pages.size (), 1, "Wrong number of UE reports");
+  E2SM_KPM_IndicationMessage_t *decoded = nullptr;
+  asn_dec_rval_t rval =
+      asn_decode (nullptr, ATS_ALIGNED_BASIC_PER, &asn_DEF_E2SM_KPM_IndicationMessage,
+                  (void **) &decoded, pages[0]->GetSpan ().data, pages[0]->GetSpan ().size);
+  NS_TEST_ASSERT_MSG_EQ (rval.code, RC_OK, "Cannot decode the UE report");
+  E2SM_KPM_IndicationMessage_Format2_t *fmt2 =
+      decoded->indicationMessage_formats.choice.indicationMessage_Format2;
+  std::vector<std::string> names;
+  for (int i = 0; i < fmt2->measCondUEidList.list.count; i++)
+    {
+      const MeasurementType_t &type = fmt2->measCondUEidList.list.array[i]->measType;
+      names.push_back (type.present == MeasurementType_PR_measName
+                           ? std::string ((const char *) type.choice.measName.buf,
+                                          type.choice.measName.size)
+                           : std::string ());
+    }
+  const auto &records = fmt2->measData.list.array[0]->measRecord.list;
+  NS_TEST_EXPECT_MSG_EQ (names.size (), 2, "Metrics out of the subscription encoded");
+  NS_TEST_EXPECT_MSG_EQ (names[0], "UEID", "Wrong first metric");
+  NS_TEST_EXPECT_MSG_EQ (names[1], "DRB.UEThpDl.UEID", "Wrong second metric");
+  NS_TEST_EXPECT_MSG_EQ (records.count, 2 * ueCount, "Wrong number of records");
+  NS_TEST_EXPECT_MSG_EQ (records.array[0]->choice.real, 111000000000001.0, "Wrong UE ID");
+  NS_TEST_EXPECT_MSG_EQ (records.array[ueCount]->choice.real, 12.5, "Wrong throughput");
+  NS_TEST_EXPECT_MSG_EQ (*fmt2->granulPeriod, 250, "Granularity period of the subscription lost");
+  ASN_STRUCT_FREE (asn_DEF_E2SM_KPM_IndicationMessage, decoded);
+
+  // without subscription all the providers are evaluated again
+  helper->ClearSubscription ();
+  helper->AddUeFromProviders ("111000000000009");
+  NS_TEST_EXPECT_MSG_EQ (m_prbCalls, 1, "Provider not evaluated without subscription");
+}
+
+/**
+ * Check that the indication helper builds the reports of a subscription
+ * from its providers, and reports the subscriptions of a termination with
+ * no report callback of the user
+ */
+class IndicationHelperReportTestCase : public TestCase
+{
+public:
+  IndicationHelperReportTestCase ();
+  virtual ~IndicationHelperReportTestCase ();
+
+private:
+  virtual void DoRun (void);
+
+  double GetThroughput (const std::string &imsi);
+  double GetPrbs ();
+  std::vector<std::string> GetUes ();
+
+  /**
+  * \return the decoded format of a report
+  */
+  static int GetFormat (Ptr<KpmIndicationMessage> message);
+};
+
+IndicationHelperReportTestCase::IndicationHelperReportTestCase ()
+  : TestCase ("Indication helper reports the subscriptions from its providers")
+{
+}
+
+IndicationHelperReportTestCase::~IndicationHelperReportTestCase ()
+{
+}
+
+double
+IndicationHelperReportTestCase::GetThroughput (const std::string &imsi)
+{
+  return 12.5;
+}
+
+double
+IndicationHelperReportTestCase::GetPrbs ()
+{
+  return 7;
+}
+
+std::vector<std::string>
+IndicationHelperReportTestCase::GetUes ()
+{
+  return {"111000000000001", "111000000000002"};
+}
+
+int
+IndicationHelperReportTestCase::GetFormat (Ptr<KpmIndicationMessage> message)
+{
+  E2SM_KPM_IndicationMessage_t *decoded = nullptr;
+  asn_dec_rval_t rval =
+      asn_decode (nullptr, ATS_ALIGNED_BASIC_PER, &asn_DEF_E2SM_KPM_IndicationMessage,
+                  (void **) &decoded, message->GetSpan ().data, message->GetSpan ().size);
+  int format = rval.code == RC_OK ? decoded->indicationMessage_formats.present : -1;
+  ASN_STRUCT_FREE (asn_DEF_E2SM_KPM_IndicationMessage, decoded);
+  return format;
+}
+
+void
+IndicationHelperReportTestCase::DoRun (void)
+{
+  Ptr<NrIndicationMessageHelper> helper = CreateObject<NrIndicationMessageHelper> (
+      IndicationMessageHelper::IndicationMessageType::gNB, false, false);
+  E2Termination::RicSubscriptionRequest_rval_s subscription {};
+  subscription.requestorId = 1024;
+  subscription.instanceId = 1;
+  subscription.ranFuncionId = 2;
+  subscription.actionId = 1;
+  subscription.reportingPeriod = 100;
+  subscription.ricStyleType = -1;
+  NS_TEST_EXPECT_MSG_EQ (helper->BuildReports (subscription).size (), 0,
+                         "Report built without provider");
+
+  helper->RegisterUeMetricProvider (
+      "DRB.UEThpDl.UEID", MakeCallback (&IndicationHelperReportTestCase::GetThroughput, this));
+  helper->RegisterCellMetricProvider (
+      "RRU.PrbUsedDl", MakeCallback (&IndicationHelperReportTestCase::GetPrbs, this));
+  helper->SetUeListProvider (MakeCallback (&IndicationHelperReportTestCase::GetUes, this));
+
+  // without action definition, the cell report and the UE report
+  std::vector<E2ReportScheduler::Report> reports = helper->BuildReports (subscription);
+  NS_TEST_ASSERT_MSG_EQ (reports.size (), 2, "Cell and UE reports expected");
+  NS_TEST_EXPECT_MSG_EQ (
+      GetFormat (reports[0].message),
+      E2SM_KPM_IndicationMessage__indicationMessage_formats_PR_indicationMessage_Format1,
+      "Cell report not in Format 1");
+  NS_TEST_EXPECT_MSG_EQ (
+      GetFormat (reports[1].message),
+      E2SM_KPM_IndicationMessage__indicationMessage_formats_PR_indicationMessage_Format2,
+      "UE report not in Format 2");
+
+  // E2 node measurements only
+  subscription.ricStyleType = 1;
+  subscription.measNames = {"RRU.PrbUsedDl"};
+  reports = helper->BuildReports (subscription);
+  NS_TEST_ASSERT_MSG_EQ (reports.size (), 1, "Only the cell report expected");
+  NS_TEST_EXPECT_MSG_EQ (
+      GetFormat (reports[0].message),
+      E2SM_KPM_IndicationMessage__indicationMessage_formats_PR_indicationMessage_Format1,
+      "Cell report not in Format 1");
+
+  // UE measurements only, the UEs of the previous report are not repeated
+  subscription.ricStyleType = 4;
+  subscription.measNames = {"UEID", "DRB.UEThpDl.UEID"};
+  helper->BuildReports (subscription);
+  reports = helper->BuildReports (subscription);
+  NS_TEST_ASSERT_MSG_EQ (reports.size (), 1, "Only the UE report expected");
+  E2SM_KPM_IndicationMessage_t *decoded = nullptr;
+  asn_dec_rval_t rval = asn_decode (
+      nullptr, ATS_ALIGNED_BASIC_PER, &asn_DEF_E2SM_KPM_IndicationMessage, (void **) &decoded,
+      reports[0].message->GetSpan ().data, reports[0].message->GetSpan ().size);
+  NS_TEST_ASSERT_MSG_EQ (rval.code, RC_OK, "Cannot decode the UE report");
+  const auto &records = decoded->indicationMessage_formats.choice.indicationMessage_Format2
+                            ->measData.list.array[0]
+                            ->measRecord.list;
+  NS_TEST_EXPECT_MSG_EQ (records.count, 4, "Wrong number of records");
+  NS_TEST_EXPECT_MSG_EQ (records.array[2]->choice.real, 12.5, "Wrong throughput");
+  ASN_STRUCT_FREE (asn_DEF_E2SM_KPM_IndicationMessage, decoded);
+
+  // a termination reports its subscriptions through the helper
+  int sockets[2];
+  NS_TEST_ASSERT_MSG_EQ (socketpair (AF_UNIX, SOCK_SEQPACKET, 0, sockets), 0,
+                         "Cannot create the socket pair");
+  Ptr<E2Termination> termination =
+      CreateObject<E2Termination> ("127.0.0.1", 36422, 38472, "1", "111");
+  termination->SetE2Socket (sockets[0]);
+  helper->InstallReports (termination, 1);
+  NS_TEST_ASSERT_MSG_NE (termination->GetReportScheduler () == nullptr, true,
+                         "No report scheduler set on the termination");
+  termination->Start ();
+  termination->GetReportScheduler ()->AddSubscription (subscription);
+  Simulator::Stop (MilliSeconds (250));
+  Simulator::Run ();
+  termination->Flush ();
+
+  std::vector<uint8_t> buffer (65536);
+  uint32_t indications = 0;
+  ssize_t size;
+  while ((size = recv (sockets[1], buffer.data (), buffer.size (), MSG_DONTWAIT)) > 0)
+    {
+      indications += size >= 2 && buffer[0] == 0 && buffer[1] == ProcedureCode_id_RICindication;
+    }
+  NS_TEST_EXPECT_MSG_EQ (indications, 2, "One UE report per reporting period expected");
+
+  termination->Dispose ();
+  close (sockets[1]);
+  Simulator::Destroy ();
+}
+
+/**
+ * Check that the Format 2 pages stay within their budgets and carry all
+ * the UEs of the report, in order
+ */
+class Format2PaginationTestCase : public TestCase
+{
+public:
+  Format2PaginationTestCase ();
+  virtual ~Format2PaginationTestCase ();
+
+private:
+  virtual void DoRun (void);
+
+  /**
+  * \return the number of records of a Format 2 page
+  */
+  int CountRecords (Ptr<KpmIndicationMessage> page);
+};
+
+Format2PaginationTestCase::Format2PaginationTestCase ()
+  : TestCase ("Format 2 UE reports are split into pages within their budgets")
+{
+}
+
+Format2PaginationTestCase::~Format2PaginationTestCase ()
+{
+}
+
+int
+Format2PaginationTestCase::CountRecords (Ptr<KpmIndicationMessage> page)
+{
+  E2SM_KPM_IndicationMessage_t *decoded = nullptr;
+  asn_dec_rval_t rval =
+      asn_decode (nullptr, ATS_ALIGNED_BASIC_PER, &asn_DEF_E2SM_KPM_IndicationMessage,
+                  (void **) &decoded, page->GetSpan ().data, page->GetSpan ().size);
+  NS_TEST_ASSERT_MSG_EQ_RETURNS_VALUE (rval.code, RC_OK, "Cannot decode a Format 2 page", -1);
+  int records = decoded->indicationMessage_formats.choice.indicationMessage_Format2->measData
+                    .list.array[0]
+                    ->measRecord.list.count;
+  ASN_STRUCT_FREE (asn_DEF_E2SM_KPM_IndicationMessage, decoded);
+  return records;
+}
+
+void
+Format2PaginationTestCase::DoRun (void)
+{
+  Ptr<const KpiSchema> schema = KpmMetricRegistry::Get ().GetSchema (KpmMetricRegistry::UE_GNB);
+  KpmIndicationMessage::KpmIndicationMessageValues values;
+  values.m_ueTable = Create<KpiTable> (schema);
+  const uint32_t ueCount = 300;
+  for (uint32_t u = 0; u < ueCount; u++)
+    {
+      uint32_t row = values.m_ueTable->AppendRow (std::to_string (1000 + u)).GetRow ();
+      for (uint32_t m = 0; m < schema->GetMetricCount (); m++)
+        {
+          values.m_ueTable->SetReal (m, row, u * 1.37 + m);
+        }
+    }
+  int metricCount = schema->GetMetricCount ();
+
+  // the estimate bounds the size of the single message
+  Ptr<KpmIndicationMessage> whole =
+      Create<KpmIndicationMessage> (values, E2SM_KPM_INDICATION_MESSAGE_FORMART2);
+  NS_TEST_EXPECT_MSG_GT_OR_EQ (KpmIndicationMessage::EstimateFormat2Size (values, 0, ueCount),
+                               whole->GetSpan ().size, "Size estimate below the encoded size");
+
+  values.m_maxFormat2Bytes = 4000;
+  std::vector<Ptr<KpmIndicationMessage>> pages = KpmIndicationMessage::CreateFormat2Pages (values);
+  NS_TEST_ASSERT_MSG_GT (pages.size (), 1, "Report not split");
+  int records = 0;
+  for (const Ptr<KpmIndicationMessage> &page : pages)
+    {
+      NS_TEST_EXPECT_MSG_LT_OR_EQ (page->GetSpan ().size, values.m_maxFormat2Bytes,
+                                   "Page larger than the byte budget");
+      records += CountRecords (page);
+    }
+  NS_TEST_EXPECT_MSG_EQ (records, ueCount * metricCount, "UEs lost across the pages");
+
+  values.m_maxFormat2Bytes = 0;
+  values.m_maxFormat2Ues = 64;
+  pages = KpmIndicationMessage::CreateFormat2Pages (values);
+  NS_TEST_ASSERT_MSG_EQ (pages.size (), 5, "Wrong number of pages for the UE budget");
+  NS_TEST_EXPECT_MSG_EQ (CountRecords (pages[0]), 64 * metricCount, "Wrong first page");
+  NS_TEST_EXPECT_MSG_EQ (CountRecords (pages[4]), (ueCount - 4 * 64) * metricCount,
+                         "Wrong last page");
+
+  values.m_ueTable = Create<KpiTable> (schema);
+  NS_TEST_EXPECT_MSG_EQ (KpmIndicationMessage::CreateFormat2Pages (values).size (), 0,
+                         "Page without UEs");
+}
+
+/**
+ * Check that the reports encoded by the encoder service are sent in the
+ * order of their submission, with consecutive SNs and the same bytes as
+ * the reports encoded in the simulator thread
+ */
+class KpmEncoderServiceTestCase : public TestCase
+{
+public:
+  KpmEncoderServiceTestCase ();
+  virtual ~KpmEncoderServiceTestCase ();
+
+private:
+  virtual void DoRun (void);
+
+  std::vector<std::shared_ptr<KpmEncodeJob>>
+  BuildJobs (const E2ReportScheduler::Subscription &subscription);
+  void SendIndication (const E2ReportScheduler::Subscription &subscription, long sequenceNumber,
+                       Ptr<KpmIndicationHeader> header, Ptr<KpmIndicationMessage> message);
+
+  std::vector<std::vector<uint8_t>> m_expected; //!< messages, in the order of the jobs
+  std::map<uint16_t, long> m_nextSn; //!< next expected SN, by RIC Instance ID
+  uint32_t m_sent; //!< indications sent
+  bool m_ordered; //!< false if a message or a SN was out of order
+};
+
+KpmEncoderServiceTestCase::KpmEncoderServiceTestCase ()
+  : TestCase ("KPM encoder service keeps the order and the bytes of the reports"),
+    m_sent (0),
+    m_ordered (true)
+{
+}
+
+KpmEncoderServiceTestCase::~KpmEncoderServiceTestCase ()
+{
+}
+
+std::vector<std::shared_ptr<KpmEncodeJob>>
+KpmEncoderServiceTestCase::BuildJobs (const E2ReportScheduler::Subscription &subscription)
+{
+  KpmIndicationHeader::KpmRicIndicationHeaderValues headerValues;
+  headerValues.m_plmId = "111";
+  headerValues.m_gnbId = "1";
+  headerValues.m_nrCellId = 1;
+  headerValues.m_timestamp = 1630068679000000ULL;
+
+  // several cells per subscription, each with values unique to its job
+  std::vector<std::shared_ptr<KpmEncodeJob>> jobs;
+  for (uint16_t cellId = 1; cellId <= 3; cellId++)
+    {
+      uint32_t job = m_expected.size ();
+      KpmIndicationMessage::KpmIndicationMessageValues msgValues;
+      msgValues.m_cellTable =
+          Create<KpiTable> (KpmMetricRegistry::Get ().GetSchema (KpmMetricRegistry::CELL_LTE));
+      msgValues.m_cellTable->AppendRow (std::to_string (cellId))
+          .Put (job)
+          .Put (job * 0.25)
+          .Put (100 + job)
+          .Put (200 + job)
+          .Put (cellId);
+      msgValues.m_granularityPeriod = subscription.granularityPeriod;
+
+      Ptr<KpmIndicationMessage> message =
+          Create<KpmIndicationMessage> (msgValues, E2SM_KPM_INDICATION_MESSAGE_FORMART1);
+      KpmEncodeBuffer::Span encoded = message->GetSpan ();
+      m_expected.emplace_back (encoded.data, encoded.data + encoded.size);
+      jobs.push_back (std::make_shared<KpmEncodeJob> (
+          KpmIndicationHeader::GlobalE2nodeType::eNB, headerValues, msgValues,
+          E2SM_KPM_INDICATION_MESSAGE_FORMART1));
+    }
+  return jobs;
+}
+
+void
+KpmEncoderServiceTestCase::SendIndication (const E2ReportScheduler::Subscription &subscription,
+                                           long sequenceNumber, Ptr<KpmIndicationHeader> header,
+                                           Ptr<KpmIndicationMessage> message)
+{
+  m_ordered = m_ordered && sequenceNumber == m_nextSn[subscription.instanceId]++;
+  KpmEncodeBuffer::Span encoded = message->GetSpan ();
+  m_ordered = m_ordered && m_sent < m_expected.size () &&
+              encoded.size == m_expected[m_sent].size () &&
+              memcmp (encoded.data, m_expected[m_sent].data (), encoded.size) == 0;
+  m_sent++;
+}
+
+void
+KpmEncoderServiceTestCase::DoRun (void)
+{
+  Ptr<KpmEncoderService> service = CreateObject<KpmEncoderService> ();
+  service->SetAttribute ("Workers", UintegerValue (4));
+
+  Ptr<E2ReportScheduler> scheduler = CreateObject<E2ReportScheduler> ();
+  scheduler->SetIndicationCallback (
+      MakeCallback (&KpmEncoderServiceTestCase::SendIndication, this));
+  scheduler->SetEncoderService (service,
+                                MakeCallback (&KpmEncoderServiceTestCase::BuildJobs, this));
+
+  E2ReportScheduler::Subscription subscription {};
+  subscription.ranFuncionId = 200;
+  subscription.requestorId = 1;
+  for (uint16_t instanceId : {1, 2, 3})
+    {
+      subscription.instanceId = instanceId;
+      subscription.reportingPeriod = instanceId == 3 ? 200 : 100;
+      scheduler->AddSubscription (subscription);
+    }
+
+  Simulator::Stop (MilliSeconds (1050));
+  Simulator::Run ();
+  scheduler->FlushEncoded ();
+
+  NS_TEST_ASSERT_MSG_EQ (service->GetWorkerCount (), 4, "Wrong number of workers");
+  NS_TEST_ASSERT_MSG_EQ (m_expected.size (), 3 * (10 + 10 + 5), "One job per cell and tick");
+  NS_TEST_ASSERT_MSG_EQ (m_sent, m_expected.size (), "Encoded reports not sent");
+  NS_TEST_ASSERT_MSG_EQ (m_ordered, true, "Reports out of order or different from the sync ones");
+
+  scheduler->Dispose ();
+  service->Dispose ();
+  Simulator::Destroy ();
+}
+
+/**
+ * Check that the messages encoded in the buffers of the thread match the
+ * asn1c encoding to a new buffer, and that the buffers are presized and
+ * reused across the messages
+ */
+class KpmEncodeBufferTestCase : public TestCase
+{
+public:
+  KpmEncodeBufferTestCase ();
+  virtual ~KpmEncodeBufferTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+KpmEncodeBufferTestCase::KpmEncodeBufferTestCase ()
+  : TestCase ("KPM messages are encoded in reusable buffers of the thread")
+{
+}
+
+KpmEncodeBufferTestCase::~KpmEncodeBufferTestCase ()
+{
+}
+
+void
+KpmEncodeBufferTestCase::DoRun (void)
+{
+  Ptr<const KpiSchema> schema = KpmMetricRegistry::Get ().GetSchema (KpmMetricRegistry::UE_GNB);
+  KpmIndicationMessage::KpmIndicationMessageValues values;
+  values.m_ueTable = Create<KpiTable> (schema);
+  const uint32_t ueCount = 100;
+  for (uint32_t u = 0; u < ueCount; u++)
+    {
+      uint32_t row = values.m_ueTable->AppendRow (std::to_string (1000 + u)).GetRow ();
+      for (uint32_t m = 0; m < schema->GetMetricCount (); m++)
+        {
+          values.m_ueTable->SetReal (m, row, u * 2.71 + m);
+        }
+    }
+  // the whole message goes through the buffers of the thread
+  values.m_useMeasDataEncoder = false;
+
+  KpmEncodeBuffer &buffer = KpmEncodeBuffer::GetThreadBuffer ();
+  uint64_t sizeKey = ((uint64_t) E2SM_KPM_INDICATION_MESSAGE_FORMART2 << 32) | ueCount;
+  KpmEncodeBuffer::Stats before = buffer.GetStats ();
+
+  Ptr<KpmIndicationMessage> message =
+      Create<KpmIndicationMessage> (values, E2SM_KPM_INDICATION_MESSAGE_FORMART2);
+  KpmEncodeBuffer::Span encoded = message->GetSpan ();
+  std::vector<uint8_t> first (encoded.data, encoded.data + encoded.size);
+  KpmEncodeBuffer::Stats afterFirst = buffer.GetStats ();
+  NS_TEST_ASSERT_MSG_GT (first.size (), 0, "Message not encoded");
+  NS_TEST_EXPECT_MSG_EQ (buffer.GetHighWaterMark (sizeKey), first.size (),
+                         "Wrong high-water mark of the key");
+
+  // the buffer of the first message serves the second one, presized
+  message = nullptr;
+  message = Create<KpmIndicationMessage> (values, E2SM_KPM_INDICATION_MESSAGE_FORMART2);
+  encoded = message->GetSpan ();
+  KpmEncodeBuffer::Stats afterSecond = buffer.GetStats ();
+  NS_TEST_EXPECT_MSG_EQ (afterSecond.encoded - before.encoded, 2, "Wrong number of encodings");
+  NS_TEST_EXPECT_MSG_EQ (afterSecond.reused - afterFirst.reused, 1, "Buffer not reused");
+  NS_TEST_EXPECT_MSG_EQ (afterSecond.retried, afterFirst.retried,
+                         "Encoding retried despite the size prediction");
+  NS_TEST_ASSERT_MSG_EQ (encoded.size, first.size (), "Message sizes differ");
+  NS_TEST_EXPECT_MSG_EQ (memcmp (encoded.data, first.data (), encoded.size), 0,
+                         "Message bytes differ");
+
+  // same bytes as the encoding of asn1c to a new buffer
+  E2SM_KPM_IndicationMessage_t *decoded = nullptr;
+  asn_dec_rval_t rval =
+      asn_decode (nullptr, ATS_ALIGNED_BASIC_PER, &asn_DEF_E2SM_KPM_IndicationMessage,
+                  (void **) &decoded, encoded.data, encoded.size);
+  NS_TEST_ASSERT_MSG_EQ (rval.code, RC_OK, "Cannot decode the message");
+  asn_encode_to_new_buffer_result_s reference = asn_encode_to_new_buffer (
+      nullptr, ATS_ALIGNED_BASIC_PER, &asn_DEF_E2SM_KPM_IndicationMessage, decoded);
+  ASN_STRUCT_FREE (asn_DEF_E2SM_KPM_IndicationMessage, decoded);
+  NS_TEST_ASSERT_MSG_EQ ((size_t) reference.result.encoded, encoded.size,
+                         "Size differs from the asn1c encoding");
+  NS_TEST_EXPECT_MSG_EQ (memcmp (reference.buffer, encoded.data, encoded.size), 0,
+                         "Bytes differ from the asn1c encoding");
+  free (reference.buffer);
+}
+
+/**
+ * Check that the messages whose records are written by the measurement
+ * data encoder are bit-exact with the ones encoded by asn1c
+ */
+class KpmMeasDataEncoderTestCase : public TestCase
+{
+public:
+  KpmMeasDataEncoderTestCase ();
+  virtual ~KpmMeasDataEncoderTestCase ();
+
+private:
+  virtual void DoRun (void);
+
+  /**
+  * Encode a message with and without the measurement data encoder
+  *
+  * \return true if the two encodings are identical
+  */
+  bool Compare (KpmIndicationMessage::KpmIndicationMessageValues values,
+                E2SM_KPM_IndicationMessage_FormatType format);
+};
+
+KpmMeasDataEncoderTestCase::KpmMeasDataEncoderTestCase ()
+  : TestCase ("KPM measurement data encoder matches the asn1c encoding")
+{
+}
+
+KpmMeasDataEncoderTestCase::~KpmMeasDataEncoderTestCase ()
+{
+}
+
+bool
+KpmMeasDataEncoderTestCase::Compare (KpmIndicationMessage::KpmIndicationMessageValues values,
+                                     E2SM_KPM_IndicationMessage_FormatType format)
+{
+  values.m_useMeasDataEncoder = true;
+  Ptr<KpmIndicationMessage> direct = Create<KpmIndicationMessage> (values, format);
+  values.m_useMeasDataEncoder = false;
+  Ptr<KpmIndicationMessage> generic = Create<KpmIndicationMessage> (values, format);
+  KpmEncodeBuffer::Span a = direct->GetSpan ();
+  KpmEncodeBuffer::Span b = generic->GetSpan ();
+  return a.size > 0 && a.size == b.size && memcmp (a.data, b.data, a.size) == 0;
+}
+
+void
+KpmMeasDataEncoderTestCase::DoRun (void)
+{
+  NS_TEST_ASSERT_MSG_EQ (KpmMeasDataEncoder::IsConsistent (), true,
+                         "Probe values encoded differently from asn1c");
+
+  // any bit pattern is a valid double, including NaNs, infinities and subnormals
+  std::mt19937_64 rng (12345);
+  auto randomReal = [&rng] () {
+    uint64_t bits = rng ();
+    double value;
+    memcpy (&value, &bits, sizeof (value));
+    return value;
+  };
+
+  Ptr<KpiSchema> schema = Create<KpiSchema> ();
+  schema->AddMetric ("RRU.PrbUsedDl", KpiSchema::Type::INTEGER);
+  schema->AddMetric ("DRB.UEThpDl", KpiSchema::Type::REAL);
+  schema->AddMetric ("DRB.PdcpSduVolumeDl", KpiSchema::Type::INTEGER);
+  schema->AddMetric ("DRB.RlcSduDelayDl", KpiSchema::Type::REAL);
+  const int64_t integers[] = {0, 1, 127, 128, 255, 256, 65535, 65536, 16777215, 16777216,
+                              4294967295LL};
+  uint64_t before = KpmMeasDataEncoder::GetEncodedCount ();
+
+  // Format 1: INTEGER and REAL records of a cell
+  uint32_t mismatches = 0;
+  uint32_t messages = 0;
+  for (uint32_t i = 0; i < 200; i++)
+    {
+      KpmIndicationMessage::KpmIndicationMessageValues values;
+      values.m_cellTable = Create<KpiTable> (schema);
+      values.m_cellTable->AppendRow ("1")
+          .Put (integers[i % 11])
+          .Put (randomReal ())
+          .Put ((int64_t) (rng () % 4294967296ULL))
+          .Put (i * 0.125 - 3);
+      mismatches += !Compare (values, E2SM_KPM_INDICATION_MESSAGE_FORMART1);
+      messages++;
+    }
+  NS_TEST_EXPECT_MSG_EQ (mismatches, 0, "Format 1 messages differ from asn1c");
+
+  // Format 2: REAL records of real and integer columns, whole and in pages
+  mismatches = 0;
+  for (uint32_t ueCount : {1u, 42u, 130u, 600u})
+    {
+      KpmIndicationMessage::KpmIndicationMessageValues values;
+      values.m_ueTable = Create<KpiTable> (schema);
+      for (uint32_t u = 0; u < ueCount; u++)
+        {
+          values.m_ueTable->AppendRow (std::to_string (1000 + u))
+              .Put ((int64_t) (rng () % 100000))
+              .Put (randomReal ())
+              .Put (integers[u % 11])
+              .Put ((rng () % 1000000) * 0.001);
+        }
+      mismatches += !Compare (values, E2SM_KPM_INDICATION_MESSAGE_FORMART2);
+      messages++;
+
+      values.m_maxFormat2Ues = 50;
+      for (const auto &range : KpmIndicationMessage::GetFormat2Pages (values))
+        {
+          values.m_useMeasDataEncoder = true;
+          Ptr<KpmIndicationMessage> direct =
+              Create<KpmIndicationMessage> (values, range.first, range.second);
+          values.m_useMeasDataEncoder = false;
+          Ptr<KpmIndicationMessage> generic =
+              Create<KpmIndicationMessage> (values, range.first, range.second);
+          KpmEncodeBuffer::Span a = direct->GetSpan ();
+          KpmEncodeBuffer::Span b = generic->GetSpan ();
+          mismatches += !(a.size == b.size && memcmp (a.data, b.data, a.size) == 0);
+          messages++;
+        }
+    }
+  NS_TEST_EXPECT_MSG_EQ (mismatches, 0, "Format 2 messages differ from asn1c");
+  NS_TEST_EXPECT_MSG_EQ (KpmMeasDataEncoder::GetEncodedCount () - before, messages,
+                         "Records of some messages not written by the encoder");
+
+  // too many records for a single length determinant: left to asn1c
+  KpmIndicationMessage::KpmIndicationMessageValues values;
+  values.m_ueTable = Create<KpiTable> (schema);
+  for (uint32_t u = 0; u < 5000; u++)
+    {
+      values.m_ueTable->AppendRow (std::to_string (u)).Put (u).Put (u * 0.5).Put (u).Put (1.0);
+    }
+  before = KpmMeasDataEncoder::GetEncodedCount ();
+  NS_TEST_EXPECT_MSG_EQ (Compare (values, E2SM_KPM_INDICATION_MESSAGE_FORMART2), true,
+                         "Fragmented records differ from asn1c");
+  NS_TEST_EXPECT_MSG_EQ (KpmMeasDataEncoder::GetEncodedCount (), before,
+                         "Fragmented records written by the encoder");
+}
+
 // The TestSuite class names the TestSuite, identifies what type of TestSuite,
 // and enables the TestCases to be run.  Typically, only the constructor for
 // this class must be defined
@@ -83,6 +3056,29 @@ OranInterfaceTestSuite::OranInterfaceTestSuite ()
 {
   // TestDuration for TestCase can be QUICK, EXTENSIVE or TAKES_FOREVER
   AddTestCase (new OranInterfaceTestCase1, TestCase::QUICK);
+  AddTestCase (new KpmIndicationHeaderTemplateTestCase, TestCase::QUICK);
+  AddTestCase (new KpmArenaTestCase, TestCase::QUICK);
+  AddTestCase (new E2ReportSchedulerTestCase, TestCase::QUICK);
+  AddTestCase (new E2ReceiveQueueTestCase, TestCase::QUICK);
+  AddTestCase (new E2SendQueueTestCase, TestCase::QUICK);
+  AddTestCase (new E2TerminationManagerTestCase, TestCase::QUICK);
+  AddTestCase (new RcHandoverDecoderTestCase, TestCase::QUICK);
+  AddTestCase (new AsnStructPoolTestCase, TestCase::QUICK);
+  AddTestCase (new RcMultiActionControlTestCase, TestCase::QUICK);
+  AddTestCase (new ControlCoalescerTestCase, TestCase::QUICK);
+  AddTestCase (new ControlDispatchTestCase, TestCase::QUICK);
+  AddTestCase (new LockstepTestCase, TestCase::QUICK);
+  AddTestCase (new ControlResponseEncoderTestCase, TestCase::QUICK);
+  AddTestCase (new RcPolicyTestCase, TestCase::QUICK);
+  AddTestCase (new EmbeddedRicTestCase, TestCase::QUICK);
+  AddTestCase (new IndicationEncoderTestCase, TestCase::QUICK);
+  AddTestCase (new KpiTableTestCase, TestCase::QUICK);
+  AddTestCase (new IndicationHelperSubscriptionTestCase, TestCase::QUICK);
+  AddTestCase (new IndicationHelperReportTestCase, TestCase::QUICK);
+  AddTestCase (new Format2PaginationTestCase, TestCase::QUICK);
+  AddTestCase (new KpmEncoderServiceTestCase, TestCase::QUICK);
+  AddTestCase (new KpmEncodeBufferTestCase, TestCase::QUICK);
+  AddTestCase (new KpmMeasDataEncoderTestCase, TestCase::QUICK);
 }
 
 // Do not forget to allocate an instance of this TestSuite